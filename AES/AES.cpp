@@ -1,9 +1,17 @@
 #include "AES.h"
+#include "AESProfiler.h"
+#include "AESModeEngine.h"
+#include "AESVectorPermute.h"
+#include <cstring>
+#include <cstdint>
 
 
-//set default values of Nk and Nr to AES-128
-size_t AES::Nk = 4; //number of 32-bit words in the key
-size_t AES::Nr = 10; //number of rounds (AES-128 has 10 rounds, AES-192 has 12 rounds, AES-256 has 14 rounds)
+//set default values of Nk and Nr to AES-128, each thread holds its own operation mode
+thread_local size_t AES::Nk = 4; //number of 32-bit words in the key
+thread_local size_t AES::Nr = 10; //number of rounds (AES-128 has 10 rounds, AES-192 has 12 rounds, AES-256 has 14 rounds)
+
+//the vector mode functions run on the table-based backend unless another one is selected
+atomic<AES::ModeBackend> AES::modeBackend{ AES::TableBackend };
 
 
 /**
@@ -170,6 +178,12 @@ const unsigned char AES::GaloisMult[15][256] = {
 };
 
 
+/**
+ * @brief  Round constants table for AES key schedule, index 0 is unused.
+ */
+const unsigned char AES::RCON[11] = { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+
+
 /**
  * @brief  Function that handles the operation mode of AES encryption.
  * @param  size_t keySize
@@ -361,7 +375,7 @@ unsigned char* AES::SubWord(unsigned char* word) {
  * @return  unsigned char rconValue
  */
 unsigned char AES::Rcon(unsigned char value) {
-	if (value == 0) return 0x00; //if value is 0 we return 0x00
+    if (value < sizeof(RCON)) return RCON[value]; //key schedule only needs the first ten constants so we take them from table
     unsigned char rconValue = 0x01; //initialize with 0x01 (first round constant)
     for (size_t i = 1; i < value; i++) {
         if (rconValue & 0x80) //if the leftmost bit (0x80) is set
@@ -473,8 +487,12 @@ unsigned char* AES::MixColumns(unsigned char* state, const bool inverse) {
  */
 unsigned char* AES::XOR(unsigned char* first, const unsigned char* second) {
     if (first != NULL && second != NULL) { //if both arrays not null
-        for (size_t i = 0; i < BlockSize; i++) //iterate over the arrays
-            first[i] ^= second[i]; //perform XOR on arrays elements
+        uint64_t firstWords[2], secondWords[2]; //represents arrays as two 64-bit words each
+        memcpy(firstWords, first, BlockSize); //load first array, memcpy avoids unaligned access
+        memcpy(secondWords, second, BlockSize); //load second array
+        firstWords[0] ^= secondWords[0]; //perform XOR on first half of arrays
+        firstWords[1] ^= secondWords[1]; //perform XOR on second half of arrays
+        memcpy(first, firstWords, BlockSize); //store XOR result in first array
     }
     return first; //return first array with XOR value
 }
@@ -486,6 +504,9 @@ unsigned char* AES::XOR(unsigned char* first, const unsigned char* second) {
  * @return  vector<vector<unsigned char>> roundKeys
  */
 vector<vector<unsigned char>> AES::KeySchedule(const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("KeySchedule", key.size()); //profile key expansion
+    const size_t Nk = key.size() / Nb; //number of 32-bit words in the key, derived from key so round keys don't depend on operation mode
+    const size_t Nr = Nk + 6; //number of rounds, derived from key so round keys don't depend on operation mode
     vector<vector<unsigned char>> roundKeysMatrix; //represents round keys as matrix of vectors (each represented as a vector of unsigned char)
     vector<unsigned char> roundKeysVector(BlockSize * (Nr + 1)); //represents round keys as vector
     unsigned char temp[Nb]{}; //represents temporary keyword for key schedule operations
@@ -519,6 +540,38 @@ vector<vector<unsigned char>> AES::KeySchedule(const vector<unsigned char>& key)
 }
 
 
+/**
+ * @brief  Function for generating round keys into a flat array without heap allocations, supports AES-128, AES-192 and AES-256.
+ * @brief  The array must hold (keySize / 4 + 7) round keys of 16 bytes, the round keys match KeySchedule.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* roundKeys
+ */
+void AES::KeySchedule(const unsigned char* key, const size_t keySize, unsigned char* roundKeys) {
+    AES_PROFILE_SCOPE("KeySchedule", keySize); //profile flat key expansion
+    const size_t Nk = keySize / Nb; //number of 32-bit words in the key
+    const size_t words = Nb * (Nk + 7); //number of 32-bit words in all round keys
+    unsigned char temp[Nb]{}; //represents temporary keyword for key schedule operations
+    memcpy(roundKeys, key, keySize); //add initial key to round keys
+    for (size_t i = Nk; i < words; i++) { //iterate over the words of round keys
+        memcpy(temp, roundKeys + (i - 1) * Nb, Nb); //copy the previous word to temp
+        if (i % Nk == 0) { //if we are at the beginning of a new set of Nk words, we apply RotWord, SubWord and XOR with Rcon value
+            RotWord(temp); //apply RotWord operation on current word
+            SubWord(temp); //apply SubWord operation on current word
+            temp[0] ^= Rcon((unsigned char)(i / Nk)); //XOR current word with Rcon value
+        }
+        else if (Nk > 6 && i % Nk == Nb) //for AES-256 we need to apply SubWord again half way of the generation
+            SubWord(temp); //apply the SubWord operation again for AES-256
+        uint32_t word = 0, previous = 0; //represents transformed word and word from the previous set of Nk words
+        memcpy(&word, temp, Nb); //load transformed word
+        memcpy(&previous, roundKeys + (i - Nk) * Nb, Nb); //load word from the previous set of Nk words
+        word ^= previous; //XOR both words at once
+        memcpy(roundKeys + i * Nb, &word, Nb); //store the new word
+    }
+    fill(temp, temp + Nb, 0x00); //clear temp for added security after we finish operations
+}
+
+
 /**
  * @brief  Function that performs AES encryption on given text using specified round keys, supports AES-128, AES-192 and AES-256.
  * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
@@ -528,6 +581,7 @@ vector<vector<unsigned char>> AES::KeySchedule(const vector<unsigned char>& key)
  */
 unsigned char* AES::EncryptBlock(unsigned char* text, const vector<vector<unsigned char>>& roundKeys) {
     if (text != NULL) { //if text not null
+        const size_t Nr = roundKeys.size() - 1; //number of rounds, derived from round keys so blocks can be encrypted concurrently
         //apply initial round key
         XOR(text, roundKeys[0].data()); //perform first AddRoundKey operation on text
         //apply AES operations of SubByte, ShiftRows, MixColumns and AddRoundKey
@@ -555,6 +609,7 @@ unsigned char* AES::EncryptBlock(unsigned char* text, const vector<vector<unsign
  */
 unsigned char* AES::DecryptBlock(unsigned char* text, const vector<vector<unsigned char>>& roundKeys) {
     if (text != NULL) { //if text not null
+        const size_t Nr = roundKeys.size() - 1; //number of rounds, derived from round keys so blocks can be decrypted concurrently
         //apply AES final round operations in reverse order of AddRoundKey, ShiftRows and SubBytes
         XOR(text, roundKeys[Nr].data()); //perform AddRoundKey operation on text
         ShiftRows(text, true); //perform ShiftRows operation on text
@@ -573,6 +628,75 @@ unsigned char* AES::DecryptBlock(unsigned char* text, const vector<vector<unsign
 }
 
 
+/**
+ * @brief  Function that performs AES encryption on given text using round keys stored back to back in a flat array.
+ * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
+ * @param  unsigned char* text
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ * @return  unsigned char* cipherText
+ */
+unsigned char* AES::EncryptBlock(unsigned char* text, const unsigned char* roundKeys, const size_t rounds) {
+    if (text != NULL && roundKeys != NULL) { //if text and round keys not null
+        XOR(text, roundKeys); //perform first AddRoundKey operation on text
+        for (size_t i = 1; i < rounds; i++) { //iterate over roundKeys and apply AES operations
+            SubBytes(text, false); //perform SubBytes operation on text
+            ShiftRows(text, false); //perform ShiftRows operation on text
+            MixColumns(text, false); //perform MixColumns operation on text
+            XOR(text, roundKeys + i * BlockSize); //perform AddRoundKey operation on text
+        }
+        SubBytes(text, false); //perform SubBytes operation on text
+        ShiftRows(text, false); //perform ShiftRows operation on text
+        XOR(text, roundKeys + rounds * BlockSize); //perform AddRoundKey operation on text
+    }
+    return text; //return ciphered text
+}
+
+
+/**
+ * @brief  Function that performs AES decryption on given text using round keys stored back to back in a flat array.
+ * @brief  This function performs AES decryption with fixed block size of 16 bytes (128-bit).
+ * @param  unsigned char* text
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ * @return  unsigned char* decipherText
+ */
+unsigned char* AES::DecryptBlock(unsigned char* text, const unsigned char* roundKeys, const size_t rounds) {
+    if (text != NULL && roundKeys != NULL) { //if text and round keys not null
+        XOR(text, roundKeys + rounds * BlockSize); //perform AddRoundKey operation on text
+        ShiftRows(text, true); //perform ShiftRows operation on text
+        SubBytes(text, true); //perform SubBytes operation on text
+        for (size_t i = rounds - 1; i >= 1; i--) { //iterate over roundKeys in reverse order and apply AES operations
+            XOR(text, roundKeys + i * BlockSize); //perform AddRoundKey operation on text
+            MixColumns(text, true); //perform MixColumns operation on text
+            ShiftRows(text, true); //perform ShiftRows operation on text
+            SubBytes(text, true); //perform SubBytes operation on text
+        }
+        XOR(text, roundKeys); //perform AddRoundKey operation on text
+    }
+    return text; //return deciphered text
+}
+
+
+/**
+ * @brief  Function that selects the block backend of Encrypt_ECB through Decrypt_CTR, the table-based backend is the default.
+ * @brief  The vector permute backend is constant-time on processors with SSSE3 and falls back to the tables on others, see AESVectorPermute.
+ * @param  ModeBackend backend
+ */
+void AES::SetBackend(const ModeBackend backend) {
+    modeBackend = backend; //set backend of vector mode functions
+}
+
+
+/**
+ * @brief  Function that returns the block backend of Encrypt_ECB through Decrypt_CTR.
+ * @return  ModeBackend backend
+ */
+AES::ModeBackend AES::GetBackend() {
+    return modeBackend; //return backend of vector mode functions
+}
+
+
 /**
  * @brief  Function that performs AES encryption on given text using specified key, supports AES-128, AES-192 and AES-256.
  * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
@@ -583,6 +707,7 @@ unsigned char* AES::DecryptBlock(unsigned char* text, const vector<vector<unsign
  * @throws  invalid_argument thrown if given key is invalid.
  */
 vector<unsigned char>& AES::Encrypt(vector<unsigned char>& text, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("Block-Encrypt", text.size()); //profile single block encryption
     if (text.size() != BlockSize) //if plaintext isn't valid we throw invalid argument
         throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES requirements."); //throw invalid argument
     SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
@@ -603,6 +728,7 @@ vector<unsigned char>& AES::Encrypt(vector<unsigned char>& text, const vector<un
  * @throws  invalid_argument thrown if given key is invalid.
  */
 vector<unsigned char>& AES::Decrypt(vector<unsigned char>& text, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("Block-Decrypt", text.size()); //profile single block decryption
     if (text.size() != BlockSize) //if plaintext isn't valid we throw invalid argument
         throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES requirements."); //throw invalid argument
     SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
@@ -624,19 +750,10 @@ vector<unsigned char>& AES::Decrypt(vector<unsigned char>& text, const vector<un
  * @throws  invalid_argument thrown if given key is invalid.
  */
 vector<unsigned char>& AES::Encrypt_ECB(vector<unsigned char>& text, const vector<unsigned char>& key) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES ECB requirements."); //throw invalid argument
-    if (text.size() % BlockSize != 0) { //if text size isn't multiply of 16 bytes we add padding
-        unsigned char padding = BlockSize - (text.size() % BlockSize); //calculate the number of padding bytes needed
-        text.insert(text.end(), padding, padding); //append the padding bytes to the text
-    }
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    for (size_t i = 0; i < text.size(); i += BlockSize) { //iterate over text
-        EncryptBlock(text.data() + i, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations 
-    return text; //return ciphered text
+    AES_PROFILE_SCOPE("ECB-Encrypt", text.size()); //profile ECB encryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Encrypt<AESVectorPermute::Backend, AESModeEngine::ECBPolicy>(text, key); //encrypt text with the vector permute backend
+    return AESModeEngine::Encrypt<AESModeEngine::SoftwareBackend, AESModeEngine::ECBPolicy>(text, key); //encrypt text with the mode engine, which validates, pads and returns ciphered text
 }
 
 
@@ -652,21 +769,10 @@ vector<unsigned char>& AES::Encrypt_ECB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given key is invalid.
  */
 vector<unsigned char>& AES::Decrypt_ECB(vector<unsigned char>& text, const vector<unsigned char>& key) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty() || text.size() % BlockSize != 0) //if plaintext is empty or plaintext size isn't multiply of 16 bytes
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES ECB requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    for (size_t i = 0; i < text.size(); i += BlockSize) { //iterate over text
-        DecryptBlock(text.data() + i, roundKeys); //decrypt the block using our AES DecryptBlock function using round keys
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations 
-    unsigned char padding = text.back(); //get the value of the last byte, which indicates the padding size
-    if (padding > 0 && padding <= BlockSize && padding <= text.size()) { //if true we have padding bytes to remove from text
-        for (size_t i = text.size(); i-- > text.size() - padding;) //check if last bytes match padding value
-            if (text[i] != padding) return text; //if byte doesn't match padding value we return deciphered text
-        text.resize(text.size() - padding); //remove the padding bytes from the text
-    }
-    return text; //return deciphered text
+    AES_PROFILE_SCOPE("ECB-Decrypt", text.size()); //profile ECB decryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Decrypt<AESVectorPermute::Backend, AESModeEngine::ECBPolicy>(text, key); //decrypt text with the vector permute backend
+    return AESModeEngine::Decrypt<AESModeEngine::SoftwareBackend, AESModeEngine::ECBPolicy>(text, key); //decrypt text with the mode engine, which validates, pads and returns deciphered text
 }
 
 
@@ -683,24 +789,10 @@ vector<unsigned char>& AES::Decrypt_ECB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Encrypt_CBC(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CBC requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CBC requirements."); //throw invalid argument
-    if (text.size() % BlockSize != 0) { //if text size isn't multiply of 16 bytes we add padding
-        unsigned char padding = BlockSize - (text.size() % BlockSize); //calculate the number of padding bytes needed
-        text.insert(text.end(), padding, padding); //append the padding bytes to the text
-    }
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> currentCipher = iv; //initialize currentCipher vector with IV vector
-    for (size_t i = 0; i < text.size(); i += BlockSize) { //iterate over text
-        XOR(text.data() + i, currentCipher.data()); //XOR with currentCipher block
-        EncryptBlock(text.data() + i, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
-        copy(text.begin() + i, text.begin() + i + BlockSize, currentCipher.begin()); //update currentCipher block with previous block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return ciphered text
+    AES_PROFILE_SCOPE("CBC-Encrypt", text.size()); //profile CBC encryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Encrypt<AESVectorPermute::Backend, AESModeEngine::CBCPolicy>(text, key, iv); //encrypt text with the vector permute backend
+    return AESModeEngine::Encrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CBCPolicy>(text, key, iv); //encrypt text with the mode engine, which validates, pads and returns ciphered text
 }
 
 
@@ -718,28 +810,10 @@ vector<unsigned char>& AES::Encrypt_CBC(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Decrypt_CBC(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty() || text.size() % BlockSize != 0) //if plaintext is empty or plaintext size isn't multiply of 16 bytes
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CBC requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CBC requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> currentCipher = iv; //initialize currentCipher vector with IV vector
-    vector<unsigned char> previousCipher(BlockSize); //initialize previousCipher vector
-    for (size_t i = 0; i < text.size(); i += BlockSize) { //iterate over text
-        copy(text.begin() + i, text.begin() + i + BlockSize, previousCipher.begin()); //save current block in previousCipher 
-        DecryptBlock(text.data() + i, roundKeys); //decrypt the block using our AES DecryptBlock function using round keys
-        XOR(text.data() + i, currentCipher.data()); //XOR with currentCipher block
-        currentCipher = previousCipher; //update currentCipher block with previousCipher block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    unsigned char padding = text.back(); //get the value of the last byte, which indicates the padding size
-    if (padding > 0 && padding <= BlockSize && padding <= text.size()) { //if true we have padding bytes to remove from text
-        for (size_t i = text.size(); i-- > text.size() - padding;) //check if last bytes match padding value
-            if (text[i] != padding) return text; //if byte doesn't match padding value we return deciphered text
-        text.resize(text.size() - padding); //remove the padding bytes from the text
-    }
-    return text; //return deciphered text
+    AES_PROFILE_SCOPE("CBC-Decrypt", text.size()); //profile CBC decryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Decrypt<AESVectorPermute::Backend, AESModeEngine::CBCPolicy>(text, key, iv); //decrypt text with the vector permute backend
+    return AESModeEngine::Decrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CBCPolicy>(text, key, iv); //decrypt text with the mode engine, which validates, pads and returns deciphered text
 }
 
 
@@ -756,26 +830,10 @@ vector<unsigned char>& AES::Decrypt_CBC(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Encrypt_CFB(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CFB requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CFB requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> previousCipher = iv; //initialize previousCipher vector with IV vector
-    vector<unsigned char> currentCipher(BlockSize); //initialize currentCipher vector
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentCipher 
-            currentCipher = previousCipher; //set currentCipher vector to previousCipher block for encryption
-            EncryptBlock(currentCipher.data(), roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for currentCipher back to zero to perform XOR operation 
-        }
-        text[i] ^= currentCipher[j]; //perform byte XOR between text and currentCipher block
-        previousCipher[j] = text[i]; //update previousCipher with the new ciphered text
-        j++; //increase j index for currentCipher block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return ciphered text
+    AES_PROFILE_SCOPE("CFB-Encrypt", text.size()); //profile CFB encryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Encrypt<AESVectorPermute::Backend, AESModeEngine::CFBPolicy>(text, key, iv); //encrypt text with the vector permute backend
+    return AESModeEngine::Encrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CFBPolicy>(text, key, iv); //encrypt text with the mode engine, which validates, pads and returns ciphered text
 }
 
 
@@ -792,26 +850,10 @@ vector<unsigned char>& AES::Encrypt_CFB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Decrypt_CFB(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CFB requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CFB requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> previousCipher = iv; //initialize previousCipher vector with IV vector
-    vector<unsigned char> currentCipher(BlockSize); //initialize currentCipher vector 
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentCipher 
-            currentCipher = previousCipher; //set currentCipher vector to previousCipher block for decryption
-            EncryptBlock(currentCipher.data(), roundKeys); //decrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for currentCipher back to zero to perform XOR operation 
-        }
-        previousCipher[j] = text[i]; //update previousCipher with the new deciphered text
-        text[i] ^= currentCipher[j]; //perform byte XOR between text and currentCipher block
-        j++; //increase j index for currentCipher block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return deciphered text
+    AES_PROFILE_SCOPE("CFB-Decrypt", text.size()); //profile CFB decryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Decrypt<AESVectorPermute::Backend, AESModeEngine::CFBPolicy>(text, key, iv); //decrypt text with the vector permute backend
+    return AESModeEngine::Decrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CFBPolicy>(text, key, iv); //decrypt text with the mode engine, which validates, pads and returns deciphered text
 }
 
 
@@ -828,23 +870,10 @@ vector<unsigned char>& AES::Decrypt_CFB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Encrypt_OFB(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES OFB requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES OFB requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> currentCipher = iv; //initialize currentCipher vector with IV vector
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentCipher 
-            EncryptBlock(currentCipher.data(), roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for currentCipher back to zero to perform XOR operation 
-        }
-        text[i] ^= currentCipher[j]; //perform byte XOR between text and currentCipher block
-        j++; //increase j index for currentCipher block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return ciphered text
+    AES_PROFILE_SCOPE("OFB-Encrypt", text.size()); //profile OFB encryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Encrypt<AESVectorPermute::Backend, AESModeEngine::OFBPolicy>(text, key, iv); //encrypt text with the vector permute backend
+    return AESModeEngine::Encrypt<AESModeEngine::SoftwareBackend, AESModeEngine::OFBPolicy>(text, key, iv); //encrypt text with the mode engine, which validates, pads and returns ciphered text
 }
 
 
@@ -861,23 +890,10 @@ vector<unsigned char>& AES::Encrypt_OFB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Decrypt_OFB(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES OFB requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES OFB requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> currentCipher = iv; //initialize currentCipher vector with IV vector
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentCipher 
-            EncryptBlock(currentCipher.data(), roundKeys); //decrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for currentCipher back to zero to perform XOR operation 
-        }
-        text[i] ^= currentCipher[j]; //perform byte XOR between text and currentCipher block
-        j++; //increase j index for currentCipher block
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return deciphered text
+    AES_PROFILE_SCOPE("OFB-Decrypt", text.size()); //profile OFB decryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Decrypt<AESVectorPermute::Backend, AESModeEngine::OFBPolicy>(text, key, iv); //decrypt text with the vector permute backend
+    return AESModeEngine::Decrypt<AESModeEngine::SoftwareBackend, AESModeEngine::OFBPolicy>(text, key, iv); //decrypt text with the mode engine, which validates, pads and returns deciphered text
 }
 
 
@@ -894,30 +910,10 @@ vector<unsigned char>& AES::Decrypt_OFB(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Encrypt_CTR(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CTR requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CTR requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> previousIV = iv; //initialize previousIV vector with IV vector
-    vector<unsigned char> currentIV(BlockSize); //initialize currentIV vector
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentIV
-            currentIV = previousIV; //set currentIV vector to previousIV vector for encryption
-            EncryptBlock(currentIV.data(), roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for IV vector back to zero to perform XOR operation 
-        }
-        text[i] ^= currentIV[j]; //perform byte XOR between text and IV vector
-        j++; //increase j index for IV vector
-        //here we increase the counter for IV vector
-        if (j == BlockSize) { //if j equals to block size 
-            for (size_t k = BlockSize; k-- > BlockSize / 2;) //iterate over previousIV from end to start
-                if (++previousIV[k]) break; //increment previousIV[k] and break if it's not zero
-        }
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return ciphered text
+    AES_PROFILE_SCOPE("CTR-Encrypt", text.size()); //profile CTR encryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Encrypt<AESVectorPermute::Backend, AESModeEngine::CTRPolicy>(text, key, iv); //encrypt text with the vector permute backend
+    return AESModeEngine::Encrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CTRPolicy>(text, key, iv); //encrypt text with the mode engine, which validates, pads and returns ciphered text
 }
 
 
@@ -934,28 +930,8 @@ vector<unsigned char>& AES::Encrypt_CTR(vector<unsigned char>& text, const vecto
  * @throws  invalid_argument thrown if given iv is invalid.
  */
 vector<unsigned char>& AES::Decrypt_CTR(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv) {
-    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
-    if (text.empty()) //if plaintext is empty
-        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CTR requirements."); //throw invalid argument
-    if (iv.size() != BlockSize) //if IV vector isn't in correct size
-        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES CTR requirements."); //throw invalid argument
-    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //call our KeySchedule function for generating round keys
-    vector<unsigned char> previousIV = iv; //initialize previousIV vector with IV vector
-    vector<unsigned char> currentIV(BlockSize); //initialize currentIV vector
-    for (size_t i = 0, j = 0; i < text.size(); i++) { //iterate over text
-        if (j % BlockSize == 0) { //if we are in new cipher block we encrypt currentIV
-            currentIV = previousIV; //set currentIV vector to previousIV vector for decryption
-            EncryptBlock(currentIV.data(), roundKeys); //decrypt the block using our AES EncryptBlock function using round keys
-            j = 0; //set the index for IV vector back to zero to perform XOR operation 
-        }
-        text[i] ^= currentIV[j]; //perform byte XOR between text and IV vector
-        j++; //increase j index for IV vector
-        //here we increase the counter for IV vector
-        if (j == BlockSize) { //if j equals to block size 
-            for (size_t k = BlockSize; k-- > BlockSize / 2;) //iterate over previousIV from end to start
-                if (++previousIV[k]) break; //increment previousIV[k] and break if it's not zero
-        }
-    }
-    ClearVector(roundKeys); //clear our roundKeys for added security after we finish operations
-    return text; //return deciphered text
+    AES_PROFILE_SCOPE("CTR-Decrypt", text.size()); //profile CTR decryption
+    if (modeBackend == VectorPermuteBackend) //if vector permute backend is selected
+        return AESModeEngine::Decrypt<AESVectorPermute::Backend, AESModeEngine::CTRPolicy>(text, key, iv); //decrypt text with the vector permute backend
+    return AESModeEngine::Decrypt<AESModeEngine::SoftwareBackend, AESModeEngine::CTRPolicy>(text, key, iv); //decrypt text with the mode engine, which validates, pads and returns deciphered text
 }
\ No newline at end of file
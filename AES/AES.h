@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <random>
+#include <atomic>
 
 using namespace std;
 
@@ -33,26 +34,31 @@ private:
 	static const unsigned char GaloisMult[15][256];
 
 	/**
-	 * @brief  number of columns in the state (always 4 for AES).
+	 * @brief  Round constants table for AES key schedule.
 	 */
-	static const size_t Nb = 4;
+	static const unsigned char RCON[11];
 
 	/**
 	 * @brief  number of 32-bit words in the key.
 	 */
-	static size_t Nk;
+	static thread_local size_t Nk;
 
 	/**
 	 * @brief  number of rounds (AES-128 has 10 rounds, AES-192 has 12 rounds, AES-256 has 14 rounds).
 	 */
-	static size_t Nr;
+	static thread_local size_t Nr;
+
+protected:
+	/**
+	 * @brief  number of columns in the state (always 4 for AES).
+	 */
+	static const size_t Nb = 4;
 
 	/**
 	 * @brief  represents the size of AES block that is always 16 bytes (128-bit).
 	 */
 	static const size_t BlockSize = Nb * Nb;
 
-protected:
 	/**
 	 * @brief  Function that performs AES encryption on given text using specified round keys, supports AES-128, AES-192 and AES-256.
 	 * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
@@ -71,6 +77,26 @@ protected:
 	 */
 	static unsigned char* DecryptBlock(unsigned char* text, const vector<vector<unsigned char>>& roundKeys);
 
+	/**
+	 * @brief  Function that performs AES encryption on given text using round keys stored back to back in a flat array.
+	 * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
+	 * @param  unsigned char* text
+	 * @param  const unsigned char* roundKeys
+	 * @param  size_t rounds
+	 * @return  unsigned char* cipherText
+	 */
+	static unsigned char* EncryptBlock(unsigned char* text, const unsigned char* roundKeys, const size_t rounds);
+
+	/**
+	 * @brief  Function that performs AES decryption on given text using round keys stored back to back in a flat array.
+	 * @brief  This function performs AES decryption with fixed block size of 16 bytes (128-bit).
+	 * @param  unsigned char* text
+	 * @param  const unsigned char* roundKeys
+	 * @param  size_t rounds
+	 * @return  unsigned char* decipherText
+	 */
+	static unsigned char* DecryptBlock(unsigned char* text, const unsigned char* roundKeys, const size_t rounds);
+
 	/**
 	 * @brief  Function for generating round keys for AES encryption, supports AES-128, AES-192 and AES-256.
 	 * @param  vector<unsigned char> key
@@ -78,6 +104,15 @@ protected:
 	 */
 	static vector<vector<unsigned char>> KeySchedule(const vector<unsigned char>& key);
 
+	/**
+	 * @brief  Function for generating round keys into a flat array without heap allocations, supports AES-128, AES-192 and AES-256.
+	 * @brief  The array must hold (keySize / 4 + 7) round keys of 16 bytes, the round keys match KeySchedule.
+	 * @param  const unsigned char* key
+	 * @param  size_t keySize
+	 * @param  unsigned char* roundKeys
+	 */
+	static void KeySchedule(const unsigned char* key, const size_t keySize, unsigned char* roundKeys);
+
 	/**
 	 * @brief  Function that handles the operation mode of AES encryption.
 	 * @param  size_t keySize
@@ -139,6 +174,24 @@ protected:
 	static unsigned char* XOR(unsigned char* first, const unsigned char* second);
 
 public:
+	/**
+	 * @brief  Represents the block backends of the mode engine the vector mode functions can run on.
+	 */
+	enum ModeBackend { TableBackend, VectorPermuteBackend };
+
+	/**
+	 * @brief  Function that selects the block backend of Encrypt_ECB through Decrypt_CTR, the table-based backend is the default.
+	 * @brief  The vector permute backend is constant-time on processors with SSSE3 and falls back to the tables on others, see AESVectorPermute.
+	 * @param  ModeBackend backend
+	 */
+	static void SetBackend(const ModeBackend backend);
+
+	/**
+	 * @brief  Function that returns the block backend of Encrypt_ECB through Decrypt_CTR.
+	 * @return  ModeBackend backend
+	 */
+	static ModeBackend GetBackend();
+
 	/**
 	 * @brief  Function that performs AES encryption on given text using specified key, supports AES-128, AES-192 and AES-256.
 	 * @brief  This function performs AES encryption with fixed block size of 16 bytes (128-bit).
@@ -362,5 +415,11 @@ public:
 	 * @param  vector<vector<unsigned char>> vec
 	 */
 	static void PrintVector(const vector<vector<unsigned char>>& vec);
+
+protected:
+	/**
+	 * @brief  Represents the block backend of the vector mode functions, shared by all threads.
+	 */
+	static atomic<ModeBackend> modeBackend;
 };
 #endif
\ No newline at end of file
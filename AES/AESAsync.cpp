@@ -0,0 +1,386 @@
+#include "AESAsync.h"
+#include "AESProfiler.h"
+
+
+//initialize default async settings
+atomic<size_t> AESAsync::inlineThreshold{ 64 * 1024 }; //default to 64 KB so small buffers don't pay for a worker round trip
+atomic<size_t> AESAsync::sliceSize{ 1024 * 1024 }; //default to 1 MB so other operations get a worker at least every millisecond or so
+thread_local AESAsync::Executor AESAsync::executor; //no executor by default, coroutines resume on the worker thread
+
+
+/**
+ * @brief  Constructor that creates a new token that isn't cancelled.
+ */
+AESAsync::CancelToken::CancelToken() : cancelled(make_shared<atomic<bool>>(false)) {}
+
+
+/**
+ * @brief  Function that cancels all operations that received this token.
+ */
+void AESAsync::CancelToken::Cancel() const {
+    *cancelled = true; //set shared cancellation flag
+}
+
+
+/**
+ * @brief  Function that returns if the token is cancelled.
+ * @return  bool isCancelled
+ */
+bool AESAsync::CancelToken::IsCancelled() const {
+    return *cancelled; //return shared cancellation flag
+}
+
+
+/**
+ * @brief  Destructor that clears the round keys of the operation.
+ */
+AESAsync::State::~State() {
+    ClearVector(roundKeys); //clear round keys once no chunk of the operation uses them
+}
+
+
+/**
+ * @brief  Function that processes the buffer inline and returns true if it's smaller than the inline threshold, otherwise returns false so the coroutine suspends.
+ * @return  bool isReady
+ */
+bool AESAsync::Operation::await_ready() {
+    if (state->length >= inlineThreshold) //if buffer is large we suspend and offload it
+        return false;
+    try {
+        if (state->cancel.IsCancelled()) //if operation was cancelled before it started
+            throw runtime_error("Operation was cancelled before it completed."); //throw runtime error when coroutine resumes
+        ProcessSlice(*state, state->length); //process whole buffer on awaiting thread
+    }
+    catch (...) { //if operation failed we save the exception for await_resume
+        state->error = current_exception(); //save exception
+    }
+    return true; //coroutine continues without suspending
+}
+
+
+/**
+ * @brief  Function that offloads the buffer to the worker pool and remembers given coroutine for resuming.
+ * @param  coroutine_handle<> handle
+ */
+void AESAsync::Operation::await_suspend(coroutine_handle<> handle) {
+    state->handle = handle; //remember awaiting coroutine
+    state->executor = executor; //resume through executor of awaiting thread
+    shared_ptr<State> operation = state; //copy state, the coroutine may resume and destroy this awaitable before Submit returns
+    Submit([operation]() { RunSlice(operation); }); //process first slice on worker pool
+}
+
+
+/**
+ * @brief  Function that rethrows the error of the operation if it failed or was cancelled.
+ * @throws  runtime_error thrown if the operation was cancelled.
+ */
+void AESAsync::Operation::await_resume() {
+    if (state->error) //if operation failed or was cancelled
+        rethrow_exception(state->error); //rethrow exception in awaiting coroutine
+}
+
+
+/**
+ * @brief  Function that validates given buffer, key and iv and returns a new operation.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+ */
+AESAsync::Operation AESAsync::Create(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const string& mode, const bool encrypt, const CancelToken& cancel) {
+    if ((length > 0 && (input == NULL || output == NULL)) || ((mode == "ECB" || mode == "CBC") && length % BlockSize != 0)) //if buffer is missing or block mode length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + mode + " requirements."); //throw invalid argument
+    Operation operation; //represents new operation
+    operation.state = make_shared<State>(); //create shared state
+    operation.state->roundKeys = Prepare(key, iv, mode); //validate key and IV and generate round keys
+    operation.state->input = input; //set input buffer
+    operation.state->output = output; //set output buffer
+    operation.state->length = length; //set length
+    operation.state->iv = iv; //set iv
+    operation.state->mode = mode; //set mode
+    operation.state->encrypt = encrypt; //set direction
+    operation.state->cancel = cancel; //share cancellation flag
+    return operation; //return operation, nothing is processed until it's awaited
+}
+
+
+/**
+ * @brief  Function that processes given number of bytes of given operation from its current offset.
+ * @param  State state
+ * @param  size_t size
+ */
+void AESAsync::ProcessSlice(State& state, const size_t size) {
+    AES_PROFILE_SCOPE("Async-Slice", size); //profile asynchronous slice
+    const unsigned char* input = state.input + state.offset; //represents input of slice
+    unsigned char* output = state.output + state.offset; //represents output of slice
+    if (state.mode == "ECB") //if mode is ECB
+        ECBBlocks(input, output, size, state.roundKeys, state.encrypt); //process slice in ECB mode
+    else if (state.mode == "CBC") //if mode is CBC
+        state.encrypt ? CBCEncryptBlocks(input, output, size, state.roundKeys, state.iv) : CBCDecryptBlocks(input, output, size, state.roundKeys, state.iv); //process slice in CBC mode
+    else if (state.mode == "CFB") //if mode is CFB
+        state.encrypt ? CFBEncryptBlocks(input, output, size, state.roundKeys, state.iv) : CFBDecryptBlocks(input, output, size, state.roundKeys, state.iv); //process slice in CFB mode
+    else if (state.mode == "OFB") //if mode is OFB
+        OFBBlocks(input, output, size, state.roundKeys, state.iv); //process slice in OFB mode
+    else //else mode is CTR
+        CTRBlocks(input, output, size, state.roundKeys, state.iv); //process slice in CTR mode
+    state.offset += size; //move past processed slice
+}
+
+
+/**
+ * @brief  Function that runs on a worker, processes one slice of given operation and resubmits it or resumes the awaiting coroutine.
+ * @param  shared_ptr<State> state
+ */
+void AESAsync::RunSlice(const shared_ptr<State>& state) {
+    try {
+        if (state->cancel.IsCancelled()) //if operation was cancelled we stop before next slice
+            throw runtime_error("Operation was cancelled before it completed."); //throw runtime error when coroutine resumes
+        ProcessSlice(*state, min((size_t)sliceSize, state->length - state->offset)); //process next slice
+        if (state->offset < state->length) { //if buffer isn't finished we yield the worker
+            shared_ptr<State> operation = state; //copy state for next slice
+            Submit([operation]() { RunSlice(operation); }); //continue at end of queue so other operations get their turn
+            return;
+        }
+    }
+    catch (...) { //if operation failed we save the exception for await_resume
+        state->error = current_exception(); //save exception
+    }
+    if (state->executor) //if awaiting thread has an executor we let it resume the coroutine
+        state->executor(state->handle); //post coroutine to its event loop
+    else //else we resume on worker thread
+        state->handle.resume(); //resume awaiting coroutine
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES encryption in ECB mode on given buffer using specified key.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+AESAsync::Operation AESAsync::Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const CancelToken& cancel) {
+    return Create(input, output, length, key, NULL, "ECB", true, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES decryption in ECB mode on given buffer using specified key.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+AESAsync::Operation AESAsync::Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const CancelToken& cancel) {
+    return Create(input, output, length, key, NULL, "ECB", false, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES encryption in CBC mode on given buffer using specified key and initialization vector.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CBC", true, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES decryption in CBC mode on given buffer using specified key and initialization vector.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CBC", false, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES encryption in CFB mode on given buffer using specified key and initialization vector.
+ * @brief  CFB mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Encrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CFB", true, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES decryption in CFB mode on given buffer using specified key and initialization vector.
+ * @brief  CFB mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Decrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CFB", false, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES encryption in OFB mode on given buffer using specified key and initialization vector.
+ * @brief  OFB mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Encrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "OFB", true, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES decryption in OFB mode on given buffer using specified key and initialization vector.
+ * @brief  OFB mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Decrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "OFB", false, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES encryption in CTR mode on given buffer using specified key and initialization vector.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CTR", true, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that returns an awaitable AES decryption in CTR mode on given buffer using specified key and initialization vector.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  CancelToken cancel
+ * @return  Operation operation
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESAsync::Operation AESAsync::Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel) {
+    return Create(input, output, length, key, iv, "CTR", false, cancel); //return new operation
+}
+
+
+/**
+ * @brief  Function that sets the executor that resumes coroutines awaiting on the calling thread, an empty executor resumes them on the worker thread.
+ * @param  Executor executor
+ */
+void AESAsync::SetExecutor(const Executor& executor) {
+    AESAsync::executor = executor; //set executor of calling thread
+}
+
+
+/**
+ * @brief  Function that sets the buffer size in bytes below which operations are processed inline on the awaiting thread.
+ * @param  size_t threshold
+ */
+void AESAsync::SetInlineThreshold(const size_t threshold) {
+    inlineThreshold = threshold; //set inline threshold
+}
+
+
+/**
+ * @brief  Function that returns the buffer size in bytes below which operations are processed inline on the awaiting thread.
+ * @return  size_t threshold
+ */
+size_t AESAsync::GetInlineThreshold() {
+    return inlineThreshold; //return inline threshold
+}
+
+
+/**
+ * @brief  Function that sets the slice size in bytes that an operation processes before it yields the worker, rounded down to a multiple of 16 bytes.
+ * @param  size_t sliceSize
+ * @throws  invalid_argument thrown if given sliceSize is smaller than 16 bytes.
+ */
+void AESAsync::SetSliceSize(const size_t sliceSize) {
+    if (sliceSize < BlockSize) //if slice size is smaller than a single block
+        throw invalid_argument("Invalid slice size, please provide slice size of at least 16 bytes."); //throw invalid argument
+    AESAsync::sliceSize = sliceSize - (sliceSize % BlockSize); //set slice size rounded down to a multiple of block size
+}
+
+
+/**
+ * @brief  Function that returns the slice size in bytes that an operation processes before it yields the worker.
+ * @return  size_t sliceSize
+ */
+size_t AESAsync::GetSliceSize() {
+    return sliceSize; //return slice size
+}
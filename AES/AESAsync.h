@@ -0,0 +1,325 @@
+#ifndef _AESASYNC_H
+#define _AESASYNC_H
+#include "AESParallel.h"
+#include <coroutine>
+
+/**
+ * @file AESAsync.h
+ * @brief  AESAsync class with C++20 awaitable encryption and decryption for coroutines running on an event loop.
+ * @brief  Buffers smaller than the inline threshold are processed on the awaiting thread without suspending.
+ * @brief  Larger buffers are processed on the AESParallel worker pool in slices, after each slice the operation goes to the back of the worker queue so one huge buffer can't starve other operations.
+ * @brief  Operations can be cancelled with a CancelToken, a cancelled operation stops at the next slice and throws when resumed.
+ * @brief  The awaiting coroutine is resumed through the executor of the awaiting thread if one is set with SetExecutor, otherwise on the worker thread.
+ * @brief  Buffers and iv must stay valid until the operation completes, the iv is updated like in the AESParallel pointer modes.
+ */
+class AESAsync : public AESParallel {
+public:
+	/**
+	 * @brief  Represents a cancellation flag shared between copies of the token and the operations that received it.
+	 */
+	class CancelToken {
+	public:
+		/**
+		 * @brief  Constructor that creates a new token that isn't cancelled.
+		 */
+		CancelToken();
+
+		/**
+		 * @brief  Function that cancels all operations that received this token.
+		 */
+		void Cancel() const;
+
+		/**
+		 * @brief  Function that returns if the token is cancelled.
+		 * @return  bool isCancelled
+		 */
+		bool IsCancelled() const;
+
+	private:
+		shared_ptr<atomic<bool>> cancelled; //shared cancellation flag
+	};
+
+	/**
+	 * @brief  Represents the function that resumes a coroutine on its event loop, for example by posting the handle to the loop's queue.
+	 */
+	typedef function<void(coroutine_handle<>)> Executor;
+
+protected:
+	/**
+	 * @brief  Represents the shared state of an operation, owned by the awaitable and by the worker task that processes it.
+	 */
+	struct State {
+		const unsigned char* input = NULL; //input buffer
+		unsigned char* output = NULL; //output buffer
+		size_t length = 0; //length of buffer in bytes
+		size_t offset = 0; //number of bytes processed
+		unsigned char* iv = NULL; //iv that is updated with each slice
+		vector<vector<unsigned char>> roundKeys; //round keys of key
+		string mode; //mode of operation
+		bool encrypt = true; //true for encryption, false for decryption
+		CancelToken cancel; //cancellation token of operation
+		Executor executor; //executor of awaiting thread, empty to resume on worker thread
+		coroutine_handle<> handle; //awaiting coroutine
+		exception_ptr error; //exception thrown by operation or cancellation
+
+		/**
+		 * @brief  Destructor that clears the round keys of the operation.
+		 */
+		~State();
+	};
+
+public:
+	/**
+	 * @brief  Represents an awaitable encryption or decryption, the result of co_await is void and errors are thrown when the coroutine resumes.
+	 */
+	class Operation {
+	public:
+		/**
+		 * @brief  Function that processes the buffer inline and returns true if it's smaller than the inline threshold, otherwise returns false so the coroutine suspends.
+		 * @return  bool isReady
+		 */
+		bool await_ready();
+
+		/**
+		 * @brief  Function that offloads the buffer to the worker pool and remembers given coroutine for resuming.
+		 * @param  coroutine_handle<> handle
+		 */
+		void await_suspend(coroutine_handle<> handle);
+
+		/**
+		 * @brief  Function that rethrows the error of the operation if it failed or was cancelled.
+		 * @throws  runtime_error thrown if the operation was cancelled.
+		 */
+		void await_resume();
+
+	private:
+		friend class AESAsync;
+		shared_ptr<State> state; //shared state of operation
+	};
+
+	/**
+	 * @brief  Function that returns an awaitable AES encryption in ECB mode on given buffer using specified key.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static Operation Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES decryption in ECB mode on given buffer using specified key.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static Operation Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES encryption in CBC mode on given buffer using specified key and initialization vector.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES decryption in CBC mode on given buffer using specified key and initialization vector.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES encryption in CFB mode on given buffer using specified key and initialization vector.
+	 * @brief  CFB mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Encrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES decryption in CFB mode on given buffer using specified key and initialization vector.
+	 * @brief  CFB mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Decrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES encryption in OFB mode on given buffer using specified key and initialization vector.
+	 * @brief  OFB mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Encrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES decryption in OFB mode on given buffer using specified key and initialization vector.
+	 * @brief  OFB mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Decrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES encryption in CTR mode on given buffer using specified key and initialization vector.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that returns an awaitable AES decryption in CTR mode on given buffer using specified key and initialization vector.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Operation Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const CancelToken& cancel = CancelToken());
+
+	/**
+	 * @brief  Function that sets the executor that resumes coroutines awaiting on the calling thread, an empty executor resumes them on the worker thread.
+	 * @param  Executor executor
+	 */
+	static void SetExecutor(const Executor& executor);
+
+	/**
+	 * @brief  Function that sets the buffer size in bytes below which operations are processed inline on the awaiting thread.
+	 * @param  size_t threshold
+	 */
+	static void SetInlineThreshold(const size_t threshold);
+
+	/**
+	 * @brief  Function that returns the buffer size in bytes below which operations are processed inline on the awaiting thread.
+	 * @return  size_t threshold
+	 */
+	static size_t GetInlineThreshold();
+
+	/**
+	 * @brief  Function that sets the slice size in bytes that an operation processes before it yields the worker, rounded down to a multiple of 16 bytes.
+	 * @param  size_t sliceSize
+	 * @throws  invalid_argument thrown if given sliceSize is smaller than 16 bytes.
+	 */
+	static void SetSliceSize(const size_t sliceSize);
+
+	/**
+	 * @brief  Function that returns the slice size in bytes that an operation processes before it yields the worker.
+	 * @return  size_t sliceSize
+	 */
+	static size_t GetSliceSize();
+
+protected:
+	/**
+	 * @brief  Buffer size in bytes from which operations are offloaded to the worker pool.
+	 */
+	static atomic<size_t> inlineThreshold;
+
+	/**
+	 * @brief  Slice size in bytes that an operation processes before it yields the worker.
+	 */
+	static atomic<size_t> sliceSize;
+
+	/**
+	 * @brief  Executor that resumes coroutines awaiting on the calling thread.
+	 */
+	static thread_local Executor executor;
+
+	/**
+	 * @brief  Function that validates given buffer, key and iv and returns a new operation.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  CancelToken cancel
+	 * @return  Operation operation
+	 * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+	 */
+	static Operation Create(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const string& mode, const bool encrypt, const CancelToken& cancel);
+
+	/**
+	 * @brief  Function that processes given number of bytes of given operation from its current offset.
+	 * @param  State state
+	 * @param  size_t size
+	 */
+	static void ProcessSlice(State& state, const size_t size);
+
+	/**
+	 * @brief  Function that runs on a worker, processes one slice of given operation and resubmits it or resumes the awaiting coroutine.
+	 * @param  shared_ptr<State> state
+	 */
+	static void RunSlice(const shared_ptr<State>& state);
+};
+#endif
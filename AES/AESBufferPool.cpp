@@ -0,0 +1,492 @@
+#include "AESBufferPool.h"
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+
+/**
+ * @brief  Constructor that creates an empty handle that holds no buffer.
+ */
+AESBufferPool::Buffer::Buffer() : pool(NULL), data(NULL), size(0), used(0) {}
+
+
+/**
+ * @brief  Constructor that wraps given buffer of given pool.
+ * @param  AESBufferPool* pool
+ * @param  unsigned char* data
+ */
+AESBufferPool::Buffer::Buffer(AESBufferPool* pool, unsigned char* data) : pool(pool), data(data), size(0), used(0) {}
+
+
+/**
+ * @brief  Constructor that takes the buffer of given handle, which is left empty.
+ * @param  Buffer other
+ */
+AESBufferPool::Buffer::Buffer(Buffer&& other) noexcept : pool(other.pool), data(other.data), size(other.size), used(other.used) {
+    other.pool = NULL; //leave other handle empty
+    other.data = NULL;
+    other.size = other.used = 0;
+}
+
+
+/**
+ * @brief  Operator that returns the current buffer to its pool and takes the buffer of given handle, which is left empty.
+ * @param  Buffer other
+ * @return  Buffer buffer
+ */
+AESBufferPool::Buffer& AESBufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) { //if other is another handle
+        Release(); //return current buffer
+        pool = other.pool; //take buffer of other handle
+        data = other.data;
+        size = other.size;
+        used = other.used;
+        other.pool = NULL; //leave other handle empty
+        other.data = NULL;
+        other.size = other.used = 0;
+    }
+    return *this; //return handle
+}
+
+
+/**
+ * @brief  Destructor that returns the buffer to its pool.
+ */
+AESBufferPool::Buffer::~Buffer() {
+    Release(); //return buffer
+}
+
+
+/**
+ * @brief  Function that returns the data of the buffer, NULL if the handle is empty.
+ * @return  unsigned char* data
+ */
+unsigned char* AESBufferPool::Buffer::Data() {
+    return data; //return data
+}
+
+
+/**
+ * @brief  Function that returns the data of the buffer, NULL if the handle is empty.
+ * @return  const unsigned char* data
+ */
+const unsigned char* AESBufferPool::Buffer::Data() const {
+    return data; //return data
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes in use of the buffer.
+ * @return  size_t size
+ */
+size_t AESBufferPool::Buffer::Size() const {
+    return size; //return size
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes the buffer can hold.
+ * @return  size_t capacity
+ */
+size_t AESBufferPool::Buffer::Capacity() const {
+    return pool != NULL ? pool->capacity : 0; //return capacity of pool buffers, empty handles hold nothing
+}
+
+
+/**
+ * @brief  Function that sets the number of bytes in use of the buffer, the contents aren't changed.
+ * @param  size_t size
+ * @throws  invalid_argument thrown if given size is larger than capacity.
+ */
+void AESBufferPool::Buffer::Resize(const size_t size) {
+    if (size > Capacity()) //if size doesn't fit in buffer
+        throw invalid_argument("Invalid size, please provide size that fits in the buffer capacity."); //throw invalid argument
+    this->size = size; //set size
+    used = max(used, size); //remember largest size so it's cleared when returned
+}
+
+
+/**
+ * @brief  Function that returns if the handle holds a buffer.
+ * @return  bool isValid
+ */
+bool AESBufferPool::Buffer::IsValid() const {
+    return data != NULL; //return true if handle holds a buffer
+}
+
+
+/**
+ * @brief  Function that clears the buffer and returns it to its pool, the handle is left empty.
+ */
+void AESBufferPool::Buffer::Release() {
+    if (pool != NULL) //if handle holds a buffer
+        pool->Return(data, used); //clear and return buffer
+    pool = NULL; //leave handle empty
+    data = NULL;
+    size = used = 0;
+}
+
+
+/**
+ * @brief  Constructor that maps, binds, locks and pre-faults a region for given number of buffers of given size.
+ * @param  size_t bufferSize
+ * @param  size_t count
+ * @param  int numaNode
+ * @throws  invalid_argument thrown if given buffer size or count is invalid.
+ * @throws  runtime_error thrown if memory can't be mapped or bound to given NUMA node.
+ */
+AESBufferPool::AESBufferPool(const size_t bufferSize, const size_t count, const int numaNode)
+    : region(NULL), regionSize(0), capacity(0), count(count), hugePages(false), locked(false) {
+    if (bufferSize == 0 || count == 0 || bufferSize > SIZE_MAX / 2 / count) //if pool is empty or too large
+        throw invalid_argument("Invalid buffer pool, please provide buffer size and count larger than zero."); //throw invalid argument
+    capacity = (bufferSize + BlockSize + Alignment - 1) / Alignment * Alignment; //add room for a padding block and round up to alignment
+    regionSize = (capacity * count + HugePageSize - 1) / HugePageSize * HugePageSize; //round region up to whole huge pages
+    Map(numaNode); //map, bind and lock region
+    for (size_t i = 0; i < regionSize; i += 4096) //iterate over pages of region
+        ((volatile unsigned char*)region)[i] = 0x00; //touch each page so it's faulted in now and not during encryption
+    freeBuffers.reserve(count); //reserve room for all buffers so returning a buffer never allocates
+    for (size_t i = count; i-- > 0;) //iterate over buffers in reverse so the first buffer is handed out first
+        freeBuffers.push_back(region + i * capacity); //add buffer to pool
+}
+
+
+/**
+ * @brief  Destructor that clears and unmaps the region, all buffers must be returned before.
+ */
+AESBufferPool::~AESBufferPool() {
+    Unmap(); //unmap region, buffers are cleared when they are returned
+}
+
+
+/**
+ * @brief  Function that maps a region of given size, binds it to given NUMA node and locks it.
+ * @param  int numaNode
+ * @throws  runtime_error thrown if memory can't be mapped or bound to given NUMA node.
+ */
+void AESBufferPool::Map(const int numaNode) {
+#if defined(_WIN32)
+    DWORD node = numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE; //represents preferred NUMA node
+    SIZE_T largePage = GetLargePageMinimum(); //represents large page size, 0 if large pages aren't supported
+    if (largePage > 0 && regionSize % largePage == 0) //if large pages are supported we try them first, they need the lock pages privilege
+        region = (unsigned char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, regionSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node); //map large pages
+    hugePages = region != NULL; //large pages are always locked in memory
+    if (region == NULL) //if large pages aren't available we use regular pages
+        region = (unsigned char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, regionSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node); //map regular pages
+    if (region == NULL) //if region couldn't be mapped
+        throw runtime_error("Failed to allocate buffer pool of " + to_string(regionSize) + " bytes."); //throw runtime error
+    locked = hugePages || VirtualLock(region, regionSize) != 0; //lock region in memory if working set allows it
+#else
+    void* mapped = MAP_FAILED; //represents mapping
+#if defined(MAP_HUGETLB)
+    mapped = mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0); //map explicit huge pages, fails if none are reserved
+    if (mapped != MAP_FAILED) { //if explicit huge pages are available
+        region = (unsigned char*)mapped; //set region
+        hugePages = true; //region uses explicit huge pages
+    }
+#endif
+    if (region == NULL) { //if explicit huge pages aren't available we align regular pages to huge page boundary for transparent huge pages
+        mapped = mmap(NULL, regionSize + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); //map region with room for alignment
+        if (mapped == MAP_FAILED) //if region couldn't be mapped
+            throw runtime_error("Failed to allocate buffer pool of " + to_string(regionSize) + " bytes."); //throw runtime error
+        uintptr_t start = (uintptr_t)mapped; //represents start of mapping
+        uintptr_t aligned = (start + HugePageSize - 1) / HugePageSize * HugePageSize; //represents start of region aligned to huge page
+        if (aligned > start) //if mapping isn't aligned we unmap the head
+            munmap(mapped, aligned - start); //unmap head
+        if (aligned + regionSize < start + regionSize + HugePageSize) //if there's a tail past region we unmap it
+            munmap((void*)(aligned + regionSize), start + HugePageSize - aligned); //unmap tail
+        region = (unsigned char*)aligned; //set region
+#if defined(MADV_HUGEPAGE)
+        madvise(region, regionSize, MADV_HUGEPAGE); //ask for transparent huge pages, ignored if they're disabled
+#endif
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    if (numaNode >= 0) { //if a NUMA node is requested we bind region to it before it's faulted in
+        unsigned long nodeMask[16] = {}; //represents node mask of up to 1024 nodes
+        const size_t maskBits = sizeof(unsigned long) * 8; //represents number of nodes per mask word
+        if ((size_t)numaNode < sizeof(nodeMask) * 8) //if node fits in mask
+            nodeMask[numaNode / maskBits] = 1UL << (numaNode % maskBits); //set node bit
+        if ((size_t)numaNode >= sizeof(nodeMask) * 8 || syscall(SYS_mbind, region, regionSize, 2 /* MPOL_BIND */, nodeMask, sizeof(nodeMask) * 8 + 1, 0) != 0) { //if node is invalid or region couldn't be bound
+            Unmap(); //unmap region
+            throw runtime_error("Failed to bind buffer pool to NUMA node " + to_string(numaNode) + "."); //throw runtime error
+        }
+    }
+#else
+    (void)numaNode; //NUMA binding isn't supported on this platform
+#endif
+    locked = mlock(region, regionSize) == 0; //lock region in memory if memory lock limit allows it
+#endif
+}
+
+
+/**
+ * @brief  Function that unmaps the region.
+ */
+void AESBufferPool::Unmap() {
+    if (region == NULL) //if region isn't mapped
+        return;
+#if defined(_WIN32)
+    if (locked && !hugePages) VirtualUnlock(region, regionSize); //unlock region
+    VirtualFree(region, 0, MEM_RELEASE); //unmap region
+#else
+    if (locked) munlock(region, regionSize); //unlock region
+    munmap(region, regionSize); //unmap region
+#endif
+    region = NULL; //mark region as unmapped
+}
+
+
+/**
+ * @brief  Function that clears given number of bytes of given buffer and returns it to the pool.
+ * @param  unsigned char* data
+ * @param  size_t used
+ */
+void AESBufferPool::Return(unsigned char* data, const size_t used) {
+    fill(data, data + used, 0x00); //clear the bytes the caller used before the buffer is handed out again, the rest was never written
+    {
+        lock_guard<mutex> lock(poolMutex); //lock pool
+        freeBuffers.push_back(data); //return buffer, never allocates since all buffers fit in reserved room
+    }
+    poolCondition.notify_one(); //wake a thread waiting for a buffer
+}
+
+
+/**
+ * @brief  Function that takes a buffer from the pool and wraps it in a handle of given size, must be called with poolMutex locked.
+ * @param  size_t size
+ * @return  Buffer buffer
+ */
+AESBufferPool::Buffer AESBufferPool::Take(const size_t size) {
+    Buffer buffer(this, freeBuffers.back()); //wrap most recently returned buffer, it's most likely still in cache
+    freeBuffers.pop_back(); //remove buffer from pool
+    buffer.size = buffer.used = size; //set size
+    return buffer; //return buffer
+}
+
+
+/**
+ * @brief  Function that returns a buffer of given size from the pool, waits until a buffer is returned if all are in use.
+ * @brief  Size must leave room for a padding block, so it's at most GetBufferSize.
+ * @param  size_t size
+ * @return  Buffer buffer
+ * @throws  invalid_argument thrown if given size is larger than buffer size.
+ */
+AESBufferPool::Buffer AESBufferPool::Acquire(const size_t size) {
+    if (size > GetBufferSize()) //if size doesn't leave room for padding
+        throw invalid_argument("Invalid size, please provide size that leaves room for a padding block in the buffer."); //throw invalid argument
+    unique_lock<mutex> lock(poolMutex); //lock pool
+    poolCondition.wait(lock, [this] { return !freeBuffers.empty(); }); //wait until a buffer is available
+    return Take(size); //return buffer
+}
+
+
+/**
+ * @brief  Function that returns a buffer of given size from the pool, or an empty handle if all are in use.
+ * @brief  Size must leave room for a padding block, so it's at most GetBufferSize.
+ * @param  size_t size
+ * @return  Buffer buffer
+ * @throws  invalid_argument thrown if given size is larger than buffer size.
+ */
+AESBufferPool::Buffer AESBufferPool::TryAcquire(const size_t size) {
+    if (size > GetBufferSize()) //if size doesn't leave room for padding
+        throw invalid_argument("Invalid size, please provide size that leaves room for a padding block in the buffer."); //throw invalid argument
+    lock_guard<mutex> lock(poolMutex); //lock pool
+    if (freeBuffers.empty()) //if all buffers are in use
+        return Buffer(); //return empty handle
+    return Take(size); //return buffer
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes each buffer can hold, including the room for padding.
+ * @return  size_t capacity
+ */
+size_t AESBufferPool::GetBufferCapacity() const {
+    return capacity; //return capacity
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes of data each buffer can hold, which leaves room for a padding block and is at least the requested buffer size.
+ * @return  size_t bufferSize
+ */
+size_t AESBufferPool::GetBufferSize() const {
+    return capacity - BlockSize; //capacity always includes a padding block
+}
+
+
+/**
+ * @brief  Function that returns the number of buffers in the pool.
+ * @return  size_t count
+ */
+size_t AESBufferPool::GetCount() const {
+    return count; //return count
+}
+
+
+/**
+ * @brief  Function that returns the number of buffers that aren't in use.
+ * @return  size_t available
+ */
+size_t AESBufferPool::GetAvailable() {
+    lock_guard<mutex> lock(poolMutex); //lock pool
+    return freeBuffers.size(); //return number of free buffers
+}
+
+
+/**
+ * @brief  Function that returns if the region is backed by explicit huge pages, otherwise transparent huge pages were requested.
+ * @return  bool isHugePages
+ */
+bool AESBufferPool::IsHugePages() const {
+    return hugePages; //return true if explicit huge pages are used
+}
+
+
+/**
+ * @brief  Function that returns if the region is locked in memory so it can't be swapped out.
+ * @return  bool isLocked
+ */
+bool AESBufferPool::IsLocked() const {
+    return locked; //return true if region is locked
+}
+
+
+/**
+ * @brief  Function that adds 1 to 16 bytes of PKCS7 padding to given buffer, a full block if its size is a multiple of 16 bytes.
+ * @param  Buffer buffer
+ * @param  string mode
+ * @throws  invalid_argument thrown if given buffer is invalid.
+ */
+void AESBufferPool::Pad(Buffer& buffer, const string& mode) {
+    if (!buffer.IsValid()) //if buffer holds no memory
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES " + mode + " requirements."); //throw invalid argument
+    size_t size = buffer.Size(); //represents size before padding
+    unsigned char padding = (unsigned char)(BlockSize - (size % BlockSize)); //calculate the number of padding bytes, a full block if size is a multiple of 16 bytes
+    buffer.Resize(size + padding); //grow buffer into room past requested size, always fits
+    fill(buffer.Data() + size, buffer.Data() + size + padding, padding); //write the padding bytes
+}
+
+
+/**
+ * @brief  Function that removes PKCS7 padding from given buffer, the decrypted text is cleared if the padding is invalid.
+ * @param  Buffer buffer
+ * @throws  invalid_argument thrown if given buffer doesn't end in valid padding.
+ */
+void AESBufferPool::Unpad(Buffer& buffer) {
+    unsigned char* data = buffer.Data(); //represents deciphered text
+    size_t size = buffer.Size(); //represents size with padding, a nonzero multiple of 16 bytes
+    unsigned char value = data[size - 1]; //get the value of the last byte, which indicates the padding size
+    unsigned char mismatch = (unsigned char)(value == 0 || value > BlockSize); //represents if padding is invalid, checked without early exit
+    for (size_t i = size - BlockSize; i < size; i++) //iterate over bytes of last block
+        mismatch |= (unsigned char)((i >= size - value) & (data[i] != value)); //each padding byte must equal padding size
+    if (mismatch) { //if padding is invalid we don't hand out the decrypted text
+        fill(data, data + size, 0x00); //clear decrypted text
+        throw invalid_argument("Invalid padding, please provide ciphertext with valid PKCS7 padding."); //throw invalid argument
+    }
+    buffer.Resize(size - value); //remove the padding bytes from the buffer
+}
+
+
+/**
+ * @brief  Function that checks that given buffer holds whole blocks for decryption in given mode.
+ * @param  Buffer buffer
+ * @param  string mode
+ * @throws  invalid_argument thrown if given buffer is empty or isn't a multiple of 16 bytes.
+ */
+void AESBufferPool::CheckBlocks(const Buffer& buffer, const string& mode) {
+    if (!buffer.IsValid() || buffer.Size() == 0 || buffer.Size() % BlockSize != 0) //if buffer is empty or size isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES " + mode + " requirements."); //throw invalid argument
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in ECB mode on given buffer in place using specified key.
+ * @brief  Always adds PKCS7 padding in the room past the buffer size, a full block if the size is a multiple of 16 bytes.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given buffer or key is invalid.
+ */
+void AESBufferPool::Encrypt_ECB(Buffer& buffer, const vector<unsigned char>& key) {
+    Pad(buffer, "ECB"); //add padding in place
+    AESParallel::Encrypt_ECB(buffer.Data(), buffer.Data(), buffer.Size(), key); //encrypt buffer in place
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in ECB mode on given buffer in place using specified key.
+ * @brief  Removes PKCS7 padding by resizing the buffer and rejects invalid padding.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given buffer, key or padding is invalid.
+ */
+void AESBufferPool::Decrypt_ECB(Buffer& buffer, const vector<unsigned char>& key) {
+    CheckBlocks(buffer, "ECB"); //check buffer holds whole blocks
+    AESParallel::Decrypt_ECB(buffer.Data(), buffer.Data(), buffer.Size(), key); //decrypt buffer in place
+    Unpad(buffer); //remove padding
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CBC mode on given buffer in place using specified key and iv, iv is updated for the next call.
+ * @brief  Always adds PKCS7 padding in the room past the buffer size, a full block if the size is a multiple of 16 bytes.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+ */
+void AESBufferPool::Encrypt_CBC(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv) {
+    Pad(buffer, "CBC"); //add padding in place
+    AESParallel::Encrypt_CBC(buffer.Data(), buffer.Data(), buffer.Size(), key, iv); //encrypt buffer in place
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CBC mode on given buffer in place using specified key and iv, iv is updated for the next call.
+ * @brief  Removes PKCS7 padding by resizing the buffer and rejects invalid padding.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffer, key, iv or padding is invalid.
+ */
+void AESBufferPool::Decrypt_CBC(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv) {
+    CheckBlocks(buffer, "CBC"); //check buffer holds whole blocks
+    AESParallel::Decrypt_CBC(buffer.Data(), buffer.Data(), buffer.Size(), key, iv); //decrypt buffer in place
+    Unpad(buffer); //remove padding
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CTR mode on given buffer in place using specified key and iv, iv is updated for the next call.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+ */
+void AESBufferPool::Encrypt_CTR(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv) {
+    if (!buffer.IsValid()) //if handle is empty
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CTR requirements."); //throw invalid argument
+    AESParallel::Encrypt_CTR(buffer.Data(), buffer.Data(), buffer.Size(), key, iv); //encrypt buffer in place
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CTR mode on given buffer in place using specified key and iv, iv is updated for the next call.
+ * @param  Buffer buffer
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+ */
+void AESBufferPool::Decrypt_CTR(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv) {
+    if (!buffer.IsValid()) //if handle is empty
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES CTR requirements."); //throw invalid argument
+    AESParallel::Decrypt_CTR(buffer.Data(), buffer.Data(), buffer.Size(), key, iv); //decrypt buffer in place
+}
@@ -0,0 +1,303 @@
+#ifndef _AESBUFFERPOOL_H
+#define _AESBUFFERPOOL_H
+#include "AESParallel.h"
+#include <condition_variable>
+
+/**
+ * @file AESBufferPool.h
+ * @brief  AESBufferPool class for a reusable pool of pinned, pre-faulted buffers for bulk encryption.
+ * @brief  All buffers of a pool live in one region backed by 2 MB huge pages, explicit huge pages if the system has them reserved and transparent huge pages otherwise.
+ * @brief  The region is optionally bound to a NUMA node, locked in memory if the memory limit allows it and touched once when the pool is created, so using a buffer never page faults.
+ * @brief  Buffers are aligned to 64 bytes and have room for a block of padding past the requested size, so CBC and ECB padding is added in place.
+ * @brief  Buffers are returned to the pool when their handle is destroyed, the pool must outlive all of its buffers.
+ */
+class AESBufferPool : public AESParallel {
+public:
+	/**
+	 * @brief  Represents a buffer acquired from a pool, returns the buffer to the pool when destroyed.
+	 */
+	class Buffer {
+	public:
+		/**
+		 * @brief  Constructor that creates an empty handle that holds no buffer.
+		 */
+		Buffer();
+
+		/**
+		 * @brief  Constructor that takes the buffer of given handle, which is left empty.
+		 * @param  Buffer other
+		 */
+		Buffer(Buffer&& other) noexcept;
+
+		/**
+		 * @brief  Operator that returns the current buffer to its pool and takes the buffer of given handle, which is left empty.
+		 * @param  Buffer other
+		 * @return  Buffer buffer
+		 */
+		Buffer& operator=(Buffer&& other) noexcept;
+
+		/**
+		 * @brief  Destructor that returns the buffer to its pool.
+		 */
+		~Buffer();
+
+		Buffer(const Buffer&) = delete;
+		Buffer& operator=(const Buffer&) = delete;
+
+		/**
+		 * @brief  Function that returns the data of the buffer, NULL if the handle is empty.
+		 * @return  unsigned char* data
+		 */
+		unsigned char* Data();
+
+		/**
+		 * @brief  Function that returns the data of the buffer, NULL if the handle is empty.
+		 * @return  const unsigned char* data
+		 */
+		const unsigned char* Data() const;
+
+		/**
+		 * @brief  Function that returns the number of bytes in use of the buffer.
+		 * @return  size_t size
+		 */
+		size_t Size() const;
+
+		/**
+		 * @brief  Function that returns the number of bytes the buffer can hold.
+		 * @return  size_t capacity
+		 */
+		size_t Capacity() const;
+
+		/**
+		 * @brief  Function that sets the number of bytes in use of the buffer, the contents aren't changed.
+		 * @param  size_t size
+		 * @throws  invalid_argument thrown if given size is larger than capacity.
+		 */
+		void Resize(const size_t size);
+
+		/**
+		 * @brief  Function that returns if the handle holds a buffer.
+		 * @return  bool isValid
+		 */
+		bool IsValid() const;
+
+		/**
+		 * @brief  Function that clears the buffer and returns it to its pool, the handle is left empty.
+		 */
+		void Release();
+
+	private:
+		friend class AESBufferPool;
+		AESBufferPool* pool; //pool that owns the buffer, NULL if handle is empty
+		unsigned char* data; //data of buffer
+		size_t size; //number of bytes in use
+		size_t used; //largest size the buffer had, cleared when the buffer is returned
+
+		/**
+		 * @brief  Constructor that wraps given buffer of given pool.
+		 * @param  AESBufferPool* pool
+		 * @param  unsigned char* data
+		 */
+		Buffer(AESBufferPool* pool, unsigned char* data);
+	};
+
+	/**
+	 * @brief  Constructor that maps, binds, locks and pre-faults a region for given number of buffers of given size.
+	 * @param  size_t bufferSize
+	 * @param  size_t count
+	 * @param  int numaNode
+	 * @throws  invalid_argument thrown if given buffer size or count is invalid.
+	 * @throws  runtime_error thrown if memory can't be mapped or bound to given NUMA node.
+	 */
+	AESBufferPool(const size_t bufferSize, const size_t count, const int numaNode = -1);
+
+	/**
+	 * @brief  Destructor that clears and unmaps the region, all buffers must be returned before.
+	 */
+	~AESBufferPool();
+
+	AESBufferPool(const AESBufferPool&) = delete;
+	AESBufferPool& operator=(const AESBufferPool&) = delete;
+
+	/**
+	 * @brief  Function that returns a buffer of given size from the pool, waits until a buffer is returned if all are in use.
+	 * @brief  Size must leave room for a padding block, so it's at most GetBufferSize.
+	 * @param  size_t size
+	 * @return  Buffer buffer
+	 * @throws  invalid_argument thrown if given size is larger than buffer size.
+	 */
+	Buffer Acquire(const size_t size = 0);
+
+	/**
+	 * @brief  Function that returns a buffer of given size from the pool, or an empty handle if all are in use.
+	 * @brief  Size must leave room for a padding block, so it's at most GetBufferSize.
+	 * @param  size_t size
+	 * @return  Buffer buffer
+	 * @throws  invalid_argument thrown if given size is larger than buffer size.
+	 */
+	Buffer TryAcquire(const size_t size = 0);
+
+	/**
+	 * @brief  Function that returns the number of bytes each buffer can hold, including the room for padding.
+	 * @return  size_t capacity
+	 */
+	size_t GetBufferCapacity() const;
+
+	/**
+	 * @brief  Function that returns the number of bytes of data each buffer can hold, which leaves room for a padding block and is at least the requested buffer size.
+	 * @return  size_t bufferSize
+	 */
+	size_t GetBufferSize() const;
+
+	/**
+	 * @brief  Function that returns the number of buffers in the pool.
+	 * @return  size_t count
+	 */
+	size_t GetCount() const;
+
+	/**
+	 * @brief  Function that returns the number of buffers that aren't in use.
+	 * @return  size_t available
+	 */
+	size_t GetAvailable();
+
+	/**
+	 * @brief  Function that returns if the region is backed by explicit huge pages, otherwise transparent huge pages were requested.
+	 * @return  bool isHugePages
+	 */
+	bool IsHugePages() const;
+
+	/**
+	 * @brief  Function that returns if the region is locked in memory so it can't be swapped out.
+	 * @return  bool isLocked
+	 */
+	bool IsLocked() const;
+
+	/**
+	 * @brief  Function that performs AES encryption in ECB mode on given buffer in place using specified key.
+	 * @brief  Always adds PKCS7 padding in the room past the buffer size, a full block if the size is a multiple of 16 bytes.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given buffer or key is invalid.
+	 */
+	static void Encrypt_ECB(Buffer& buffer, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES decryption in ECB mode on given buffer in place using specified key.
+	 * @brief  Removes PKCS7 padding by resizing the buffer and rejects invalid padding.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given buffer, key or padding is invalid.
+	 */
+	static void Decrypt_ECB(Buffer& buffer, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES encryption in CBC mode on given buffer in place using specified key and iv, iv is updated for the next call.
+	 * @brief  Always adds PKCS7 padding in the room past the buffer size, a full block if the size is a multiple of 16 bytes.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+	 */
+	static void Encrypt_CBC(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CBC mode on given buffer in place using specified key and iv, iv is updated for the next call.
+	 * @brief  Removes PKCS7 padding by resizing the buffer and rejects invalid padding.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffer, key, iv or padding is invalid.
+	 */
+	static void Decrypt_CBC(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in CTR mode on given buffer in place using specified key and iv, iv is updated for the next call.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+	 */
+	static void Encrypt_CTR(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CTR mode on given buffer in place using specified key and iv, iv is updated for the next call.
+	 * @param  Buffer buffer
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffer, key or iv is invalid.
+	 */
+	static void Decrypt_CTR(Buffer& buffer, const vector<unsigned char>& key, unsigned char* iv);
+
+protected:
+	/**
+	 * @brief  Represents the size in bytes of a huge page, the region is a multiple of it.
+	 */
+	static const size_t HugePageSize = 2 * 1024 * 1024;
+
+	/**
+	 * @brief  Represents the alignment in bytes of each buffer, a cache line.
+	 */
+	static const size_t Alignment = 64;
+
+	/**
+	 * @brief  Function that adds 1 to 16 bytes of PKCS7 padding to given buffer, a full block if its size is a multiple of 16 bytes.
+	 * @param  Buffer buffer
+	 * @param  string mode
+	 * @throws  invalid_argument thrown if given buffer is invalid.
+	 */
+	static void Pad(Buffer& buffer, const string& mode);
+
+	/**
+	 * @brief  Function that removes PKCS7 padding from given buffer, the decrypted text is cleared if the padding is invalid.
+	 * @param  Buffer buffer
+	 * @throws  invalid_argument thrown if given buffer doesn't end in valid padding.
+	 */
+	static void Unpad(Buffer& buffer);
+
+	/**
+	 * @brief  Function that checks that given buffer holds whole blocks for decryption in given mode.
+	 * @param  Buffer buffer
+	 * @param  string mode
+	 * @throws  invalid_argument thrown if given buffer is empty or isn't a multiple of 16 bytes.
+	 */
+	static void CheckBlocks(const Buffer& buffer, const string& mode);
+
+private:
+	unsigned char* region; //region of all buffers
+	size_t regionSize; //size of region in bytes, a multiple of huge page size
+	size_t capacity; //capacity of each buffer in bytes
+	size_t count; //number of buffers
+	bool hugePages; //true if region is backed by explicit huge pages
+	bool locked; //true if region is locked in memory
+	vector<unsigned char*> freeBuffers; //buffers that aren't in use, reserved for all buffers so returning never allocates
+	mutex poolMutex; //guards freeBuffers
+	condition_variable poolCondition; //wakes threads waiting for a buffer
+
+	/**
+	 * @brief  Function that maps a region of given size, binds it to given NUMA node and locks it.
+	 * @param  int numaNode
+	 * @throws  runtime_error thrown if memory can't be mapped or bound to given NUMA node.
+	 */
+	void Map(const int numaNode);
+
+	/**
+	 * @brief  Function that unmaps the region.
+	 */
+	void Unmap();
+
+	/**
+	 * @brief  Function that clears given number of bytes of given buffer and returns it to the pool.
+	 * @param  unsigned char* data
+	 * @param  size_t used
+	 */
+	void Return(unsigned char* data, const size_t used);
+
+	/**
+	 * @brief  Function that takes a buffer from the pool and wraps it in a handle of given size, must be called with poolMutex locked.
+	 * @param  size_t size
+	 * @return  Buffer buffer
+	 */
+	Buffer Take(const size_t size);
+};
+#endif
@@ -0,0 +1,424 @@
+#include "AESChecksum.h"
+#include "AESProfiler.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES_CRC_TARGET
+#else
+#define AES_CRC_TARGET __attribute__((target("sse4.2")))
+#endif
+#define AES_CHECKSUM_SSE42
+#endif
+
+
+//use the SSE4.2 CRC32 instruction by default when the processor supports it
+atomic<bool> AESChecksum::sse42Enabled{ true };
+
+
+#ifdef AES_CHECKSUM_SSE42
+/**
+ * @brief  Function that updates given raw CRC32C state with given buffer using the SSE4.2 CRC32 instruction, eight bytes at a time.
+ * @param  uint32_t state
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @return  uint32_t state
+ */
+AES_CRC_TARGET static uint32_t UpdateSSE42(const uint32_t state, const unsigned char* data, size_t length) {
+    uint64_t crc = state; //represents state widened for 64 bit instruction
+    for (; length >= 8; data += 8, length -= 8) { //iterate over eight byte words
+        uint64_t word; //represents current word
+        memcpy(&word, data, sizeof(word)); //load word, data may be unaligned
+        crc = _mm_crc32_u64(crc, word); //add word to state
+    }
+    uint32_t result = (uint32_t)crc; //represents state of remaining bytes
+    for (; length > 0; data++, length--) //iterate over remaining bytes
+        result = _mm_crc32_u8(result, *data); //add byte to state
+    return result;
+}
+#endif
+
+
+/**
+ * @brief  Function that returns the lookup tables, they're generated on first use.
+ * @return  Table table
+ */
+const AESChecksum::Table& AESChecksum::GetTable() {
+    static const Table table = []() { //generate tables once
+        Table generated; //represents generated tables
+        for (uint32_t i = 0; i < 256; i++) { //iterate over byte values
+            uint32_t crc = i; //represents remainder of byte
+            for (size_t bit = 0; bit < 8; bit++) //iterate over bits of byte
+                crc = (crc & 1) ? (crc >> 1) ^ Polynomial : crc >> 1; //divide by polynomial in reflected order
+            generated.values[0][i] = crc; //set remainder of byte
+        }
+        for (size_t k = 1; k < 8; k++) //iterate over slices
+            for (size_t i = 0; i < 256; i++) //iterate over byte values
+                generated.values[k][i] = (generated.values[k - 1][i] >> 8) ^ generated.values[0][generated.values[k - 1][i] & 0xFF]; //advance previous slice by one zero byte
+        return generated;
+    }();
+    return table;
+}
+
+
+/**
+ * @brief  Function that updates given raw CRC32C state with given buffer using the lookup tables.
+ * @param  uint32_t state
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @return  uint32_t state
+ */
+uint32_t AESChecksum::UpdateTable(uint32_t state, const unsigned char* data, size_t length) {
+    const Table& table = GetTable(); //represents lookup tables
+    for (; length >= 8; data += 8, length -= 8) { //iterate over eight byte words
+        state ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24); //add first four bytes to state in little endian
+        state = table.values[7][state & 0xFF] ^ table.values[6][(state >> 8) & 0xFF] ^ table.values[5][(state >> 16) & 0xFF] ^ table.values[4][state >> 24]
+            ^ table.values[3][data[4]] ^ table.values[2][data[5]] ^ table.values[1][data[6]] ^ table.values[0][data[7]]; //advance state past all eight bytes at once
+    }
+    for (; length > 0; data++, length--) //iterate over remaining bytes
+        state = (state >> 8) ^ table.values[0][(state ^ *data) & 0xFF]; //add byte to state
+    return state;
+}
+
+
+/**
+ * @brief  Function that updates given raw CRC32C state with given buffer, using SSE4.2 if it's available and enabled.
+ * @param  uint32_t state
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @return  uint32_t state
+ */
+uint32_t AESChecksum::Update(const uint32_t state, const unsigned char* data, const size_t length) {
+#ifdef AES_CHECKSUM_SSE42
+    if (UsesSSE42()) //if CRC32 instruction can be used
+        return UpdateSSE42(state, data, length); //update state with CRC32 instruction
+#endif
+    return UpdateTable(state, data, length); //update state with lookup tables
+}
+
+
+/**
+ * @brief  Function that returns the CRC32C of given buffer, continuing from given CRC32C of the data before it.
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @param  uint32_t crc
+ * @return  uint32_t crc
+ */
+uint32_t AESChecksum::CRC32C(const unsigned char* data, const size_t length, const uint32_t crc) {
+    if (length == 0 || data == NULL) //if there's nothing to add
+        return crc;
+    return ~Update(~crc, data, length); //undo final inversion, add buffer and invert again
+}
+
+
+/**
+ * @brief  Function that multiplies two polynomials modulo the CRC32C polynomial, both in reflected bit order.
+ * @param  uint32_t first
+ * @param  uint32_t second
+ * @return  uint32_t product
+ */
+uint32_t AESChecksum::Multiply(uint32_t first, uint32_t second) {
+    uint32_t product = 0; //represents product
+    for (uint32_t bit = 1u << 31; bit != 0 && first != 0; bit >>= 1) { //iterate over coefficients of first from x^0 upwards
+        if (first & bit) { //if coefficient is set
+            product ^= second; //add second times current power of x
+            first ^= bit; //remove coefficient, loop ends after the highest one
+        }
+        second = (second & 1) ? (second >> 1) ^ Polynomial : second >> 1; //multiply second by x modulo polynomial
+    }
+    return product;
+}
+
+
+/**
+ * @brief  Function that returns the CRC32C of two concatenated buffers from the CRC32C of each and the length of the second.
+ * @param  uint32_t first
+ * @param  uint32_t second
+ * @param  size_t secondLength
+ * @return  uint32_t crc
+ */
+uint32_t AESChecksum::Combine(const uint32_t first, const uint32_t second, const size_t secondLength) {
+    uint32_t power = 1u << 31, square = 1u << 23; //represents x^(8 * length) accumulated so far and x^8 raised to the current bit of length
+    for (size_t length = secondLength; length > 0; length >>= 1) { //iterate over bits of length
+        if (length & 1) //if bit is set
+            power = Multiply(power, square); //multiply power by square of bit
+        square = Multiply(square, square); //square for next bit
+    }
+    return Multiply(power, first) ^ second; //shift first past second and add second, the inversions cancel out
+}
+
+
+/**
+ * @brief  Function that returns if the processor supports SSE4.2, in which case checksums use the CRC32 instruction unless disabled.
+ * @return  bool hasSSE42
+ */
+bool AESChecksum::HasSSE42() {
+#if defined(AES_CHECKSUM_SSE42) && defined(_MSC_VER)
+    static const bool hasSSE42 = []() { int info[4]{}; __cpuid(info, 1); return ((info[2] >> 20) & 1) != 0; }(); //check SSE4.2 bit of CPUID leaf 1 once
+    return hasSSE42; //return cached result
+#elif defined(AES_CHECKSUM_SSE42)
+    static const bool hasSSE42 = __builtin_cpu_supports("sse4.2"); //check processor features once
+    return hasSSE42; //return cached result
+#else
+    return false; //CRC32 instruction isn't available on this architecture
+#endif
+}
+
+
+/**
+ * @brief  Function that enables or disables the SSE4.2 CRC32 instruction, it's only used if the processor supports it.
+ * @param  bool enabled
+ */
+void AESChecksum::SetSSE42(const bool enabled) {
+    sse42Enabled = enabled; //set if SSE4.2 is enabled
+}
+
+
+/**
+ * @brief  Function that returns if checksums use the SSE4.2 CRC32 instruction, which requires it to be enabled and supported by the processor.
+ * @return  bool usesSSE42
+ */
+bool AESChecksum::UsesSSE42() {
+    return sse42Enabled && HasSSE42(); //return if SSE4.2 is enabled and supported
+}
+
+
+/**
+ * @brief  Function that performs given mode on given range block by block and returns its requested checksums.
+ * @brief  Chain holds the previous cipher block in CBC mode or the counter in CTR mode and is updated past the range.
+ * @param  Mode mode
+ * @param  bool encrypt
+ * @param  KeyContext context
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  unsigned char* chain
+ * @param  int checksums
+ * @param  bool streaming
+ * @return  Checksums checksums
+ */
+AESChecksum::Checksums AESChecksum::ProcessRange(const Mode mode, const bool encrypt, const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* chain, const int checksums, const bool streaming) {
+    uint32_t inputState = 0xFFFFFFFF, outputState = 0xFFFFFFFF; //represents raw CRC32C states of input and output
+    unsigned char block[BlockSize], saved[BlockSize]; //represents current block and saved cipher block or keystream
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over range
+        PrefetchAhead(input + i, streaming); //prefetch input ahead when streaming
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last CTR block may be partial
+        memcpy(block, input + i, size); //copy block, input and output may be the same buffer
+        if (checksums & InputChecksum) //if input checksum is requested
+            inputState = Update(inputState, block, size); //add input block while it's on the stack
+        if (mode == ECBMode) { //if mode is ECB
+            if (encrypt) //if we encrypt
+                EncryptBlock(block, context.roundKeys, context.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+            else //else we decrypt
+                DecryptBlock(block, context.roundKeys, context.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+        }
+        else if (mode == CBCMode && encrypt) { //if mode is CBC encryption
+            XOR(block, chain); //XOR with previous cipher block
+            EncryptBlock(block, context.roundKeys, context.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+            memcpy(chain, block, BlockSize); //update previous cipher block with new cipher block
+        }
+        else if (mode == CBCMode) { //if mode is CBC decryption
+            memcpy(saved, block, BlockSize); //save current cipher block
+            DecryptBlock(block, context.roundKeys, context.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+            XOR(block, chain); //XOR with previous cipher block
+            memcpy(chain, saved, BlockSize); //update previous cipher block with current cipher block
+        }
+        else { //else mode is CTR
+            memcpy(saved, chain, BlockSize); //set keystream to current counter for encryption
+            EncryptBlock(saved, context.roundKeys, context.rounds); //encrypt the counter using our AES EncryptBlock function using flat round keys
+            for (size_t j = 0; j < size; j++) //iterate over block
+                block[j] ^= saved[j]; //perform byte XOR between input and keystream block
+            AddCounter(chain, 1); //increase counter for next block
+        }
+        if (checksums & OutputChecksum) //if output checksum is requested
+            outputState = Update(outputState, block, size); //add output block before it's stored
+        if (size == BlockSize) //if block is full
+            StoreBlock(output + i, block, streaming); //store output block, around the cache when streaming
+        else //else last block is partial
+            memcpy(output + i, block, size); //copy partial block to output
+    }
+    StreamFence(streaming); //make streamed output visible before the range is reported as done
+    fill(block, block + BlockSize, 0x00); //clear last output block
+    fill(saved, saved + BlockSize, 0x00); //clear saved input block
+    Checksums result; //represents checksums of range
+    result.input = (checksums & InputChecksum) ? ~inputState : 0; //finalize input checksum
+    result.output = (checksums & OutputChecksum) ? ~outputState : 0; //finalize output checksum
+    return result;
+}
+
+
+/**
+ * @brief  Function that validates given buffer, key and iv, performs given mode and returns the requested checksums.
+ * @brief  Chunks are processed in parallel if the buffer is large enough, except for CBC encryption which is sequential.
+ * @param  Mode mode
+ * @param  bool encrypt
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given length, key or iv is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Process(const Mode mode, const bool encrypt, const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums) {
+    const string name = mode == ECBMode ? "ECB" : mode == CBCMode ? "CBC" : "CTR"; //represents name of mode for error messages
+    if ((length > 0 && (input == NULL || output == NULL)) || (mode != CTRMode && length % BlockSize != 0)) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + name + " requirements."); //throw invalid argument
+    KeyContext context = Expand(key); //validate key and expand round keys
+    if (mode != ECBMode && iv == NULL) //if IV is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + name + " requirements."); //throw invalid argument
+    Checksums result; //represents checksums of whole buffer
+    const bool streaming = IsStreaming(input, output, length); //represents if output bypasses the cache
+    if (mode == CBCMode && encrypt) //if mode is CBC encryption every block depends on the previous one
+        result = ProcessRange(mode, encrypt, context, input, output, length, iv, checksums, streaming); //process whole buffer on calling thread, updates IV
+    else if (length > 0) { //else chunks are independent
+        const size_t chunk = max(BlockSize, GetChunkSize() / BlockSize * BlockSize); //represents chunk size rounded down to full blocks
+        const size_t count = (length + chunk - 1) / chunk; //represents number of chunks
+        vector<unsigned char> chains(count * BlockSize); //represents chaining value of each chunk, saved before chunks are processed in place
+        for (size_t offset = 0; offset < length && mode != ECBMode; offset += chunk) { //iterate over chunk offsets
+            unsigned char* chain = chains.data() + (offset / chunk) * BlockSize; //represents chaining value of chunk
+            if (mode == CBCMode) //if mode is CBC we need the cipher block before chunk
+                memcpy(chain, offset == 0 ? iv : input + offset - BlockSize, BlockSize); //save cipher block before chunk
+            else { //else mode is CTR and we need the counter of the first block of chunk
+                memcpy(chain, iv, BlockSize); //initialize counter with IV
+                AddCounter(chain, offset / BlockSize); //add number of blocks before chunk to counter
+            }
+        }
+        if (mode == CBCMode) //if mode is CBC decryption
+            memcpy(iv, input + length - BlockSize, BlockSize); //update IV with last cipher block for next call
+        else if (mode == CTRMode) //if mode is CTR
+            AddCounter(iv, (length + BlockSize - 1) / BlockSize); //update IV with counter of next block for next call
+        vector<Checksums> parts(count); //represents checksums of each chunk
+        vector<size_t> sizes(count, 0); //represents length each checksum covers, a single task covers the whole buffer
+        ForEachChunk(length, chunk, [&](size_t offset, size_t size) { //process each chunk
+            const size_t index = offset / chunk; //represents index of chunk
+            parts[index] = ProcessRange(mode, encrypt, context, input + offset, output + offset, size, chains.data() + index * BlockSize, checksums, streaming); //process chunk
+            sizes[index] = size; //set length covered by checksums of chunk
+        });
+        for (size_t i = 0; i < count; i++) { //iterate over chunks in order
+            if (sizes[i] == 0) //if chunk was covered by a previous task
+                continue;
+            result.input = Combine(result.input, parts[i].input, sizes[i]); //append input checksum of chunk
+            result.output = Combine(result.output, parts[i].output, sizes[i]); //append output checksum of chunk
+        }
+        fill(chains.begin(), chains.end(), 0x00); //clear chaining values of chunks
+    }
+    Clear(context); //clear round keys of buffer, checksums are computed
+    return result;
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in ECB mode on given buffer and returns the requested checksums.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const int checksums) {
+    AES_PROFILE_SCOPE("ECB-Encrypt-CRC", length); //profile ECB encryption with fused checksums
+    return Process(ECBMode, true, input, output, length, key, NULL, checksums); //encrypt buffer
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in ECB mode on given buffer and returns the requested checksums.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const int checksums) {
+    AES_PROFILE_SCOPE("ECB-Decrypt-CRC", length); //profile ECB decryption with fused checksums
+    return Process(ECBMode, false, input, output, length, key, NULL, checksums); //decrypt buffer
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CBC mode on given buffer and returns the requested checksums, iv is updated for the next call.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums) {
+    AES_PROFILE_SCOPE("CBC-Encrypt-CRC", length); //profile CBC encryption with fused checksums
+    return Process(CBCMode, true, input, output, length, key, iv, checksums); //encrypt buffer
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CBC mode on given buffer and returns the requested checksums, iv is updated for the next call.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums) {
+    AES_PROFILE_SCOPE("CBC-Decrypt-CRC", length); //profile CBC decryption with fused checksums
+    return Process(CBCMode, false, input, output, length, key, iv, checksums); //decrypt buffer
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CTR mode on given buffer and returns the requested checksums, iv is updated for the next call.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums) {
+    AES_PROFILE_SCOPE("CTR-Encrypt-CRC", length); //profile CTR encryption with fused checksums
+    return Process(CTRMode, true, input, output, length, key, iv, checksums); //encrypt buffer
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CTR mode on given buffer and returns the requested checksums, iv is updated for the next call.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  int checksums
+ * @return  Checksums checksums
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESChecksum::Checksums AESChecksum::Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums) {
+    AES_PROFILE_SCOPE("CTR-Decrypt-CRC", length); //profile CTR decryption with fused checksums
+    return Process(CTRMode, false, input, output, length, key, iv, checksums); //CTR decryption is the same operation as CTR encryption
+}
@@ -0,0 +1,241 @@
+#ifndef _AESCHECKSUM_H
+#define _AESCHECKSUM_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+
+/**
+ * @file AESChecksum.h
+ * @brief  AESChecksum class for bulk ECB, CBC and CTR operations that compute the CRC32C of the input and output in the same pass.
+ * @brief  Each block is checksummed while it's held on the stack for the block cipher, so the checksums don't need extra passes over memory.
+ * @brief  On x86-64 processors with SSE4.2 the CRC32 instruction is used, otherwise a slicing-by-8 table.
+ * @brief  Large buffers are split over the AESParallel worker pool, the checksums of the chunks are combined into the checksum of the whole buffer.
+ */
+class AESChecksum : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents the checksums that are computed, they can be combined.
+	 */
+	enum Checksum { NoChecksum = 0, InputChecksum = 1, OutputChecksum = 2, BothChecksums = 3 };
+
+	/**
+	 * @brief  Represents the CRC32C checksums of a buffer, a checksum that wasn't requested is 0.
+	 */
+	struct Checksums {
+		uint32_t input = 0; //CRC32C of input
+		uint32_t output = 0; //CRC32C of output
+	};
+
+	/**
+	 * @brief  Function that returns the CRC32C of given buffer, continuing from given CRC32C of the data before it.
+	 * @param  const unsigned char* data
+	 * @param  size_t length
+	 * @param  uint32_t crc
+	 * @return  uint32_t crc
+	 */
+	static uint32_t CRC32C(const unsigned char* data, const size_t length, const uint32_t crc = 0);
+
+	/**
+	 * @brief  Function that returns the CRC32C of two concatenated buffers from the CRC32C of each and the length of the second.
+	 * @param  uint32_t first
+	 * @param  uint32_t second
+	 * @param  size_t secondLength
+	 * @return  uint32_t crc
+	 */
+	static uint32_t Combine(const uint32_t first, const uint32_t second, const size_t secondLength);
+
+	/**
+	 * @brief  Function that returns if the processor supports SSE4.2, in which case checksums use the CRC32 instruction unless disabled.
+	 * @return  bool hasSSE42
+	 */
+	static bool HasSSE42();
+
+	/**
+	 * @brief  Function that enables or disables the SSE4.2 CRC32 instruction, it's only used if the processor supports it.
+	 * @param  bool enabled
+	 */
+	static void SetSSE42(const bool enabled);
+
+	/**
+	 * @brief  Function that returns if checksums use the SSE4.2 CRC32 instruction, which requires it to be enabled and supported by the processor.
+	 * @return  bool usesSSE42
+	 */
+	static bool UsesSSE42();
+
+	/**
+	 * @brief  Function that performs AES encryption in ECB mode on given buffer and returns the requested checksums.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static Checksums Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const int checksums = BothChecksums);
+
+	/**
+	 * @brief  Function that performs AES decryption in ECB mode on given buffer and returns the requested checksums.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static Checksums Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, const int checksums = BothChecksums);
+
+	/**
+	 * @brief  Function that performs AES encryption in CBC mode on given buffer and returns the requested checksums, iv is updated for the next call.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Checksums Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums = BothChecksums);
+
+	/**
+	 * @brief  Function that performs AES decryption in CBC mode on given buffer and returns the requested checksums, iv is updated for the next call.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Checksums Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums = BothChecksums);
+
+	/**
+	 * @brief  Function that performs AES encryption in CTR mode on given buffer and returns the requested checksums, iv is updated for the next call.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Checksums Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums = BothChecksums);
+
+	/**
+	 * @brief  Function that performs AES decryption in CTR mode on given buffer and returns the requested checksums, iv is updated for the next call.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static Checksums Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums = BothChecksums);
+
+protected:
+	/**
+	 * @brief  Represents the modes of operation with fused checksums.
+	 */
+	enum Mode { ECBMode, CBCMode, CTRMode };
+
+	/**
+	 * @brief  Represents the slicing-by-8 lookup tables of the reflected CRC32C polynomial.
+	 */
+	struct Table {
+		uint32_t values[8][256] = {}; //values[0] is the byte table, values[k] advances it by k more zero bytes
+	};
+
+	/**
+	 * @brief  Represents the reflected CRC32C (Castagnoli) polynomial.
+	 */
+	static const uint32_t Polynomial = 0x82F63B78;
+
+	/**
+	 * @brief  Function that returns the lookup tables, they're generated on first use.
+	 * @return  Table table
+	 */
+	static const Table& GetTable();
+
+	/**
+	 * @brief  Function that updates given raw CRC32C state with given buffer, using SSE4.2 if it's available and enabled.
+	 * @param  uint32_t state
+	 * @param  const unsigned char* data
+	 * @param  size_t length
+	 * @return  uint32_t state
+	 */
+	static uint32_t Update(const uint32_t state, const unsigned char* data, const size_t length);
+
+	/**
+	 * @brief  Function that updates given raw CRC32C state with given buffer using the lookup tables.
+	 * @param  uint32_t state
+	 * @param  const unsigned char* data
+	 * @param  size_t length
+	 * @return  uint32_t state
+	 */
+	static uint32_t UpdateTable(uint32_t state, const unsigned char* data, size_t length);
+
+	/**
+	 * @brief  Function that multiplies two polynomials modulo the CRC32C polynomial, both in reflected bit order.
+	 * @param  uint32_t first
+	 * @param  uint32_t second
+	 * @return  uint32_t product
+	 */
+	static uint32_t Multiply(uint32_t first, uint32_t second);
+
+	/**
+	 * @brief  Function that validates given buffer, key and iv, performs given mode and returns the requested checksums.
+	 * @brief  Chunks are processed in parallel if the buffer is large enough, except for CBC encryption which is sequential.
+	 * @param  Mode mode
+	 * @param  bool encrypt
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  int checksums
+	 * @return  Checksums checksums
+	 * @throws  invalid_argument thrown if given length, key or iv is invalid.
+	 */
+	static Checksums Process(const Mode mode, const bool encrypt, const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv, const int checksums);
+
+	/**
+	 * @brief  Function that performs given mode on given range block by block and returns its requested checksums.
+	 * @brief  Chain holds the previous cipher block in CBC mode or the counter in CTR mode and is updated past the range.
+	 * @param  Mode mode
+	 * @param  bool encrypt
+	 * @param  KeyContext context
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  unsigned char* chain
+	 * @param  int checksums
+	 * @param  bool streaming
+	 * @return  Checksums checksums
+	 */
+	static Checksums ProcessRange(const Mode mode, const bool encrypt, const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* chain, const int checksums, const bool streaming);
+
+	/**
+	 * @brief  Represents if the SSE4.2 CRC32 instruction is enabled, true by default.
+	 */
+	static atomic<bool> sse42Enabled;
+};
+#endif
@@ -0,0 +1,297 @@
+#include "AESClient.h"
+#ifdef AES_DAEMON
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+/**
+ * @brief  Function that creates an anonymous shared memory file of given size and returns its descriptor, -1 on failure.
+ * @brief  Where supported the file is sealed against shrinking, so the daemon knows its mapping stays valid.
+ * @param  size_t size
+ * @return  int fd
+ */
+static int CreateSharedMemory(const size_t size) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    int fd = memfd_create("aes-client", MFD_CLOEXEC | MFD_ALLOW_SEALING); //create anonymous memory file that can be sealed
+#else
+    static atomic<unsigned> counter{ 0 }; //represents number of created files, makes names unique in the process
+    string name = "/aes-client-" + to_string(getpid()) + "-" + to_string(counter++); //represents unique name of memory file
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600); //create named memory file
+    if (fd != -1) shm_unlink(name.c_str()); //remove name so memory file is anonymous
+#endif
+    if (fd != -1 && ftruncate(fd, (off_t)size) != 0) { //if memory file can't be sized
+        close(fd); //close memory file
+        return -1; //return failure
+    }
+#ifdef F_ADD_SEALS
+    if (fd != -1 && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0) { //if memory file can't be sealed against shrinking, which the daemon requires
+        close(fd); //close memory file
+        return -1; //return failure
+    }
+#endif
+    return fd; //return descriptor
+}
+
+
+/**
+ * @brief  Constructor that connects to the daemon at given path and attaches a shared buffer of given size.
+ * @param  string path
+ * @param  size_t bufferSize
+ * @throws  invalid_argument thrown if given buffer size is zero.
+ * @throws  runtime_error thrown if the daemon can't be reached or the buffer can't be shared.
+ */
+AESClient::AESClient(const string& path, const size_t bufferSize) : fd(-1), buffer(NULL), bufferSize(bufferSize), nextId(1), lastBatchSize(0) {
+    if (bufferSize == 0) //if buffer is empty
+        throw invalid_argument("Invalid buffer size, please provide buffer size larger than zero."); //throw invalid argument
+    sockaddr_un address{}; //represents socket address
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) //if path doesn't fit in socket address
+        throw runtime_error("Invalid socket path, please provide path shorter than " + to_string(sizeof(address.sun_path)) + " characters."); //throw runtime error
+    address.sun_family = AF_UNIX; //set address family
+    memcpy(address.sun_path, path.c_str(), path.size() + 1); //set socket path
+    fd = socket(AF_UNIX, SOCK_STREAM, 0); //create socket
+    if (fd == -1 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) { //if daemon can't be reached
+        string error = strerror(errno); //save error before closing
+        if (fd != -1) close(fd); //close socket
+        throw runtime_error("Failed to connect to daemon at " + path + ": " + error); //throw runtime error
+    }
+    int memory = CreateSharedMemory(bufferSize); //create shared memory
+    void* mapped = memory != -1 ? mmap(NULL, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0) : MAP_FAILED; //map shared memory
+    if (mapped == MAP_FAILED) { //if shared memory couldn't be created
+        if (memory != -1) close(memory); //close memory file
+        close(fd); //close socket
+        throw runtime_error("Failed to create shared buffer of " + to_string(bufferSize) + " bytes."); //throw runtime error
+    }
+    buffer = (unsigned char*)mapped; //set buffer
+    AESDaemon::Request request{}; //represents Attach request
+    request.type = AESDaemon::Attach; //set type
+    request.length = bufferSize; //set shared memory size
+    AESDaemon::Response response; //represents response
+    try {
+        response = Call(request, memory); //attach shared memory, daemon maps it
+    }
+    catch (...) { //if daemon can't be reached we release everything
+        close(memory); //close memory file
+        munmap(buffer, bufferSize); //unmap buffer
+        close(fd); //close socket
+        throw; //rethrow
+    }
+    close(memory); //mappings keep memory alive
+    if (response.status != AESDaemon::Ok) { //if daemon couldn't map shared memory
+        munmap(buffer, bufferSize); //unmap buffer
+        close(fd); //close socket
+        throw runtime_error("Failed to share buffer of " + to_string(bufferSize) + " bytes with daemon."); //throw runtime error
+    }
+}
+
+
+/**
+ * @brief  Destructor that disconnects from the daemon and clears the shared buffer, the daemon drops the keys of the client.
+ */
+AESClient::~AESClient() {
+    fill(buffer, buffer + bufferSize, 0x00); //clear shared buffer before it is unmapped
+    munmap(buffer, bufferSize); //unmap buffer
+    close(fd); //close socket, daemon releases keys of client
+}
+
+
+/**
+ * @brief  Function that sends given request, with given descriptor as ancillary data if it's valid, and waits for its response.
+ * @param  Request request
+ * @param  int descriptor
+ * @return  Response response
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+AESDaemon::Response AESClient::Call(AESDaemon::Request& request, const int descriptor) {
+    request.id = nextId++; //set request id
+    iovec io{ &request, sizeof(request) }; //represents request bytes
+    union { cmsghdr header; char space[CMSG_SPACE(sizeof(int))]; } control{}; //represents ancillary data
+    msghdr message{}; //represents sent message
+    message.msg_iov = &io; //set request bytes
+    message.msg_iovlen = 1;
+    if (descriptor != -1) { //if a descriptor is passed we add it as ancillary data
+        message.msg_control = control.space; //set ancillary data buffer
+        message.msg_controllen = sizeof(control.space);
+        cmsghdr* header = CMSG_FIRSTHDR(&message); //represents ancillary data header
+        header->cmsg_level = SOL_SOCKET; //set level
+        header->cmsg_type = SCM_RIGHTS; //pass descriptor
+        header->cmsg_len = CMSG_LEN(sizeof(int)); //set length
+        memcpy(CMSG_DATA(header), &descriptor, sizeof(int)); //set descriptor
+    }
+    ssize_t sent; //represents number of bytes sent
+    do sent = sendmsg(fd, &message, MSG_NOSIGNAL); //send request
+    while (sent < 0 && errno == EINTR); //retry if interrupted by a signal
+    if (sent != (ssize_t)sizeof(request)) //if request couldn't be sent
+        throw runtime_error("Failed to send request to daemon: " + string(sent < 0 ? strerror(errno) : "short write")); //throw runtime error
+    AESDaemon::Response response; //represents response
+    for (size_t received = 0; received < sizeof(response);) { //read until whole response arrived
+        ssize_t size = recv(fd, (unsigned char*)&response + received, sizeof(response) - received, 0); //receive response bytes
+        if (size < 0 && errno == EINTR) continue; //retry if interrupted by a signal
+        if (size <= 0) //if daemon disconnected
+            throw runtime_error("Failed to receive response from daemon: " + string(size < 0 ? strerror(errno) : "connection closed")); //throw runtime error
+        received += (size_t)size; //add received bytes
+    }
+    if (response.id != request.id) //if response doesn't belong to request
+        throw runtime_error("Failed to receive response from daemon: response doesn't match request."); //throw runtime error
+    return response; //return response
+}
+
+
+/**
+ * @brief  Function that registers given key with the daemon and returns its id.
+ * @param  vector<unsigned char> key
+ * @return  uint32_t keyId
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+uint32_t AESClient::RegisterKey(const vector<unsigned char>& key) {
+    if (key.size() != 16 && key.size() != 24 && key.size() != 32) //if key size is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    AESDaemon::Request request{}; //represents Register request
+    request.type = AESDaemon::Register; //set type
+    request.keySize = (uint8_t)key.size(); //set key size
+    memcpy(request.key, key.data(), key.size()); //set key
+    AESDaemon::Response response = Call(request); //register key
+    fill(request.key, request.key + sizeof(request.key), 0x00); //clear key in request, the daemon keeps its own copy
+    if (response.status != AESDaemon::Ok) //if daemon rejected key
+        ThrowStatus(response.status, "", true); //throw exception of status
+    return response.keyId; //return key id
+}
+
+
+/**
+ * @brief  Function that unregisters given key, the daemon clears the key once no client has it registered.
+ * @param  uint32_t keyId
+ * @throws  invalid_argument thrown if given key isn't registered.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+void AESClient::UnregisterKey(const uint32_t keyId) {
+    AESDaemon::Request request{}; //represents Unregister request
+    request.type = AESDaemon::Unregister; //set type
+    request.keyId = keyId; //set key id
+    AESDaemon::Response response = Call(request); //unregister key
+    if (response.status != AESDaemon::Ok) //if key isn't registered
+        ThrowStatus(response.status, "", true); //throw exception of status
+}
+
+
+/**
+ * @brief  Function that returns the buffer shared with the daemon, payloads are processed in place in it.
+ * @return  unsigned char* buffer
+ */
+unsigned char* AESClient::GetBuffer() {
+    return buffer; //return shared buffer
+}
+
+
+/**
+ * @brief  Function that returns the size in bytes of the buffer shared with the daemon.
+ * @return  size_t bufferSize
+ */
+size_t AESClient::GetBufferSize() const {
+    return bufferSize; //return shared buffer size
+}
+
+
+/**
+ * @brief  Function that encrypts given range of the shared buffer in place with given mode and registered key, iv is updated for the next call.
+ * @brief  ECB and CBC require length to be a multiple of 16 bytes, CFB, OFB and CTR support any length.
+ * @param  string mode
+ * @param  uint32_t keyId
+ * @param  size_t offset
+ * @param  size_t length
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+void AESClient::Encrypt(const string& mode, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv) {
+    Process(mode, true, keyId, offset, length, iv); //encrypt range
+}
+
+
+/**
+ * @brief  Function that decrypts given range of the shared buffer in place with given mode and registered key, iv is updated for the next call.
+ * @brief  ECB and CBC require length to be a multiple of 16 bytes, CFB, OFB and CTR support any length.
+ * @param  string mode
+ * @param  uint32_t keyId
+ * @param  size_t offset
+ * @param  size_t length
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+void AESClient::Decrypt(const string& mode, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv) {
+    Process(mode, false, keyId, offset, length, iv); //decrypt range
+}
+
+
+/**
+ * @brief  Function that returns the number of requests the daemon coalesced with the last encryption or decryption.
+ * @return  size_t batchSize
+ */
+size_t AESClient::GetLastBatchSize() const {
+    return lastBatchSize; //return batch size
+}
+
+
+/**
+ * @brief  Function that sends a Process request for given range and updates iv with the response.
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  uint32_t keyId
+ * @param  size_t offset
+ * @param  size_t length
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+void AESClient::Process(const string& mode, const bool encrypt, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv) {
+    static const string modes[AESDaemon::ModeCount] = { "ECB", "CBC", "CFB", "OFB", "CTR" }; //represents modes in order of AESDaemon::Mode
+    AESDaemon::Request request{}; //represents Process request
+    for (request.mode = AESDaemon::ECBMode; request.mode < AESDaemon::ModeCount && modes[request.mode] != mode; request.mode++) {} //find mode
+    if (request.mode == AESDaemon::ModeCount) //if mode is invalid
+        throw invalid_argument("Invalid mode of operation, please provide ECB, CBC, CFB, OFB or CTR mode for daemon."); //throw invalid argument
+    if (request.mode != AESDaemon::ECBMode && iv == NULL) //if IV is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + mode + " requirements."); //throw invalid argument
+    if (offset > bufferSize || length > bufferSize - offset || ((request.mode == AESDaemon::ECBMode || request.mode == AESDaemon::CBCMode) && length % BlockSize != 0)) //if range is outside shared buffer or block mode length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + mode + " requirements."); //throw invalid argument
+    request.type = AESDaemon::Process; //set type
+    request.keyId = keyId; //set key id
+    request.encrypt = encrypt ? 1 : 0; //set direction
+    request.offset = offset; //set range
+    request.length = length;
+    if (iv != NULL) memcpy(request.iv, iv, BlockSize); //set IV
+    AESDaemon::Response response = Call(request); //process range
+    if (response.status != AESDaemon::Ok) //if daemon rejected request
+        ThrowStatus(response.status, mode, encrypt); //throw exception of status
+    if (iv != NULL && request.mode != AESDaemon::ECBMode) //if mode uses an IV
+        memcpy(iv, response.iv, BlockSize); //update IV for next call
+    lastBatchSize = response.batchSize; //save batch size
+}
+
+
+/**
+ * @brief  Function that throws the exception of given response status.
+ * @param  int32_t status
+ * @param  string mode
+ * @param  bool encrypt
+ * @throws  invalid_argument thrown if status reports an invalid request.
+ * @throws  runtime_error thrown if status reports a daemon failure.
+ */
+void AESClient::ThrowStatus(const int32_t status, const string& mode, const bool encrypt) {
+    if (status == AESDaemon::InvalidKey) //if key isn't valid or registered
+        throw invalid_argument("Invalid key, please provide a key registered with the daemon that matches AES requirements."); //throw invalid argument
+    if (status == AESDaemon::InvalidRequest || status == AESDaemon::OutOfBounds) //if request is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + mode + " requirements."); //throw invalid argument
+    throw runtime_error("Daemon failed to process request with status " + to_string(status) + "."); //throw runtime error
+}
+#endif
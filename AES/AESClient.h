@@ -0,0 +1,133 @@
+#ifndef _AESCLIENT_H
+#define _AESCLIENT_H
+#include "AESDaemon.h"
+#ifdef AES_DAEMON
+
+/**
+ * @file AESClient.h
+ * @brief  AESClient class, the client library of the AESDaemon local encryption daemon.
+ * @brief  A client connects to the daemon socket and shares a buffer with it, payloads are written to the buffer and processed there in place by the daemon.
+ * @brief  Keys are registered once and referred to by id, the daemon keeps their round keys and shares them with other clients that register the same key.
+ * @brief  A client is a single connection with one request in flight, threads should each use their own client.
+ */
+class AESClient : public AES {
+public:
+	/**
+	 * @brief  Constructor that connects to the daemon at given path and attaches a shared buffer of given size.
+	 * @param  string path
+	 * @param  size_t bufferSize
+	 * @throws  invalid_argument thrown if given buffer size is zero.
+	 * @throws  runtime_error thrown if the daemon can't be reached or the buffer can't be shared.
+	 */
+	AESClient(const string& path, const size_t bufferSize = 1024 * 1024);
+
+	/**
+	 * @brief  Destructor that disconnects from the daemon and clears the shared buffer, the daemon drops the keys of the client.
+	 */
+	~AESClient();
+
+	AESClient(const AESClient&) = delete;
+	AESClient& operator=(const AESClient&) = delete;
+
+	/**
+	 * @brief  Function that registers given key with the daemon and returns its id.
+	 * @param  vector<unsigned char> key
+	 * @return  uint32_t keyId
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	uint32_t RegisterKey(const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that unregisters given key, the daemon clears the key once no client has it registered.
+	 * @param  uint32_t keyId
+	 * @throws  invalid_argument thrown if given key isn't registered.
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	void UnregisterKey(const uint32_t keyId);
+
+	/**
+	 * @brief  Function that returns the buffer shared with the daemon, payloads are processed in place in it.
+	 * @return  unsigned char* buffer
+	 */
+	unsigned char* GetBuffer();
+
+	/**
+	 * @brief  Function that returns the size in bytes of the buffer shared with the daemon.
+	 * @return  size_t bufferSize
+	 */
+	size_t GetBufferSize() const;
+
+	/**
+	 * @brief  Function that encrypts given range of the shared buffer in place with given mode and registered key, iv is updated for the next call.
+	 * @brief  ECB and CBC require length to be a multiple of 16 bytes, CFB, OFB and CTR support any length.
+	 * @param  string mode
+	 * @param  uint32_t keyId
+	 * @param  size_t offset
+	 * @param  size_t length
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	void Encrypt(const string& mode, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv = NULL);
+
+	/**
+	 * @brief  Function that decrypts given range of the shared buffer in place with given mode and registered key, iv is updated for the next call.
+	 * @brief  ECB and CBC require length to be a multiple of 16 bytes, CFB, OFB and CTR support any length.
+	 * @param  string mode
+	 * @param  uint32_t keyId
+	 * @param  size_t offset
+	 * @param  size_t length
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	void Decrypt(const string& mode, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv = NULL);
+
+	/**
+	 * @brief  Function that returns the number of requests the daemon coalesced with the last encryption or decryption.
+	 * @return  size_t batchSize
+	 */
+	size_t GetLastBatchSize() const;
+
+private:
+	int fd; //socket connected to daemon
+	unsigned char* buffer; //buffer shared with daemon
+	size_t bufferSize; //size of shared buffer
+	uint32_t nextId; //id of next request
+	size_t lastBatchSize; //batch size of last Process request
+
+	/**
+	 * @brief  Function that sends given request, with given descriptor as ancillary data if it's valid, and waits for its response.
+	 * @param  Request request
+	 * @param  int descriptor
+	 * @return  Response response
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	AESDaemon::Response Call(AESDaemon::Request& request, const int descriptor = -1);
+
+	/**
+	 * @brief  Function that sends a Process request for given range and updates iv with the response.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  uint32_t keyId
+	 * @param  size_t offset
+	 * @param  size_t length
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given mode, key, range or iv is invalid.
+	 * @throws  runtime_error thrown if the daemon can't be reached.
+	 */
+	void Process(const string& mode, const bool encrypt, const uint32_t keyId, const size_t offset, const size_t length, unsigned char* iv);
+
+	/**
+	 * @brief  Function that throws the exception of given response status.
+	 * @param  int32_t status
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @throws  invalid_argument thrown if status reports an invalid request.
+	 * @throws  runtime_error thrown if status reports a daemon failure.
+	 */
+	static void ThrowStatus(const int32_t status, const string& mode, const bool encrypt);
+};
+#endif
+#endif
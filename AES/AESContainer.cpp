@@ -0,0 +1,603 @@
+#include "AESContainer.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <stdexcept>
+
+
+/**
+ * @brief  Function that stores given value in big endian order in given number of bytes.
+ * @param  unsigned char* data
+ * @param  uint64_t value
+ * @param  size_t size
+ */
+static void StoreBigEndian(unsigned char* data, uint64_t value, const size_t size) {
+    for (size_t i = size; i-- > 0;) { //iterate over bytes from end to start
+        data[i] = (unsigned char)(value & 0xFF); //set each byte
+        value >>= 8; //move to next byte
+    }
+}
+
+
+/**
+ * @brief  Function that loads a value stored in big endian order in given number of bytes.
+ * @param  const unsigned char* data
+ * @param  size_t size
+ * @return  uint64_t value
+ */
+static uint64_t LoadBigEndian(const unsigned char* data, const size_t size) {
+    uint64_t value = 0; //represents loaded value
+    for (size_t i = 0; i < size; i++) //iterate over bytes
+        value = (value << 8) | data[i]; //add each byte to value
+    return value; //return value
+}
+
+
+/**
+ * @brief  Function that compares two tags in constant time so the comparison doesn't leak the position of the first difference.
+ * @param  const unsigned char* first
+ * @param  const unsigned char* second
+ * @return  bool isEqual
+ */
+static bool TagEquals(const unsigned char* first, const unsigned char* second) {
+    unsigned char difference = 0; //represents accumulated difference
+    for (size_t i = 0; i < AESContainer::TagSize; i++) //iterate over tags
+        difference |= first[i] ^ second[i]; //accumulate differences
+    return difference == 0; //return true if tags are equal
+}
+
+
+/**
+ * @brief  Function that computes the AES-CMAC tag of an optional 16 byte prefix block followed by given data.
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  const unsigned char* prefix
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @param  unsigned char* tag
+ */
+void AESContainer::CMAC(const vector<vector<unsigned char>>& roundKeys, const unsigned char* prefix, const unsigned char* data, const size_t length, unsigned char* tag) {
+    unsigned char subkey[BlockSize]{}; //represents CMAC subkey, K1 for complete last block and K2 for padded last block
+    EncryptBlock(subkey, roundKeys); //encrypt zero block to get L
+    size_t total = (prefix != NULL ? BlockSize : 0) + length; //calculate message length
+    size_t blocks = total == 0 ? 1 : (total + BlockSize - 1) / BlockSize; //calculate number of blocks, empty message has one padded block
+    bool complete = total > 0 && total % BlockSize == 0; //check if last block is complete
+    for (int doubling = complete ? 1 : 2; doubling > 0; doubling--) { //double L once for K1 and twice for K2
+        unsigned char carry = subkey[0] >> 7; //save most significant bit
+        for (size_t i = 0; i < BlockSize - 1; i++) //iterate over subkey
+            subkey[i] = (unsigned char)((subkey[i] << 1) | (subkey[i + 1] >> 7)); //shift subkey left by one bit
+        subkey[BlockSize - 1] = (unsigned char)((subkey[BlockSize - 1] << 1) ^ (carry ? 0x87 : 0x00)); //reduce by the CMAC polynomial
+    }
+    unsigned char state[BlockSize]{}; //represents CBC-MAC state
+    for (size_t i = 0; i + 1 < blocks; i++) { //iterate over all blocks except the last
+        const unsigned char* block = prefix != NULL ? (i == 0 ? prefix : data + (i - 1) * BlockSize) : data + i * BlockSize; //get block of message
+        XOR(state, block); //XOR block into state
+        EncryptBlock(state, roundKeys); //encrypt state using our AES EncryptBlock function using round keys
+    }
+    unsigned char last[BlockSize]{}; //represents last block
+    size_t lastStart = (blocks - 1) * BlockSize; //calculate message offset of last block
+    size_t lastSize = total - lastStart; //calculate size of last block
+    if (prefix != NULL && lastStart == 0) //if last block is the prefix
+        memcpy(last, prefix, BlockSize);
+    else if (lastSize > 0) //else last block is part of data
+        memcpy(last, data + lastStart - (prefix != NULL ? BlockSize : 0), lastSize);
+    if (!complete) //if last block is incomplete we pad it with a single one bit
+        last[lastSize] = 0x80;
+    XOR(last, subkey); //XOR last block with subkey
+    XOR(state, last); //XOR last block into state
+    EncryptBlock(state, roundKeys); //encrypt state using our AES EncryptBlock function using round keys
+    memcpy(tag, state, TagSize); //set tag
+    fill(subkey, subkey + BlockSize, 0x00); //clear CMAC subkey
+    fill(state, state + BlockSize, 0x00); //clear state
+    fill(last, last + BlockSize, 0x00); //clear last block
+}
+
+
+/**
+ * @brief  Function that derives the encryption and MAC round keys from given key and serialized header.
+ * @param  vector<unsigned char> key
+ * @param  vector<unsigned char> header
+ * @param  vector<vector<unsigned char>> encryptionKeys
+ * @param  vector<vector<unsigned char>> macKeys
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESContainer::DeriveKeys(const vector<unsigned char>& key, const vector<unsigned char>& header, vector<vector<unsigned char>>& encryptionKeys, vector<vector<unsigned char>>& macKeys) {
+    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
+    vector<vector<unsigned char>> masterKeys = KeySchedule(key); //call our KeySchedule function for generating round keys of given key
+    static const string label = "AESContainer"; //represents KDF label
+    size_t outputLength = 2 * key.size(); //derive encryption key and MAC key of same size as given key
+    vector<unsigned char> message(4 + label.size() + 1 + header.size() + 4, 0x00); //represents counter || label || 0x00 || context || length
+    memcpy(message.data() + 4, label.data(), label.size()); //set label
+    memcpy(message.data() + 4 + label.size() + 1, header.data(), header.size()); //set header as context so keys are unique per container
+    StoreBigEndian(message.data() + message.size() - 4, outputLength * 8, 4); //set output length in bits
+    vector<unsigned char> derived((outputLength + BlockSize - 1) / BlockSize * BlockSize); //represents derived key material
+    for (size_t i = 0; i < derived.size() / BlockSize; i++) { //iterate over output blocks of SP 800-108 counter KDF
+        StoreBigEndian(message.data(), i + 1, 4); //set counter
+        CMAC(masterKeys, NULL, message.data(), message.size(), derived.data() + i * BlockSize); //compute next output block
+    }
+    vector<unsigned char> encryptionKey(derived.begin(), derived.begin() + key.size()); //represents derived encryption key
+    vector<unsigned char> macKey(derived.begin() + key.size(), derived.begin() + outputLength); //represents derived MAC key
+    encryptionKeys = KeySchedule(encryptionKey); //generate round keys of encryption key
+    macKeys = KeySchedule(macKey); //generate round keys of MAC key
+    ClearVector(masterKeys); //clear round keys of master key, only the derived keys are kept
+    ClearVector(derived);
+    ClearVector(encryptionKey);
+    ClearVector(macKey);
+}
+
+
+/**
+ * @brief  Function that computes the tag of given chunk.
+ * @param  vector<vector<unsigned char>> macKeys
+ * @param  uint64_t index
+ * @param  bool last
+ * @param  const unsigned char* cipher
+ * @param  size_t length
+ * @param  unsigned char* tag
+ */
+void AESContainer::ChunkTag(const vector<vector<unsigned char>>& macKeys, const uint64_t index, const bool last, const unsigned char* cipher, const size_t length, unsigned char* tag) {
+    unsigned char prefix[BlockSize]{}; //represents type || last flag || reserved || length || index
+    prefix[0] = 0x01; //chunk tag type
+    prefix[1] = last ? 0x01 : 0x00; //last chunk flag so a truncated container can't pass as complete
+    StoreBigEndian(prefix + 4, length, 4); //set ciphertext length
+    StoreBigEndian(prefix + 8, index, 8); //set chunk index so chunks can't be reordered
+    CMAC(macKeys, prefix, cipher, length, tag); //compute tag
+}
+
+
+/**
+ * @brief  Function that computes the tag of the index footer.
+ * @param  vector<vector<unsigned char>> macKeys
+ * @param  uint64_t chunkCount
+ * @param  uint64_t dataSize
+ * @param  vector<unsigned char> tags
+ * @param  unsigned char* tag
+ */
+void AESContainer::IndexTag(const vector<vector<unsigned char>>& macKeys, const uint64_t chunkCount, const uint64_t dataSize, const vector<unsigned char>& tags, unsigned char* tag) {
+    unsigned char prefix[BlockSize]{}; //represents type || reserved || chunk count
+    prefix[0] = 0x02; //index tag type
+    StoreBigEndian(prefix + 8, chunkCount, 8); //set chunk count
+    vector<unsigned char> data(8 + tags.size()); //represents data size || chunk tags
+    StoreBigEndian(data.data(), dataSize, 8); //set data size
+    if (!tags.empty()) memcpy(data.data() + 8, tags.data(), tags.size()); //set chunk tags
+    CMAC(macKeys, prefix, data.data(), data.size(), tag); //compute tag
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts a single chunk in place with its derived IV.
+ * @brief  The chunk index is XORed into the upper 8 bytes of the base IV, CTR increments only the lower 8 bytes so counters of chunks never overlap.
+ * @brief  CBC encrypts the derived value to get an unpredictable IV, as recommended in SP 800-38A appendix C.
+ * @param  vector<vector<unsigned char>> encryptionKeys
+ * @param  bool isCBC
+ * @param  const unsigned char* baseIV
+ * @param  uint64_t index
+ * @param  unsigned char* data
+ * @param  size_t length
+ * @param  bool encrypt
+ */
+void AESContainer::ProcessChunk(const vector<vector<unsigned char>>& encryptionKeys, const bool isCBC, const unsigned char* baseIV, const uint64_t index, unsigned char* data, const size_t length, const bool encrypt) {
+    unsigned char iv[BlockSize]; //represents IV of chunk
+    memcpy(iv, baseIV, BlockSize); //initialize IV with base IV
+    for (size_t i = 0; i < 8; i++) //iterate over upper half of IV
+        iv[i] ^= (unsigned char)(index >> (56 - 8 * i)); //XOR chunk index in big endian order
+    if (isCBC) { //if mode is CBC
+        EncryptBlock(iv, encryptionKeys); //encrypt derived value to get chunk IV
+        encrypt ? CBCEncryptBlocks(data, data, length, encryptionKeys, iv) : CBCDecryptBlocks(data, data, length, encryptionKeys, iv);
+    }
+    else //else mode is CTR
+        CTRRange(data, data, length, encryptionKeys, iv); //CTR encryption and decryption are the same
+    fill(iv, iv + BlockSize, 0x00); //clear chunk IV
+}
+
+
+/**
+ * @brief  Function that returns the ciphertext size of a chunk with given data size, CBC pads chunks that aren't a multiple of 16 bytes.
+ * @param  bool isCBC
+ * @param  size_t size
+ * @return  size_t cipherSize
+ */
+size_t AESContainer::CipherSize(const bool isCBC, const size_t size) {
+    return isCBC && size % BlockSize != 0 ? size + BlockSize - (size % BlockSize) : size; //return size with padding
+}
+
+
+/**
+ * @brief  Function that returns the offset of the index footer from the container start for given data size.
+ * @param  bool isCBC
+ * @param  size_t chunkSize
+ * @param  uint64_t dataSize
+ * @return  uint64_t indexOffset
+ */
+uint64_t AESContainer::IndexOffset(const bool isCBC, const size_t chunkSize, const uint64_t dataSize) {
+    uint64_t fullChunks = dataSize / chunkSize; //calculate number of full chunks
+    return HeaderSize + fullChunks * chunkSize + CipherSize(isCBC, (size_t)(dataSize % chunkSize)); //return header, full chunks and last partial chunk
+}
+
+
+/**
+ * @brief  Function that serializes given header.
+ * @param  Header header
+ * @return  vector<unsigned char> header
+ */
+vector<unsigned char> AESContainer::SerializeHeader(const Header& header) {
+    vector<unsigned char> data(HeaderSize, 0x00); //represents serialized header
+    memcpy(data.data(), "AESC", 4); //set magic
+    data[4] = 0x01; //set version
+    data[5] = header.mode == "CBC" ? 0x01 : 0x02; //set mode
+    data[6] = (unsigned char)header.keySize; //set key size
+    StoreBigEndian(data.data() + 8, header.chunkSize, 4); //set chunk size
+    memcpy(data.data() + 16, header.keyId.data(), header.keyId.size()); //set key ID, shorter IDs are zero padded
+    memcpy(data.data() + 32, header.iv.data(), BlockSize); //set base IV
+    return data; //return serialized header
+}
+
+
+/**
+ * @brief  Function that parses given serialized header.
+ * @param  const unsigned char* data
+ * @return  Header header
+ * @throws  invalid_argument thrown if the header is invalid.
+ */
+AESContainer::Header AESContainer::ParseHeader(const unsigned char* data) {
+    if (memcmp(data, "AESC", 4) != 0 || data[4] != 0x01) //if magic or version is invalid
+        throw invalid_argument("Invalid container, please provide valid container header."); //throw invalid argument
+    Header header; //represents parsed header
+    if (data[5] != 0x01 && data[5] != 0x02) //if mode is invalid
+        throw invalid_argument("Invalid container, please provide valid container mode."); //throw invalid argument
+    header.mode = data[5] == 0x01 ? "CBC" : "CTR"; //set mode
+    header.keySize = data[6]; //set key size
+    if (header.keySize != 16 && header.keySize != 24 && header.keySize != 32) //if key size is invalid
+        throw invalid_argument("Invalid container, please provide valid container key size."); //throw invalid argument
+    header.chunkSize = (size_t)LoadBigEndian(data + 8, 4); //set chunk size
+    if (header.chunkSize < BlockSize || header.chunkSize % BlockSize != 0 || header.chunkSize > (1 << 30)) //if chunk size is invalid
+        throw invalid_argument("Invalid container, please provide valid container chunk size."); //throw invalid argument
+    header.keyId.assign(data + 16, data + 32); //set key ID
+    header.iv.assign(data + 32, data + 48); //set base IV
+    return header; //return parsed header
+}
+
+
+/**
+ * @brief  Function that reads and parses the container header from given input stream without a key, for example to find the key by its ID.
+ * @brief  The stream position is restored after reading.
+ * @param  istream input
+ * @return  Header header
+ * @throws  invalid_argument thrown if the header is invalid.
+ * @throws  runtime_error thrown if reading failed.
+ */
+AESContainer::Header AESContainer::ReadHeader(istream& input) {
+    streampos position = input.tellg(); //save stream position
+    unsigned char data[HeaderSize]; //represents serialized header
+    input.read((char*)data, HeaderSize); //read header
+    if (input.gcount() != (streamsize)HeaderSize) //if header is incomplete
+        throw invalid_argument("Invalid container, please provide valid container header."); //throw invalid argument
+    input.seekg(position); //restore stream position
+    if (!input) //if stream failed
+        throw runtime_error("Failed reading container."); //throw runtime error
+    return ParseHeader(data); //return parsed header
+}
+
+
+/**
+ * @brief  Constructor that validates given parameters and writes the container header.
+ * @param  ostream output
+ * @param  vector<unsigned char> key
+ * @param  string mode
+ * @param  vector<unsigned char> keyId
+ * @param  vector<unsigned char> iv
+ * @param  size_t chunkSize
+ * @throws  invalid_argument thrown if given mode, key, key ID, iv or chunk size is invalid.
+ * @throws  runtime_error thrown if writing failed.
+ */
+AESContainer::Writer::Writer(ostream& output, const vector<unsigned char>& key, const string& mode, const vector<unsigned char>& keyId, const vector<unsigned char>& iv, const size_t chunkSize)
+    : output(output), chunkSize(chunkSize), isCBC(mode == "CBC"), buffered(0), chunkCount(0), dataSize(0), closed(false) {
+    if (mode != "CBC" && mode != "CTR") //if mode is invalid
+        throw invalid_argument("Invalid mode of operation, please provide CBC or CTR mode for container."); //throw invalid argument
+    if (iv.size() != BlockSize) //if IV is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + mode + " requirements."); //throw invalid argument
+    if (keyId.size() > 16) //if key ID is too long
+        throw invalid_argument("Invalid key ID, please provide key ID of at most 16 bytes."); //throw invalid argument
+    if (chunkSize < BlockSize || chunkSize % BlockSize != 0 || chunkSize > (1 << 30)) //if chunk size is invalid
+        throw invalid_argument("Invalid chunk size, please provide chunk size that is a multiple of 16 bytes and at most 1 GB."); //throw invalid argument
+    Header parameters; //represents header of container
+    parameters.mode = mode; //set mode
+    parameters.keySize = key.size(); //set key size
+    parameters.keyId = keyId; //set key ID
+    parameters.chunkSize = chunkSize; //set chunk size
+    parameters.iv = iv; //set base IV
+    header = SerializeHeader(parameters); //serialize header
+    DeriveKeys(key, header, encryptionKeys, macKeys); //validate key and derive keys of container
+    size_t batch = GetThreadCount() ? GetThreadCount() : 1; //encrypt one chunk per thread in each batch
+    buffer.resize(batch * chunkSize); //allocate batch buffer
+    cipher.resize(batch * chunkSize); //allocate batch ciphertext, padded last chunk is never larger than chunk size
+    output.write((const char*)header.data(), (streamsize)header.size()); //write header
+    if (!output) //if write failed
+        throw runtime_error("Failed writing container."); //throw runtime error
+}
+
+
+/**
+ * @brief  Destructor that clears the keys and buffered data.
+ */
+AESContainer::Writer::~Writer() {
+    ClearVector(encryptionKeys); //clear encryption round keys of writer
+    ClearVector(macKeys);
+    ClearVector(buffer);
+    ClearVector(cipher);
+}
+
+
+/**
+ * @brief  Function that encrypts and writes the buffered chunks in parallel.
+ * @param  bool last
+ */
+void AESContainer::Writer::Flush(const bool last) {
+    AES_PROFILE_SCOPE("Container-Write", buffered); //profile encryption of buffered container chunks
+    size_t count = (buffered + chunkSize - 1) / chunkSize; //calculate number of buffered chunks
+    if (count == 0) return; //nothing to write
+    tags.resize((size_t)(chunkCount + count) * TagSize); //add room for tags of buffered chunks
+    ParallelFor(count, [&](size_t i) { //encrypt and authenticate each chunk in parallel
+        size_t size = min(chunkSize, buffered - i * chunkSize); //calculate data size of chunk
+        size_t cipherSize = CipherSize(isCBC, size); //calculate ciphertext size of chunk
+        unsigned char* chunk = cipher.data() + i * chunkSize; //get ciphertext position of chunk
+        memcpy(chunk, buffer.data() + i * chunkSize, size); //copy data of chunk
+        memset(chunk + size, (int)(cipherSize - size), cipherSize - size); //append PKCS7 padding bytes if needed
+        ProcessChunk(encryptionKeys, isCBC, header.data() + 32, chunkCount + i, chunk, cipherSize, true); //encrypt chunk
+        ChunkTag(macKeys, chunkCount + i, last && i + 1 == count, chunk, cipherSize, tags.data() + (chunkCount + i) * TagSize); //authenticate chunk
+    });
+    size_t lastSize = buffered - (count - 1) * chunkSize; //calculate data size of last buffered chunk
+    output.write((const char*)cipher.data(), (streamsize)((count - 1) * chunkSize + CipherSize(isCBC, lastSize))); //write ciphertext of chunks back to back
+    if (!output) //if write failed
+        throw runtime_error("Failed writing container."); //throw runtime error
+    chunkCount += count; //add written chunks
+    dataSize += buffered; //add written data
+    buffered = 0; //clear buffer
+}
+
+
+/**
+ * @brief  Function that adds given data to the container.
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @throws  invalid_argument thrown if writer is already closed.
+ * @throws  runtime_error thrown if writing failed.
+ */
+void AESContainer::Writer::Write(const unsigned char* data, const size_t length) {
+    if (closed) //if writer is closed
+        throw invalid_argument("Invalid container, writer is already closed."); //throw invalid argument
+    if (length > 0 && data == NULL) //if data is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES container requirements."); //throw invalid argument
+    size_t offset = 0; //represents position in data
+    while (offset < length) { //buffer data until batch is full
+        if (buffered == buffer.size()) //a full batch is flushed only when more data arrives, so its last chunk isn't marked as last
+            Flush(false);
+        size_t size = min(buffer.size() - buffered, length - offset); //calculate size that fits in batch
+        memcpy(buffer.data() + buffered, data + offset, size); //copy data to batch
+        buffered += size; //add buffered data
+        offset += size; //move to next data
+    }
+}
+
+
+/**
+ * @brief  Function that adds given data to the container.
+ * @param  vector<unsigned char> data
+ * @throws  invalid_argument thrown if writer is already closed.
+ * @throws  runtime_error thrown if writing failed.
+ */
+void AESContainer::Writer::Write(const vector<unsigned char>& data) {
+    Write(data.data(), data.size()); //add data
+}
+
+
+/**
+ * @brief  Function that writes the last chunks and the index footer.
+ * @throws  invalid_argument thrown if writer is already closed.
+ * @throws  runtime_error thrown if writing failed.
+ */
+void AESContainer::Writer::Close() {
+    if (closed) //if writer is closed
+        throw invalid_argument("Invalid container, writer is already closed."); //throw invalid argument
+    Flush(true); //write last chunks
+    closed = true; //mark writer as closed
+    unsigned char counts[16]; //represents chunk count || data size
+    StoreBigEndian(counts, chunkCount, 8); //set chunk count
+    StoreBigEndian(counts + 8, dataSize, 8); //set data size
+    unsigned char indexTag[TagSize]; //represents tag of index
+    IndexTag(macKeys, chunkCount, dataSize, tags, indexTag); //authenticate index
+    unsigned char trailer[12]; //represents index offset || magic
+    StoreBigEndian(trailer, IndexOffset(isCBC, chunkSize, dataSize), 8); //set index offset
+    memcpy(trailer + 8, "AESI", 4); //set index magic
+    output.write((const char*)counts, sizeof(counts)); //write index
+    if (!tags.empty()) output.write((const char*)tags.data(), (streamsize)tags.size());
+    output.write((const char*)indexTag, sizeof(indexTag));
+    output.write((const char*)trailer, sizeof(trailer));
+    output.flush(); //flush output
+    if (!output) //if write failed
+        throw runtime_error("Failed writing container."); //throw runtime error
+}
+
+
+/**
+ * @brief  Constructor that reads the header, derives the keys and reads and authenticates the index footer.
+ * @param  istream input
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given key doesn't match the container or the container is invalid.
+ * @throws  runtime_error thrown if reading failed.
+ */
+AESContainer::Reader::Reader(istream& input, const vector<unsigned char>& key) : input(input), isCBC(false), chunkCount(0), dataSize(0) {
+    start = (streamoff)input.tellg(); //save container start
+    if (start < 0) //if stream isn't seekable
+        throw runtime_error("Failed reading container, input isn't seekable."); //throw runtime error
+    vector<unsigned char> data(HeaderSize); //represents serialized header
+    input.read((char*)data.data(), HeaderSize); //read header
+    if (input.gcount() != (streamsize)HeaderSize) //if header is incomplete
+        throw invalid_argument("Invalid container, please provide valid container header."); //throw invalid argument
+    header = ParseHeader(data.data()); //parse header
+    isCBC = header.mode == "CBC"; //set mode
+    if (key.size() != header.keySize) //if key size doesn't match container
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES container requirements."); //throw invalid argument
+    DeriveKeys(key, data, encryptionKeys, macKeys); //derive keys of container
+    input.seekg(0, ios::end); //move to end of container
+    streamoff end = (streamoff)input.tellg(); //represents container end
+    unsigned char trailer[12]; //represents index offset || magic
+    if (end - start < (streamoff)(HeaderSize + 16 + TagSize + sizeof(trailer))) //if container is too small for header and index
+        throw invalid_argument("Invalid container, please provide valid container index."); //throw invalid argument
+    input.seekg(end - (streamoff)sizeof(trailer)); //move to trailer
+    input.read((char*)trailer, sizeof(trailer)); //read trailer
+    unsigned char counts[16]; //represents chunk count || data size
+    uint64_t indexOffset = LoadBigEndian(trailer, 8); //get index offset
+    if (!input || memcmp(trailer + 8, "AESI", 4) != 0 || indexOffset > (uint64_t)(end - start)) //if trailer is invalid
+        throw invalid_argument("Invalid container, please provide valid container index."); //throw invalid argument
+    input.seekg(start + (streamoff)indexOffset); //move to index
+    input.read((char*)counts, sizeof(counts)); //read counts
+    chunkCount = LoadBigEndian(counts, 8); //get chunk count
+    dataSize = LoadBigEndian(counts + 8, 8); //get data size
+    uint64_t tagsSize = (uint64_t)(end - start) - indexOffset - sizeof(counts) - TagSize - sizeof(trailer); //calculate size left for chunk tags
+    if (!input || chunkCount != (dataSize + header.chunkSize - 1) / header.chunkSize || tagsSize != chunkCount * TagSize || IndexOffset(isCBC, header.chunkSize, dataSize) != indexOffset) //if index doesn't match layout
+        throw invalid_argument("Invalid container, please provide valid container index."); //throw invalid argument
+    tags.resize((size_t)tagsSize); //allocate chunk tags
+    unsigned char indexTag[TagSize], expectedTag[TagSize]; //represents stored and computed index tags
+    if (!tags.empty()) input.read((char*)tags.data(), (streamsize)tags.size()); //read chunk tags
+    input.read((char*)indexTag, TagSize); //read index tag
+    if (!input) //if read failed
+        throw runtime_error("Failed reading container."); //throw runtime error
+    IndexTag(macKeys, chunkCount, dataSize, tags, expectedTag); //compute index tag
+    if (!TagEquals(indexTag, expectedTag)) //if index tag doesn't match the key is wrong or index was modified
+        throw invalid_argument("Invalid container, index authentication failed."); //throw invalid argument
+}
+
+
+/**
+ * @brief  Destructor that clears the keys.
+ */
+AESContainer::Reader::~Reader() {
+    ClearVector(encryptionKeys); //clear encryption round keys of reader
+    ClearVector(macKeys);
+}
+
+
+/**
+ * @brief  Function that returns the container header.
+ * @return  Header header
+ */
+const AESContainer::Header& AESContainer::Reader::GetHeader() const {
+    return header; //return header
+}
+
+
+/**
+ * @brief  Function that returns the size of the data in the container in bytes.
+ * @return  uint64_t dataSize
+ */
+uint64_t AESContainer::Reader::GetSize() const {
+    return dataSize; //return data size
+}
+
+
+/**
+ * @brief  Function that returns the number of chunks in the container.
+ * @return  uint64_t chunkCount
+ */
+uint64_t AESContainer::Reader::GetChunkCount() const {
+    return chunkCount; //return chunk count
+}
+
+
+/**
+ * @brief  Function that reads the ciphertext of given chunk range, chunks are stored back to back.
+ * @param  uint64_t first
+ * @param  uint64_t count
+ * @return  vector<unsigned char> cipher
+ * @throws  runtime_error thrown if reading failed.
+ */
+vector<unsigned char> AESContainer::Reader::ReadCipher(const uint64_t first, const uint64_t count) {
+    uint64_t begin = HeaderSize + first * header.chunkSize; //calculate offset of first chunk
+    uint64_t end = first + count == chunkCount ? IndexOffset(isCBC, header.chunkSize, dataSize) : begin + count * header.chunkSize; //calculate offset after last chunk
+    vector<unsigned char> cipher((size_t)(end - begin)); //represents ciphertext of chunks
+    input.clear(); //clear end of file state of previous reads
+    input.seekg(start + (streamoff)begin); //move to first chunk
+    input.read((char*)cipher.data(), (streamsize)cipher.size()); //read chunks
+    if (!input) //if read failed
+        throw runtime_error("Failed reading container."); //throw runtime error
+    return cipher; //return ciphertext
+}
+
+
+/**
+ * @brief  Function that verifies and decrypts given range of data, chunks of the range are processed in parallel.
+ * @param  uint64_t offset
+ * @param  size_t length
+ * @return  vector<unsigned char> data
+ * @throws  invalid_argument thrown if given range is invalid or chunk authentication failed.
+ * @throws  runtime_error thrown if reading failed.
+ */
+vector<unsigned char> AESContainer::Reader::Read(const uint64_t offset, const size_t length) {
+    AES_PROFILE_SCOPE("Container-Read", length); //profile container range read
+    if (offset > dataSize || length > dataSize - offset) //if range is outside of container
+        throw invalid_argument("Invalid range, please provide range within container size."); //throw invalid argument
+    vector<unsigned char> data(length); //represents decrypted range
+    if (length == 0) return data; //nothing to read
+    const size_t chunkSize = header.chunkSize; //represents chunk size
+    uint64_t first = offset / chunkSize, last = (offset + length - 1) / chunkSize; //calculate first and last chunk of range
+    uint64_t batch = GetThreadCount() ? GetThreadCount() : 1; //process one chunk per thread in each batch
+    for (uint64_t current = first; current <= last; current += batch) { //iterate over batches of chunks
+        uint64_t count = min(batch, last - current + 1); //calculate number of chunks in batch
+        vector<unsigned char> cipher = ReadCipher(current, count); //read ciphertext of batch
+        ParallelFor((size_t)count, [&](size_t i) { //verify and decrypt each chunk in parallel
+            uint64_t index = current + i; //represents chunk index
+            uint64_t chunkStart = index * chunkSize; //calculate data offset of chunk
+            size_t size = (size_t)min((uint64_t)chunkSize, dataSize - chunkStart); //calculate data size of chunk
+            size_t cipherSize = CipherSize(isCBC, size); //calculate ciphertext size of chunk
+            unsigned char* chunk = cipher.data() + i * chunkSize; //get ciphertext of chunk
+            unsigned char tag[TagSize]; //represents computed tag
+            ChunkTag(macKeys, index, index + 1 == chunkCount, chunk, cipherSize, tag); //compute tag of chunk
+            if (!TagEquals(tag, tags.data() + index * TagSize)) //if tag doesn't match chunk was modified
+                throw invalid_argument("Invalid container, authentication of chunk " + to_string(index) + " failed."); //throw invalid argument
+            ProcessChunk(encryptionKeys, isCBC, header.iv.data(), index, chunk, cipherSize, false); //decrypt chunk
+            uint64_t from = max(offset, chunkStart), to = min(offset + length, chunkStart + size); //calculate part of chunk inside range
+            memcpy(data.data() + (from - offset), chunk + (from - chunkStart), (size_t)(to - from)); //copy part of chunk
+        });
+        ClearVector(cipher); //clear chunks of range, they were decrypted in place
+    }
+    return data; //return decrypted range
+}
+
+
+/**
+ * @brief  Function that verifies and decrypts the chunk at given index.
+ * @param  uint64_t index
+ * @return  vector<unsigned char> data
+ * @throws  invalid_argument thrown if given index is invalid or chunk authentication failed.
+ * @throws  runtime_error thrown if reading failed.
+ */
+vector<unsigned char> AESContainer::Reader::ReadChunk(const uint64_t index) {
+    if (index >= chunkCount) //if index is invalid
+        throw invalid_argument("Invalid chunk index, please provide index smaller than chunk count."); //throw invalid argument
+    uint64_t chunkStart = index * header.chunkSize; //calculate data offset of chunk
+    return Read(chunkStart, (size_t)min((uint64_t)header.chunkSize, dataSize - chunkStart)); //read whole chunk
+}
+
+
+/**
+ * @brief  Function that verifies the tags of all chunks in parallel without decrypting them.
+ * @return  bool isValid
+ * @throws  runtime_error thrown if reading failed.
+ */
+bool AESContainer::Reader::Verify() {
+    AES_PROFILE_SCOPE("Container-Verify", dataSize); //profile container verification
+    uint64_t batch = GetThreadCount() ? GetThreadCount() : 1; //verify one chunk per thread in each batch
+    atomic<bool> isValid{ true }; //represents if all chunks are valid
+    for (uint64_t current = 0; current < chunkCount && isValid; current += batch) { //iterate over batches of chunks
+        uint64_t count = min(batch, chunkCount - current); //calculate number of chunks in batch
+        vector<unsigned char> cipher = ReadCipher(current, count); //read ciphertext of batch
+        ParallelFor((size_t)count, [&](size_t i) { //verify each chunk in parallel
+            uint64_t index = current + i; //represents chunk index
+            size_t size = (size_t)min((uint64_t)header.chunkSize, dataSize - index * header.chunkSize); //calculate data size of chunk
+            unsigned char tag[TagSize]; //represents computed tag
+            ChunkTag(macKeys, index, index + 1 == chunkCount, cipher.data() + i * header.chunkSize, CipherSize(isCBC, size), tag); //compute tag of chunk
+            if (!TagEquals(tag, tags.data() + index * TagSize)) //if tag doesn't match chunk was modified
+                isValid = false; //mark container as invalid
+        });
+    }
+    return isValid; //return true if all chunks are valid
+}
@@ -0,0 +1,301 @@
+#ifndef _AESCONTAINER_H
+#define _AESCONTAINER_H
+#include "AESParallel.h"
+#include <istream>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * @file AESContainer.h
+ * @brief  AESContainer class for a chunked, seekable and authenticated encrypted container format.
+ * @brief  A container starts with a 48 byte header (magic, version, mode, key size, chunk size, key ID and base IV).
+ * @brief  Data is split into fixed-size chunks that are encrypted with CBC or CTR independently, each chunk has its own IV derived from the base IV.
+ * @brief  Each chunk is authenticated with an AES-CMAC tag over its index, length, last-chunk flag and ciphertext.
+ * @brief  The index footer holds the chunk count, data size and all chunk tags, and is authenticated with its own CMAC tag.
+ * @brief  Encryption and MAC keys are derived from the given key and the header with the SP 800-108 counter KDF using AES-CMAC.
+ * @brief  Chunks are encrypted, verified and decrypted in parallel with the AESParallel worker pool, any chunk can be decrypted in O(1).
+ *
+ * Layout: header | chunk 0 | chunk 1 | ... | chunk N-1 | chunk count | data size | N tags | index tag | index offset | "AESI"
+ */
+class AESContainer : public AESParallel {
+public:
+	/**
+	 * @brief  Size of container header in bytes.
+	 */
+	static const size_t HeaderSize = 48;
+
+	/**
+	 * @brief  Size of chunk and index authentication tags in bytes.
+	 */
+	static const size_t TagSize = 16;
+
+	/**
+	 * @brief  Represents the header of a container.
+	 */
+	struct Header {
+		string mode; //mode of operation, CBC or CTR
+		size_t keySize = 0; //key size in bytes
+		vector<unsigned char> keyId; //16 byte key ID for finding the key of the container
+		size_t chunkSize = 0; //chunk size in bytes, multiple of 16 bytes
+		vector<unsigned char> iv; //16 byte base IV that chunk IVs are derived from
+	};
+
+	/**
+	 * @brief  Writer that encrypts data into a container on given output stream.
+	 * @brief  Data is buffered until a batch of chunks is full, then the batch is encrypted in parallel and written.
+	 * @brief  Close must be called to write the last chunk and the index footer, a container without footer can't be read.
+	 */
+	class Writer {
+	public:
+		/**
+		 * @brief  Constructor that validates given parameters and writes the container header.
+		 * @param  ostream output
+		 * @param  vector<unsigned char> key
+		 * @param  string mode
+		 * @param  vector<unsigned char> keyId
+		 * @param  vector<unsigned char> iv
+		 * @param  size_t chunkSize
+		 * @throws  invalid_argument thrown if given mode, key, key ID, iv or chunk size is invalid.
+		 * @throws  runtime_error thrown if writing failed.
+		 */
+		Writer(ostream& output, const vector<unsigned char>& key, const string& mode, const vector<unsigned char>& keyId, const vector<unsigned char>& iv, const size_t chunkSize = 1024 * 1024);
+
+		/**
+		 * @brief  Destructor that clears the keys and buffered data.
+		 */
+		~Writer();
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		/**
+		 * @brief  Function that adds given data to the container.
+		 * @param  const unsigned char* data
+		 * @param  size_t length
+		 * @throws  invalid_argument thrown if writer is already closed.
+		 * @throws  runtime_error thrown if writing failed.
+		 */
+		void Write(const unsigned char* data, const size_t length);
+
+		/**
+		 * @brief  Function that adds given data to the container.
+		 * @param  vector<unsigned char> data
+		 * @throws  invalid_argument thrown if writer is already closed.
+		 * @throws  runtime_error thrown if writing failed.
+		 */
+		void Write(const vector<unsigned char>& data);
+
+		/**
+		 * @brief  Function that writes the last chunks and the index footer.
+		 * @throws  invalid_argument thrown if writer is already closed.
+		 * @throws  runtime_error thrown if writing failed.
+		 */
+		void Close();
+
+	private:
+		ostream& output; //output stream of container
+		vector<unsigned char> header; //serialized header
+		size_t chunkSize; //chunk size in bytes
+		bool isCBC; //true for CBC, false for CTR
+		vector<vector<unsigned char>> encryptionKeys; //round keys of derived encryption key
+		vector<vector<unsigned char>> macKeys; //round keys of derived MAC key
+		vector<unsigned char> buffer; //buffered data of current batch
+		size_t buffered; //number of buffered bytes
+		vector<unsigned char> cipher; //ciphertext of current batch
+		vector<unsigned char> tags; //tags of all written chunks
+		uint64_t chunkCount; //number of written chunks
+		uint64_t dataSize; //number of written data bytes
+		bool closed; //true after Close was called
+
+		/**
+		 * @brief  Function that encrypts and writes the buffered chunks in parallel.
+		 * @param  bool last
+		 */
+		void Flush(const bool last);
+	};
+
+	/**
+	 * @brief  Reader that verifies and decrypts a container from given seekable input stream.
+	 * @brief  The header and index footer are read and authenticated on construction, chunks are read on demand.
+	 */
+	class Reader {
+	public:
+		/**
+		 * @brief  Constructor that reads the header, derives the keys and reads and authenticates the index footer.
+		 * @param  istream input
+		 * @param  vector<unsigned char> key
+		 * @throws  invalid_argument thrown if given key doesn't match the container or the container is invalid.
+		 * @throws  runtime_error thrown if reading failed.
+		 */
+		Reader(istream& input, const vector<unsigned char>& key);
+
+		/**
+		 * @brief  Destructor that clears the keys.
+		 */
+		~Reader();
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		/**
+		 * @brief  Function that returns the container header.
+		 * @return  Header header
+		 */
+		const Header& GetHeader() const;
+
+		/**
+		 * @brief  Function that returns the size of the data in the container in bytes.
+		 * @return  uint64_t dataSize
+		 */
+		uint64_t GetSize() const;
+
+		/**
+		 * @brief  Function that returns the number of chunks in the container.
+		 * @return  uint64_t chunkCount
+		 */
+		uint64_t GetChunkCount() const;
+
+		/**
+		 * @brief  Function that verifies and decrypts the chunk at given index.
+		 * @param  uint64_t index
+		 * @return  vector<unsigned char> data
+		 * @throws  invalid_argument thrown if given index is invalid or chunk authentication failed.
+		 * @throws  runtime_error thrown if reading failed.
+		 */
+		vector<unsigned char> ReadChunk(const uint64_t index);
+
+		/**
+		 * @brief  Function that verifies and decrypts given range of data, chunks of the range are processed in parallel.
+		 * @param  uint64_t offset
+		 * @param  size_t length
+		 * @return  vector<unsigned char> data
+		 * @throws  invalid_argument thrown if given range is invalid or chunk authentication failed.
+		 * @throws  runtime_error thrown if reading failed.
+		 */
+		vector<unsigned char> Read(const uint64_t offset, const size_t length);
+
+		/**
+		 * @brief  Function that verifies the tags of all chunks in parallel without decrypting them.
+		 * @return  bool isValid
+		 * @throws  runtime_error thrown if reading failed.
+		 */
+		bool Verify();
+
+	private:
+		istream& input; //input stream of container
+		streamoff start; //stream position of container header
+		Header header; //parsed header
+		bool isCBC; //true for CBC, false for CTR
+		vector<vector<unsigned char>> encryptionKeys; //round keys of derived encryption key
+		vector<vector<unsigned char>> macKeys; //round keys of derived MAC key
+		vector<unsigned char> tags; //tags of all chunks
+		uint64_t chunkCount; //number of chunks
+		uint64_t dataSize; //number of data bytes
+
+		/**
+		 * @brief  Function that reads the ciphertext of given chunk range, chunks are stored back to back.
+		 * @param  uint64_t first
+		 * @param  uint64_t count
+		 * @return  vector<unsigned char> cipher
+		 * @throws  runtime_error thrown if reading failed.
+		 */
+		vector<unsigned char> ReadCipher(const uint64_t first, const uint64_t count);
+	};
+
+	/**
+	 * @brief  Function that reads and parses the container header from given input stream without a key, for example to find the key by its ID.
+	 * @brief  The stream position is restored after reading.
+	 * @param  istream input
+	 * @return  Header header
+	 * @throws  invalid_argument thrown if the header is invalid.
+	 * @throws  runtime_error thrown if reading failed.
+	 */
+	static Header ReadHeader(istream& input);
+
+protected:
+	/**
+	 * @brief  Function that computes the AES-CMAC tag of an optional 16 byte prefix block followed by given data.
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  const unsigned char* prefix
+	 * @param  const unsigned char* data
+	 * @param  size_t length
+	 * @param  unsigned char* tag
+	 */
+	static void CMAC(const vector<vector<unsigned char>>& roundKeys, const unsigned char* prefix, const unsigned char* data, const size_t length, unsigned char* tag);
+
+	/**
+	 * @brief  Function that derives the encryption and MAC round keys from given key and serialized header.
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> header
+	 * @param  vector<vector<unsigned char>> encryptionKeys
+	 * @param  vector<vector<unsigned char>> macKeys
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void DeriveKeys(const vector<unsigned char>& key, const vector<unsigned char>& header, vector<vector<unsigned char>>& encryptionKeys, vector<vector<unsigned char>>& macKeys);
+
+	/**
+	 * @brief  Function that computes the tag of given chunk.
+	 * @param  vector<vector<unsigned char>> macKeys
+	 * @param  uint64_t index
+	 * @param  bool last
+	 * @param  const unsigned char* cipher
+	 * @param  size_t length
+	 * @param  unsigned char* tag
+	 */
+	static void ChunkTag(const vector<vector<unsigned char>>& macKeys, const uint64_t index, const bool last, const unsigned char* cipher, const size_t length, unsigned char* tag);
+
+	/**
+	 * @brief  Function that computes the tag of the index footer.
+	 * @param  vector<vector<unsigned char>> macKeys
+	 * @param  uint64_t chunkCount
+	 * @param  uint64_t dataSize
+	 * @param  vector<unsigned char> tags
+	 * @param  unsigned char* tag
+	 */
+	static void IndexTag(const vector<vector<unsigned char>>& macKeys, const uint64_t chunkCount, const uint64_t dataSize, const vector<unsigned char>& tags, unsigned char* tag);
+
+	/**
+	 * @brief  Function that encrypts or decrypts a single chunk in place with its derived IV.
+	 * @param  vector<vector<unsigned char>> encryptionKeys
+	 * @param  bool isCBC
+	 * @param  const unsigned char* baseIV
+	 * @param  uint64_t index
+	 * @param  unsigned char* data
+	 * @param  size_t length
+	 * @param  bool encrypt
+	 */
+	static void ProcessChunk(const vector<vector<unsigned char>>& encryptionKeys, const bool isCBC, const unsigned char* baseIV, const uint64_t index, unsigned char* data, const size_t length, const bool encrypt);
+
+	/**
+	 * @brief  Function that returns the ciphertext size of a chunk with given data size, CBC pads chunks that aren't a multiple of 16 bytes.
+	 * @param  bool isCBC
+	 * @param  size_t size
+	 * @return  size_t cipherSize
+	 */
+	static size_t CipherSize(const bool isCBC, const size_t size);
+
+	/**
+	 * @brief  Function that returns the offset of the index footer from the container start for given data size.
+	 * @param  bool isCBC
+	 * @param  size_t chunkSize
+	 * @param  uint64_t dataSize
+	 * @return  uint64_t indexOffset
+	 */
+	static uint64_t IndexOffset(const bool isCBC, const size_t chunkSize, const uint64_t dataSize);
+
+	/**
+	 * @brief  Function that serializes given header.
+	 * @param  Header header
+	 * @return  vector<unsigned char> header
+	 */
+	static vector<unsigned char> SerializeHeader(const Header& header);
+
+	/**
+	 * @brief  Function that parses given serialized header.
+	 * @param  const unsigned char* data
+	 * @return  Header header
+	 * @throws  invalid_argument thrown if the header is invalid.
+	 */
+	static Header ParseHeader(const unsigned char* data);
+};
+#endif
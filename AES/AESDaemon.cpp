@@ -0,0 +1,464 @@
+#include "AESDaemon.h"
+#ifdef AES_DAEMON
+#include "AESProfiler.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+/**
+ * @brief  Constructor that creates the socket at given path and listens for clients, an existing file at path is replaced.
+ * @param  string path
+ * @throws  runtime_error thrown if the socket can't be created.
+ */
+AESDaemon::AESDaemon(const string& path)
+    : path(path), listenFd(-1), wakeFds{ -1, -1 }, stopping(false), batchWindow(0), requestCount(0), batchCount(0), nextKeyId(1) {
+    sockaddr_un address{}; //represents socket address
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) //if path doesn't fit in socket address
+        throw runtime_error("Invalid socket path, please provide path shorter than " + to_string(sizeof(address.sun_path)) + " characters."); //throw runtime error
+    address.sun_family = AF_UNIX; //set address family
+    memcpy(address.sun_path, path.c_str(), path.size() + 1); //set socket path
+    if (pipe(wakeFds) != 0) //create self pipe for Stop
+        throw runtime_error("Failed to create daemon wake pipe: " + string(strerror(errno))); //throw runtime error
+    fcntl(wakeFds[0], F_SETFL, O_NONBLOCK); //make pipe non-blocking so Stop never blocks
+    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0); //create listening socket
+    unlink(path.c_str()); //remove stale socket of previous daemon
+    if (listenFd == -1 || bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 128) != 0) { //if socket can't be created, bound or listened on
+        string error = strerror(errno); //save error before closing
+        if (listenFd != -1) close(listenFd); //close socket
+        close(wakeFds[0]); //close pipe
+        close(wakeFds[1]);
+        throw runtime_error("Failed to listen on " + path + ": " + error); //throw runtime error
+    }
+    fcntl(listenFd, F_SETFL, O_NONBLOCK); //make socket non-blocking so accepting never blocks the loop
+}
+
+
+/**
+ * @brief  Destructor that disconnects all clients, removes the socket and clears all keys.
+ */
+AESDaemon::~AESDaemon() {
+    for (Client* client : clients) { //iterate over clients
+        Disconnect(*client); //release keys and shared memory of client
+        delete client; //free client
+    }
+    close(listenFd); //close listening socket
+    unlink(path.c_str()); //remove socket
+    close(wakeFds[0]); //close pipe
+    close(wakeFds[1]);
+    for (auto& key : keys) { //iterate over remaining keys
+        ClearVector(key.second.key); //clear raw key of entry before the daemon exits
+        ClearVector(key.second.roundKeys); //clear round keys
+        Clear(key.second.context); //clear flat round keys
+    }
+    ClearVector(keystream); //clear keystream
+}
+
+
+/**
+ * @brief  Function that serves clients on the calling thread until Stop is called.
+ * @throws  runtime_error thrown if waiting for clients fails.
+ */
+void AESDaemon::Run() {
+    vector<pollfd> fds; //represents watched descriptors, pipe and listening socket followed by clients
+    vector<Pending> pending; //represents Process requests of current round
+    while (!stopping) { //serve until stopped
+        fds.clear(); //rebuild watched descriptors
+        fds.push_back({ wakeFds[0], POLLIN, 0 }); //watch self pipe
+        fds.push_back({ listenFd, POLLIN, 0 }); //watch listening socket
+        for (Client* client : clients) //iterate over clients
+            fds.push_back({ client->fd, POLLIN, 0 }); //watch client
+        if (poll(fds.data(), fds.size(), -1) < 0) { //wait for activity
+            if (errno == EINTR) continue; //retry if interrupted by a signal
+            throw runtime_error("Failed to wait for clients: " + string(strerror(errno))); //throw runtime error
+        }
+        if (fds[0].revents != 0) { //if Stop was called
+            char drain[64]; //represents drained bytes
+            while (read(wakeFds[0], drain, sizeof(drain)) > 0) {} //drain pipe
+            continue; //loop condition checks stopping
+        }
+        if (fds[1].revents & POLLIN) { //if clients are connecting
+            int fd; //represents accepted socket
+            while ((fd = accept(listenFd, NULL, NULL)) >= 0) { //accept all waiting clients
+                fcntl(fd, F_SETFL, O_NONBLOCK); //make client non-blocking so a slow client can't stall the loop
+                Client* client = new Client(); //create client
+                client->fd = fd; //set socket
+                clients.push_back(client); //add client
+            }
+        }
+        for (size_t i = 2; i < fds.size(); i++) //iterate over clients that were watched
+            if (fds[i].revents != 0) //if client sent requests or disconnected
+                Receive(*clients[i - 2], pending); //receive requests of client
+        size_t window = batchWindow; //read window once
+        if (!pending.empty() && window > 0) { //if a batch window is set we wait for more requests before processing
+            chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::microseconds(window); //represents end of window
+            for (chrono::steady_clock::time_point now = chrono::steady_clock::now(); now < deadline; now = chrono::steady_clock::now()) { //wait until window ends
+                int timeout = (int)((chrono::duration_cast<chrono::microseconds>(deadline - now).count() + 999) / 1000); //round remaining window up to milliseconds
+                if (poll(fds.data() + 2, fds.size() - 2, timeout) <= 0) break; //stop waiting if nothing arrives
+                for (size_t i = 2; i < fds.size(); i++) //iterate over clients
+                    if (fds[i].revents != 0 && !clients[i - 2]->closed) //if client sent more requests
+                        Receive(*clients[i - 2], pending); //receive requests of client
+            }
+        }
+        if (!pending.empty()) //if Process requests arrived
+            Dispatch(pending); //process requests in batches and send responses
+        pending.clear(); //clear requests, keeps capacity
+        for (size_t i = 0; i < clients.size();) { //iterate over clients and remove closed clients
+            if (clients[i]->closed) { //if client disconnected
+                Disconnect(*clients[i]); //release keys and shared memory of client
+                delete clients[i]; //free client
+                clients.erase(clients.begin() + i); //remove client
+            }
+            else i++; //move to next client
+        }
+    }
+    stopping = false; //allow Run to be called again
+}
+
+
+/**
+ * @brief  Function that makes Run return, can be called from any thread or a signal handler.
+ */
+void AESDaemon::Stop() {
+    stopping = true; //tell loop to stop
+    char wake = 1; //represents wake byte
+    ssize_t written = write(wakeFds[1], &wake, 1); //wake loop, write is async-signal-safe
+    (void)written; //pipe may be full if a wake is already pending
+}
+
+
+/**
+ * @brief  Function that sets how long in microseconds the daemon waits for more requests after the first one before processing a batch, 0 by default.
+ * @brief  By default only requests that already arrived are coalesced, a short window trades latency for larger batches.
+ * @param  size_t microseconds
+ */
+void AESDaemon::SetBatchWindow(const size_t microseconds) {
+    batchWindow = microseconds; //set batch window
+}
+
+
+/**
+ * @brief  Function that returns the number of Process requests served.
+ * @return  size_t requests
+ */
+size_t AESDaemon::GetRequestCount() const {
+    return requestCount; //return number of requests
+}
+
+
+/**
+ * @brief  Function that returns the number of batches Process requests were coalesced into.
+ * @return  size_t batches
+ */
+size_t AESDaemon::GetBatchCount() const {
+    return batchCount; //return number of batches
+}
+
+
+/**
+ * @brief  Function that receives all complete requests of given client, handles control requests and queues Process requests.
+ * @param  Client client
+ * @param  vector<Pending> pending
+ */
+void AESDaemon::Receive(Client& client, vector<Pending>& pending) {
+    while (!client.closed) { //read until socket is drained
+        unsigned char buffer[sizeof(Request) * 16]; //represents received bytes
+        iovec io{ buffer, sizeof(buffer) }; //represents receive buffer
+        union { cmsghdr header; char space[CMSG_SPACE(sizeof(int))]; } control{}; //represents ancillary data of Attach requests
+        msghdr message{}; //represents received message
+        message.msg_iov = &io; //set receive buffer
+        message.msg_iovlen = 1;
+        message.msg_control = control.space; //set ancillary data buffer
+        message.msg_controllen = sizeof(control.space);
+        ssize_t size = recvmsg(client.fd, &message, 0); //receive bytes and descriptor if any
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) //if socket is drained
+            return;
+        if (size < 0 && errno == EINTR) //if interrupted by a signal
+            continue;
+        if (size <= 0) { //if client disconnected or failed
+            client.closed = true; //mark client as closed
+            return;
+        }
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) //iterate over ancillary data
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) { //if ancillary data carries a descriptor
+                if (client.attachFd != -1) close(client.attachFd); //close descriptor that was never attached
+                memcpy(&client.attachFd, CMSG_DATA(header), sizeof(int)); //keep descriptor until its Attach request is complete
+            }
+        client.received.insert(client.received.end(), buffer, buffer + size); //append bytes to incomplete request
+        size_t offset = 0; //represents position of next request
+        for (; offset + sizeof(Request) <= client.received.size(); offset += sizeof(Request)) { //iterate over complete requests
+            Request request; //represents current request
+            memcpy(&request, client.received.data() + offset, sizeof(Request)); //copy request, buffer may be unaligned
+            if (request.type == Process) { //if request is Process we queue it for batching
+                Pending entry{ &client, request, Response{} }; //represents queued request
+                entry.response.id = request.id; //set response id
+                entry.response.status = Validate(client, request); //validate request
+                memcpy(entry.response.iv, request.iv, BlockSize); //initialize updated IV with IV of request
+                if (entry.response.status == Ok) { //if request is valid it holds the key until it's dispatched, so a later Unregister can't remove it
+                    keys[request.keyId].references++; //add reference of request, key exists since client registered it
+                    entry.holdsKey = true; //release reference after dispatch
+                }
+                pending.push_back(entry); //queue request
+            }
+            else //else request is a control request that's handled right away
+                Send(client, Control(client, request)); //handle request and send response
+        }
+        client.received.erase(client.received.begin(), client.received.begin() + offset); //remove handled requests
+    }
+}
+
+
+/**
+ * @brief  Function that handles given control request of given client and returns its response.
+ * @param  Client client
+ * @param  Request request
+ * @return  Response response
+ */
+AESDaemon::Response AESDaemon::Control(Client& client, const Request& request) {
+    Response response{}; //represents response
+    response.id = request.id; //set response id
+    response.status = Ok; //assume request succeeds
+    if (request.type == Attach) { //if client attaches its shared memory
+        int fd = client.attachFd; //represents descriptor that came with request
+        client.attachFd = -1; //descriptor is consumed by this request
+        struct stat status{}; //represents status of shared memory file
+        bool isValid = fd != -1 && request.length > 0 && client.shared == NULL && fstat(fd, &status) == 0 && status.st_size >= 0 && (uint64_t)status.st_size >= request.length; //memory must exist and hold the claimed size, else accessing it raises SIGBUS
+#ifdef F_GET_SEALS
+        int seals = isValid ? fcntl(fd, F_GET_SEALS) : -1; //represents seals of memory file
+        isValid = seals != -1 && (seals & F_SEAL_SHRINK) != 0; //memory must be sealed against shrinking, so the client can't truncate it under the mapping
+#endif
+        void* shared = isValid ? mmap(NULL, request.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED; //map shared memory once per client
+        if (fd != -1) close(fd); //mapping keeps memory alive
+        if (shared == MAP_FAILED) //if memory couldn't be mapped
+            response.status = NotAttached; //report failure
+        else { //else memory is mapped
+            client.shared = (unsigned char*)shared; //set shared memory
+            client.sharedSize = request.length; //set shared memory size
+        }
+    }
+    else if (request.type == Register) { //if client registers a key
+        if (request.keySize != 16 && request.keySize != 24 && request.keySize != 32) //if key size is invalid
+            response.status = InvalidKey; //report invalid key
+        else { //else key is valid
+            vector<unsigned char> key(request.key, request.key + request.keySize); //represents key
+            auto found = keyIds.find(key); //find key if another client registered it
+            if (found == keyIds.end()) { //if key is new we expand it
+                KeyEntry& entry = keys[nextKeyId]; //create entry
+                entry.key = key; //set key
+                entry.roundKeys = KeySchedule(key); //generate round keys
+                Expand(key.data(), key.size(), entry.context); //generate flat round keys
+                found = keyIds.emplace(key, nextKeyId++).first; //remember id of key
+            }
+            keys[found->second].references++; //add registration
+            client.keys[found->second]++; //add registration of client
+            response.keyId = found->second; //return key id
+            ClearVector(key); //clear key copy
+        }
+    }
+    else if (request.type == Unregister) { //if client unregisters a key
+        auto found = client.keys.find(request.keyId); //find registration of client
+        if (found == client.keys.end()) //if client didn't register key
+            response.status = InvalidKey; //report invalid key
+        else { //else release one registration
+            if (--found->second == 0) client.keys.erase(found); //drop registration of client
+            ReleaseKey(request.keyId); //drop registration
+        }
+    }
+    else //else request type is unknown
+        response.status = InvalidRequest; //report invalid request
+    return response; //return response
+}
+
+
+/**
+ * @brief  Function that validates given Process request and returns its status.
+ * @param  Client client
+ * @param  Request request
+ * @return  Status status
+ */
+AESDaemon::Status AESDaemon::Validate(const Client& client, const Request& request) const {
+    if (request.mode >= ModeCount || ((request.mode == ECBMode || request.mode == CBCMode) && request.length % BlockSize != 0)) //if mode is invalid or ECB and CBC length isn't multiply of 16 bytes
+        return InvalidRequest; //return invalid request
+    if (client.keys.find(request.keyId) == client.keys.end()) //if client didn't register key
+        return InvalidKey; //return invalid key
+    if (client.shared == NULL) //if client didn't attach shared memory
+        return NotAttached; //return not attached
+    if (request.offset > client.sharedSize || request.length > client.sharedSize - request.offset) //if range is outside shared memory
+        return OutOfBounds; //return out of bounds
+    return Ok; //return ok
+}
+
+
+/**
+ * @brief  Function that groups given Process requests by key, mode and direction and processes each group as a batch.
+ * @param  vector<Pending> pending
+ */
+void AESDaemon::Dispatch(vector<Pending>& pending) {
+    vector<Pending*> order; //represents valid requests ordered by key, mode and direction
+    order.reserve(pending.size()); //reserve room for all requests
+    for (Pending& entry : pending) //iterate over requests
+        if (entry.response.status == Ok) //if request is valid we batch it
+            order.push_back(&entry); //add request
+    stable_sort(order.begin(), order.end(), [](const Pending* first, const Pending* second) { //group requests, keeping arrival order in each group
+        return make_tuple(first->request.keyId, first->request.mode, first->request.encrypt) < make_tuple(second->request.keyId, second->request.mode, second->request.encrypt); //compare key, mode and direction
+    });
+    for (size_t start = 0, end = 0; start < order.size(); start = end) { //iterate over groups
+        for (end = start + 1; end < order.size() && order[end]->request.keyId == order[start]->request.keyId && order[end]->request.mode == order[start]->request.mode && order[end]->request.encrypt == order[start]->request.encrypt; end++) {} //find end of group
+        ProcessBatch(order.data() + start, end - start); //process group as one batch
+    }
+    for (Pending& entry : pending) { //iterate over requests in arrival order
+        if (!entry.client->closed) //if client is still connected
+            Send(*entry.client, entry.response); //send response
+        if (entry.holdsKey) //if request holds its key
+            ReleaseKey(entry.request.keyId); //drop reference of request
+    }
+}
+
+
+/**
+ * @brief  Function that processes given requests that share a key, mode and direction.
+ * @param  Pending** batch
+ * @param  size_t count
+ */
+void AESDaemon::ProcessBatch(Pending** batch, const size_t count) {
+    size_t total = 0; //represents number of bytes in batch
+    for (size_t i = 0; i < count; i++) //iterate over requests
+        total += batch[i]->request.length; //add length of request
+    AES_PROFILE_SCOPE("Daemon-Batch", total); //profile daemon batch
+    auto found = keys.find(batch[0]->request.keyId); //find key of batch, queued requests hold a reference so it's always found
+    if (found == keys.end()) { //if key is gone we fail the batch instead of stopping the daemon
+        for (size_t i = 0; i < count; i++) //iterate over requests
+            batch[i]->response.status = InvalidKey; //report invalid key
+        return;
+    }
+    const KeyEntry& entry = found->second; //represents key of batch
+    requestCount += count; //count requests
+    batchCount++; //count batch
+    for (size_t i = 0; i < count; i++) //iterate over requests
+        batch[i]->response.batchSize = (uint32_t)count; //report batch size
+    if (batch[0]->request.mode == CTRMode) { //if batch is CTR we generate the keystream of all requests at once
+        ProcessCTR(entry, batch, count); //process CTR batch
+        return;
+    }
+    auto process = [&](size_t i) { //process a single request of the batch
+        Pending& pending = *batch[i]; //represents request
+        unsigned char* data = pending.client->shared + pending.request.offset; //represents payload in shared memory
+        size_t length = pending.request.length; //represents payload length
+        unsigned char* iv = pending.response.iv; //represents IV, updated for next call
+        bool encrypt = pending.request.encrypt != 0; //represents direction
+        switch (pending.request.mode) { //process payload in place with the round keys of the key
+        case ECBMode: ECBBlocks(data, data, length, entry.roundKeys, encrypt); break;
+        case CBCMode: encrypt ? CBCEncryptBlocks(data, data, length, entry.roundKeys, iv) : CBCDecryptBlocks(data, data, length, entry.roundKeys, iv); break;
+        case CFBMode: encrypt ? CFBEncryptBlocks(data, data, length, entry.roundKeys, iv) : CFBDecryptBlocks(data, data, length, entry.roundKeys, iv); break;
+        case OFBMode: OFBBlocks(data, data, length, entry.roundKeys, iv); break;
+        default: break; //CTR batches are processed by ProcessCTR and Validate rejects other modes
+        }
+    };
+    if (count > 1 && total >= GetParallelThreshold()) //if batch is large enough we spread its requests over the worker pool
+        ParallelFor(count, process); //process requests in parallel
+    else //else we process requests on this thread
+        for (size_t i = 0; i < count; i++) //iterate over requests
+            process(i); //process request
+}
+
+
+/**
+ * @brief  Function that processes given CTR requests with one keystream generated for the whole batch.
+ * @param  KeyEntry entry
+ * @param  Pending** batch
+ * @param  size_t count
+ */
+void AESDaemon::ProcessCTR(const KeyEntry& entry, Pending** batch, const size_t count) {
+    size_t blocks = 0; //represents number of keystream blocks of batch
+    for (size_t i = 0; i < count; i++) //iterate over requests
+        blocks += (batch[i]->request.length + BlockSize - 1) / BlockSize; //add blocks of request
+    if (keystream.size() < blocks * BlockSize) //if keystream buffer is too small we grow it once
+        keystream.resize(blocks * BlockSize); //grow keystream buffer
+    for (size_t i = 0, position = 0; i < count; i++) { //iterate over requests and lay out their counter blocks back to back
+        size_t requestBlocks = (batch[i]->request.length + BlockSize - 1) / BlockSize; //represents blocks of request
+        for (size_t j = 0; j < requestBlocks; j++, position += BlockSize) { //iterate over blocks of request
+            memcpy(keystream.data() + position, batch[i]->response.iv, BlockSize); //copy counter
+            AddCounter(batch[i]->response.iv, 1); //increment counter, response gets counter of next block
+        }
+    }
+    ForEachChunk(blocks * BlockSize, GetChunkSize(), [&](size_t offset, size_t size) { //encrypt counters of all requests in one pass, in parallel if batch is large enough
+        EncryptBlocks(entry.context, keystream.data() + offset, keystream.data() + offset, size); //encrypt counter blocks
+    });
+    for (size_t i = 0, position = 0; i < count; i++) { //iterate over requests and XOR their payloads with their keystream
+        unsigned char* data = batch[i]->client->shared + batch[i]->request.offset; //represents payload in shared memory
+        size_t length = batch[i]->request.length; //represents payload length
+        size_t j = 0; //represents position in payload
+        for (; j + BlockSize <= length; j += BlockSize) //iterate over full blocks
+            XOR(data + j, keystream.data() + position + j); //perform XOR between payload and keystream block
+        for (; j < length; j++) //iterate over partial last block
+            data[j] ^= keystream[position + j]; //perform byte XOR between payload and keystream
+        position += (length + BlockSize - 1) / BlockSize * BlockSize; //move to keystream of next request
+    }
+    fill(keystream.begin(), keystream.begin() + blocks * BlockSize, 0x00); //clear keystream of batch
+}
+
+
+/**
+ * @brief  Function that sends given response to given client, the client is closed if it can't take the response.
+ * @param  Client client
+ * @param  Response response
+ */
+void AESDaemon::Send(Client& client, const Response& response) {
+    ssize_t sent; //represents number of bytes sent
+    do sent = send(client.fd, &response, sizeof(response), MSG_NOSIGNAL); //send response
+    while (sent < 0 && errno == EINTR); //retry if interrupted by a signal
+    if (sent != (ssize_t)sizeof(response)) //if client doesn't read its responses
+        client.closed = true; //drop client
+}
+
+
+/**
+ * @brief  Function that releases the keys and shared memory of given client and closes its socket.
+ * @param  Client client
+ */
+void AESDaemon::Disconnect(Client& client) {
+    for (auto& key : client.keys) //iterate over registrations of client
+        for (size_t i = 0; i < key.second; i++) //iterate over registrations of key
+            ReleaseKey(key.first); //drop registration
+    client.keys.clear(); //clear registrations
+    if (client.shared != NULL) //if client attached shared memory
+        munmap(client.shared, client.sharedSize); //unmap shared memory
+    client.shared = NULL; //mark as detached
+    if (client.attachFd != -1) //if a descriptor was never attached
+        close(client.attachFd); //close descriptor
+    client.attachFd = -1; //mark descriptor as closed
+    if (client.fd != -1) //if socket is open
+        close(client.fd); //close socket
+    client.fd = -1; //mark socket as closed
+}
+
+
+/**
+ * @brief  Function that drops one registration of given key and clears the key when it's no longer registered.
+ * @param  uint32_t keyId
+ */
+void AESDaemon::ReleaseKey(const uint32_t keyId) {
+    auto found = keys.find(keyId); //find key
+    if (found == keys.end() || --found->second.references > 0) //if key is unknown or still registered
+        return;
+    keyIds.erase(found->second.key); //forget id of key
+    ClearVector(found->second.key); //clear raw key, no client has it registered anymore
+    ClearVector(found->second.roundKeys); //clear round keys
+    Clear(found->second.context); //clear flat round keys
+    keys.erase(found); //remove key
+}
+#endif
@@ -0,0 +1,220 @@
+#ifndef _AESDAEMON_H
+#define _AESDAEMON_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+#include <map>
+#if defined(__unix__) || defined(__APPLE__)
+#define AES_DAEMON
+
+/**
+ * @file AESDaemon.h
+ * @brief  AESDaemon class for a local encryption daemon that serves many processes over a Unix domain socket.
+ * @brief  The daemon holds the expanded round keys of registered keys, so clients don't expand a key for every message, identical keys of different clients share one entry.
+ * @brief  Payloads aren't copied through the socket, each client attaches a shared memory buffer and requests refer to a range of it that is processed in place.
+ * @brief  Requests that arrive together and share a key, mode and direction are coalesced into one batch, CTR batches generate the keystream of all requests in a single pass of the block engine.
+ * @brief  Batches that are large enough are spread over the AESParallel worker pool.
+ * @brief  The wire format is Request and Response, see AESClient for the client library.
+ */
+class AESDaemon : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents the types of requests.
+	 */
+	enum RequestType : uint32_t { Attach = 0, Register = 1, Unregister = 2, Process = 3 };
+
+	/**
+	 * @brief  Represents the status of responses.
+	 */
+	enum Status : int32_t { Ok = 0, InvalidRequest = 1, InvalidKey = 2, NotAttached = 3, OutOfBounds = 4 };
+
+	/**
+	 * @brief  Represents the modes of Process requests, values from ModeCount on are invalid.
+	 */
+	enum Mode : uint8_t { ECBMode = 0, CBCMode = 1, CFBMode = 2, OFBMode = 3, CTRMode = 4, ModeCount = 5 };
+
+	/**
+	 * @brief  Represents a request sent by a client, Attach requests carry the shared memory file descriptor as ancillary data.
+	 */
+	struct Request {
+		uint32_t type; //request type, see RequestType
+		uint32_t id; //request id, echoed in response
+		uint32_t keyId; //registered key of Process and Unregister requests
+		uint8_t mode; //mode of Process requests, see Mode
+		uint8_t encrypt; //1 for encryption, 0 for decryption
+		uint8_t keySize; //key size in bytes of Register requests
+		uint8_t reserved; //unused, zero
+		uint64_t offset; //offset in shared memory of Process requests
+		uint64_t length; //length of Process requests, size of shared memory of Attach requests
+		unsigned char iv[16]; //IV or counter of Process requests
+		unsigned char key[32]; //key of Register requests
+	};
+
+	/**
+	 * @brief  Represents a response sent by the daemon, the processed payload is in shared memory.
+	 */
+	struct Response {
+		uint32_t id; //id of request
+		int32_t status; //status, see Status
+		uint32_t keyId; //registered key of Register requests
+		uint32_t batchSize; //number of requests in the batch of Process requests
+		unsigned char iv[16]; //updated IV or counter of Process requests for the next call
+	};
+
+	/**
+	 * @brief  Constructor that creates the socket at given path and listens for clients, an existing file at path is replaced.
+	 * @param  string path
+	 * @throws  runtime_error thrown if the socket can't be created.
+	 */
+	AESDaemon(const string& path);
+
+	/**
+	 * @brief  Destructor that disconnects all clients, removes the socket and clears all keys.
+	 */
+	~AESDaemon();
+
+	AESDaemon(const AESDaemon&) = delete;
+	AESDaemon& operator=(const AESDaemon&) = delete;
+
+	/**
+	 * @brief  Function that serves clients on the calling thread until Stop is called.
+	 * @throws  runtime_error thrown if waiting for clients fails.
+	 */
+	void Run();
+
+	/**
+	 * @brief  Function that makes Run return, can be called from any thread or a signal handler.
+	 */
+	void Stop();
+
+	/**
+	 * @brief  Function that sets how long in microseconds the daemon waits for more requests after the first one before processing a batch, 0 by default.
+	 * @brief  By default only requests that already arrived are coalesced, a short window trades latency for larger batches.
+	 * @param  size_t microseconds
+	 */
+	void SetBatchWindow(const size_t microseconds);
+
+	/**
+	 * @brief  Function that returns the number of Process requests served.
+	 * @return  size_t requests
+	 */
+	size_t GetRequestCount() const;
+
+	/**
+	 * @brief  Function that returns the number of batches Process requests were coalesced into.
+	 * @return  size_t batches
+	 */
+	size_t GetBatchCount() const;
+
+protected:
+	/**
+	 * @brief  Represents a registered key with its round keys.
+	 */
+	struct KeyEntry {
+		vector<unsigned char> key; //raw key
+		vector<vector<unsigned char>> roundKeys; //round keys for the block functions
+		KeyContext context; //flat round keys for the batched keystream
+		size_t references = 0; //number of registrations of the key and queued requests that use it
+	};
+
+	/**
+	 * @brief  Represents a connected client.
+	 */
+	struct Client {
+		int fd = -1; //socket of client
+		vector<unsigned char> received; //bytes of incomplete request
+		unsigned char* shared = NULL; //shared memory of client, NULL if not attached
+		size_t sharedSize = 0; //size of shared memory
+		int attachFd = -1; //shared memory descriptor received ahead of its Attach request, -1 if none
+		map<uint32_t, size_t> keys; //number of registrations of each key by client
+		bool closed = false; //true if client disconnected or misbehaved
+	};
+
+	/**
+	 * @brief  Represents a Process request waiting to be batched.
+	 */
+	struct Pending {
+		Client* client; //client that sent request
+		Request request; //request
+		Response response; //response, iv is updated when request is processed
+		bool holdsKey = false; //true if request holds a reference of its key until it's dispatched
+	};
+
+	/**
+	 * @brief  Function that receives all complete requests of given client, handles control requests and queues Process requests.
+	 * @param  Client client
+	 * @param  vector<Pending> pending
+	 */
+	void Receive(Client& client, vector<Pending>& pending);
+
+	/**
+	 * @brief  Function that handles given control request of given client and returns its response.
+	 * @param  Client client
+	 * @param  Request request
+	 * @return  Response response
+	 */
+	Response Control(Client& client, const Request& request);
+
+	/**
+	 * @brief  Function that validates given Process request and returns its status.
+	 * @param  Client client
+	 * @param  Request request
+	 * @return  Status status
+	 */
+	Status Validate(const Client& client, const Request& request) const;
+
+	/**
+	 * @brief  Function that groups given Process requests by key, mode and direction and processes each group as a batch.
+	 * @param  vector<Pending> pending
+	 */
+	void Dispatch(vector<Pending>& pending);
+
+	/**
+	 * @brief  Function that processes given requests that share a key, mode and direction.
+	 * @param  Pending** batch
+	 * @param  size_t count
+	 */
+	void ProcessBatch(Pending** batch, const size_t count);
+
+	/**
+	 * @brief  Function that processes given CTR requests with one keystream generated for the whole batch.
+	 * @param  KeyEntry entry
+	 * @param  Pending** batch
+	 * @param  size_t count
+	 */
+	void ProcessCTR(const KeyEntry& entry, Pending** batch, const size_t count);
+
+	/**
+	 * @brief  Function that sends given response to given client, the client is closed if it can't take the response.
+	 * @param  Client client
+	 * @param  Response response
+	 */
+	static void Send(Client& client, const Response& response);
+
+	/**
+	 * @brief  Function that releases the keys and shared memory of given client and closes its socket.
+	 * @param  Client client
+	 */
+	void Disconnect(Client& client);
+
+	/**
+	 * @brief  Function that drops one registration of given key and clears the key when it's no longer registered.
+	 * @param  uint32_t keyId
+	 */
+	void ReleaseKey(const uint32_t keyId);
+
+private:
+	string path; //path of socket
+	int listenFd; //listening socket
+	int wakeFds[2]; //self pipe that wakes Run when Stop is called
+	atomic<bool> stopping; //true if Stop was called
+	atomic<size_t> batchWindow; //batch window in microseconds
+	atomic<size_t> requestCount; //number of Process requests served
+	atomic<size_t> batchCount; //number of batches
+	vector<Client*> clients; //connected clients
+	map<uint32_t, KeyEntry> keys; //registered keys by id
+	map<vector<unsigned char>, uint32_t> keyIds; //ids of registered keys by key
+	uint32_t nextKeyId; //id of next registered key
+	vector<unsigned char> keystream; //keystream of CTR batches, kept so steady state doesn't allocate
+};
+#endif
+#endif
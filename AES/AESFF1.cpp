@@ -0,0 +1,433 @@
+#include "AESFF1.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief  Represents the alphabet of texts, numeral i is the character at index i.
+ */
+const char AESFF1::Alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+
+/**
+ * @brief  Function that writes the integer of given numerals in given radix as given number of big-endian bytes, the integer must fit.
+ * @param  const uint16_t* numerals
+ * @param  size_t count
+ * @param  unsigned radix
+ * @param  unsigned char* bytes
+ * @param  size_t size
+ */
+static void ToBytes(const uint16_t* numerals, const size_t count, const unsigned radix, unsigned char* bytes, const size_t size) {
+    memset(bytes, 0, size); //start with zero
+    for (size_t i = 0; i < count; i++) { //iterate over numerals from most significant
+        uint32_t carry = numerals[i]; //represents numeral added to the integer
+        for (size_t j = size; j-- > 0;) { //multiply integer by radix and add numeral from least significant byte
+            const uint32_t value = (uint32_t)bytes[j] * radix + carry; //represents product of byte with carry
+            bytes[j] = (unsigned char)value; //keep low byte
+            carry = value >> 8; //carry the rest
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that divides the integer of given big-endian bytes in place by given radix and returns the remainder.
+ * @param  unsigned char* bytes
+ * @param  size_t size
+ * @param  unsigned radix
+ * @return  unsigned remainder
+ */
+static unsigned DivideBytes(unsigned char* bytes, const size_t size, const unsigned radix) {
+    uint32_t remainder = 0; //represents remainder of bytes divided so far
+    for (size_t j = 0; j < size; j++) { //iterate over bytes from most significant
+        const uint32_t value = (remainder << 8) | bytes[j]; //represents remainder followed by byte
+        bytes[j] = (unsigned char)(value / radix); //keep quotient
+        remainder = value % radix; //keep remainder for next byte
+    }
+    return remainder;
+}
+
+
+/**
+ * @brief  Constructor that expands given key for FF1 with given radix.
+ * @param  vector<unsigned char> key
+ * @param  unsigned radix
+ * @throws  invalid_argument thrown if given key or radix is invalid.
+ */
+AESFF1::AESFF1(const vector<unsigned char>& key, const unsigned radix) : radix(radix), minLength(2) {
+    if (radix < 2 || radix > 65536) //if radix is out of range of SP 800-38G
+        throw invalid_argument("Invalid radix, please provide radix between 2 and 65536."); //throw invalid argument
+    uint64_t domain = 1; //represents radix^minLength
+    size_t length = 0; //represents number of numerals so domain has at least one million values
+    while (domain < 1000000) //until domain is large enough
+        domain *= radix, length++; //add numeral
+    minLength = max(minLength, length); //FF1 requires at least two numerals
+    context = Expand(key); //expand key once
+}
+
+
+/**
+ * @brief  Destructor that clears the round keys.
+ */
+AESFF1::~AESFF1() {
+    Clear(context); //clear round keys
+}
+
+
+/**
+ * @brief  Function that encrypts given numerals with given tweak.
+ * @param  vector<uint16_t> numerals
+ * @param  vector<unsigned char> tweak
+ * @return  vector<uint16_t> encryptedNumerals
+ * @throws  invalid_argument thrown if given numerals are invalid.
+ */
+vector<uint16_t> AESFF1::Encrypt(const vector<uint16_t>& numerals, const vector<unsigned char>& tweak) const {
+    vector<uint16_t> result(numerals); //represents encrypted numerals
+    Span span = { result.data(), result.size() }; //represents token
+    Process(&span, 1, tweak, true); //encrypt token in place
+    return result;
+}
+
+
+/**
+ * @brief  Function that decrypts given numerals with given tweak.
+ * @param  vector<uint16_t> numerals
+ * @param  vector<unsigned char> tweak
+ * @return  vector<uint16_t> decryptedNumerals
+ * @throws  invalid_argument thrown if given numerals are invalid.
+ */
+vector<uint16_t> AESFF1::Decrypt(const vector<uint16_t>& numerals, const vector<unsigned char>& tweak) const {
+    vector<uint16_t> result(numerals); //represents decrypted numerals
+    Span span = { result.data(), result.size() }; //represents token
+    Process(&span, 1, tweak, false); //decrypt token in place
+    return result;
+}
+
+
+/**
+ * @brief  Function that encrypts given text with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+ * @param  string text
+ * @param  vector<unsigned char> tweak
+ * @return  string encryptedText
+ * @throws  invalid_argument thrown if given text or radix is invalid.
+ */
+string AESFF1::Encrypt(const string& text, const vector<unsigned char>& tweak) const {
+    vector<string> texts(1, text); //represents encrypted text
+    ProcessTexts(texts, tweak, true); //encrypt text in place
+    return texts[0];
+}
+
+
+/**
+ * @brief  Function that decrypts given text with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+ * @param  string text
+ * @param  vector<unsigned char> tweak
+ * @return  string decryptedText
+ * @throws  invalid_argument thrown if given text or radix is invalid.
+ */
+string AESFF1::Decrypt(const string& text, const vector<unsigned char>& tweak) const {
+    vector<string> texts(1, text); //represents decrypted text
+    ProcessTexts(texts, tweak, false); //decrypt text in place
+    return texts[0];
+}
+
+
+/**
+ * @brief  Function that encrypts given tokens of numerals in place with given tweak, tokens may have different lengths.
+ * @brief  All tokens are validated first, so the batch is left unchanged if one of them is invalid.
+ * @param  vector<vector<uint16_t>> tokens
+ * @param  vector<unsigned char> tweak
+ * @throws  invalid_argument thrown if given tokens are invalid.
+ */
+void AESFF1::EncryptBatch(vector<vector<uint16_t>>& tokens, const vector<unsigned char>& tweak) const {
+    vector<Span> spans(tokens.size()); //represents tokens
+    for (size_t i = 0; i < tokens.size(); i++) //iterate over tokens
+        spans[i] = { tokens[i].data(), tokens[i].size() }; //point at numerals of token
+    Process(spans.data(), spans.size(), tweak, true); //encrypt tokens in place
+}
+
+
+/**
+ * @brief  Function that decrypts given tokens of numerals in place with given tweak, tokens may have different lengths.
+ * @brief  All tokens are validated first, so the batch is left unchanged if one of them is invalid.
+ * @param  vector<vector<uint16_t>> tokens
+ * @param  vector<unsigned char> tweak
+ * @throws  invalid_argument thrown if given tokens are invalid.
+ */
+void AESFF1::DecryptBatch(vector<vector<uint16_t>>& tokens, const vector<unsigned char>& tweak) const {
+    vector<Span> spans(tokens.size()); //represents tokens
+    for (size_t i = 0; i < tokens.size(); i++) //iterate over tokens
+        spans[i] = { tokens[i].data(), tokens[i].size() }; //point at numerals of token
+    Process(spans.data(), spans.size(), tweak, false); //decrypt tokens in place
+}
+
+
+/**
+ * @brief  Function that encrypts given texts in place with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+ * @brief  All texts are validated first, so the batch is left unchanged if one of them is invalid.
+ * @param  vector<string> texts
+ * @param  vector<unsigned char> tweak
+ * @throws  invalid_argument thrown if given texts or radix are invalid.
+ */
+void AESFF1::EncryptBatch(vector<string>& texts, const vector<unsigned char>& tweak) const {
+    ProcessTexts(texts, tweak, true); //encrypt texts in place
+}
+
+
+/**
+ * @brief  Function that decrypts given texts in place with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+ * @brief  All texts are validated first, so the batch is left unchanged if one of them is invalid.
+ * @param  vector<string> texts
+ * @param  vector<unsigned char> tweak
+ * @throws  invalid_argument thrown if given texts or radix are invalid.
+ */
+void AESFF1::DecryptBatch(vector<string>& texts, const vector<unsigned char>& tweak) const {
+    ProcessTexts(texts, tweak, false); //decrypt texts in place
+}
+
+
+/**
+ * @brief  Function that returns the radix of numerals.
+ * @return  unsigned radix
+ */
+unsigned AESFF1::GetRadix() const {
+    return radix;
+}
+
+
+/**
+ * @brief  Function that returns the minimal number of numerals of a token, so that radix^length is at least one million.
+ * @return  size_t minLength
+ */
+size_t AESFF1::GetMinLength() const {
+    return minLength;
+}
+
+
+/**
+ * @brief  Function that computes the layout of tokens with given length and given tweak, encrypts P and the leading blocks of Q.
+ * @param  size_t length
+ * @param  vector<unsigned char> tweak
+ * @param  Layout layout
+ */
+void AESFF1::Prepare(const size_t length, const vector<unsigned char>& tweak, Layout& layout) const {
+    layout.length = length; //set number of numerals
+    layout.u = length / 2; //first half has floor(n/2) numerals
+    layout.v = length - layout.u; //second half has the rest
+    vector<unsigned char> power(1, 1); //represents radix^v as little-endian bytes
+    for (size_t i = 0; i < layout.v; i++) { //multiply by radix v times
+        uint32_t carry = 0; //represents carry of multiplication
+        for (unsigned char& byte : power) { //iterate over bytes from least significant
+            const uint32_t value = (uint32_t)byte * radix + carry; //represents product of byte with carry
+            byte = (unsigned char)value; //keep low byte
+            carry = value >> 8; //carry the rest
+        }
+        for (; carry != 0; carry >>= 8) //while carry remains
+            power.push_back((unsigned char)carry); //append byte
+    }
+    for (unsigned char& byte : power) //subtract one, radix^v is at least two
+        if (byte-- != 0) //if byte didn't borrow
+            break;
+    while (power.size() > 1 && power.back() == 0) //strip leading zeros
+        power.pop_back();
+    layout.b = power.size(); //b is the number of bytes of radix^v - 1, which equals ceil(ceil(v * log2(radix)) / 8)
+    layout.d = 4 * ((layout.b + 3) / 4) + 4; //d = 4 * ceil(b / 4) + 4
+    const size_t tweakSize = tweak.size(); //represents t
+    const size_t pad = (16 - (tweakSize + layout.b + 1) % 16) % 16; //represents (-t-b-1) mod 16
+    const size_t prefixBlocks = (tweakSize + pad) / 16; //number of blocks of Q that only hold tweak and padding
+    layout.headSize = (tweakSize + pad) % 16; //tweak and padding bytes before the round number
+    layout.tailBlocks = (layout.headSize + 1 + layout.b) / 16; //blocks that hold round number and half
+    const unsigned char p[16] = { 1, 2, 1, (unsigned char)(radix >> 16), (unsigned char)(radix >> 8), (unsigned char)radix, 10, (unsigned char)layout.u,
+        (unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length,
+        (unsigned char)(tweakSize >> 24), (unsigned char)(tweakSize >> 16), (unsigned char)(tweakSize >> 8), (unsigned char)tweakSize }; //represents P
+    memcpy(layout.prefix, p, 16); //CBC-MAC starts with P
+    EncryptBlock(layout.prefix, context.roundKeys, context.rounds); //encrypt P
+    for (size_t i = 0; i < prefixBlocks * 16 + layout.headSize; i++) { //iterate over tweak and padding bytes of Q
+        const unsigned char byte = i < tweakSize ? tweak[i] : 0; //represents byte of tweak or padding
+        if (i < prefixBlocks * 16) //if byte is in a leading block
+            layout.prefix[i % 16] ^= byte; //chain byte
+        else //else byte is in first block of tail
+            layout.head[i % 16] = byte; //keep byte for each round
+        if (i % 16 == 15 && i < prefixBlocks * 16) //if leading block is complete
+            EncryptBlock(layout.prefix, context.roundKeys, context.rounds); //encrypt block
+    }
+}
+
+
+/**
+ * @brief  Function that validates given tokens.
+ * @param  const Span* spans
+ * @param  size_t count
+ * @throws  invalid_argument thrown if given tokens are invalid.
+ */
+void AESFF1::Validate(const Span* spans, const size_t count) const {
+    for (size_t i = 0; i < count; i++) { //iterate over tokens
+        if (spans[i].length < minLength || spans[i].length > MaxLength) //if length is out of range
+            throw invalid_argument("Invalid text, please provide numerals whose length matches FF1 requirements."); //throw invalid argument
+        for (size_t j = 0; j < spans[i].length; j++) //iterate over numerals
+            if (spans[i].numerals[j] >= radix) //if numeral is out of range
+                throw invalid_argument("Invalid text, please provide numerals smaller than the radix."); //throw invalid argument
+    }
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given tokens in place, in parallel if the batch is large enough.
+ * @param  Span* spans
+ * @param  size_t count
+ * @param  vector<unsigned char> tweak
+ * @param  bool encrypt
+ * @throws  invalid_argument thrown if given tokens are invalid.
+ */
+void AESFF1::Process(Span* spans, const size_t count, const vector<unsigned char>& tweak, const bool encrypt) const {
+    AES_PROFILE_SCOPE(encrypt ? "FF1-Encrypt" : "FF1-Decrypt", count * 16); //profile FF1 batch of given direction
+    Validate(spans, count); //validate whole batch before changing it
+    if (tweak.size() > MaxLength) //if tweak length doesn't fit in P
+        throw invalid_argument("Invalid tweak, please provide tweak shorter than 2^32 bytes."); //throw invalid argument
+    const size_t groups = (count + GroupTokens - 1) / GroupTokens; //number of groups of tokens
+    if (count < ParallelThreshold || GetThreadCount() <= 1) { //if batch is small we process it on calling thread
+        for (size_t index = 0; index < groups; index++) //iterate over groups
+            ProcessGroup(spans + index * GroupTokens, min(count - index * GroupTokens, GroupTokens), tweak, encrypt); //process group
+        return;
+    }
+    ParallelFor(groups, [&](size_t index) { //process each group of tokens in parallel
+        ProcessGroup(spans + index * GroupTokens, min(count - index * GroupTokens, GroupTokens), tweak, encrypt); //process group
+    });
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given group of tokens in place and interleaves their rounds, tokens must be valid.
+ * @param  Span* spans
+ * @param  size_t count
+ * @param  vector<unsigned char> tweak
+ * @param  bool encrypt
+ */
+void AESFF1::ProcessGroup(Span* spans, const size_t count, const vector<unsigned char>& tweak, const bool encrypt) const {
+    vector<Layout> layouts; //represents layouts of distinct lengths in group, usually a single one
+    vector<size_t> indices(count), offsets(count); //represents layout and tail offset of each token
+    size_t tailSize = 0, maxTailBlocks = 0, maxD = 0; //represents sizes of scratch buffers
+    for (size_t g = 0; g < count; g++) { //iterate over tokens
+        size_t index = 0; //represents index of layout of token
+        while (index < layouts.size() && layouts[index].length != spans[g].length) //search layout of length
+            index++;
+        if (index == layouts.size()) { //if length is new
+            layouts.emplace_back(); //add layout
+            Prepare(spans[g].length, tweak, layouts.back()); //compute layout and encrypt P once for length
+        }
+        indices[g] = index; //set layout of token
+        offsets[g] = tailSize; //set tail of token
+        tailSize += layouts[index].tailBlocks * 16; //reserve tail
+        maxTailBlocks = max(maxTailBlocks, layouts[index].tailBlocks); //track longest tail
+        maxD = max(maxD, layouts[index].d); //track longest S
+    }
+    vector<unsigned char> tails(tailSize), states(count * 16), s(maxD), block(16); //represents round dependent blocks of Q, CBC-MAC states, S and a block of S
+    for (size_t round = 0; round < Rounds; round++) { //iterate over rounds
+        const size_t i = encrypt ? round : Rounds - 1 - round; //represents round number, decryption runs rounds backwards
+        for (size_t g = 0; g < count; g++) { //build Q of each token
+            const Layout& layout = layouts[indices[g]]; //represents layout of token
+            unsigned char* tail = tails.data() + offsets[g]; //represents tail of token
+            memcpy(tail, layout.head, layout.headSize); //copy tweak and padding
+            tail[layout.headSize] = (unsigned char)i; //set round number
+            if (i % 2 == 0) //if round reads second half
+                ToBytes(spans[g].numerals + layout.u, layout.v, radix, tail + layout.headSize + 1, layout.b); //write NUM(B) as b bytes
+            else //else round reads first half
+                ToBytes(spans[g].numerals, layout.u, radix, tail + layout.headSize + 1, layout.b); //write NUM(B) as b bytes
+            memcpy(states.data() + g * 16, layout.prefix, 16); //continue CBC-MAC after P and leading blocks
+        }
+        for (size_t t = 0; t < maxTailBlocks; t++) //iterate over tail blocks, each step encrypts one block of every token
+            for (size_t g = 0; g < count; g++) //iterate over tokens
+                if (t < layouts[indices[g]].tailBlocks) { //if token has this block
+                    unsigned char* state = states.data() + g * 16; //represents CBC-MAC state of token
+                    const unsigned char* tail = tails.data() + offsets[g] + t * 16; //represents block of Q
+                    for (size_t j = 0; j < 16; j++) //iterate over bytes
+                        state[j] ^= tail[j]; //chain block
+                    EncryptBlock(state, context.roundKeys, context.rounds); //encrypt block
+                }
+        for (size_t g = 0; g < count; g++) { //derive S and update half of each token
+            const Layout& layout = layouts[indices[g]]; //represents layout of token
+            const unsigned char* r = states.data() + g * 16; //represents R
+            memcpy(s.data(), r, min<size_t>(16, layout.d)); //S starts with R
+            for (size_t k = 1; k * 16 < layout.d; k++) { //append CIPH(R xor [k]) while S is too short
+                memcpy(block.data(), r, 16); //copy R
+                for (size_t j = 0; j < 8; j++) //iterate over low bytes
+                    block[15 - j] ^= (unsigned char)(k >> (8 * j)); //xor k as big-endian integer
+                EncryptBlock(block.data(), context.roundKeys, context.rounds); //encrypt block
+                memcpy(s.data() + k * 16, block.data(), min<size_t>(16, layout.d - k * 16)); //append block
+            }
+            uint16_t* half = spans[g].numerals + (i % 2 == 0 ? 0 : layout.u); //represents half that is updated
+            const size_t m = i % 2 == 0 ? layout.u : layout.v; //represents number of numerals of half
+            unsigned carry = 0; //represents carry of addition or borrow of subtraction
+            for (size_t j = m; j-- > 0;) { //iterate over numerals from least significant
+                const unsigned y = DivideBytes(s.data(), layout.d, radix); //represents next numeral of y
+                if (encrypt) { //if we encrypt we add y
+                    unsigned value = half[j] + y + carry; //represents sum of numerals
+                    carry = value >= radix; //carry if sum overflows
+                    half[j] = (uint16_t)(value - (carry ? radix : 0)); //keep numeral
+                }
+                else { //else we subtract y
+                    const unsigned subtrahend = y + carry; //represents numeral to subtract
+                    carry = half[j] < subtrahend; //borrow if difference underflows
+                    half[j] = (uint16_t)(half[j] + (carry ? radix : 0) - subtrahend); //keep numeral
+                }
+            }
+        }
+    }
+    for (vector<unsigned char>* buffer : { &tails, &states, &s, &block }) { //clear intermediate values of rounds
+        volatile unsigned char* bytes = buffer->data(); //write through volatile so round values are really wiped
+        for (size_t i = 0; i < buffer->size(); i++) //iterate over bytes
+            bytes[i] = 0x00; //clear each byte
+    }
+}
+
+
+/**
+ * @brief  Function that converts given text to numerals.
+ * @param  string text
+ * @param  uint16_t* numerals
+ * @throws  invalid_argument thrown if given text or radix is invalid.
+ */
+void AESFF1::ToNumerals(const string& text, uint16_t* numerals) const {
+    for (size_t i = 0; i < text.size(); i++) { //iterate over characters
+        const char c = text[i]; //represents character
+        unsigned numeral = radix; //represents numeral of character, radix if character isn't in alphabet
+        if (c >= '0' && c <= '9') //if character is a digit
+            numeral = c - '0';
+        else if (c >= 'a' && c <= 'z') //if character is a lowercase letter
+            numeral = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'Z') //if character is an uppercase letter
+            numeral = c - 'A' + 36;
+        if (numeral >= radix) //if character isn't a numeral of radix
+            throw invalid_argument("Invalid text, please provide characters of the alphabet 0-9a-zA-Z smaller than the radix."); //throw invalid argument
+        numerals[i] = (uint16_t)numeral; //set numeral
+    }
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given texts in place.
+ * @param  vector<string> texts
+ * @param  vector<unsigned char> tweak
+ * @param  bool encrypt
+ * @throws  invalid_argument thrown if given texts or radix are invalid.
+ */
+void AESFF1::ProcessTexts(vector<string>& texts, const vector<unsigned char>& tweak, const bool encrypt) const {
+    if (radix > sizeof(Alphabet) - 1) //if radix has more numerals than the alphabet
+        throw invalid_argument("Invalid radix, please provide radix of at most 62 for texts."); //throw invalid argument
+    size_t total = 0; //represents number of characters of all texts
+    for (const string& text : texts) //iterate over texts
+        total += text.size(); //add characters of text
+    vector<uint16_t> numerals(total); //represents numerals of all texts back to back
+    vector<Span> spans(texts.size()); //represents texts as tokens
+    for (size_t i = 0, offset = 0; i < texts.size(); offset += texts[i].size(), i++) { //iterate over texts
+        ToNumerals(texts[i], numerals.data() + offset); //convert text
+        spans[i] = { numerals.data() + offset, texts[i].size() }; //point at numerals of text
+    }
+    Process(spans.data(), spans.size(), tweak, encrypt); //encrypt or decrypt tokens in place
+    for (size_t i = 0; i < texts.size(); i++) //iterate over texts
+        for (size_t j = 0; j < spans[i].length; j++) //iterate over numerals
+            texts[i][j] = Alphabet[spans[i].numerals[j]]; //convert numeral back to character
+    volatile uint16_t* values = numerals.data(); //write through volatile so numerals of texts are really wiped
+    for (size_t i = 0; i < numerals.size(); i++) //iterate over numerals
+        values[i] = 0; //clear each numeral
+}
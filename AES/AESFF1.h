@@ -0,0 +1,217 @@
+#ifndef _AESFF1_H
+#define _AESFF1_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+
+/**
+ * @file AESFF1.h
+ * @brief  AESFF1 class for format-preserving encryption with the FF1 mode of NIST SP 800-38G, which encrypts strings of numerals in any radix to strings of the same length and radix.
+ * @brief  It suits tokenization of card numbers, account numbers and other fields whose format must be kept, the key is expanded once into a KeyContext.
+ * @brief  Each of the ten Feistel rounds runs a CBC-MAC over the tweak and half of the numerals, the blocks that only depend on length and tweak are encrypted once per length.
+ * @brief  Batches interleave the rounds of many tokens, each round encrypts one block of every token of a group before the next round starts.
+ * @brief  Large batches are split into groups that are processed in parallel with the AESParallel worker pool.
+ */
+class AESFF1 : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Constructor that expands given key for FF1 with given radix.
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned radix
+	 * @throws  invalid_argument thrown if given key or radix is invalid.
+	 */
+	AESFF1(const vector<unsigned char>& key, const unsigned radix = 10);
+
+	/**
+	 * @brief  Destructor that clears the round keys.
+	 */
+	~AESFF1();
+
+	AESFF1(const AESFF1&) = delete;
+	AESFF1& operator=(const AESFF1&) = delete;
+
+	/**
+	 * @brief  Function that encrypts given numerals with given tweak.
+	 * @param  vector<uint16_t> numerals
+	 * @param  vector<unsigned char> tweak
+	 * @return  vector<uint16_t> encryptedNumerals
+	 * @throws  invalid_argument thrown if given numerals are invalid.
+	 */
+	vector<uint16_t> Encrypt(const vector<uint16_t>& numerals, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that decrypts given numerals with given tweak.
+	 * @param  vector<uint16_t> numerals
+	 * @param  vector<unsigned char> tweak
+	 * @return  vector<uint16_t> decryptedNumerals
+	 * @throws  invalid_argument thrown if given numerals are invalid.
+	 */
+	vector<uint16_t> Decrypt(const vector<uint16_t>& numerals, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that encrypts given text with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+	 * @param  string text
+	 * @param  vector<unsigned char> tweak
+	 * @return  string encryptedText
+	 * @throws  invalid_argument thrown if given text or radix is invalid.
+	 */
+	string Encrypt(const string& text, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that decrypts given text with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+	 * @param  string text
+	 * @param  vector<unsigned char> tweak
+	 * @return  string decryptedText
+	 * @throws  invalid_argument thrown if given text or radix is invalid.
+	 */
+	string Decrypt(const string& text, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that encrypts given tokens of numerals in place with given tweak, tokens may have different lengths.
+	 * @brief  All tokens are validated first, so the batch is left unchanged if one of them is invalid.
+	 * @param  vector<vector<uint16_t>> tokens
+	 * @param  vector<unsigned char> tweak
+	 * @throws  invalid_argument thrown if given tokens are invalid.
+	 */
+	void EncryptBatch(vector<vector<uint16_t>>& tokens, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that decrypts given tokens of numerals in place with given tweak, tokens may have different lengths.
+	 * @brief  All tokens are validated first, so the batch is left unchanged if one of them is invalid.
+	 * @param  vector<vector<uint16_t>> tokens
+	 * @param  vector<unsigned char> tweak
+	 * @throws  invalid_argument thrown if given tokens are invalid.
+	 */
+	void DecryptBatch(vector<vector<uint16_t>>& tokens, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that encrypts given texts in place with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+	 * @brief  All texts are validated first, so the batch is left unchanged if one of them is invalid.
+	 * @param  vector<string> texts
+	 * @param  vector<unsigned char> tweak
+	 * @throws  invalid_argument thrown if given texts or radix are invalid.
+	 */
+	void EncryptBatch(vector<string>& texts, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that decrypts given texts in place with given tweak, characters are numerals of the alphabet "0-9a-zA-Z" and radix must be at most 62.
+	 * @brief  All texts are validated first, so the batch is left unchanged if one of them is invalid.
+	 * @param  vector<string> texts
+	 * @param  vector<unsigned char> tweak
+	 * @throws  invalid_argument thrown if given texts or radix are invalid.
+	 */
+	void DecryptBatch(vector<string>& texts, const vector<unsigned char>& tweak = vector<unsigned char>()) const;
+
+	/**
+	 * @brief  Function that returns the radix of numerals.
+	 * @return  unsigned radix
+	 */
+	unsigned GetRadix() const;
+
+	/**
+	 * @brief  Function that returns the minimal number of numerals of a token, so that radix^length is at least one million.
+	 * @return  size_t minLength
+	 */
+	size_t GetMinLength() const;
+
+protected:
+	/**
+	 * @brief  Represents the number of Feistel rounds of FF1.
+	 */
+	static const size_t Rounds = 10;
+
+	/**
+	 * @brief  Represents the number of tokens whose rounds are interleaved, also the number of tokens each worker processes at a time.
+	 */
+	static const size_t GroupTokens = 256;
+
+	/**
+	 * @brief  Represents the maximal number of numerals of a token.
+	 */
+	static const size_t MaxLength = 0xFFFFFFFF;
+
+	/**
+	 * @brief  Represents the alphabet of texts, numeral i is the character at index i.
+	 */
+	static const char Alphabet[];
+
+	/**
+	 * @brief  Represents the numerals of a token that are processed in place.
+	 */
+	struct Span {
+		uint16_t* numerals; //numerals of token
+		size_t length; //number of numerals
+	};
+
+	/**
+	 * @brief  Represents the parameters of FF1 that only depend on token length and tweak.
+	 */
+	struct Layout {
+		size_t length; //number of numerals n
+		size_t u; //number of numerals of first half
+		size_t v; //number of numerals of second half
+		size_t b; //number of bytes of a half as integer
+		size_t d; //number of bytes of S
+		size_t tailBlocks; //number of blocks of Q that depend on the round
+		size_t headSize; //number of tweak and padding bytes in first block of tail
+		unsigned char head[16]; //tweak and padding bytes in first block of tail
+		unsigned char prefix[16]; //CBC-MAC of P and the blocks of Q that don't depend on the round
+	};
+
+	/**
+	 * @brief  Function that computes the layout of tokens with given length and given tweak, encrypts P and the leading blocks of Q.
+	 * @param  size_t length
+	 * @param  vector<unsigned char> tweak
+	 * @param  Layout layout
+	 */
+	void Prepare(const size_t length, const vector<unsigned char>& tweak, Layout& layout) const;
+
+	/**
+	 * @brief  Function that validates given tokens.
+	 * @param  const Span* spans
+	 * @param  size_t count
+	 * @throws  invalid_argument thrown if given tokens are invalid.
+	 */
+	void Validate(const Span* spans, const size_t count) const;
+
+	/**
+	 * @brief  Function that encrypts or decrypts given tokens in place, in parallel if the batch is large enough.
+	 * @param  Span* spans
+	 * @param  size_t count
+	 * @param  vector<unsigned char> tweak
+	 * @param  bool encrypt
+	 * @throws  invalid_argument thrown if given tokens are invalid.
+	 */
+	void Process(Span* spans, const size_t count, const vector<unsigned char>& tweak, const bool encrypt) const;
+
+	/**
+	 * @brief  Function that encrypts or decrypts given group of tokens in place and interleaves their rounds, tokens must be valid.
+	 * @param  Span* spans
+	 * @param  size_t count
+	 * @param  vector<unsigned char> tweak
+	 * @param  bool encrypt
+	 */
+	void ProcessGroup(Span* spans, const size_t count, const vector<unsigned char>& tweak, const bool encrypt) const;
+
+	/**
+	 * @brief  Function that converts given text to numerals.
+	 * @param  string text
+	 * @param  uint16_t* numerals
+	 * @throws  invalid_argument thrown if given text or radix is invalid.
+	 */
+	void ToNumerals(const string& text, uint16_t* numerals) const;
+
+	/**
+	 * @brief  Function that encrypts or decrypts given texts in place.
+	 * @param  vector<string> texts
+	 * @param  vector<unsigned char> tweak
+	 * @param  bool encrypt
+	 * @throws  invalid_argument thrown if given texts or radix are invalid.
+	 */
+	void ProcessTexts(vector<string>& texts, const vector<unsigned char>& tweak, const bool encrypt) const;
+
+private:
+	KeyContext context; //expanded key
+	unsigned radix; //radix of numerals
+	size_t minLength; //minimal number of numerals
+};
+#endif
@@ -0,0 +1,379 @@
+#include "AESKeyBatch.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES_NI_TARGET
+#else
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif
+#define AES_KEYBATCH_AESNI
+#endif
+
+
+//use AES-NI key expansion by default when the processor supports it
+atomic<bool> AESKeyBatch::aesniEnabled{ true };
+
+
+#ifdef AES_KEYBATCH_AESNI
+/**
+ * @brief  Function that XORs given word with all its left shifted copies, so each word becomes the XOR of itself and all words before it.
+ * @param  __m128i word
+ * @return  __m128i prefixXor
+ */
+AES_NI_TARGET static inline __m128i PrefixXOR(__m128i word) {
+    word = _mm_xor_si128(word, _mm_slli_si128(word, 4)); //XOR with words shifted by one position
+    return _mm_xor_si128(word, _mm_slli_si128(word, 8)); //XOR with words shifted by two positions
+}
+
+
+/**
+ * @brief  Function that generates the next AES-128 round key from the previous round key and the result of AESKEYGENASSIST.
+ * @param  __m128i key
+ * @param  __m128i assist
+ * @return  __m128i nextKey
+ */
+AES_NI_TARGET static inline __m128i Expand128Step(__m128i key, __m128i assist) {
+    return _mm_xor_si128(PrefixXOR(key), _mm_shuffle_epi32(assist, 0xFF)); //XOR with rotated, substituted and Rcon XORed last word
+}
+
+
+/**
+ * @brief  Function that generates the next six AES-192 key words from the previous six words held in first and lower half of second.
+ * @param  __m128i first
+ * @param  __m128i second
+ * @param  __m128i assist
+ */
+AES_NI_TARGET static inline void Expand192Step(__m128i& first, __m128i& second, __m128i assist) {
+    first = _mm_xor_si128(PrefixXOR(first), _mm_shuffle_epi32(assist, 0x55)); //first four words, XOR with transformed word 5
+    second = _mm_xor_si128(second, _mm_slli_si128(second, 4)); //next two words
+    second = _mm_xor_si128(second, _mm_shuffle_epi32(first, 0xFF)); //XOR with last word of first
+}
+
+
+/**
+ * @brief  Function that generates the next AES-256 round key from the previous two round keys.
+ * @param  __m128i key
+ * @param  __m128i assist
+ * @return  __m128i nextKey
+ */
+AES_NI_TARGET static inline __m128i Expand256Step(__m128i key, __m128i assist) {
+    return _mm_xor_si128(PrefixXOR(key), assist); //XOR with broadcasted transformed word
+}
+#endif
+
+
+/**
+ * @brief  Function that expands given key into given flat round keys with word operations, supports AES-128, AES-192 and AES-256.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* roundKeys
+ */
+void AESKeyBatch::ExpandSoftware(const unsigned char* key, const size_t keySize, unsigned char* roundKeys) {
+    KeySchedule(key, keySize, roundKeys); //generate round keys with the flat AES key schedule
+}
+
+
+/**
+ * @brief  Function that expands given key into given flat round keys with AESKEYGENASSIST, supports AES-128, AES-192 and AES-256.
+ * @brief  Must only be called if HasAESNI returns true.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* roundKeys
+ */
+#ifdef AES_KEYBATCH_AESNI
+AES_NI_TARGET void AESKeyBatch::ExpandAESNI(const unsigned char* key, const size_t keySize, unsigned char* roundKeys) {
+    __m128i* schedule = (__m128i*)roundKeys; //represents round keys as 128-bit words, KeyContext keeps them aligned
+    if (keySize == 16) { //AES-128, each AESKEYGENASSIST gives the next round key, Rcon must be an immediate value
+        __m128i temp = _mm_loadu_si128((const __m128i*)key); //load key
+        schedule[0] = temp; //first round key is the key itself
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x01)); schedule[1] = temp; //round key 1
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x02)); schedule[2] = temp; //round key 2
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x04)); schedule[3] = temp; //round key 3
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x08)); schedule[4] = temp; //round key 4
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x10)); schedule[5] = temp; //round key 5
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x20)); schedule[6] = temp; //round key 6
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x40)); schedule[7] = temp; //round key 7
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x80)); schedule[8] = temp; //round key 8
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x1B)); schedule[9] = temp; //round key 9
+        temp = Expand128Step(temp, _mm_aeskeygenassist_si128(temp, 0x36)); schedule[10] = temp; //round key 10
+    }
+    else if (keySize == 24) { //AES-192, each step gives six words so round keys are assembled from halves
+        unsigned char tail[BlockSize]{}; //represents last 8 bytes of key, copied so we don't read past the key
+        memcpy(tail, key + BlockSize, 8); //copy last 8 bytes of key
+        __m128i first = _mm_loadu_si128((const __m128i*)key); //words 0-3
+        __m128i second = _mm_loadu_si128((const __m128i*)tail); //words 4-5
+        schedule[0] = first; //round key 0 from words 0-3
+        schedule[1] = second; //lower half of round key 1 from words 4-5
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x01)); //words 6-11
+        schedule[1] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(schedule[1]), _mm_castsi128_pd(first), 0)); //round key 1 from words 4-7
+        schedule[2] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(first), _mm_castsi128_pd(second), 1)); //round key 2 from words 8-11
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x02)); //words 12-17
+        schedule[3] = first; //round key 3 from words 12-15
+        schedule[4] = second; //lower half of round key 4 from words 16-17
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x04)); //words 18-23
+        schedule[4] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(schedule[4]), _mm_castsi128_pd(first), 0)); //round key 4 from words 16-19
+        schedule[5] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(first), _mm_castsi128_pd(second), 1)); //round key 5 from words 20-23
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x08)); //words 24-29
+        schedule[6] = first; //round key 6 from words 24-27
+        schedule[7] = second; //lower half of round key 7 from words 28-29
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x10)); //words 30-35
+        schedule[7] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(schedule[7]), _mm_castsi128_pd(first), 0)); //round key 7 from words 28-31
+        schedule[8] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(first), _mm_castsi128_pd(second), 1)); //round key 8 from words 32-35
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x20)); //words 36-41
+        schedule[9] = first; //round key 9 from words 36-39
+        schedule[10] = second; //lower half of round key 10 from words 40-41
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x40)); //words 42-47
+        schedule[10] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(schedule[10]), _mm_castsi128_pd(first), 0)); //round key 10 from words 40-43
+        schedule[11] = _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(first), _mm_castsi128_pd(second), 1)); //round key 11 from words 44-47
+        Expand192Step(first, second, _mm_aeskeygenassist_si128(second, 0x80)); //words 48-53
+        schedule[12] = first; //round key 12 from words 48-51
+        fill(tail, tail + BlockSize, 0x00); //clear tail, it holds words of the key
+        second = _mm_setzero_si128(); //clear key words
+    }
+    else { //AES-256, round keys alternate between the Rcon step and the SubWord only step
+        __m128i first = _mm_loadu_si128((const __m128i*)key); //words 0-3
+        __m128i second = _mm_loadu_si128((const __m128i*)(key + BlockSize)); //words 4-7
+        schedule[0] = first; //round key 0
+        schedule[1] = second; //round key 1
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x01), 0xFF)); schedule[2] = first; //round key 2
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[3] = second; //round key 3
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x02), 0xFF)); schedule[4] = first; //round key 4
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[5] = second; //round key 5
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x04), 0xFF)); schedule[6] = first; //round key 6
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[7] = second; //round key 7
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x08), 0xFF)); schedule[8] = first; //round key 8
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[9] = second; //round key 9
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x10), 0xFF)); schedule[10] = first; //round key 10
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[11] = second; //round key 11
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x20), 0xFF)); schedule[12] = first; //round key 12
+        second = Expand256Step(second, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(first, 0x00), 0xAA)); schedule[13] = second; //round key 13
+        first = Expand256Step(first, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(second, 0x40), 0xFF)); schedule[14] = first; //round key 14
+        second = _mm_setzero_si128(); //clear key words
+    }
+}
+#else
+void AESKeyBatch::ExpandAESNI(const unsigned char* key, const size_t keySize, unsigned char* roundKeys) {
+    ExpandSoftware(key, keySize, roundKeys); //AES-NI isn't available on this architecture so we use the software expansion
+}
+#endif
+
+
+/**
+ * @brief  Function that returns if the processor supports AES-NI, in which case key expansion uses AESKEYGENASSIST unless disabled.
+ * @return  bool hasAESNI
+ */
+bool AESKeyBatch::HasAESNI() {
+#if defined(AES_KEYBATCH_AESNI) && defined(_MSC_VER)
+    static const bool hasAESNI = []() { int info[4]{}; __cpuid(info, 1); return ((info[2] >> 25) & 1) != 0; }(); //check AES bit of CPUID leaf 1 once
+    return hasAESNI; //return cached result
+#elif defined(AES_KEYBATCH_AESNI)
+    static const bool hasAESNI = __builtin_cpu_supports("aes"); //check processor features once
+    return hasAESNI; //return cached result
+#else
+    return false; //AES-NI isn't available on this architecture
+#endif
+}
+
+
+/**
+ * @brief  Function that enables or disables the AES-NI key expansion, it's only used if the processor supports it.
+ * @param  bool enabled
+ */
+void AESKeyBatch::SetAESNI(const bool enabled) {
+    aesniEnabled = enabled; //set if AES-NI is enabled
+}
+
+
+/**
+ * @brief  Function that returns if key expansion uses AES-NI, which requires it to be enabled and supported by the processor.
+ * @return  bool usesAESNI
+ */
+bool AESKeyBatch::UsesAESNI() {
+    return aesniEnabled && HasAESNI(); //return if AES-NI is enabled and supported
+}
+
+
+/**
+ * @brief  Function that expands given key into given context.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  KeyContext context
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESKeyBatch::Expand(const unsigned char* key, const size_t keySize, KeyContext& context) {
+    if (key == NULL || (keySize != 16 && keySize != 24 && keySize != 32)) //if key is missing or key size is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if (UsesAESNI()) //if AES-NI is enabled and supported
+        ExpandAESNI(key, keySize, context.roundKeys); //expand key with AESKEYGENASSIST
+    else //else we use the software expansion
+        ExpandSoftware(key, keySize, context.roundKeys); //expand key with word operations
+    context.rounds = keySize / Nb + 6; //set number of rounds
+}
+
+
+/**
+ * @brief  Function that expands given key into a new context.
+ * @param  vector<unsigned char> key
+ * @return  KeyContext context
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+AESKeyBatch::KeyContext AESKeyBatch::Expand(const vector<unsigned char>& key) {
+    KeyContext context; //represents expanded key
+    Expand(key.data(), key.size(), context); //expand key
+    return context; //return expanded key
+}
+
+
+/**
+ * @brief  Function that expands given number of keys of the same size stored back to back into given contexts.
+ * @param  const unsigned char* keys
+ * @param  size_t keySize
+ * @param  size_t count
+ * @param  KeyContext* contexts
+ * @throws  invalid_argument thrown if given keys are invalid.
+ */
+void AESKeyBatch::ExpandBatch(const unsigned char* keys, const size_t keySize, const size_t count, KeyContext* contexts) {
+    AES_PROFILE_SCOPE("KeyBatch-Expand", count * keySize); //profile batched key expansion
+    if (count == 0) //if there are no keys
+        return;
+    if (keys == NULL || contexts == NULL || (keySize != 16 && keySize != 24 && keySize != 32)) //if keys are missing or key size is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    const bool useAESNI = UsesAESNI(); //check backend once for whole batch
+    const size_t rounds = keySize / Nb + 6; //number of rounds of all keys
+    auto expandRange = [&](size_t first, size_t last) { //expands keys in range [first, last)
+        for (size_t i = first; i < last; i++) { //iterate over keys
+            if (useAESNI) //if AES-NI is enabled and supported
+                ExpandAESNI(keys + i * keySize, keySize, contexts[i].roundKeys); //expand key with AESKEYGENASSIST
+            else //else we use the software expansion
+                ExpandSoftware(keys + i * keySize, keySize, contexts[i].roundKeys); //expand key with word operations
+            contexts[i].rounds = rounds; //set number of rounds
+        }
+    };
+    if (count < ParallelThreshold || GetThreadCount() <= 1) { //if batch is small we expand it on calling thread
+        expandRange(0, count); //expand all keys
+        return;
+    }
+    const size_t group = ParallelThreshold / 4; //number of keys each worker expands at a time
+    ParallelFor((count + group - 1) / group, [&](size_t index) { //expand each group of keys in parallel
+        expandRange(index * group, min(count, (index + 1) * group)); //expand group
+    });
+}
+
+
+/**
+ * @brief  Function that expands given keys into new contexts, keys may have different sizes.
+ * @param  vector<vector<unsigned char>> keys
+ * @return  vector<KeyContext> contexts
+ * @throws  invalid_argument thrown if given keys are invalid.
+ */
+vector<AESKeyBatch::KeyContext> AESKeyBatch::ExpandBatch(const vector<vector<unsigned char>>& keys) {
+    AES_PROFILE_SCOPE("KeyBatch-Expand", keys.size() * 16); //profile batched key expansion of mixed key sizes
+    for (const vector<unsigned char>& key : keys) //iterate over keys and validate them before expanding
+        if (key.size() != 16 && key.size() != 24 && key.size() != 32) //if key size is invalid
+            throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    vector<KeyContext> contexts(keys.size()); //represents expanded keys
+    auto expandRange = [&](size_t first, size_t last) { //expands keys in range [first, last)
+        for (size_t i = first; i < last; i++) //iterate over keys
+            Expand(keys[i].data(), keys[i].size(), contexts[i]); //expand key
+    };
+    if (keys.size() < ParallelThreshold || GetThreadCount() <= 1) //if batch is small we expand it on calling thread
+        expandRange(0, keys.size()); //expand all keys
+    else { //else we expand groups of keys in parallel
+        const size_t group = ParallelThreshold / 4; //number of keys each worker expands at a time
+        ParallelFor((keys.size() + group - 1) / group, [&](size_t index) { //expand each group of keys in parallel
+            expandRange(index * group, min(keys.size(), (index + 1) * group)); //expand group
+        });
+    }
+    return contexts; //return expanded keys
+}
+
+
+/**
+ * @brief  Function that encrypts given buffer block by block with the round keys of given context, like ECB mode.
+ * @brief  Length must be a multiple of 16 bytes, input and output may be the same buffer.
+ * @param  KeyContext context
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @throws  invalid_argument thrown if given context or buffer is invalid.
+ */
+void AESKeyBatch::EncryptBlocks(const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length) {
+    if (context.rounds == 0) //if context wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES ECB requirements."); //throw invalid argument
+    ForEachChunk(length, GetChunkSize(), [&](size_t offset, size_t size) { //process each chunk
+        for (size_t i = offset; i < offset + size; i += BlockSize) { //iterate over chunk
+            if (output != input) memcpy(output + i, input + i, BlockSize); //copy block to output when working out of place
+            EncryptBlock(output + i, context.roundKeys, context.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+        }
+    });
+}
+
+
+/**
+ * @brief  Function that decrypts given buffer block by block with the round keys of given context, like ECB mode.
+ * @brief  Length must be a multiple of 16 bytes, input and output may be the same buffer.
+ * @param  KeyContext context
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @throws  invalid_argument thrown if given context or buffer is invalid.
+ */
+void AESKeyBatch::DecryptBlocks(const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length) {
+    if (context.rounds == 0) //if context wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES ECB requirements."); //throw invalid argument
+    ForEachChunk(length, GetChunkSize(), [&](size_t offset, size_t size) { //process each chunk
+        for (size_t i = offset; i < offset + size; i += BlockSize) { //iterate over chunk
+            if (output != input) memcpy(output + i, input + i, BlockSize); //copy block to output when working out of place
+            DecryptBlock(output + i, context.roundKeys, context.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+        }
+    });
+}
+
+
+/**
+ * @brief  Function that converts given context to round keys in the format returned by KeySchedule.
+ * @param  KeyContext context
+ * @return  vector<vector<unsigned char>> roundKeys
+ * @throws  invalid_argument thrown if given context is empty.
+ */
+vector<vector<unsigned char>> AESKeyBatch::ToRoundKeys(const KeyContext& context) {
+    if (context.rounds == 0) //if context wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys; //represents round keys as matrix of vectors
+    roundKeys.reserve(context.rounds + 1); //reserve memory for our keys in advance
+    for (size_t i = 0; i <= context.rounds; i++) //iterate over round keys
+        roundKeys.emplace_back(context.roundKeys + i * BlockSize, context.roundKeys + (i + 1) * BlockSize); //add each round key
+    return roundKeys; //return round keys
+}
+
+
+/**
+ * @brief  Function that clears the round keys of given context.
+ * @param  KeyContext context
+ */
+void AESKeyBatch::Clear(KeyContext& context) {
+    volatile unsigned char* roundKeys = context.roundKeys; //write through volatile so batched round keys are really wiped
+    for (size_t i = 0; i < sizeof(context.roundKeys); i++) //iterate over round keys
+        roundKeys[i] = 0x00; //clear each byte
+    context.rounds = 0; //mark context as empty
+}
+
+
+/**
+ * @brief  Function that clears the round keys of given contexts.
+ * @param  vector<KeyContext> contexts
+ */
+void AESKeyBatch::Clear(vector<KeyContext>& contexts) {
+    for (KeyContext& context : contexts) //iterate over contexts
+        Clear(context); //clear each context
+    contexts.clear(); //remove contexts
+}
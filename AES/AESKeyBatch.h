@@ -0,0 +1,146 @@
+#ifndef _AESKEYBATCH_H
+#define _AESKEYBATCH_H
+#include "AESParallel.h"
+
+/**
+ * @file AESKeyBatch.h
+ * @brief  AESKeyBatch class for key-agile workloads that expand many keys and encrypt a few blocks with each.
+ * @brief  Round keys are expanded into a flat, contiguous and aligned KeyContext without any heap allocations.
+ * @brief  On x86 processors with AES-NI the key expansion uses AESKEYGENASSIST, otherwise a word-based software expansion is used.
+ * @brief  Batches of keys are expanded in parallel with the AESParallel worker pool when the batch is large enough.
+ * @brief  The schedule is identical to the one returned by KeySchedule, so contexts can be converted for the rest of the library.
+ */
+class AESKeyBatch : public AESParallel {
+public:
+	/**
+	 * @brief  Represents the expanded encryption round keys of a single key stored back to back.
+	 */
+	struct KeyContext {
+		alignas(16) unsigned char roundKeys[15 * 16] = {}; //round keys, 11, 13 or 15 keys of 16 bytes
+		size_t rounds = 0; //number of rounds (10, 12 or 14), 0 if context is empty
+	};
+
+	/**
+	 * @brief  Function that expands given key into given context.
+	 * @param  const unsigned char* key
+	 * @param  size_t keySize
+	 * @param  KeyContext context
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void Expand(const unsigned char* key, const size_t keySize, KeyContext& context);
+
+	/**
+	 * @brief  Function that expands given key into a new context.
+	 * @param  vector<unsigned char> key
+	 * @return  KeyContext context
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static KeyContext Expand(const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that expands given number of keys of the same size stored back to back into given contexts.
+	 * @param  const unsigned char* keys
+	 * @param  size_t keySize
+	 * @param  size_t count
+	 * @param  KeyContext* contexts
+	 * @throws  invalid_argument thrown if given keys are invalid.
+	 */
+	static void ExpandBatch(const unsigned char* keys, const size_t keySize, const size_t count, KeyContext* contexts);
+
+	/**
+	 * @brief  Function that expands given keys into new contexts, keys may have different sizes.
+	 * @param  vector<vector<unsigned char>> keys
+	 * @return  vector<KeyContext> contexts
+	 * @throws  invalid_argument thrown if given keys are invalid.
+	 */
+	static vector<KeyContext> ExpandBatch(const vector<vector<unsigned char>>& keys);
+
+	/**
+	 * @brief  Function that encrypts given buffer block by block with the round keys of given context, like ECB mode.
+	 * @brief  Length must be a multiple of 16 bytes, input and output may be the same buffer.
+	 * @param  KeyContext context
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @throws  invalid_argument thrown if given context or buffer is invalid.
+	 */
+	static void EncryptBlocks(const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that decrypts given buffer block by block with the round keys of given context, like ECB mode.
+	 * @brief  Length must be a multiple of 16 bytes, input and output may be the same buffer.
+	 * @param  KeyContext context
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @throws  invalid_argument thrown if given context or buffer is invalid.
+	 */
+	static void DecryptBlocks(const KeyContext& context, const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that converts given context to round keys in the format returned by KeySchedule.
+	 * @param  KeyContext context
+	 * @return  vector<vector<unsigned char>> roundKeys
+	 * @throws  invalid_argument thrown if given context is empty.
+	 */
+	static vector<vector<unsigned char>> ToRoundKeys(const KeyContext& context);
+
+	/**
+	 * @brief  Function that clears the round keys of given context.
+	 * @param  KeyContext context
+	 */
+	static void Clear(KeyContext& context);
+
+	/**
+	 * @brief  Function that clears the round keys of given contexts.
+	 * @param  vector<KeyContext> contexts
+	 */
+	static void Clear(vector<KeyContext>& contexts);
+
+	/**
+	 * @brief  Function that returns if the processor supports AES-NI, in which case key expansion uses AESKEYGENASSIST unless disabled.
+	 * @return  bool hasAESNI
+	 */
+	static bool HasAESNI();
+
+	/**
+	 * @brief  Function that enables or disables the AES-NI key expansion, it's only used if the processor supports it.
+	 * @param  bool enabled
+	 */
+	static void SetAESNI(const bool enabled);
+
+	/**
+	 * @brief  Function that returns if key expansion uses AES-NI, which requires it to be enabled and supported by the processor.
+	 * @return  bool usesAESNI
+	 */
+	static bool UsesAESNI();
+
+protected:
+	/**
+	 * @brief  Represents if the AES-NI key expansion is enabled, true by default.
+	 */
+	static atomic<bool> aesniEnabled;
+
+	/**
+	 * @brief  Represents the minimal number of keys in a batch that is expanded in parallel.
+	 */
+	static const size_t ParallelThreshold = 1024;
+
+	/**
+	 * @brief  Function that expands given key into given flat round keys with word operations, supports AES-128, AES-192 and AES-256.
+	 * @param  const unsigned char* key
+	 * @param  size_t keySize
+	 * @param  unsigned char* roundKeys
+	 */
+	static void ExpandSoftware(const unsigned char* key, const size_t keySize, unsigned char* roundKeys);
+
+	/**
+	 * @brief  Function that expands given key into given flat round keys with AESKEYGENASSIST, supports AES-128, AES-192 and AES-256.
+	 * @brief  Must only be called if HasAESNI returns true.
+	 * @param  const unsigned char* key
+	 * @param  size_t keySize
+	 * @param  unsigned char* roundKeys
+	 */
+	static void ExpandAESNI(const unsigned char* key, const size_t keySize, unsigned char* roundKeys);
+};
+#endif
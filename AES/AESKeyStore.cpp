@@ -0,0 +1,343 @@
+#include "AESKeyStore.h"
+#ifdef AES_KEYSTORE
+#include <cstring>
+#include <stdexcept>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * @brief  Constructor that creates a new store with given name that holds given number of entries and opens it for writing.
+ * @brief  Only the creating process writes to the store, it may add and remove entries from several threads.
+ * @param  string name
+ * @param  size_t capacity
+ * @throws  invalid_argument thrown if given name or capacity is invalid.
+ * @throws  runtime_error thrown if the store already exists or can't be created.
+ */
+AESKeyStore::AESKeyStore(const string& name, const size_t capacity) : header(NULL), entries(NULL), capacity(0), mappingSize(0), isWritable(true) {
+    if (capacity == 0 || capacity > (SIZE_MAX - sizeof(Header)) / sizeof(Entry) / 2) //if capacity is empty or too large to map
+        throw invalid_argument("Invalid capacity, please provide capacity larger than zero that fits in memory."); //throw invalid argument
+    size_t entryCount = 1; //represents capacity rounded up to a power of two
+    while (entryCount < capacity) //until capacity fits
+        entryCount <<= 1; //double number of entries
+    Map(name, entryCount, true); //create and map store
+}
+
+
+/**
+ * @brief  Constructor that opens the existing store with given name read-only.
+ * @param  string name
+ * @throws  invalid_argument thrown if given name is invalid.
+ * @throws  runtime_error thrown if the store doesn't exist or isn't a valid store.
+ */
+AESKeyStore::AESKeyStore(const string& name) : header(NULL), entries(NULL), capacity(0), mappingSize(0), isWritable(false) {
+    Map(name, 0, false); //open and map store
+}
+
+
+/**
+ * @brief  Destructor that unmaps the store, the store itself stays until Unlink is called.
+ */
+AESKeyStore::~AESKeyStore() {
+    if (header != NULL) //if store is mapped
+        munmap(header, mappingSize); //unmap store
+}
+
+
+/**
+ * @brief  Function that expands given key and stores it under given key id and version, an existing entry with the same id and version is replaced.
+ * @param  uint64_t keyId
+ * @param  uint64_t version
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  runtime_error thrown if the store is read-only or full.
+ */
+void AESKeyStore::Put(const uint64_t keyId, const uint64_t version, const vector<unsigned char>& key) {
+    if (!isWritable) //if store is opened read-only
+        throw runtime_error("Failed to write key store, it's opened read-only."); //throw runtime error
+    KeyContext context = Expand(key); //expand key once for all processes
+    lock_guard<mutex> lock(writeMutex); //only one writer changes entries at a time
+    size_t home = Home(keyId), target = SIZE_MAX; //represents first entry of probe chain and entry we write
+    bool isReplaced = false; //represents if an entry with same id and version exists
+    for (size_t i = 0; i < capacity; i++) { //iterate over probe chain
+        Entry& entry = entries[(home + i) & (capacity - 1)]; //get entry of chain
+        uint64_t state = entry.state.load(memory_order_relaxed); //we're the only writer so entries can be read directly
+        if (state == UsedState && entry.keyId.load(memory_order_relaxed) == keyId && entry.version.load(memory_order_relaxed) == version) { //if entry holds same id and version
+            target = (home + i) & (capacity - 1); //replace it
+            isReplaced = true; //entry isn't counted again
+            break;
+        }
+        if (state != UsedState && target == SIZE_MAX) //if entry is the first free one of the chain
+            target = (home + i) & (capacity - 1); //use it unless same id and version follows
+        if (state == EmptyState) //if chain ends
+            break;
+    }
+    if (target == SIZE_MAX) { //if every entry is used
+        Clear(context); //clear round keys
+        throw runtime_error("Failed to add key, key store is full."); //throw runtime error
+    }
+    Write(entries[target], UsedState, keyId, version, &context); //publish round keys
+    Clear(context); //clear local round keys, the published copy lives in shared memory
+    if (!isReplaced) //if entry is new
+        header->count.fetch_add(1, memory_order_relaxed); //count entry
+}
+
+
+/**
+ * @brief  Function that removes and zeroizes the entry with given key id and version, returns if it was found.
+ * @param  uint64_t keyId
+ * @param  uint64_t version
+ * @return  bool isRemoved
+ * @throws  runtime_error thrown if the store is read-only.
+ */
+bool AESKeyStore::Remove(const uint64_t keyId, const uint64_t version) {
+    if (!isWritable) //if store is opened read-only
+        throw runtime_error("Failed to write key store, it's opened read-only."); //throw runtime error
+    lock_guard<mutex> lock(writeMutex); //only one writer changes entries at a time
+    size_t home = Home(keyId); //represents first entry of probe chain
+    for (size_t i = 0; i < capacity; i++) { //iterate over probe chain
+        Entry& entry = entries[(home + i) & (capacity - 1)]; //get entry of chain
+        uint64_t state = entry.state.load(memory_order_relaxed); //we're the only writer so entries can be read directly
+        if (state == EmptyState) //if chain ends
+            return false; //entry isn't in store
+        if (state == UsedState && entry.keyId.load(memory_order_relaxed) == keyId && entry.version.load(memory_order_relaxed) == version) { //if entry holds same id and version
+            Write(entry, RemovedState, 0, 0, NULL); //zeroize entry, it stays in the chain so later entries are still found
+            header->count.fetch_sub(1, memory_order_relaxed); //uncount entry
+            return true; //entry was removed
+        }
+    }
+    return false; //entry isn't in store
+}
+
+
+/**
+ * @brief  Function that copies the round keys of given key id and version into given context, returns if the entry was found.
+ * @brief  Returns false if an entry of the probe chain stays mid-write for longer than ReadTimeout.
+ * @param  uint64_t keyId
+ * @param  uint64_t version
+ * @param  KeyContext context
+ * @return  bool isFound
+ */
+bool AESKeyStore::Find(const uint64_t keyId, const uint64_t version, KeyContext& context) const {
+    size_t home = Home(keyId); //represents first entry of probe chain
+    uint64_t state = EmptyState, foundVersion = 0; //represents state and version of current entry
+    for (size_t i = 0; i < capacity; i++) { //iterate over probe chain
+        if (Read(entries[(home + i) & (capacity - 1)], keyId, version, state, foundVersion, &context)) //if entry holds given id and version
+            return true; //round keys were copied into context
+        if (state == EmptyState || state == BusyState) //if chain ends or an entry of it can't be read
+            break;
+    }
+    return false; //entry isn't in store
+}
+
+
+/**
+ * @brief  Function that copies the round keys of the highest version of given key id into given context and returns its version, returns if an entry was found.
+ * @brief  Returns false if an entry of the probe chain stays mid-write for longer than ReadTimeout.
+ * @param  uint64_t keyId
+ * @param  KeyContext context
+ * @param  uint64_t version
+ * @return  bool isFound
+ */
+bool AESKeyStore::FindLatest(const uint64_t keyId, KeyContext& context, uint64_t& version) const {
+    size_t home = Home(keyId); //represents first entry of probe chain
+    uint64_t state = EmptyState, foundVersion = 0; //represents state and version of current entry
+    bool isFound = false; //represents if a version was found
+    KeyContext candidate; //represents round keys of current entry
+    for (size_t i = 0; i < capacity; i++) { //iterate over probe chain, every version of an id is in the same chain
+        if (Read(entries[(home + i) & (capacity - 1)], keyId, UINT64_MAX, state, foundVersion, &candidate) && (!isFound || foundVersion > version)) { //if entry is a higher version of given id
+            context = candidate; //keep round keys of highest version
+            version = foundVersion; //keep highest version
+            isFound = true; //a version was found
+        }
+        if (state == BusyState) { //if an entry can't be read it may hold a higher version
+            isFound = false; //fail lookup instead of returning an older version
+            Clear(context); //clear round keys of lower version
+            break;
+        }
+        if (state == EmptyState) //if chain ends
+            break;
+    }
+    Clear(candidate); //clear round keys of candidate
+    return isFound; //return if a version was found
+}
+
+
+/**
+ * @brief  Function that returns the number of entries in the store.
+ * @return  size_t count
+ */
+size_t AESKeyStore::GetCount() const {
+    return (size_t)header->count.load(memory_order_relaxed); //return number of used entries
+}
+
+
+/**
+ * @brief  Function that returns the number of entries the store holds.
+ * @return  size_t capacity
+ */
+size_t AESKeyStore::GetCapacity() const {
+    return capacity; //return number of entries
+}
+
+
+/**
+ * @brief  Function that returns if the store is opened for writing.
+ * @return  bool isWritable
+ */
+bool AESKeyStore::IsWritable() const {
+    return isWritable; //return if store was created by this object
+}
+
+
+/**
+ * @brief  Function that removes the store with given name, processes that have it mapped keep using it until they unmap it.
+ * @param  string name
+ */
+void AESKeyStore::Unlink(const string& name) {
+    shm_unlink(name.c_str()); //remove name, memory is freed once the last mapping is gone
+}
+
+
+/**
+ * @brief  Function that returns the first entry of the probe chain of given key id.
+ * @param  uint64_t keyId
+ * @return  size_t index
+ */
+size_t AESKeyStore::Home(const uint64_t keyId) const {
+    uint64_t hash = keyId + 0x9E3779B97F4A7C15ULL; //mix key id so consecutive ids spread over the store
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL; //first multiply of the splitmix64 finalizer
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL; //second multiply of the splitmix64 finalizer
+    return (size_t)(hash ^ (hash >> 31)) & (capacity - 1); //return index inside store
+}
+
+
+/**
+ * @brief  Function that reads a consistent snapshot of given entry, round keys are only copied into given context if id and version match.
+ * @brief  A version of UINT64_MAX matches any version.
+ * @brief  If the entry stays mid-write for longer than ReadTimeout, state is set to BusyState, given context is cleared and false is returned.
+ * @param  Entry entry
+ * @param  uint64_t keyId
+ * @param  uint64_t version
+ * @param  uint64_t state
+ * @param  uint64_t foundVersion
+ * @param  KeyContext* context
+ * @return  bool isMatch
+ */
+bool AESKeyStore::Read(const Entry& entry, const uint64_t keyId, const uint64_t version, uint64_t& state, uint64_t& foundVersion, KeyContext* context) {
+    chrono::steady_clock::time_point deadline; //represents time after which we stop waiting for the writer
+    for (size_t attempt = 0;; attempt++) { //retry until snapshot is consistent or the writer took too long
+        if (attempt == 1) //if first snapshot wasn't consistent we start waiting
+            deadline = chrono::steady_clock::now() + chrono::milliseconds(ReadTimeout); //set deadline of entry
+        else if (attempt > 1 && chrono::steady_clock::now() > deadline) { //if entry stays mid-write its writer may have died while writing
+            state = BusyState; //report entry as unreadable
+            if (context != NULL) //if round keys may have been copied from a torn snapshot
+                Clear(*context); //clear them
+            return false; //fail lookup
+        }
+        uint64_t sequence = entry.sequence.load(memory_order_acquire); //represents sequence before reading
+        if (sequence & 1) { //if entry is being written
+            this_thread::yield(); //let writer finish
+            continue;
+        }
+        state = entry.state.load(memory_order_relaxed); //read state
+        foundVersion = entry.version.load(memory_order_relaxed); //read version
+        bool isMatch = state == UsedState && entry.keyId.load(memory_order_relaxed) == keyId && (version == UINT64_MAX || foundVersion == version); //represents if entry holds given id and version
+        if (isMatch && context != NULL) { //if we copy round keys
+            context->rounds = (size_t)entry.rounds.load(memory_order_relaxed); //read number of rounds
+            for (size_t i = 0; i < 30; i++) { //iterate over words of round keys
+                uint64_t word = entry.roundKeys[i].load(memory_order_relaxed); //read word
+                memcpy(context->roundKeys + i * 8, &word, 8); //copy word into context
+            }
+        }
+        atomic_thread_fence(memory_order_acquire); //order reads of entry before checking sequence again
+        if (entry.sequence.load(memory_order_relaxed) == sequence) //if entry didn't change while we read it
+            return isMatch; //return if entry matches
+    }
+}
+
+
+/**
+ * @brief  Function that writes given entry under its sequence counter, round keys are zeroized if context is NULL.
+ * @param  Entry entry
+ * @param  State state
+ * @param  uint64_t keyId
+ * @param  uint64_t version
+ * @param  const KeyContext* context
+ */
+void AESKeyStore::Write(Entry& entry, const State state, const uint64_t keyId, const uint64_t version, const KeyContext* context) {
+    uint64_t sequence = entry.sequence.load(memory_order_relaxed); //represents sequence before writing
+    entry.sequence.store(sequence + 1, memory_order_relaxed); //mark entry as being written
+    atomic_thread_fence(memory_order_release); //order mark before writes of entry
+    entry.state.store(state, memory_order_relaxed); //write state
+    entry.keyId.store(keyId, memory_order_relaxed); //write key id
+    entry.version.store(version, memory_order_relaxed); //write version
+    entry.rounds.store(context != NULL ? context->rounds : 0, memory_order_relaxed); //write number of rounds
+    for (size_t i = 0; i < 30; i++) { //iterate over words of round keys
+        uint64_t word = 0; //represents word, zero when entry is zeroized
+        if (context != NULL) //if we write round keys
+            memcpy(&word, context->roundKeys + i * 8, 8); //copy word from context
+        entry.roundKeys[i].store(word, memory_order_relaxed); //write word
+    }
+    entry.sequence.store(sequence + 2, memory_order_release); //publish entry
+}
+
+
+/**
+ * @brief  Function that opens and maps the store with given name.
+ * @param  string name
+ * @param  size_t capacity
+ * @param  bool create
+ * @throws  invalid_argument thrown if given name is invalid.
+ * @throws  runtime_error thrown if the store can't be created, opened or mapped.
+ */
+void AESKeyStore::Map(const string& name, const size_t capacity, const bool create) {
+    static_assert(atomic<uint64_t>::is_always_lock_free, "Entries of shared memory require lock-free 64 bit atomics."); //atomics in shared memory must not hide locks
+    if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != string::npos) //if name isn't a valid shared memory name
+        throw invalid_argument("Invalid name, please provide name that starts with a slash and contains no other slash."); //throw invalid argument
+    int fd = create ? shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600) : shm_open(name.c_str(), O_RDONLY, 0); //create or open shared memory, only the owner may access round keys
+    if (fd == -1) //if shared memory can't be created or opened
+        throw runtime_error("Failed to " + string(create ? "create" : "open") + " key store " + name + "."); //throw runtime error
+    if (create) { //if we create the store
+        mappingSize = sizeof(Header) + capacity * sizeof(Entry); //header followed by entries
+        if (ftruncate(fd, (off_t)mappingSize) != 0) { //if shared memory can't be sized
+            close(fd); //close shared memory
+            shm_unlink(name.c_str()); //remove store we created
+            throw runtime_error("Failed to create key store " + name + "."); //throw runtime error
+        }
+    }
+    else { //else we open an existing store
+        struct stat info{}; //represents file information
+        mappingSize = fstat(fd, &info) == 0 ? (size_t)info.st_size : 0; //get size of store
+        if (mappingSize < sizeof(Header)) { //if store can't hold a header
+            close(fd); //close shared memory
+            throw runtime_error("Failed to open key store " + name + ", it isn't a valid key store."); //throw runtime error
+        }
+    }
+    void* mapping = mmap(NULL, mappingSize, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0); //map store, read-only unless we created it
+    close(fd); //mapping keeps shared memory alive
+    if (mapping == MAP_FAILED) { //if store can't be mapped
+        if (create) shm_unlink(name.c_str()); //remove store we created
+        throw runtime_error("Failed to map key store " + name + "."); //throw runtime error
+    }
+#if defined(MADV_DONTDUMP)
+    madvise(mapping, mappingSize, MADV_DONTDUMP); //keep round keys out of core dumps
+#endif
+    header = (Header*)mapping; //header is at the start of the store
+    entries = (Entry*)((unsigned char*)mapping + sizeof(Header)); //entries follow the header
+    if (create) { //if we create the store
+        header->entrySize = sizeof(Entry); //save layout of entries
+        header->capacity = capacity; //save number of entries
+        header->magic = Magic; //mark store as valid, new shared memory is zeroed so entries are empty
+    }
+    else if (header->magic != Magic || header->entrySize != sizeof(Entry) || header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 || header->capacity > (mappingSize - sizeof(Header)) / sizeof(Entry)) { //if store is invalid or has another layout
+        munmap(mapping, mappingSize); //unmap store
+        header = NULL; //store isn't mapped
+        throw runtime_error("Failed to open key store " + name + ", it isn't a valid key store."); //throw runtime error
+    }
+    this->capacity = (size_t)header->capacity; //save number of entries
+}
+#endif
@@ -0,0 +1,196 @@
+#ifndef _AESKEYSTORE_H
+#define _AESKEYSTORE_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+#if defined(__unix__) || defined(__APPLE__)
+#define AES_KEYSTORE
+
+/**
+ * @file AESKeyStore.h
+ * @brief  AESKeyStore class for a key schedule store in named shared memory, so processes of a prefork server share expanded round keys.
+ * @brief  One process creates the store and expands each key once, the other processes open it read-only and map the same pages.
+ * @brief  Entries are identified by key id and version, so the old and new version of a key can both be used while it's rotated.
+ * @brief  Lookups are lock-free, each entry is guarded by a sequence counter and readers retry while an entry is being written.
+ * @brief  Readers give up on an entry after ReadTimeout milliseconds and fail the lookup, so a writer that died while writing doesn't hang them.
+ * @brief  Removed entries are zeroized in place, readers copy round keys into their own KeyContext and should clear it after use.
+ */
+class AESKeyStore : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Constructor that creates a new store with given name that holds given number of entries and opens it for writing.
+	 * @brief  Only the creating process writes to the store, it may add and remove entries from several threads.
+	 * @param  string name
+	 * @param  size_t capacity
+	 * @throws  invalid_argument thrown if given name or capacity is invalid.
+	 * @throws  runtime_error thrown if the store already exists or can't be created.
+	 */
+	AESKeyStore(const string& name, const size_t capacity);
+
+	/**
+	 * @brief  Constructor that opens the existing store with given name read-only.
+	 * @param  string name
+	 * @throws  invalid_argument thrown if given name is invalid.
+	 * @throws  runtime_error thrown if the store doesn't exist or isn't a valid store.
+	 */
+	explicit AESKeyStore(const string& name);
+
+	/**
+	 * @brief  Destructor that unmaps the store, the store itself stays until Unlink is called.
+	 */
+	~AESKeyStore();
+
+	AESKeyStore(const AESKeyStore&) = delete;
+	AESKeyStore& operator=(const AESKeyStore&) = delete;
+
+	/**
+	 * @brief  Function that expands given key and stores it under given key id and version, an existing entry with the same id and version is replaced.
+	 * @param  uint64_t keyId
+	 * @param  uint64_t version
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  runtime_error thrown if the store is read-only or full.
+	 */
+	void Put(const uint64_t keyId, const uint64_t version, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that removes and zeroizes the entry with given key id and version, returns if it was found.
+	 * @param  uint64_t keyId
+	 * @param  uint64_t version
+	 * @return  bool isRemoved
+	 * @throws  runtime_error thrown if the store is read-only.
+	 */
+	bool Remove(const uint64_t keyId, const uint64_t version);
+
+	/**
+	 * @brief  Function that copies the round keys of given key id and version into given context, returns if the entry was found.
+	 * @brief  Returns false if an entry of the probe chain stays mid-write for longer than ReadTimeout.
+	 * @param  uint64_t keyId
+	 * @param  uint64_t version
+	 * @param  KeyContext context
+	 * @return  bool isFound
+	 */
+	bool Find(const uint64_t keyId, const uint64_t version, KeyContext& context) const;
+
+	/**
+	 * @brief  Function that copies the round keys of the highest version of given key id into given context and returns its version, returns if an entry was found.
+	 * @brief  Returns false if an entry of the probe chain stays mid-write for longer than ReadTimeout.
+	 * @param  uint64_t keyId
+	 * @param  KeyContext context
+	 * @param  uint64_t version
+	 * @return  bool isFound
+	 */
+	bool FindLatest(const uint64_t keyId, KeyContext& context, uint64_t& version) const;
+
+	/**
+	 * @brief  Function that returns the number of entries in the store.
+	 * @return  size_t count
+	 */
+	size_t GetCount() const;
+
+	/**
+	 * @brief  Function that returns the number of entries the store holds.
+	 * @return  size_t capacity
+	 */
+	size_t GetCapacity() const;
+
+	/**
+	 * @brief  Function that returns if the store is opened for writing.
+	 * @return  bool isWritable
+	 */
+	bool IsWritable() const;
+
+	/**
+	 * @brief  Function that removes the store with given name, processes that have it mapped keep using it until they unmap it.
+	 * @param  string name
+	 */
+	static void Unlink(const string& name);
+
+protected:
+	/**
+	 * @brief  Represents the state of an entry, BusyState is never stored, Read reports it for an entry that stays mid-write.
+	 */
+	enum State : uint64_t { EmptyState, UsedState, RemovedState, BusyState };
+
+	/**
+	 * @brief  Represents an entry of the store, all fields are written under the sequence counter.
+	 */
+	struct alignas(64) Entry {
+		atomic<uint64_t> sequence; //odd while entry is written
+		atomic<uint64_t> state; //state of entry, removed entries keep probe chains intact
+		atomic<uint64_t> keyId; //id of key
+		atomic<uint64_t> version; //version of key
+		atomic<uint64_t> rounds; //number of rounds (10, 12 or 14)
+		atomic<uint64_t> roundKeys[30]; //round keys as words, so readers never race with plain writes
+	};
+
+	/**
+	 * @brief  Represents the header at the start of the store.
+	 */
+	struct alignas(64) Header {
+		uint64_t magic; //identifies a store
+		uint64_t entrySize; //size of entry in bytes, guards against layout mismatches
+		uint64_t capacity; //number of entries, a power of two
+		atomic<uint64_t> count; //number of used entries
+	};
+
+	/**
+	 * @brief  Represents the magic number of a store, "AESKSTR1".
+	 */
+	static const uint64_t Magic = 0x315254534B534541ULL;
+
+	/**
+	 * @brief  Represents the number of milliseconds a reader waits for an entry that is being written before the lookup fails.
+	 */
+	static const size_t ReadTimeout = 100;
+
+	/**
+	 * @brief  Function that returns the first entry of the probe chain of given key id.
+	 * @param  uint64_t keyId
+	 * @return  size_t index
+	 */
+	size_t Home(const uint64_t keyId) const;
+
+	/**
+	 * @brief  Function that reads a consistent snapshot of given entry, round keys are only copied into given context if id and version match.
+	 * @brief  A version of UINT64_MAX matches any version.
+	 * @brief  If the entry stays mid-write for longer than ReadTimeout, state is set to BusyState, given context is cleared and false is returned.
+	 * @param  Entry entry
+	 * @param  uint64_t keyId
+	 * @param  uint64_t version
+	 * @param  uint64_t state
+	 * @param  uint64_t foundVersion
+	 * @param  KeyContext* context
+	 * @return  bool isMatch
+	 */
+	static bool Read(const Entry& entry, const uint64_t keyId, const uint64_t version, uint64_t& state, uint64_t& foundVersion, KeyContext* context);
+
+	/**
+	 * @brief  Function that writes given entry under its sequence counter, round keys are zeroized if context is NULL.
+	 * @param  Entry entry
+	 * @param  State state
+	 * @param  uint64_t keyId
+	 * @param  uint64_t version
+	 * @param  const KeyContext* context
+	 */
+	static void Write(Entry& entry, const State state, const uint64_t keyId, const uint64_t version, const KeyContext* context);
+
+	/**
+	 * @brief  Function that opens and maps the store with given name.
+	 * @param  string name
+	 * @param  size_t capacity
+	 * @param  bool create
+	 * @throws  invalid_argument thrown if given name is invalid.
+	 * @throws  runtime_error thrown if the store can't be created, opened or mapped.
+	 */
+	void Map(const string& name, const size_t capacity, const bool create);
+
+private:
+	Header* header; //header of mapped store
+	Entry* entries; //entries of mapped store
+	size_t capacity; //number of entries
+	size_t mappingSize; //size of mapping in bytes
+	bool isWritable; //true if store was created by this object
+	mutex writeMutex; //serializes writers of this process
+};
+#endif
+#endif
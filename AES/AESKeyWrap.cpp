@@ -0,0 +1,357 @@
+#include "AESKeyWrap.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <cstdint>
+#include <map>
+
+
+/**
+ * @brief  Represents the default integrity value of RFC 3394.
+ */
+static const unsigned char DefaultIV[8] = { 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6 };
+
+
+/**
+ * @brief  Represents the constant part of the alternative integrity value of RFC 5649.
+ */
+static const unsigned char AlternativeIV[4] = { 0xA6, 0x59, 0x59, 0xA6 };
+
+
+/**
+ * @brief  Function that XORs given step number in big-endian order into given integrity value.
+ * @param  unsigned char* value
+ * @param  uint64_t step
+ */
+static void XORStep(unsigned char* value, const uint64_t step) {
+    for (size_t i = 0; i < 8; i++) //iterate over bytes of integrity value
+        value[7 - i] ^= (unsigned char)(step >> (8 * i)); //XOR each byte of step, most significant byte first
+}
+
+
+/**
+ * @brief  Function that performs the wrapping rounds in place on given integrity value followed by given number of key data semiblocks.
+ * @brief  A single semiblock is encrypted as one AES block as specified in RFC 5649.
+ * @param  KeyContext kek
+ * @param  unsigned char* data
+ * @param  size_t semiblocks
+ */
+void AESKeyWrap::WrapBlocks(const KeyContext& kek, unsigned char* data, const size_t semiblocks) {
+    if (semiblocks == 1) { //if there's one semiblock the integrity value and key data form a single block
+        EncryptBlock(data, kek.roundKeys, kek.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+        return;
+    }
+    unsigned char block[BlockSize]; //represents integrity value and current semiblock
+    for (size_t j = 0; j < 6; j++) { //iterate over the six wrapping rounds
+        for (size_t i = 1; i <= semiblocks; i++) { //iterate over semiblocks
+            memcpy(block, data, SemiblockSize); //set first half to integrity value
+            memcpy(block + SemiblockSize, data + i * SemiblockSize, SemiblockSize); //set second half to current semiblock
+            EncryptBlock(block, kek.roundKeys, kek.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+            memcpy(data, block, SemiblockSize); //set integrity value to first half
+            XORStep(data, semiblocks * j + i); //XOR integrity value with step number
+            memcpy(data + i * SemiblockSize, block + SemiblockSize, SemiblockSize); //set semiblock to second half
+        }
+    }
+    fill(block, block + BlockSize, 0x00); //clear last block of wrapping, it holds key data
+}
+
+
+/**
+ * @brief  Function that performs the unwrapping rounds in place on given number of keys in lockstep.
+ * @brief  Each key is an integrity value followed by given number of key data semiblocks, all keys must have the same length.
+ * @param  KeyContext kek
+ * @param  unsigned char* const* data
+ * @param  size_t lanes
+ * @param  size_t semiblocks
+ */
+void AESKeyWrap::UnwrapBlocks(const KeyContext& kek, unsigned char* const* data, const size_t lanes, const size_t semiblocks) {
+    if (semiblocks == 1) { //if there's one semiblock the integrity value and key data form a single block
+        for (size_t lane = 0; lane < lanes; lane++) //iterate over keys
+            DecryptBlock(data[lane], kek.roundKeys, kek.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+        return;
+    }
+    unsigned char blocks[Lanes][BlockSize]; //represents integrity value and current semiblock of each key
+    for (size_t j = 6; j-- > 0;) { //iterate over the six unwrapping rounds in reverse order
+        for (size_t i = semiblocks; i >= 1; i--) { //iterate over semiblocks in reverse order
+            const uint64_t step = semiblocks * j + i; //represents step number, the same for all keys
+            for (size_t lane = 0; lane < lanes; lane++) { //build the independent blocks of all keys first
+                memcpy(blocks[lane], data[lane], SemiblockSize); //set first half to integrity value
+                XORStep(blocks[lane], step); //XOR integrity value with step number
+                memcpy(blocks[lane] + SemiblockSize, data[lane] + i * SemiblockSize, SemiblockSize); //set second half to current semiblock
+            }
+            for (size_t lane = 0; lane < lanes; lane++) //decrypt blocks back to back so their rounds overlap in the processor
+                DecryptBlock(blocks[lane], kek.roundKeys, kek.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+            for (size_t lane = 0; lane < lanes; lane++) { //store results of all keys
+                memcpy(data[lane], blocks[lane], SemiblockSize); //set integrity value to first half
+                memcpy(data[lane] + i * SemiblockSize, blocks[lane] + SemiblockSize, SemiblockSize); //set semiblock to second half
+            }
+        }
+    }
+    fill(&blocks[0][0], &blocks[0][0] + sizeof(blocks), 0x00); //clear blocks of all lanes, they hold unwrapped key data
+}
+
+
+/**
+ * @brief  Function that checks the integrity value of given unwrapped key and returns the length of its key data.
+ * @param  const unsigned char* data
+ * @param  size_t semiblocks
+ * @param  bool padded
+ * @param  size_t length
+ * @return  bool isValid
+ */
+bool AESKeyWrap::CheckIntegrity(const unsigned char* data, const size_t semiblocks, const bool padded, size_t& length) {
+    unsigned char difference = 0; //represents accumulated difference, checked at the end so timing doesn't depend on position of mismatch
+    if (!padded) { //RFC 3394 integrity value is the default IV
+        for (size_t i = 0; i < SemiblockSize; i++) //iterate over integrity value
+            difference |= data[i] ^ DefaultIV[i]; //accumulate difference
+        length = semiblocks * SemiblockSize; //key data is all semiblocks
+        return difference == 0; //return if integrity value matches
+    }
+    for (size_t i = 0; i < sizeof(AlternativeIV); i++) //RFC 5649 integrity value starts with constant part
+        difference |= data[i] ^ AlternativeIV[i]; //accumulate difference
+    length = ((size_t)data[4] << 24) | ((size_t)data[5] << 16) | ((size_t)data[6] << 8) | (size_t)data[7]; //message length indicator in big-endian order
+    if (length <= (semiblocks - 1) * SemiblockSize || length > semiblocks * SemiblockSize) //if length doesn't fit the number of semiblocks
+        return false; //integrity check failed
+    for (size_t i = SemiblockSize + length; i < SemiblockSize * (semiblocks + 1); i++) //iterate over padding
+        difference |= data[i]; //padding must be zero
+    return difference == 0; //return if integrity value and padding match
+}
+
+
+/**
+ * @brief  Function that wraps given key data with given key encryption key as specified in RFC 3394.
+ * @brief  Key data must be a multiple of 8 bytes and at least 16 bytes in length.
+ * @param  vector<unsigned char> keyData
+ * @param  vector<unsigned char> kek
+ * @return  vector<unsigned char> wrappedKey
+ * @throws  invalid_argument thrown if given key data is invalid.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::Wrap(const vector<unsigned char>& keyData, const vector<unsigned char>& kek) {
+    KeyContext context = Expand(kek); //expand key encryption key
+    vector<unsigned char> wrappedKey = Wrap(keyData, context); //wrap key data
+    Clear(context); //clear round keys of key encryption key
+    return wrappedKey; //return wrapped key
+}
+
+
+/**
+ * @brief  Function that wraps given key data with given expanded key encryption key as specified in RFC 3394.
+ * @brief  Key data must be a multiple of 8 bytes and at least 16 bytes in length.
+ * @param  vector<unsigned char> keyData
+ * @param  KeyContext kek
+ * @return  vector<unsigned char> wrappedKey
+ * @throws  invalid_argument thrown if given key data is invalid.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::Wrap(const vector<unsigned char>& keyData, const KeyContext& kek) {
+    AES_PROFILE_SCOPE("KeyWrap-Wrap", keyData.size()); //profile RFC 3394 wrapping
+    if (keyData.size() % SemiblockSize != 0 || keyData.size() < 2 * SemiblockSize) //if key data isn't a multiple of 8 bytes or shorter than 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid key data that matches AES Key Wrap requirements."); //throw invalid argument
+    if (kek.rounds == 0) //if key encryption key wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    vector<unsigned char> wrappedKey(SemiblockSize + keyData.size()); //represents integrity value followed by key data
+    memcpy(wrappedKey.data(), DefaultIV, SemiblockSize); //set integrity value to default IV
+    memcpy(wrappedKey.data() + SemiblockSize, keyData.data(), keyData.size()); //copy key data
+    WrapBlocks(kek, wrappedKey.data(), keyData.size() / SemiblockSize); //wrap in place
+    return wrappedKey; //return wrapped key
+}
+
+
+/**
+ * @brief  Function that unwraps given wrapped key with given key encryption key as specified in RFC 3394.
+ * @param  vector<unsigned char> wrappedKey
+ * @param  vector<unsigned char> kek
+ * @return  vector<unsigned char> keyData
+ * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::Unwrap(const vector<unsigned char>& wrappedKey, const vector<unsigned char>& kek) {
+    KeyContext context = Expand(kek); //expand key encryption key
+    try {
+        vector<unsigned char> keyData = Unwrap(wrappedKey, context); //unwrap key
+        Clear(context); //clear round keys of key encryption key
+        return keyData; //return key data
+    }
+    catch (...) { //if unwrapping failed we clear round keys before rethrowing
+        Clear(context); //clear round keys of key encryption key
+        throw; //rethrow exception
+    }
+}
+
+
+/**
+ * @brief  Function that unwraps given wrapped key with given expanded key encryption key as specified in RFC 3394.
+ * @param  vector<unsigned char> wrappedKey
+ * @param  KeyContext kek
+ * @return  vector<unsigned char> keyData
+ * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::Unwrap(const vector<unsigned char>& wrappedKey, const KeyContext& kek) {
+    AES_PROFILE_SCOPE("KeyWrap-Unwrap", wrappedKey.size()); //profile RFC 3394 unwrapping
+    if (wrappedKey.size() % SemiblockSize != 0 || wrappedKey.size() < 3 * SemiblockSize) //if wrapped key isn't a multiple of 8 bytes or shorter than 24 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid wrapped key that matches AES Key Wrap requirements."); //throw invalid argument
+    if (kek.rounds == 0) //if key encryption key wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    const size_t semiblocks = wrappedKey.size() / SemiblockSize - 1; //number of key data semiblocks
+    vector<unsigned char> data(wrappedKey); //represents wrapped key that is unwrapped in place
+    unsigned char* lane = data.data(); //represents the single lane of unwrapping
+    UnwrapBlocks(kek, &lane, 1, semiblocks); //unwrap in place
+    size_t length = 0; //represents length of key data
+    if (!CheckIntegrity(data.data(), semiblocks, false, length)) { //if integrity value doesn't match the key encryption key is wrong or wrapped key was modified
+        ClearVector(data); //clear unwrapped data, it didn't pass the integrity check
+        throw invalid_argument("Invalid wrapped key, integrity check failed."); //throw invalid argument
+    }
+    data.erase(data.begin(), data.begin() + SemiblockSize); //remove integrity value
+    return data; //return key data
+}
+
+
+/**
+ * @brief  Function that wraps given key data of any length with given key encryption key as specified in RFC 5649.
+ * @param  vector<unsigned char> keyData
+ * @param  vector<unsigned char> kek
+ * @return  vector<unsigned char> wrappedKey
+ * @throws  invalid_argument thrown if given key data is invalid.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::WrapPad(const vector<unsigned char>& keyData, const vector<unsigned char>& kek) {
+    KeyContext context = Expand(kek); //expand key encryption key
+    vector<unsigned char> wrappedKey = WrapPad(keyData, context); //wrap key data
+    Clear(context); //clear round keys of key encryption key
+    return wrappedKey; //return wrapped key
+}
+
+
+/**
+ * @brief  Function that wraps given key data of any length with given expanded key encryption key as specified in RFC 5649.
+ * @param  vector<unsigned char> keyData
+ * @param  KeyContext kek
+ * @return  vector<unsigned char> wrappedKey
+ * @throws  invalid_argument thrown if given key data is invalid.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::WrapPad(const vector<unsigned char>& keyData, const KeyContext& kek) {
+    AES_PROFILE_SCOPE("KeyWrap-WrapPad", keyData.size()); //profile RFC 5649 wrapping
+    if (keyData.empty() || keyData.size() > 0xFFFFFFFFULL) //if key data is empty or its length doesn't fit the message length indicator
+        throw invalid_argument("Invalid mode of operation, please provide valid key data that matches AES Key Wrap with Padding requirements."); //throw invalid argument
+    if (kek.rounds == 0) //if key encryption key wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    const size_t semiblocks = (keyData.size() + SemiblockSize - 1) / SemiblockSize; //number of key data semiblocks after zero padding
+    vector<unsigned char> wrappedKey(SemiblockSize * (semiblocks + 1), 0x00); //represents integrity value followed by zero padded key data
+    memcpy(wrappedKey.data(), AlternativeIV, sizeof(AlternativeIV)); //set constant part of integrity value
+    for (size_t i = 0; i < 4; i++) //iterate over message length indicator
+        wrappedKey[4 + i] = (unsigned char)(keyData.size() >> (8 * (3 - i))); //set length of key data in big-endian order
+    memcpy(wrappedKey.data() + SemiblockSize, keyData.data(), keyData.size()); //copy key data
+    WrapBlocks(kek, wrappedKey.data(), semiblocks); //wrap in place
+    return wrappedKey; //return wrapped key
+}
+
+
+/**
+ * @brief  Function that unwraps given wrapped key with given key encryption key as specified in RFC 5649.
+ * @param  vector<unsigned char> wrappedKey
+ * @param  vector<unsigned char> kek
+ * @return  vector<unsigned char> keyData
+ * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::UnwrapPad(const vector<unsigned char>& wrappedKey, const vector<unsigned char>& kek) {
+    KeyContext context = Expand(kek); //expand key encryption key
+    try {
+        vector<unsigned char> keyData = UnwrapPad(wrappedKey, context); //unwrap key
+        Clear(context); //clear round keys of key encryption key
+        return keyData; //return key data
+    }
+    catch (...) { //if unwrapping failed we clear round keys before rethrowing
+        Clear(context); //clear round keys of key encryption key
+        throw; //rethrow exception
+    }
+}
+
+
+/**
+ * @brief  Function that unwraps given wrapped key with given expanded key encryption key as specified in RFC 5649.
+ * @param  vector<unsigned char> wrappedKey
+ * @param  KeyContext kek
+ * @return  vector<unsigned char> keyData
+ * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<unsigned char> AESKeyWrap::UnwrapPad(const vector<unsigned char>& wrappedKey, const KeyContext& kek) {
+    AES_PROFILE_SCOPE("KeyWrap-UnwrapPad", wrappedKey.size()); //profile RFC 5649 unwrapping
+    if (wrappedKey.size() % SemiblockSize != 0 || wrappedKey.size() < 2 * SemiblockSize) //if wrapped key isn't a multiple of 8 bytes or shorter than 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid wrapped key that matches AES Key Wrap with Padding requirements."); //throw invalid argument
+    if (kek.rounds == 0) //if key encryption key wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    const size_t semiblocks = wrappedKey.size() / SemiblockSize - 1; //number of key data semiblocks
+    vector<unsigned char> data(wrappedKey); //represents wrapped key that is unwrapped in place
+    unsigned char* lane = data.data(); //represents the single lane of unwrapping
+    UnwrapBlocks(kek, &lane, 1, semiblocks); //unwrap in place
+    size_t length = 0; //represents length of key data
+    if (!CheckIntegrity(data.data(), semiblocks, true, length)) { //if integrity value or padding doesn't match the key encryption key is wrong or wrapped key was modified
+        ClearVector(data); //clear unwrapped data, it didn't pass the integrity check
+        throw invalid_argument("Invalid wrapped key, integrity check failed."); //throw invalid argument
+    }
+    vector<unsigned char> keyData(data.begin() + SemiblockSize, data.begin() + SemiblockSize + length); //represents key data without padding
+    ClearVector(data); //clear unwrapped data, key data was copied without padding
+    return keyData; //return key data
+}
+
+
+/**
+ * @brief  Function that unwraps many wrapped keys with the same key encryption key, RFC 5649 is used if padded is true and RFC 3394 otherwise.
+ * @brief  Keys of the same length are unwrapped in lockstep groups, and groups are unwrapped in parallel.
+ * @brief  Keys that are invalid or fail the integrity check are returned empty, the other keys are still unwrapped.
+ * @param  vector<vector<unsigned char>> wrappedKeys
+ * @param  KeyContext kek
+ * @param  bool padded
+ * @return  vector<vector<unsigned char>> keys
+ * @throws  invalid_argument thrown if given key encryption key is invalid.
+ */
+vector<vector<unsigned char>> AESKeyWrap::UnwrapBatch(const vector<vector<unsigned char>>& wrappedKeys, const KeyContext& kek, const bool padded) {
+    AES_PROFILE_SCOPE("KeyWrap-UnwrapBatch", wrappedKeys.size() * 40); //profile batched unwrapping
+    if (kek.rounds == 0) //if key encryption key wasn't expanded
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    vector<vector<unsigned char>> keys(wrappedKeys.size()); //represents unwrapped keys, invalid keys stay empty
+    map<size_t, vector<size_t>> groups; //represents indexes of wrapped keys grouped by length so each group can run in lockstep
+    const size_t minimum = (padded ? 2 : 3) * SemiblockSize; //represents minimal length of a wrapped key
+    for (size_t i = 0; i < wrappedKeys.size(); i++) //iterate over wrapped keys
+        if (wrappedKeys[i].size() % SemiblockSize == 0 && wrappedKeys[i].size() >= minimum) //if wrapped key length is valid
+            groups[wrappedKeys[i].size()].push_back(i); //add it to the group of its length
+
+    vector<pair<const vector<size_t>*, size_t>> tasks; //represents group and first position of each lockstep task
+    for (const auto& group : groups) //iterate over groups
+        for (size_t first = 0; first < group.second.size(); first += Lanes) //split group into lockstep tasks
+            tasks.emplace_back(&group.second, first); //add task
+
+    auto unwrap = [&](size_t task) { //unwraps the keys of a single lockstep task
+        const vector<size_t>& indexes = *tasks[task].first; //represents indexes of the group
+        const size_t first = tasks[task].second; //represents first position of the task in the group
+        const size_t lanes = min(Lanes, indexes.size() - first); //represents number of keys in the task
+        const size_t semiblocks = wrappedKeys[indexes[first]].size() / SemiblockSize - 1; //number of key data semiblocks, the same for the whole group
+        unsigned char* data[Lanes]{}; //represents the keys that are unwrapped in place
+        for (size_t lane = 0; lane < lanes; lane++) { //iterate over keys of the task
+            keys[indexes[first + lane]] = wrappedKeys[indexes[first + lane]]; //copy wrapped key, it's unwrapped in its result buffer
+            data[lane] = keys[indexes[first + lane]].data(); //set lane to result buffer
+        }
+        UnwrapBlocks(kek, data, lanes, semiblocks); //unwrap all keys of the task in lockstep
+        for (size_t lane = 0; lane < lanes; lane++) { //iterate over keys of the task
+            vector<unsigned char>& key = keys[indexes[first + lane]]; //represents unwrapped key
+            size_t length = 0; //represents length of key data
+            if (!CheckIntegrity(key.data(), semiblocks, padded, length)) //if integrity check failed
+                ClearVector(key); //return empty key
+            else { //else we remove integrity value and padding
+                fill(key.begin() + SemiblockSize + length, key.end(), 0x00); //clear padding
+                key.erase(key.begin(), key.begin() + SemiblockSize); //remove integrity value
+                key.resize(length); //remove padding
+            }
+        }
+    };
+    if (tasks.size() < 2 || GetThreadCount() <= 1) //if there's a single task or no workers we unwrap on calling thread
+        for (size_t task = 0; task < tasks.size(); task++) //iterate over tasks
+            unwrap(task); //unwrap task
+    else //else we unwrap tasks in parallel
+        ParallelFor(tasks.size(), unwrap); //unwrap each task in parallel
+    return keys; //return unwrapped keys
+}
@@ -0,0 +1,148 @@
+#ifndef _AESKEYWRAP_H
+#define _AESKEYWRAP_H
+#include "AESKeyBatch.h"
+
+/**
+ * @file AESKeyWrap.h
+ * @brief  AESKeyWrap class for AES Key Wrap (RFC 3394) and AES Key Wrap with Padding (RFC 5649).
+ * @brief  Wrapping and unwrapping use the flat round keys of an AESKeyBatch context, so a key encryption key is expanded once and reused.
+ * @brief  UnwrapBatch interleaves the six unwrapping rounds of several keys of the same length, so their independent block decryptions overlap.
+ * @brief  Groups of keys in a batch are unwrapped in parallel with the AESParallel worker pool.
+ */
+class AESKeyWrap : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Function that wraps given key data with given key encryption key as specified in RFC 3394.
+	 * @brief  Key data must be a multiple of 8 bytes and at least 16 bytes in length.
+	 * @param  vector<unsigned char> keyData
+	 * @param  vector<unsigned char> kek
+	 * @return  vector<unsigned char> wrappedKey
+	 * @throws  invalid_argument thrown if given key data is invalid.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> Wrap(const vector<unsigned char>& keyData, const vector<unsigned char>& kek);
+
+	/**
+	 * @brief  Function that wraps given key data with given expanded key encryption key as specified in RFC 3394.
+	 * @brief  Key data must be a multiple of 8 bytes and at least 16 bytes in length.
+	 * @param  vector<unsigned char> keyData
+	 * @param  KeyContext kek
+	 * @return  vector<unsigned char> wrappedKey
+	 * @throws  invalid_argument thrown if given key data is invalid.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> Wrap(const vector<unsigned char>& keyData, const KeyContext& kek);
+
+	/**
+	 * @brief  Function that unwraps given wrapped key with given key encryption key as specified in RFC 3394.
+	 * @param  vector<unsigned char> wrappedKey
+	 * @param  vector<unsigned char> kek
+	 * @return  vector<unsigned char> keyData
+	 * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> Unwrap(const vector<unsigned char>& wrappedKey, const vector<unsigned char>& kek);
+
+	/**
+	 * @brief  Function that unwraps given wrapped key with given expanded key encryption key as specified in RFC 3394.
+	 * @param  vector<unsigned char> wrappedKey
+	 * @param  KeyContext kek
+	 * @return  vector<unsigned char> keyData
+	 * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> Unwrap(const vector<unsigned char>& wrappedKey, const KeyContext& kek);
+
+	/**
+	 * @brief  Function that wraps given key data of any length with given key encryption key as specified in RFC 5649.
+	 * @param  vector<unsigned char> keyData
+	 * @param  vector<unsigned char> kek
+	 * @return  vector<unsigned char> wrappedKey
+	 * @throws  invalid_argument thrown if given key data is invalid.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> WrapPad(const vector<unsigned char>& keyData, const vector<unsigned char>& kek);
+
+	/**
+	 * @brief  Function that wraps given key data of any length with given expanded key encryption key as specified in RFC 5649.
+	 * @param  vector<unsigned char> keyData
+	 * @param  KeyContext kek
+	 * @return  vector<unsigned char> wrappedKey
+	 * @throws  invalid_argument thrown if given key data is invalid.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> WrapPad(const vector<unsigned char>& keyData, const KeyContext& kek);
+
+	/**
+	 * @brief  Function that unwraps given wrapped key with given key encryption key as specified in RFC 5649.
+	 * @param  vector<unsigned char> wrappedKey
+	 * @param  vector<unsigned char> kek
+	 * @return  vector<unsigned char> keyData
+	 * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> UnwrapPad(const vector<unsigned char>& wrappedKey, const vector<unsigned char>& kek);
+
+	/**
+	 * @brief  Function that unwraps given wrapped key with given expanded key encryption key as specified in RFC 5649.
+	 * @param  vector<unsigned char> wrappedKey
+	 * @param  KeyContext kek
+	 * @return  vector<unsigned char> keyData
+	 * @throws  invalid_argument thrown if given wrapped key is invalid or fails the integrity check.
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<unsigned char> UnwrapPad(const vector<unsigned char>& wrappedKey, const KeyContext& kek);
+
+	/**
+	 * @brief  Function that unwraps many wrapped keys with the same key encryption key, RFC 5649 is used if padded is true and RFC 3394 otherwise.
+	 * @brief  Keys of the same length are unwrapped in lockstep groups, and groups are unwrapped in parallel.
+	 * @brief  Keys that are invalid or fail the integrity check are returned empty, the other keys are still unwrapped.
+	 * @param  vector<vector<unsigned char>> wrappedKeys
+	 * @param  KeyContext kek
+	 * @param  bool padded
+	 * @return  vector<vector<unsigned char>> keys
+	 * @throws  invalid_argument thrown if given key encryption key is invalid.
+	 */
+	static vector<vector<unsigned char>> UnwrapBatch(const vector<vector<unsigned char>>& wrappedKeys, const KeyContext& kek, const bool padded = false);
+
+protected:
+	/**
+	 * @brief  Represents the number of keys that are unwrapped in lockstep.
+	 */
+	static const size_t Lanes = 8;
+
+	/**
+	 * @brief  Represents the size of a semiblock in bytes, key wrap works on 64-bit halves of AES blocks.
+	 */
+	static const size_t SemiblockSize = 8;
+
+	/**
+	 * @brief  Function that performs the wrapping rounds in place on given integrity value followed by given number of key data semiblocks.
+	 * @brief  A single semiblock is encrypted as one AES block as specified in RFC 5649.
+	 * @param  KeyContext kek
+	 * @param  unsigned char* data
+	 * @param  size_t semiblocks
+	 */
+	static void WrapBlocks(const KeyContext& kek, unsigned char* data, const size_t semiblocks);
+
+	/**
+	 * @brief  Function that performs the unwrapping rounds in place on given number of keys in lockstep.
+	 * @brief  Each key is an integrity value followed by given number of key data semiblocks, all keys must have the same length.
+	 * @param  KeyContext kek
+	 * @param  unsigned char* const* data
+	 * @param  size_t lanes
+	 * @param  size_t semiblocks
+	 */
+	static void UnwrapBlocks(const KeyContext& kek, unsigned char* const* data, const size_t lanes, const size_t semiblocks);
+
+	/**
+	 * @brief  Function that checks the integrity value of given unwrapped key and returns the length of its key data.
+	 * @param  const unsigned char* data
+	 * @param  size_t semiblocks
+	 * @param  bool padded
+	 * @param  size_t length
+	 * @return  bool isValid
+	 */
+	static bool CheckIntegrity(const unsigned char* data, const size_t semiblocks, const bool padded, size_t& length);
+};
+#endif
@@ -0,0 +1,260 @@
+#include "AESKeystream.h"
+#include "AESProfiler.h"
+#include <cstring>
+
+
+/**
+ * @brief  Function that XORs given input with given keystream a word at a time, the loop is simple enough for compilers to vectorize.
+ * @param  unsigned char* output
+ * @param  const unsigned char* input
+ * @param  const unsigned char* keystream
+ * @param  size_t length
+ */
+static void XORBytes(unsigned char* output, const unsigned char* input, const unsigned char* keystream, const size_t length) {
+    size_t i = 0; //represents position in buffer
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) { //iterate over whole words
+        uint64_t data, key; //represents input word and keystream word
+        memcpy(&data, input + i, sizeof(data)); //load input word, memcpy handles unaligned buffers
+        memcpy(&key, keystream + i, sizeof(key)); //load keystream word
+        data ^= key; //perform XOR between input and keystream word
+        memcpy(output + i, &data, sizeof(data)); //store output word
+    }
+    for (; i < length; i++) //iterate over remaining bytes
+        output[i] = input[i] ^ keystream[i]; //perform byte XOR between input and keystream
+}
+
+
+/**
+ * @brief  Constructor that validates given key and iv, fills the reservoir and starts the background refill thread if requested.
+ * @param  string mode
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @param  size_t capacity
+ * @param  bool background
+ * @throws  invalid_argument thrown if given mode, key, iv or capacity is invalid.
+ */
+AESKeystream::AESKeystream(const string& mode, const vector<unsigned char>& key, const unsigned char* iv, const size_t capacity, const bool background)
+    : isOFB(mode == "OFB"), state{}, head(0), available(0), watermark(0), stopRefill(false) {
+    if (mode != "OFB" && mode != "CTR") //if mode is invalid
+        throw invalid_argument("Invalid mode of operation, please provide OFB or CTR mode for keystream."); //throw invalid argument
+    if (capacity < BlockSize) //if capacity is smaller than a single block
+        throw invalid_argument("Invalid capacity, please provide capacity of at least 16 bytes."); //throw invalid argument
+    roundKeys = Prepare(key, iv, mode); //validate key and IV and generate round keys
+    memcpy(state, iv, BlockSize); //initialize state with IV
+    reservoir.resize(capacity - (capacity % BlockSize)); //allocate reservoir rounded down to a multiple of block size
+    watermark = reservoir.size() / 2; //refill when half of reservoir is used by default
+    Fill(); //fill reservoir ahead of first message
+    if (background) //if background refill is requested
+        refillThread = thread(&AESKeystream::RefillLoop, this); //start refill thread
+}
+
+
+/**
+ * @brief  Destructor that stops the background thread and clears the keys and reservoir.
+ */
+AESKeystream::~AESKeystream() {
+    {
+        lock_guard<mutex> lock(reservoirMutex); //lock reservoir so background thread can't miss the notification
+        stopRefill = true; //tell background thread to exit
+    }
+    refillCondition.notify_all(); //wake up background thread
+    if (refillThread.joinable()) //if background thread is running
+        refillThread.join(); //wait for background thread to exit
+    ClearVector(roundKeys); //clear round keys, the background thread has exited
+    ClearVector(reservoir); //clear keystream
+    fill(state, state + BlockSize, 0x00); //clear state
+}
+
+
+/**
+ * @brief  Function that generates given number of keystream bytes from the state, must be called with generateMutex locked.
+ * @brief  Length must be a multiple of 16 bytes.
+ * @param  unsigned char* output
+ * @param  size_t length
+ */
+void AESKeystream::Generate(unsigned char* output, const size_t length) {
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over keystream blocks
+        if (isOFB) { //if mode is OFB the keystream block is the encrypted previous keystream block
+            EncryptBlock(state, roundKeys); //encrypt the previous keystream block using our AES EncryptBlock function using round keys
+            memcpy(output + i, state, BlockSize); //copy keystream block
+        }
+        else { //else mode is CTR the keystream block is the encrypted counter
+            memcpy(output + i, state, BlockSize); //copy counter block
+            EncryptBlock(output + i, roundKeys); //encrypt the counter block using our AES EncryptBlock function using round keys
+            AddCounter(state, 1); //move to next counter
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that generates keystream until the reservoir is full, in batches so consumers aren't blocked for long.
+ */
+void AESKeystream::Fill() {
+    unsigned char batch[4096]; //represents batch of keystream generated without holding reservoirMutex
+    while (true) { //generate until reservoir is full
+        lock_guard<mutex> generateLock(generateMutex); //lock state for this batch only, consumers may take over between batches
+        size_t space = 0; //represents free space in reservoir
+        {
+            lock_guard<mutex> lock(reservoirMutex); //lock reservoir
+            space = reservoir.size() - available; //calculate free space
+        }
+        size_t size = min(sizeof(batch), space - (space % BlockSize)); //calculate batch size in whole blocks
+        if (size == 0) break; //stop when reservoir is full
+        Generate(batch, size); //generate batch, only a holder of generateMutex adds keystream so free space can only grow meanwhile
+        lock_guard<mutex> lock(reservoirMutex); //lock reservoir
+        size_t tail = (head + available) % reservoir.size(); //calculate position after last keystream byte
+        size_t first = min(size, reservoir.size() - tail); //calculate part that fits before end of ring
+        memcpy(reservoir.data() + tail, batch, first); //copy first part
+        memcpy(reservoir.data(), batch + first, size - first); //copy wrapped part
+        available += size; //add batch to reservoir
+    }
+    fill(batch, batch + sizeof(batch), 0x00); //clear local batch, its keystream was copied into the reservoir
+}
+
+
+/**
+ * @brief  Function that XORs up to given number of bytes with keystream from the reservoir, must be called with reservoirMutex locked.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  size_t processedLength
+ */
+size_t AESKeystream::Consume(const unsigned char* input, unsigned char* output, const size_t length) {
+    size_t size = min(length, available); //calculate number of bytes we can process from reservoir
+    size_t first = min(size, reservoir.size() - head); //calculate part before end of ring
+    XORBytes(output, input, reservoir.data() + head, first); //XOR first part
+    XORBytes(output + first, input + first, reservoir.data(), size - first); //XOR wrapped part
+    memset(reservoir.data() + head, 0x00, first); //clear used keystream so the reservoir only holds unused keystream
+    memset(reservoir.data(), 0x00, size - first);
+    head = (head + size) % reservoir.size(); //move head past used keystream
+    available -= size; //remove used keystream from reservoir
+    return size; //return number of processed bytes
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given buffer with the next bytes of keystream, input and output may be the same buffer.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @throws  invalid_argument thrown if given buffer is invalid.
+ */
+void AESKeystream::Process(const unsigned char* input, unsigned char* output, const size_t length) {
+    AES_PROFILE_SCOPE("Keystream-Process", length); //profile XOR with reservoir keystream
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES " + string(isOFB ? "OFB" : "CTR") + " requirements."); //throw invalid argument
+    size_t done = 0; //represents number of processed bytes
+    bool refill = false; //represents if background thread should refill
+    {
+        lock_guard<mutex> lock(reservoirMutex); //lock reservoir
+        done = Consume(input, output, length); //process message from precomputed keystream
+        refill = available < watermark; //check if reservoir dropped below watermark
+    }
+    if (done < length) { //if reservoir ran dry we generate the rest inline
+        lock_guard<mutex> generateLock(generateMutex); //lock state so nobody adds keystream while we generate
+        {
+            lock_guard<mutex> lock(reservoirMutex); //lock reservoir
+            done += Consume(input + done, output + done, length - done); //use keystream that was added meanwhile, reservoir is empty afterwards if still short
+        }
+        unsigned char keystream[1024]; //represents inline keystream batch
+        while (length - done >= BlockSize) { //iterate over whole blocks
+            size_t size = min(sizeof(keystream), (length - done) - ((length - done) % BlockSize)); //calculate batch size
+            Generate(keystream, size); //generate keystream
+            XORBytes(output + done, input + done, keystream, size); //XOR batch
+            done += size; //add batch to processed bytes
+        }
+        if (done < length) { //if a partial block is left we keep the rest of its keystream for the next message
+            Generate(keystream, BlockSize); //generate one keystream block
+            size_t size = length - done; //calculate partial size
+            XORBytes(output + done, input + done, keystream, size); //XOR partial block
+            lock_guard<mutex> lock(reservoirMutex); //lock reservoir, it is empty here
+            head = 0; //restart ring
+            memcpy(reservoir.data(), keystream + size, BlockSize - size); //keep unused keystream
+            available = BlockSize - size; //set available keystream
+        }
+        fill(keystream, keystream + sizeof(keystream), 0x00); //clear local keystream block, its unused part was kept in the reservoir
+        refill = true; //reservoir is empty
+    }
+    if (refill && refillThread.joinable()) //if reservoir dropped below watermark we wake up background thread
+        refillCondition.notify_one();
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given text in place with the next bytes of keystream.
+ * @param  vector<unsigned char> text
+ * @return  vector<unsigned char> text
+ */
+vector<unsigned char>& AESKeystream::Process(vector<unsigned char>& text) {
+    Process(text.data(), text.data(), text.size()); //process text in place
+    return text; //return processed text
+}
+
+
+/**
+ * @brief  Function that fills the reservoir to its capacity on the calling thread, for sessions without background thread.
+ */
+void AESKeystream::Refill() {
+    Fill(); //fill reservoir
+}
+
+
+/**
+ * @brief  Function that runs on the background thread and refills the reservoir when it drops below the watermark.
+ */
+void AESKeystream::RefillLoop() {
+    unique_lock<mutex> lock(reservoirMutex); //lock reservoir for background thread
+    while (true) { //refill until told to exit
+        refillCondition.wait(lock, [this]() { return stopRefill || available < watermark; }); //wait until reservoir drops below watermark
+        if (stopRefill) //if told to exit
+            return; //exit background thread
+        lock.unlock(); //unlock reservoir while we generate
+        Fill(); //fill reservoir to capacity
+        lock.lock(); //lock reservoir again
+    }
+}
+
+
+/**
+ * @brief  Function that sets the number of bytes below which the background thread refills the reservoir.
+ * @param  size_t watermark
+ * @throws  invalid_argument thrown if given watermark is larger than capacity.
+ */
+void AESKeystream::SetWatermark(const size_t watermark) {
+    if (watermark > reservoir.size()) //if watermark is larger than reservoir
+        throw invalid_argument("Invalid watermark, please provide watermark that isn't larger than capacity."); //throw invalid argument
+    {
+        lock_guard<mutex> lock(reservoirMutex); //lock reservoir so background thread sees new watermark
+        AESKeystream::watermark = watermark; //set watermark
+    }
+    refillCondition.notify_one(); //wake up background thread in case reservoir is below new watermark
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes below which the background thread refills the reservoir.
+ * @return  size_t watermark
+ */
+size_t AESKeystream::GetWatermark() const {
+    return watermark; //return watermark
+}
+
+
+/**
+ * @brief  Function that returns the number of precomputed keystream bytes.
+ * @return  size_t available
+ */
+size_t AESKeystream::GetAvailable() {
+    lock_guard<mutex> lock(reservoirMutex); //lock reservoir
+    return available; //return available keystream
+}
+
+
+/**
+ * @brief  Function that returns the reservoir capacity in bytes.
+ * @return  size_t capacity
+ */
+size_t AESKeystream::GetCapacity() const {
+    return reservoir.size(); //return capacity
+}
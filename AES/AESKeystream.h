@@ -0,0 +1,122 @@
+#ifndef _AESKEYSTREAM_H
+#define _AESKEYSTREAM_H
+#include "AESParallel.h"
+
+/**
+ * @file AESKeystream.h
+ * @brief  AESKeystream class for OFB and CTR sessions with a precomputed keystream reservoir.
+ * @brief  OFB and CTR keystreams don't depend on the data, so they are generated ahead of time into a ring buffer.
+ * @brief  A background thread refills the reservoir when it drops below the watermark, or Refill can be called during idle periods.
+ * @brief  Processing a message is then a word-wise XOR with precomputed keystream, the keystream is generated inline only if the reservoir runs dry.
+ * @brief  The session is a stream, processing consecutive messages gives the same output as Encrypt_OFB or Encrypt_CTR on their concatenation.
+ * @brief  Encryption and decryption are the same operation.
+ */
+class AESKeystream : public AESParallel {
+public:
+	/**
+	 * @brief  Constructor that validates given key and iv, fills the reservoir and starts the background refill thread if requested.
+	 * @param  string mode
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  size_t capacity
+	 * @param  bool background
+	 * @throws  invalid_argument thrown if given mode, key, iv or capacity is invalid.
+	 */
+	AESKeystream(const string& mode, const vector<unsigned char>& key, const unsigned char* iv, const size_t capacity = 64 * 1024, const bool background = true);
+
+	/**
+	 * @brief  Destructor that stops the background thread and clears the keys and reservoir.
+	 */
+	~AESKeystream();
+
+	AESKeystream(const AESKeystream&) = delete;
+	AESKeystream& operator=(const AESKeystream&) = delete;
+
+	/**
+	 * @brief  Function that encrypts or decrypts given buffer with the next bytes of keystream, input and output may be the same buffer.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @throws  invalid_argument thrown if given buffer is invalid.
+	 */
+	void Process(const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that encrypts or decrypts given text in place with the next bytes of keystream.
+	 * @param  vector<unsigned char> text
+	 * @return  vector<unsigned char> text
+	 */
+	vector<unsigned char>& Process(vector<unsigned char>& text);
+
+	/**
+	 * @brief  Function that fills the reservoir to its capacity on the calling thread, for sessions without background thread.
+	 */
+	void Refill();
+
+	/**
+	 * @brief  Function that sets the number of bytes below which the background thread refills the reservoir.
+	 * @param  size_t watermark
+	 * @throws  invalid_argument thrown if given watermark is larger than capacity.
+	 */
+	void SetWatermark(const size_t watermark);
+
+	/**
+	 * @brief  Function that returns the number of bytes below which the background thread refills the reservoir.
+	 * @return  size_t watermark
+	 */
+	size_t GetWatermark() const;
+
+	/**
+	 * @brief  Function that returns the number of precomputed keystream bytes.
+	 * @return  size_t available
+	 */
+	size_t GetAvailable();
+
+	/**
+	 * @brief  Function that returns the reservoir capacity in bytes.
+	 * @return  size_t capacity
+	 */
+	size_t GetCapacity() const;
+
+private:
+	bool isOFB; //true for OFB, false for CTR
+	vector<vector<unsigned char>> roundKeys; //round keys of the key
+	unsigned char state[BlockSize]; //next counter in CTR, previous keystream block in OFB
+	vector<unsigned char> reservoir; //ring buffer of precomputed keystream
+	size_t head; //position of next keystream byte in reservoir
+	size_t available; //number of keystream bytes in reservoir
+	atomic<size_t> watermark; //refill threshold of background thread
+	mutex reservoirMutex; //guards reservoir, head and available
+	mutex generateMutex; //guards state, held while keystream is generated so keystream order is kept, locked before reservoirMutex
+	condition_variable refillCondition; //wakes background thread
+	bool stopRefill; //tells background thread to exit
+	thread refillThread; //background refill thread
+
+	/**
+	 * @brief  Function that generates given number of keystream bytes from the state, must be called with generateMutex locked.
+	 * @brief  Length must be a multiple of 16 bytes.
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 */
+	void Generate(unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that generates keystream until the reservoir is full, in batches so consumers aren't blocked for long.
+	 */
+	void Fill();
+
+	/**
+	 * @brief  Function that XORs up to given number of bytes with keystream from the reservoir, must be called with reservoirMutex locked.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  size_t processedLength
+	 */
+	size_t Consume(const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that runs on the background thread and refills the reservoir when it drops below the watermark.
+	 */
+	void RefillLoop();
+};
+#endif
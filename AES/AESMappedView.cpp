@@ -0,0 +1,462 @@
+#include "AESMappedView.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <stdexcept>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief  Constructor that creates an empty handle that holds no page.
+ */
+AESMappedView::Page::Page() : view(NULL), slot(0), data(NULL), size(0), offset(0) {}
+
+
+/**
+ * @brief  Constructor that wraps given cache slot of given view.
+ * @param  AESMappedView* view
+ * @param  size_t slot
+ * @param  const unsigned char* data
+ * @param  size_t size
+ * @param  uint64_t offset
+ */
+AESMappedView::Page::Page(AESMappedView* view, const size_t slot, const unsigned char* data, const size_t size, const uint64_t offset) : view(view), slot(slot), data(data), size(size), offset(offset) {}
+
+
+/**
+ * @brief  Constructor that takes the page of given handle, which is left empty.
+ * @param  Page other
+ */
+AESMappedView::Page::Page(Page&& other) noexcept : view(other.view), slot(other.slot), data(other.data), size(other.size), offset(other.offset) {
+    other.view = NULL; //leave other handle empty
+    other.data = NULL;
+    other.size = 0;
+}
+
+
+/**
+ * @brief  Operator that unpins the current page and takes the page of given handle, which is left empty.
+ * @param  Page other
+ * @return  Page page
+ */
+AESMappedView::Page& AESMappedView::Page::operator=(Page&& other) noexcept {
+    if (this != &other) { //if other is another handle
+        Release(); //unpin current page
+        view = other.view; //take page of other handle
+        slot = other.slot;
+        data = other.data;
+        size = other.size;
+        offset = other.offset;
+        other.view = NULL; //leave other handle empty
+        other.data = NULL;
+        other.size = 0;
+    }
+    return *this; //return handle
+}
+
+
+/**
+ * @brief  Destructor that unpins the page.
+ */
+AESMappedView::Page::~Page() {
+    Release(); //unpin page
+}
+
+
+/**
+ * @brief  Function that returns the plaintext of the page, NULL if the handle is empty.
+ * @return  const unsigned char* data
+ */
+const unsigned char* AESMappedView::Page::Data() const {
+    return data; //return data
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes of the page, the last page of a view may be shorter.
+ * @return  size_t size
+ */
+size_t AESMappedView::Page::Size() const {
+    return size; //return size
+}
+
+
+/**
+ * @brief  Function that returns the offset of the first byte of the page in the view.
+ * @return  uint64_t offset
+ */
+uint64_t AESMappedView::Page::GetOffset() const {
+    return offset; //return offset
+}
+
+
+/**
+ * @brief  Function that returns if the handle holds a page.
+ * @return  bool isValid
+ */
+bool AESMappedView::Page::IsValid() const {
+    return view != NULL; //return if handle holds a page
+}
+
+
+/**
+ * @brief  Function that unpins the page, the handle is left empty.
+ */
+void AESMappedView::Page::Release() {
+    if (view == NULL) //if handle is empty
+        return;
+    view->Unpin(slot); //unpin page
+    view = NULL; //leave handle empty
+    data = NULL;
+    size = 0;
+}
+
+
+/**
+ * @brief  Constructor that maps given file and prepares a view of its ciphertext starting at given offset, nothing is decrypted yet.
+ * @brief  The ciphertext is CTR encrypted with given key and initial counter, as written by Encrypt_CTR in a single call.
+ * @param  string path
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @param  size_t cacheSize
+ * @param  size_t pageSize
+ * @param  uint64_t dataOffset
+ * @throws  invalid_argument thrown if given key, iv, cache size, page size or offset is invalid.
+ * @throws  runtime_error thrown if given file can't be opened or mapped.
+ */
+AESMappedView::AESMappedView(const string& path, const vector<unsigned char>& key, const unsigned char* iv, const size_t cacheSize, const size_t pageSize, const uint64_t dataOffset)
+    : mapping(NULL), fileSize(0), dataOffset(dataOffset), dataSize(0), pageSize(pageSize), capacity(0), iv{}, touchedSlots(0), hits(0), misses(0), evictions(0) {
+#if defined(_WIN32)
+    fileHandle = mappingHandle = NULL; //mark file as closed
+#else
+    descriptor = -1; //mark file as closed
+#endif
+    if (pageSize == 0 || pageSize % BlockSize != 0) //if page size isn't a multiple of 16 bytes
+        throw invalid_argument("Invalid page size, please provide page size that is a multiple of 16 bytes."); //throw invalid argument
+    if (cacheSize < pageSize) //if cache can't hold a single page
+        throw invalid_argument("Invalid cache size, please provide cache size of at least one page."); //throw invalid argument
+    roundKeys = Prepare(key, iv, "CTR"); //validate key and IV and generate round keys
+    memcpy(this->iv, iv, BlockSize); //save initial counter
+    try {
+        Map(path); //map file
+    }
+    catch (...) { //if file couldn't be mapped
+        ClearVector(roundKeys); //clear round keys before we rethrow
+        throw;
+    }
+    if (dataOffset > fileSize) { //if ciphertext starts past the end of file
+        Unmap(); //unmap file
+        ClearVector(roundKeys); //clear round keys
+        throw invalid_argument("Invalid offset, please provide offset inside the file."); //throw invalid argument
+    }
+    dataSize = fileSize - dataOffset; //ciphertext runs to the end of file
+    capacity = cacheSize / pageSize; //calculate number of pages the cache holds
+    storage.reset(new unsigned char[capacity * pageSize]); //reserve cache, pages are only touched when slots are used
+    slots.resize(capacity); //create slots
+    for (size_t slot = capacity; slot-- > 0;) //iterate over slots from last to first
+        freeSlots.push_back(slot); //add free slot, first slots are used first
+}
+
+
+/**
+ * @brief  Destructor that clears the cache and unmaps the file, all pages must be released before.
+ */
+AESMappedView::~AESMappedView() {
+    volatile unsigned char* clear = storage.get(); //represents cache through volatile so clearing isn't optimized away
+    for (size_t i = 0; i < touchedSlots * pageSize; i++) //iterate over slots that were used
+        clear[i] = 0x00; //clear decrypted page
+    ClearVector(roundKeys); //clear round keys of view
+    Unmap(); //unmap file
+}
+
+
+/**
+ * @brief  Function that maps given file.
+ * @param  string path
+ * @throws  runtime_error thrown if given file can't be opened or mapped.
+ */
+void AESMappedView::Map(const string& path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL); //open file for reading
+    if (file == INVALID_HANDLE_VALUE) //if file couldn't be opened
+        throw runtime_error("Failed to open file " + path + "."); //throw runtime error
+    fileHandle = file; //set file handle
+    LARGE_INTEGER size; //represents size of file
+    if (!GetFileSizeEx(file, &size)) { //if size couldn't be read
+        Unmap(); //close file
+        throw runtime_error("Failed to map file " + path + "."); //throw runtime error
+    }
+    fileSize = (uint64_t)size.QuadPart; //set file size
+    if (fileSize == 0) //if file is empty there's nothing to map
+        return;
+    mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL); //create read-only mapping of whole file
+    if (mappingHandle != NULL) //if mapping was created
+        mapping = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0); //map whole file
+    if (mapping == NULL) { //if file couldn't be mapped
+        Unmap(); //close file
+        throw runtime_error("Failed to map file " + path + "."); //throw runtime error
+    }
+#else
+    descriptor = open(path.c_str(), O_RDONLY); //open file for reading
+    if (descriptor < 0) //if file couldn't be opened
+        throw runtime_error("Failed to open file " + path + "."); //throw runtime error
+    struct stat status; //represents status of file
+    if (fstat(descriptor, &status) != 0) { //if status couldn't be read
+        Unmap(); //close file
+        throw runtime_error("Failed to map file " + path + "."); //throw runtime error
+    }
+    fileSize = (uint64_t)status.st_size; //set file size
+    if (fileSize == 0) //if file is empty there's nothing to map
+        return;
+    void* mapped = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_SHARED, descriptor, 0); //map whole file, pages are read from disk when touched
+    if (mapped == MAP_FAILED) { //if file couldn't be mapped
+        Unmap(); //close file
+        throw runtime_error("Failed to map file " + path + "."); //throw runtime error
+    }
+    mapping = (const unsigned char*)mapped; //set mapping
+#endif
+}
+
+
+/**
+ * @brief  Function that unmaps the file.
+ */
+void AESMappedView::Unmap() {
+#if defined(_WIN32)
+    if (mapping != NULL) UnmapViewOfFile(mapping); //unmap file
+    if (mappingHandle != NULL) CloseHandle(mappingHandle); //close mapping
+    if (fileHandle != NULL) CloseHandle(fileHandle); //close file
+    fileHandle = mappingHandle = NULL; //mark file as closed
+#else
+    if (mapping != NULL) munmap((void*)mapping, (size_t)fileSize); //unmap file
+    if (descriptor >= 0) close(descriptor); //close file
+    descriptor = -1; //mark file as closed
+#endif
+    mapping = NULL; //mark file as unmapped
+}
+
+
+/**
+ * @brief  Function that decrypts given page into given cache slot.
+ * @param  uint64_t index
+ * @param  size_t slot
+ */
+void AESMappedView::DecryptPage(const uint64_t index, const size_t slot) {
+    uint64_t offset = index * pageSize; //represents offset of page in view
+    size_t size = (size_t)min((uint64_t)pageSize, dataSize - offset); //represents size of page, last page may be shorter
+    unsigned char* data = storage.get() + slot * pageSize; //represents plaintext of slot
+    unsigned char counter[BlockSize]; //represents counter of first block of page
+    memcpy(counter, iv, BlockSize); //initialize counter with initial counter
+    AddCounter(counter, offset / BlockSize); //add number of blocks before page to counter
+    CTRRange(mapping + dataOffset + offset, data, size, roundKeys, counter); //decrypt page
+    if (size < pageSize) //if page is shorter than slot
+        fill(data + size, data + pageSize, 0x00); //clear rest of slot, it may hold plaintext of an evicted page
+}
+
+
+/**
+ * @brief  Function that unpins given cache slot, it becomes the most recently used page once no handle holds it.
+ * @param  size_t slot
+ */
+void AESMappedView::Unpin(const size_t slot) {
+    {
+        lock_guard<mutex> lock(viewMutex); //lock cache
+        if (--slots[slot].pins > 0) //if other handles still hold page
+            return;
+        recentSlots.push_front(slot); //page becomes most recently used
+        slots[slot].position = recentSlots.begin(); //save position for removal
+    }
+    viewCondition.notify_all(); //wake threads waiting for a slot
+}
+
+
+/**
+ * @brief  Function that returns the page that holds given offset, decrypting it if it isn't cached.
+ * @brief  Waits until a page is released if every cached page is pinned, so a thread shouldn't pin more pages than the cache holds.
+ * @param  uint64_t offset
+ * @return  Page page
+ * @throws  invalid_argument thrown if given offset is past the end of the view.
+ */
+AESMappedView::Page AESMappedView::Acquire(const uint64_t offset) {
+    if (offset >= dataSize) //if offset is past the end of view
+        throw invalid_argument("Invalid offset, please provide offset inside the view."); //throw invalid argument
+    const uint64_t index = offset / pageSize; //represents index of page
+    const uint64_t pageOffset = index * pageSize; //represents offset of page in view
+    const size_t size = (size_t)min((uint64_t)pageSize, dataSize - pageOffset); //represents size of page
+    unique_lock<mutex> lock(viewMutex); //lock cache
+    for (;;) { //repeat until page is pinned
+        auto found = pageSlots.find(index); //find page in cache
+        if (found != pageSlots.end()) { //if page is cached or being decrypted
+            Slot& slot = slots[found->second]; //represents slot of page
+            if (!slot.isReady) { //if another thread is decrypting page we wait for it
+                viewCondition.wait(lock); //wait for page
+                continue;
+            }
+            if (slot.pins++ == 0) //if page wasn't pinned
+                recentSlots.erase(slot.position); //remove page from least recently used list
+            hits++; //count hit
+            return Page(this, found->second, storage.get() + found->second * pageSize, size, pageOffset); //return pinned page
+        }
+        size_t slot; //represents slot for page
+        if (!freeSlots.empty()) { //if a slot is free
+            slot = freeSlots.back(); //take free slot
+            freeSlots.pop_back();
+            touchedSlots = max(touchedSlots, slot + 1); //slot is used now
+        }
+        else if (!recentSlots.empty()) { //else we evict the least recently used page
+            slot = recentSlots.back(); //take slot of least recently used page
+            recentSlots.pop_back();
+            pageSlots.erase(slots[slot].index); //drop evicted page
+            evictions++; //count eviction
+        }
+        else { //else every page is pinned and we wait for one to be released
+            viewCondition.wait(lock); //wait for slot
+            continue;
+        }
+        slots[slot].index = index; //set page of slot
+        slots[slot].pins = 1; //pin page for caller
+        slots[slot].isReady = false; //page is being decrypted
+        pageSlots[index] = slot; //add page to cache so other threads wait for it
+        misses++; //count miss
+        lock.unlock(); //decrypt without holding the lock
+        DecryptPage(index, slot); //decrypt page into slot
+        lock.lock(); //lock cache again
+        slots[slot].isReady = true; //page is decrypted
+        lock.unlock(); //unlock before waking waiting threads
+        viewCondition.notify_all(); //wake threads waiting for page
+        return Page(this, slot, storage.get() + slot * pageSize, size, pageOffset); //return pinned page
+    }
+}
+
+
+/**
+ * @brief  Function that copies the plaintext of given range into given buffer and returns the number of bytes copied, which is less at the end of the view.
+ * @param  uint64_t offset
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  size_t read
+ * @throws  invalid_argument thrown if given buffer is invalid.
+ */
+size_t AESMappedView::Read(const uint64_t offset, unsigned char* output, const size_t length) {
+    if (length > 0 && output == NULL) //if buffer is missing
+        throw invalid_argument("Invalid buffer, please provide valid output buffer."); //throw invalid argument
+    if (offset >= dataSize) //if range starts past the end of view
+        return 0;
+    size_t total = (size_t)min((uint64_t)length, dataSize - offset); //represents number of bytes to copy
+    for (size_t copied = 0; copied < total;) { //iterate over pages of range
+        Page page = Acquire(offset + copied); //pin page of current offset
+        size_t start = (size_t)(offset + copied - page.GetOffset()); //represents start of range in page
+        size_t size = min(page.Size() - start, total - copied); //represents number of bytes to copy from page
+        memcpy(output + copied, page.Data() + start, size); //copy plaintext
+        copied += size; //move to next page
+    }
+    return total;
+}
+
+
+/**
+ * @brief  Function that decrypts the pages of given range ahead of use, in parallel if there are enough pages.
+ * @brief  Only as many pages as the cache holds are decrypted.
+ * @param  uint64_t offset
+ * @param  size_t length
+ */
+void AESMappedView::Prefetch(const uint64_t offset, const size_t length) {
+    if (offset >= dataSize || length == 0) //if range is empty
+        return;
+    AES_PROFILE_SCOPE("MappedView-Prefetch", length); //profile page prefetch
+    uint64_t end = min(dataSize, offset + (uint64_t)length); //represents end of range
+    uint64_t first = offset / pageSize, last = (end - 1) / pageSize; //represents first and last page of range
+    size_t count = (size_t)min((uint64_t)capacity, last - first + 1); //represents number of pages to decrypt, at most the cache capacity
+    auto task = [&](size_t i) { Acquire((first + i) * pageSize); }; //represents decryption of a page, released right away so it stays cached
+    if (count * pageSize < GetParallelThreshold() || GetThreadCount() <= 1) //if range is below threshold we decrypt it on calling thread
+        for (size_t i = 0; i < count; i++) task(i); //decrypt each page
+    else //else range is large enough for the worker pool
+        ParallelFor(count, task); //decrypt pages in parallel
+}
+
+
+/**
+ * @brief  Function that clears and drops every cached page that isn't pinned.
+ */
+void AESMappedView::Clear() {
+    lock_guard<mutex> lock(viewMutex); //lock cache
+    for (size_t slot : recentSlots) { //iterate over unpinned pages
+        fill(storage.get() + slot * pageSize, storage.get() + (slot + 1) * pageSize, 0x00); //clear decrypted page before it leaves the cache
+        pageSlots.erase(slots[slot].index); //drop page
+        freeSlots.push_back(slot); //return slot
+    }
+    recentSlots.clear(); //no unpinned pages are left
+}
+
+
+/**
+ * @brief  Function that returns the number of plaintext bytes of the view.
+ * @return  uint64_t size
+ */
+uint64_t AESMappedView::GetSize() const {
+    return dataSize; //return size
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes of each page.
+ * @return  size_t pageSize
+ */
+size_t AESMappedView::GetPageSize() const {
+    return pageSize; //return page size
+}
+
+
+/**
+ * @brief  Function that returns the number of pages the cache holds.
+ * @return  size_t capacity
+ */
+size_t AESMappedView::GetCapacity() const {
+    return capacity; //return capacity
+}
+
+
+/**
+ * @brief  Function that returns the number of pages that are currently cached.
+ * @return  size_t cached
+ */
+size_t AESMappedView::GetCached() {
+    lock_guard<mutex> lock(viewMutex); //lock cache
+    return pageSlots.size(); //return number of cached pages
+}
+
+
+/**
+ * @brief  Function that returns the number of accesses that found their page in the cache.
+ * @return  size_t hits
+ */
+size_t AESMappedView::GetHits() {
+    lock_guard<mutex> lock(viewMutex); //lock cache
+    return hits; //return hits
+}
+
+
+/**
+ * @brief  Function that returns the number of accesses that decrypted their page.
+ * @return  size_t misses
+ */
+size_t AESMappedView::GetMisses() {
+    lock_guard<mutex> lock(viewMutex); //lock cache
+    return misses; //return misses
+}
+
+
+/**
+ * @brief  Function that returns the number of pages evicted from the cache.
+ * @return  size_t evictions
+ */
+size_t AESMappedView::GetEvictions() {
+    lock_guard<mutex> lock(viewMutex); //lock cache
+    return evictions; //return evictions
+}
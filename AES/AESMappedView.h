@@ -0,0 +1,257 @@
+#ifndef _AESMAPPEDVIEW_H
+#define _AESMAPPEDVIEW_H
+#include "AESParallel.h"
+#include <condition_variable>
+#include <unordered_map>
+#include <list>
+#include <memory>
+
+/**
+ * @file AESMappedView.h
+ * @brief  AESMappedView class for a read-only view of a CTR encrypted file that is decrypted lazily, page by page, on first access.
+ * @brief  The file is memory mapped, so ciphertext is only read from disk when a page is touched and stays in the shared page cache of the system.
+ * @brief  CTR allows random access, the counter of any page is derived from its offset, so opening a view doesn't decrypt anything.
+ * @brief  Decrypted pages are kept in a bounded cache and the least recently used page that isn't pinned is evicted, so resident plaintext tracks the working set.
+ * @brief  Pages are accessed through pinned Page handles, a page isn't evicted while a handle holds it.
+ */
+class AESMappedView : public AESParallel {
+public:
+	/**
+	 * @brief  Represents a decrypted page pinned in the cache, unpins the page when destroyed.
+	 */
+	class Page {
+	public:
+		/**
+		 * @brief  Constructor that creates an empty handle that holds no page.
+		 */
+		Page();
+
+		/**
+		 * @brief  Constructor that takes the page of given handle, which is left empty.
+		 * @param  Page other
+		 */
+		Page(Page&& other) noexcept;
+
+		/**
+		 * @brief  Operator that unpins the current page and takes the page of given handle, which is left empty.
+		 * @param  Page other
+		 * @return  Page page
+		 */
+		Page& operator=(Page&& other) noexcept;
+
+		/**
+		 * @brief  Destructor that unpins the page.
+		 */
+		~Page();
+
+		Page(const Page&) = delete;
+		Page& operator=(const Page&) = delete;
+
+		/**
+		 * @brief  Function that returns the plaintext of the page, NULL if the handle is empty.
+		 * @return  const unsigned char* data
+		 */
+		const unsigned char* Data() const;
+
+		/**
+		 * @brief  Function that returns the number of bytes of the page, the last page of a view may be shorter.
+		 * @return  size_t size
+		 */
+		size_t Size() const;
+
+		/**
+		 * @brief  Function that returns the offset of the first byte of the page in the view.
+		 * @return  uint64_t offset
+		 */
+		uint64_t GetOffset() const;
+
+		/**
+		 * @brief  Function that returns if the handle holds a page.
+		 * @return  bool isValid
+		 */
+		bool IsValid() const;
+
+		/**
+		 * @brief  Function that unpins the page, the handle is left empty.
+		 */
+		void Release();
+
+	private:
+		friend class AESMappedView;
+		AESMappedView* view; //view that owns the page, NULL if handle is empty
+		size_t slot; //cache slot of page
+		const unsigned char* data; //plaintext of page
+		size_t size; //number of bytes of page
+		uint64_t offset; //offset of page in view
+
+		/**
+		 * @brief  Constructor that wraps given cache slot of given view.
+		 * @param  AESMappedView* view
+		 * @param  size_t slot
+		 * @param  const unsigned char* data
+		 * @param  size_t size
+		 * @param  uint64_t offset
+		 */
+		Page(AESMappedView* view, const size_t slot, const unsigned char* data, const size_t size, const uint64_t offset);
+	};
+
+	/**
+	 * @brief  Constructor that maps given file and prepares a view of its ciphertext starting at given offset, nothing is decrypted yet.
+	 * @brief  The ciphertext is CTR encrypted with given key and initial counter, as written by Encrypt_CTR in a single call.
+	 * @param  string path
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  size_t cacheSize
+	 * @param  size_t pageSize
+	 * @param  uint64_t dataOffset
+	 * @throws  invalid_argument thrown if given key, iv, cache size, page size or offset is invalid.
+	 * @throws  runtime_error thrown if given file can't be opened or mapped.
+	 */
+	AESMappedView(const string& path, const vector<unsigned char>& key, const unsigned char* iv, const size_t cacheSize = 64 * 1024 * 1024, const size_t pageSize = 64 * 1024, const uint64_t dataOffset = 0);
+
+	/**
+	 * @brief  Destructor that clears the cache and unmaps the file, all pages must be released before.
+	 */
+	~AESMappedView();
+
+	AESMappedView(const AESMappedView&) = delete;
+	AESMappedView& operator=(const AESMappedView&) = delete;
+
+	/**
+	 * @brief  Function that returns the page that holds given offset, decrypting it if it isn't cached.
+	 * @brief  Waits until a page is released if every cached page is pinned, so a thread shouldn't pin more pages than the cache holds.
+	 * @param  uint64_t offset
+	 * @return  Page page
+	 * @throws  invalid_argument thrown if given offset is past the end of the view.
+	 */
+	Page Acquire(const uint64_t offset);
+
+	/**
+	 * @brief  Function that copies the plaintext of given range into given buffer and returns the number of bytes copied, which is less at the end of the view.
+	 * @param  uint64_t offset
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  size_t read
+	 * @throws  invalid_argument thrown if given buffer is invalid.
+	 */
+	size_t Read(const uint64_t offset, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that decrypts the pages of given range ahead of use, in parallel if there are enough pages.
+	 * @brief  Only as many pages as the cache holds are decrypted.
+	 * @param  uint64_t offset
+	 * @param  size_t length
+	 */
+	void Prefetch(const uint64_t offset, const size_t length);
+
+	/**
+	 * @brief  Function that clears and drops every cached page that isn't pinned.
+	 */
+	void Clear();
+
+	/**
+	 * @brief  Function that returns the number of plaintext bytes of the view.
+	 * @return  uint64_t size
+	 */
+	uint64_t GetSize() const;
+
+	/**
+	 * @brief  Function that returns the number of bytes of each page.
+	 * @return  size_t pageSize
+	 */
+	size_t GetPageSize() const;
+
+	/**
+	 * @brief  Function that returns the number of pages the cache holds.
+	 * @return  size_t capacity
+	 */
+	size_t GetCapacity() const;
+
+	/**
+	 * @brief  Function that returns the number of pages that are currently cached.
+	 * @return  size_t cached
+	 */
+	size_t GetCached();
+
+	/**
+	 * @brief  Function that returns the number of accesses that found their page in the cache.
+	 * @return  size_t hits
+	 */
+	size_t GetHits();
+
+	/**
+	 * @brief  Function that returns the number of accesses that decrypted their page.
+	 * @return  size_t misses
+	 */
+	size_t GetMisses();
+
+	/**
+	 * @brief  Function that returns the number of pages evicted from the cache.
+	 * @return  size_t evictions
+	 */
+	size_t GetEvictions();
+
+protected:
+	/**
+	 * @brief  Represents a cache slot.
+	 */
+	struct Slot {
+		uint64_t index = 0; //index of cached page
+		size_t pins = 0; //number of handles that hold the page
+		bool isReady = false; //true if page is decrypted, false while it's being decrypted
+		list<size_t>::iterator position; //position in least recently used list if page isn't pinned
+	};
+
+	/**
+	 * @brief  Function that decrypts given page into given cache slot.
+	 * @param  uint64_t index
+	 * @param  size_t slot
+	 */
+	void DecryptPage(const uint64_t index, const size_t slot);
+
+	/**
+	 * @brief  Function that unpins given cache slot, it becomes the most recently used page once no handle holds it.
+	 * @param  size_t slot
+	 */
+	void Unpin(const size_t slot);
+
+	/**
+	 * @brief  Function that maps given file.
+	 * @param  string path
+	 * @throws  runtime_error thrown if given file can't be opened or mapped.
+	 */
+	void Map(const string& path);
+
+	/**
+	 * @brief  Function that unmaps the file.
+	 */
+	void Unmap();
+
+private:
+	const unsigned char* mapping; //mapping of whole file, NULL if file is empty
+	uint64_t fileSize; //size of file in bytes
+	uint64_t dataOffset; //offset of ciphertext in file
+	uint64_t dataSize; //size of ciphertext in bytes
+	size_t pageSize; //size of each page in bytes, a multiple of 16 bytes
+	size_t capacity; //number of pages the cache holds
+	vector<vector<unsigned char>> roundKeys; //round keys of view
+	unsigned char iv[16]; //initial counter of ciphertext
+	unique_ptr<unsigned char[]> storage; //plaintext of all cache slots, only touched when slots are used
+	size_t touchedSlots; //number of slots that were ever used, they're cleared on destruction
+	vector<Slot> slots; //cache slots
+	vector<size_t> freeSlots; //slots that hold no page
+	list<size_t> recentSlots; //slots with unpinned pages, most recently used first
+	unordered_map<uint64_t, size_t> pageSlots; //slot of each cached page
+	mutex viewMutex; //guards cache
+	condition_variable viewCondition; //signals decrypted and unpinned pages
+	size_t hits; //number of cache hits
+	size_t misses; //number of cache misses
+	size_t evictions; //number of evicted pages
+#if defined(_WIN32)
+	void* fileHandle; //handle of file
+	void* mappingHandle; //handle of file mapping
+#else
+	int descriptor; //descriptor of file
+#endif
+};
+#endif
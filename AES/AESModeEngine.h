@@ -0,0 +1,355 @@
+#ifndef _AESMODEENGINE_H
+#define _AESMODEENGINE_H
+#include "AES.h"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @file AESModeEngine.h
+ * @brief  AESModeEngine class, a mode engine templated on the block backend and the chaining policy.
+ * @brief  Each pair of backend and policy compiles into its own loop, so the block functions of the backend are inlined into the chaining of the mode.
+ * @brief  The engine owns validation, key expansion into a schedule on the stack, padding and clearing, the policies only chain blocks and the backends only cipher them.
+ * @brief  A backend provides a Schedule type and static Expand, Clear, EncryptBlocks and DecryptBlocks functions, once it does it works with every mode.
+ * @brief  The engine is a template, so it lives in this header, the public mode functions of AES are thin wrappers over it.
+ * @brief  It only covers the vector functions AES::Encrypt_* and AES::Decrypt_*, which dispatch on AES::SetBackend, a new backend plugged in here isn't used by them unless they dispatch to it.
+ * @brief  AESParallel, AESStream, AESSession, AESScatter, AESAsync and AESDaemon keep their own chunked or stateful mode loops over KeySchedule round keys and don't use the engine.
+ */
+class AESModeEngine : public AES {
+public:
+	/**
+	 * @brief  Represents the number of blocks policies hand to the backend at once when blocks don't depend on each other.
+	 */
+	static const size_t ParallelBlocks = 8;
+
+	/**
+	 * @brief  Represents the largest message in bytes that CBC decryption and CTR process block by block, without the batch buffers and their clearing.
+	 */
+	static const size_t SmallMessageSize = 256;
+
+	/**
+	 * @brief  Represents the table-based software backend, round keys are kept flat on the stack.
+	 */
+	struct SoftwareBackend {
+		/**
+		 * @brief  Represents the expanded round keys of a key.
+		 */
+		struct Schedule {
+			alignas(16) unsigned char roundKeys[15 * BlockSize]; //round keys, 11, 13 or 15 keys of 16 bytes
+			size_t rounds; //number of rounds (10, 12 or 14)
+		};
+
+		/**
+		 * @brief  Function that expands given key into given schedule, key size must be valid.
+		 * @param  const unsigned char* key
+		 * @param  size_t keySize
+		 * @param  Schedule schedule
+		 */
+		static void Expand(const unsigned char* key, const size_t keySize, Schedule& schedule) {
+			KeySchedule(key, keySize, schedule.roundKeys); //generate flat round keys
+			schedule.rounds = keySize / Nb + 6; //number of rounds derived from key
+		}
+
+		/**
+		 * @brief  Function that clears given schedule.
+		 * @param  Schedule schedule
+		 */
+		static void Clear(Schedule& schedule) {
+			volatile unsigned char* bytes = schedule.roundKeys; //write through volatile so engine round keys are really wiped
+			for (size_t i = 0; i < sizeof(schedule.roundKeys); i++) //iterate over round keys
+				bytes[i] = 0x00; //clear each byte
+		}
+
+		/**
+		 * @brief  Function that encrypts given number of consecutive blocks in place.
+		 * @param  unsigned char* blocks
+		 * @param  size_t count
+		 * @param  Schedule schedule
+		 */
+		static void EncryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule) {
+			for (size_t i = 0; i < count; i++) //iterate over blocks
+				EncryptBlock(blocks + i * BlockSize, schedule.roundKeys, schedule.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+		}
+
+		/**
+		 * @brief  Function that decrypts given number of consecutive blocks in place.
+		 * @param  unsigned char* blocks
+		 * @param  size_t count
+		 * @param  Schedule schedule
+		 */
+		static void DecryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule) {
+			for (size_t i = 0; i < count; i++) //iterate over blocks
+				DecryptBlock(blocks + i * BlockSize, schedule.roundKeys, schedule.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+		}
+	};
+
+	/**
+	 * @brief  Represents ECB chaining, blocks are independent and handed to the backend in one call.
+	 */
+	struct ECBPolicy {
+		static const bool Padded = true; //text is padded with PKCS7
+		static const bool UsesIV = false; //mode has no IV
+		static const char* Name() { return "ECB"; }
+
+		template <class Backend>
+		static void Encrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			(void)state; //ECB has no state
+			Backend::EncryptBlocks(text, length / BlockSize, schedule); //encrypt all blocks
+		}
+
+		template <class Backend>
+		static void Decrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			(void)state; //ECB has no state
+			Backend::DecryptBlocks(text, length / BlockSize, schedule); //decrypt all blocks
+		}
+	};
+
+	/**
+	 * @brief  Represents CBC chaining, encryption is serial and decryption hands batches of blocks to the backend unless the message is small.
+	 */
+	struct CBCPolicy {
+		static const bool Padded = true; //text is padded with PKCS7
+		static const bool UsesIV = true; //state holds previous cipher block
+		static const char* Name() { return "CBC"; }
+
+		template <class Backend>
+		static void Encrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				XOR(text + i, state); //XOR with previous cipher block
+				Backend::EncryptBlocks(text + i, 1, schedule); //encrypt the block
+				memcpy(state, text + i, BlockSize); //update previous cipher block
+			}
+		}
+
+		template <class Backend>
+		static void Decrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			if (length <= SmallMessageSize) { //if message is small we avoid setup costs of the batched path
+				DecryptSmall<Backend>(text, length, schedule, state); //decrypt message block by block
+				return;
+			}
+			unsigned char ciphers[ParallelBlocks * BlockSize]; //represents cipher blocks of current batch
+			for (size_t i = 0; i < length; i += ParallelBlocks * BlockSize) { //iterate over batches of blocks
+				size_t size = min(length - i, ParallelBlocks * BlockSize); //calculate batch size, last batch may be shorter
+				memcpy(ciphers, text + i, size); //save cipher blocks before they're decrypted in place
+				Backend::DecryptBlocks(text + i, size / BlockSize, schedule); //decrypt batch
+				XOR(text + i, state); //XOR first block with previous cipher block
+				for (size_t j = BlockSize; j < size; j += BlockSize) //iterate over remaining blocks of batch
+					XOR(text + i + j, ciphers + j - BlockSize); //XOR with previous cipher block
+				memcpy(state, ciphers + size - BlockSize, BlockSize); //update previous cipher block
+			}
+		}
+
+		template <class Backend>
+		static void DecryptSmall(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			unsigned char cipher[BlockSize]; //represents current cipher block
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				memcpy(cipher, text + i, BlockSize); //save cipher block before it's decrypted in place
+				Backend::DecryptBlocks(text + i, 1, schedule); //decrypt the block
+				XOR(text + i, state); //XOR with previous cipher block
+				memcpy(state, cipher, BlockSize); //update previous cipher block
+			}
+		}
+	};
+
+	/**
+	 * @brief  Represents CFB chaining with full-block feedback, text may end with a partial block.
+	 */
+	struct CFBPolicy {
+		static const bool Padded = false; //text may have any length
+		static const bool UsesIV = true; //state holds previous cipher block
+		static const char* Name() { return "CFB"; }
+
+		template <class Backend>
+		static void Encrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				Backend::EncryptBlocks(state, 1, schedule); //encrypt previous cipher block into keystream block
+				size_t size = min(length - i, BlockSize); //calculate block size, last block may be partial
+				for (size_t j = 0; j < size; j++) //iterate over block
+					state[j] = text[i + j] ^= state[j]; //perform byte XOR and keep cipher byte as feedback
+			}
+		}
+
+		template <class Backend>
+		static void Decrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			unsigned char cipher[BlockSize]; //represents current cipher block
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				size_t size = min(length - i, BlockSize); //calculate block size, last block may be partial
+				memcpy(cipher, text + i, size); //save cipher bytes before they're decrypted in place
+				Backend::EncryptBlocks(state, 1, schedule); //encrypt previous cipher block into keystream block
+				for (size_t j = 0; j < size; j++) //iterate over block
+					text[i + j] ^= state[j]; //perform byte XOR between cipher and keystream
+				memcpy(state, cipher, size); //keep cipher bytes as feedback
+			}
+		}
+	};
+
+	/**
+	 * @brief  Represents OFB chaining, the keystream block is encrypted again for every block.
+	 */
+	struct OFBPolicy {
+		static const bool Padded = false; //text may have any length
+		static const bool UsesIV = true; //state holds keystream block
+		static const char* Name() { return "OFB"; }
+
+		template <class Backend>
+		static void Encrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				Backend::EncryptBlocks(state, 1, schedule); //encrypt keystream block into next keystream block
+				if (length - i >= BlockSize) //if block is whole we XOR it at once
+					XOR(text + i, state); //perform XOR between text and keystream block
+				else //else last block is partial
+					for (size_t j = 0; j < length - i; j++) //iterate over remaining bytes
+						text[i + j] ^= state[j]; //perform byte XOR between text and keystream block
+			}
+		}
+
+		template <class Backend>
+		static void Decrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			Encrypt<Backend>(text, length, schedule, state); //OFB decryption is the same operation
+		}
+	};
+
+	/**
+	 * @brief  Represents CTR chaining, counter blocks of a batch are handed to the backend in one call unless the message is small.
+	 * @brief  The counter is the lower 64 bits of the block in big endian order and wraps around.
+	 */
+	struct CTRPolicy {
+		static const bool Padded = false; //text may have any length
+		static const bool UsesIV = true; //state holds counter
+		static const char* Name() { return "CTR"; }
+
+		template <class Backend>
+		static void Encrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			if (length <= SmallMessageSize) { //if message is small we avoid setup costs of the batched path
+				EncryptSmall<Backend>(text, length, schedule, state); //process message block by block
+				return;
+			}
+			unsigned char keystream[ParallelBlocks * BlockSize]; //represents keystream of current batch
+			for (size_t i = 0; i < length; i += ParallelBlocks * BlockSize) { //iterate over batches of blocks
+				size_t size = min(length - i, ParallelBlocks * BlockSize); //calculate batch size, last batch may be shorter
+				size_t blocks = (size + BlockSize - 1) / BlockSize; //calculate number of counter blocks, last block may be partial
+				for (size_t j = 0; j < blocks; j++) { //iterate over counter blocks
+					memcpy(keystream + j * BlockSize, state, BlockSize); //copy counter
+					for (size_t k = BlockSize; k-- > BlockSize / 2;) //iterate over lower half of counter from end to start
+						if (++state[k]) break; //increment state[k] and break if it's not zero
+				}
+				Backend::EncryptBlocks(keystream, blocks, schedule); //encrypt counter blocks of batch
+				size_t j = 0; //represents position in batch
+				for (; j + BlockSize <= size; j += BlockSize) //iterate over whole blocks
+					XOR(text + i + j, keystream + j); //perform XOR between text and keystream block
+				for (; j < size; j++) //iterate over partial last block
+					text[i + j] ^= keystream[j]; //perform byte XOR between text and keystream
+			}
+			fill(keystream, keystream + sizeof(keystream), 0x00); //clear keystream of last batch
+		}
+
+		template <class Backend>
+		static void EncryptSmall(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			unsigned char keystream[BlockSize]; //represents keystream of current block
+			for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+				memcpy(keystream, state, BlockSize); //copy counter
+				for (size_t k = BlockSize; k-- > BlockSize / 2;) //iterate over lower half of counter from end to start
+					if (++state[k]) break; //increment state[k] and break if it's not zero
+				Backend::EncryptBlocks(keystream, 1, schedule); //encrypt counter block
+				if (length - i >= BlockSize) //if block is whole we XOR it at once
+					XOR(text + i, keystream); //perform XOR between text and keystream block
+				else //else last block is partial
+					for (size_t j = 0; j < length - i; j++) //iterate over remaining bytes
+						text[i + j] ^= keystream[j]; //perform byte XOR between text and keystream block
+			}
+			fill(keystream, keystream + BlockSize, 0x00); //clear keystream of last block
+		}
+
+		template <class Backend>
+		static void Decrypt(unsigned char* text, const size_t length, const typename Backend::Schedule& schedule, unsigned char* state) {
+			Encrypt<Backend>(text, length, schedule, state); //CTR decryption is the same operation
+		}
+	};
+
+	/**
+	 * @brief  Function that performs AES encryption on given text in place using specified key and iv with given backend and policy.
+	 * @brief  Padded policies add PKCS7 padding if text isn't a multiple of 16 bytes, iv is ignored by policies without IV.
+	 * @param  vector<unsigned char> text
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> iv
+	 * @return  vector<unsigned char> cipherText
+	 * @throws  invalid_argument thrown if given text, key or iv is invalid.
+	 */
+	template <class Backend, class Policy>
+	static vector<unsigned char>& Encrypt(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv = vector<unsigned char>()) {
+		Validate<Policy>(text, key, iv, false); //validate text, key and IV
+		if (Policy::Padded && text.size() % BlockSize != 0) { //if text size isn't multiply of 16 bytes we add padding
+			unsigned char padding = (unsigned char)(BlockSize - (text.size() % BlockSize)); //calculate the number of padding bytes needed
+			text.insert(text.end(), padding, padding); //append the padding bytes to the text
+		}
+		Process<Backend, Policy>(text.data(), text.size(), key, Policy::UsesIV ? iv.data() : NULL, true); //encrypt text
+		return text; //return ciphered text
+	}
+
+	/**
+	 * @brief  Function that performs AES decryption on given text in place using specified key and iv with given backend and policy.
+	 * @brief  Padded policies require text to be a multiple of 16 bytes and remove valid PKCS7 padding, iv is ignored by policies without IV.
+	 * @param  vector<unsigned char> text
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> iv
+	 * @return  vector<unsigned char> decipherText
+	 * @throws  invalid_argument thrown if given text, key or iv is invalid.
+	 */
+	template <class Backend, class Policy>
+	static vector<unsigned char>& Decrypt(vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv = vector<unsigned char>()) {
+		Validate<Policy>(text, key, iv, true); //validate text, key and IV
+		Process<Backend, Policy>(text.data(), text.size(), key, Policy::UsesIV ? iv.data() : NULL, false); //decrypt text
+		if (Policy::Padded) { //if policy is padded we remove the padding
+			unsigned char padding = text.back(); //get the value of the last byte, which indicates the padding size
+			if (padding > 0 && padding <= BlockSize && padding <= text.size()) { //if true we have padding bytes to remove from text
+				for (size_t i = text.size(); i-- > text.size() - padding;) //check if last bytes match padding value
+					if (text[i] != padding) return text; //if byte doesn't match padding value we return deciphered text
+				text.resize(text.size() - padding); //remove the padding bytes from the text
+			}
+		}
+		return text; //return deciphered text
+	}
+
+	/**
+	 * @brief  Function that expands given key on the stack and encrypts or decrypts given buffer in place with given backend and policy.
+	 * @brief  Key size must be valid, padded policies require length to be a multiple of 16 bytes, iv may be NULL for policies without IV.
+	 * @param  unsigned char* text
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  bool encrypt
+	 */
+	template <class Backend, class Policy>
+	static void Process(unsigned char* text, const size_t length, const vector<unsigned char>& key, const unsigned char* iv, const bool encrypt) {
+		typename Backend::Schedule schedule; //represents round keys on the stack
+		unsigned char state[BlockSize] = {}; //represents chaining state of policy
+		Backend::Expand(key.data(), key.size(), schedule); //expand key without heap allocations
+		if (iv != NULL) //if policy uses an IV
+			memcpy(state, iv, BlockSize); //initialize state with IV
+		if (encrypt) //if we encrypt
+			Policy::template Encrypt<Backend>(text, length, schedule, state); //encrypt buffer
+		else //else we decrypt
+			Policy::template Decrypt<Backend>(text, length, schedule, state); //decrypt buffer
+		Backend::Clear(schedule); //clear round keys of backend schedule
+		fill(state, state + BlockSize, 0x00); //clear state
+	}
+
+protected:
+	/**
+	 * @brief  Function that validates given text, key and iv for given policy with the messages of the mode functions.
+	 * @param  vector<unsigned char> text
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> iv
+	 * @param  bool decrypt
+	 * @throws  invalid_argument thrown if given text, key or iv is invalid.
+	 */
+	template <class Policy>
+	static void Validate(const vector<unsigned char>& text, const vector<unsigned char>& key, const vector<unsigned char>& iv, const bool decrypt) {
+		SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
+		if (text.empty() || (decrypt && Policy::Padded && text.size() % BlockSize != 0)) //if plaintext is empty or padded ciphertext isn't multiply of 16 bytes
+			throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES " + string(Policy::Name()) + " requirements."); //throw invalid argument
+		if (Policy::UsesIV && iv.size() != BlockSize) //if IV vector isn't in correct size
+			throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + string(Policy::Name()) + " requirements."); //throw invalid argument
+	}
+};
+#endif
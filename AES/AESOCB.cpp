@@ -0,0 +1,366 @@
+#include "AESOCB.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/**
+ * @brief  Function that expands given key and precomputes its offsets into a new context.
+ * @param  vector<unsigned char> key
+ * @param  size_t tagSize
+ * @return  Context context
+ * @throws  invalid_argument thrown if given key or tag size is invalid.
+ */
+AESOCB::Context AESOCB::CreateContext(const vector<unsigned char>& key, const size_t tagSize) {
+    if (tagSize == 0 || tagSize > BlockSize) //if tag size isn't between 1 and 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid tag size that matches AES OCB requirements."); //throw invalid argument
+    Context context; //represents new context
+    Expand(key.data(), key.size(), context.key); //expand round keys, throws invalid argument if key invalid
+    EncryptBlock(context.lStar, context.key.roundKeys, context.key.rounds); //L_* is the encryption of the zero block
+    Double(context.lStar, context.lDollar); //L_$ is double of L_*
+    Double(context.lDollar, context.l[0]); //L_0 is double of L_$
+    for (size_t i = 1; i < LTableSize; i++) //iterate over L table
+        Double(context.l[i - 1], context.l[i]); //each L_i is double of the previous one
+    context.tagSize = tagSize; //set tag size
+    return context; //return context
+}
+
+
+/**
+ * @brief  Function that clears the round keys and offsets of given context.
+ * @param  Context context
+ */
+void AESOCB::Clear(Context& context) {
+    Clear(context.key); //clear round keys
+    volatile unsigned char* offsets[] = { context.lStar, context.lDollar, context.l[0] }; //write through volatile so key dependent offsets are really wiped
+    const size_t sizes[] = { sizeof(context.lStar), sizeof(context.lDollar), sizeof(context.l) }; //represents size of each offset array
+    for (size_t i = 0; i < 3; i++) //iterate over offset arrays
+        for (size_t j = 0; j < sizes[i]; j++) //iterate over bytes
+            offsets[i][j] = 0x00; //clear each byte
+}
+
+
+/**
+ * @brief  Function that encrypts and authenticates given buffer with given context, nonce and associated data and writes the tag.
+ * @brief  Input and output may be the same buffer, tag must have room for the tag size of the context.
+ * @param  Context context
+ * @param  const unsigned char* nonce
+ * @param  size_t nonceSize
+ * @param  const unsigned char* aad
+ * @param  size_t aadSize
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  unsigned char* tag
+ * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+ */
+void AESOCB::Encrypt(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* tag) {
+    AES_PROFILE_SCOPE("OCB-Encrypt", length); //profile OCB encryption
+    if (tag == NULL) //if tag is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid tag that matches AES OCB requirements."); //throw invalid argument
+    unsigned char fullTag[BlockSize]; //represents untruncated tag
+    Process(context, nonce, nonceSize, aad, aadSize, input, output, length, fullTag, true); //encrypt buffer and compute tag
+    memcpy(tag, fullTag, context.tagSize); //write tag truncated to tag size
+    fill(fullTag, fullTag + BlockSize, 0x00); //clear tag
+}
+
+
+/**
+ * @brief  Function that decrypts given buffer with given context, nonce and associated data and returns if given tag is authentic.
+ * @brief  Input and output may be the same buffer, output is cleared if the tag isn't authentic.
+ * @param  Context context
+ * @param  const unsigned char* nonce
+ * @param  size_t nonceSize
+ * @param  const unsigned char* aad
+ * @param  size_t aadSize
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  const unsigned char* tag
+ * @return  bool isAuthentic
+ * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+ */
+bool AESOCB::Decrypt(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, const unsigned char* tag) {
+    AES_PROFILE_SCOPE("OCB-Decrypt", length); //profile OCB decryption
+    if (tag == NULL) //if tag is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid tag that matches AES OCB requirements."); //throw invalid argument
+    unsigned char fullTag[BlockSize]; //represents untruncated tag
+    Process(context, nonce, nonceSize, aad, aadSize, input, output, length, fullTag, false); //decrypt buffer and compute tag
+    unsigned char difference = 0; //represents accumulated difference, compared in constant time
+    for (size_t i = 0; i < context.tagSize; i++) //iterate over tag
+        difference |= fullTag[i] ^ tag[i]; //accumulate difference of each byte
+    fill(fullTag, fullTag + BlockSize, 0x00); //clear tag
+    if (difference != 0) { //if tag isn't authentic we don't release the plaintext
+        fill(output, output + length, 0x00); //clear output
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief  Function that encrypts and authenticates given plaintext with given key, nonce and associated data and returns the ciphertext followed by a 16 byte tag.
+ * @param  vector<unsigned char> plainText
+ * @param  vector<unsigned char> key
+ * @param  vector<unsigned char> nonce
+ * @param  vector<unsigned char> aad
+ * @return  vector<unsigned char> cipherText
+ * @throws  invalid_argument thrown if given key or nonce is invalid.
+ */
+vector<unsigned char> AESOCB::Encrypt(const vector<unsigned char>& plainText, const vector<unsigned char>& key, const vector<unsigned char>& nonce, const vector<unsigned char>& aad) {
+    Context context = CreateContext(key); //expand key and offsets
+    try {
+        vector<unsigned char> cipherText(plainText.size() + BlockSize); //represents ciphertext followed by tag
+        Encrypt(context, nonce.data(), nonce.size(), aad.data(), aad.size(), plainText.data(), cipherText.data(), plainText.size(), cipherText.data() + plainText.size()); //encrypt plaintext and append tag
+        Clear(context); //clear round keys and offset table of context
+        return cipherText; //return ciphertext
+    }
+    catch (...) { //if encryption failed we clear round keys before rethrowing
+        Clear(context); //clear context of failed encryption
+        throw; //rethrow exception
+    }
+}
+
+
+/**
+ * @brief  Function that checks the 16 byte tag at the end of given ciphertext and returns the plaintext.
+ * @param  vector<unsigned char> cipherText
+ * @param  vector<unsigned char> key
+ * @param  vector<unsigned char> nonce
+ * @param  vector<unsigned char> aad
+ * @return  vector<unsigned char> plainText
+ * @throws  invalid_argument thrown if given ciphertext, key or nonce is invalid or the tag isn't authentic.
+ */
+vector<unsigned char> AESOCB::Decrypt(const vector<unsigned char>& cipherText, const vector<unsigned char>& key, const vector<unsigned char>& nonce, const vector<unsigned char>& aad) {
+    if (cipherText.size() < BlockSize) //if ciphertext can't hold a tag
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES OCB requirements."); //throw invalid argument
+    Context context = CreateContext(key); //expand key and offsets
+    try {
+        size_t length = cipherText.size() - BlockSize; //represents length of ciphertext without tag
+        vector<unsigned char> plainText(length); //represents plaintext
+        bool isAuthentic = Decrypt(context, nonce.data(), nonce.size(), aad.data(), aad.size(), cipherText.data(), plainText.data(), length, cipherText.data() + length); //decrypt ciphertext and check tag
+        Clear(context); //clear round keys and offset table of context
+        if (!isAuthentic) //if tag doesn't match the key, nonce or associated data is wrong or ciphertext was modified
+            throw invalid_argument("Invalid ciphertext, authentication failed."); //throw invalid argument
+        return plainText; //return plaintext
+    }
+    catch (...) { //if decryption failed we clear round keys before rethrowing
+        Clear(context); //clear context of failed decryption
+        throw; //rethrow exception
+    }
+}
+
+
+/**
+ * @brief  Function that doubles given block in GF(2^128) as specified in RFC 7253.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ */
+void AESOCB::Double(const unsigned char* input, unsigned char* output) {
+    unsigned char carry = input[0] >> 7; //represents most significant bit that is shifted out
+    for (size_t i = 0; i < BlockSize - 1; i++) //iterate over block except last byte
+        output[i] = (unsigned char)((input[i] << 1) | (input[i + 1] >> 7)); //shift left by one bit
+    output[BlockSize - 1] = (unsigned char)((input[BlockSize - 1] << 1) ^ (carry * 0x87)); //shift last byte and reduce modulo the field polynomial
+}
+
+
+/**
+ * @brief  Function that returns the number of trailing zero bits of given nonzero value.
+ * @param  uint64_t value
+ * @return  size_t count
+ */
+size_t AESOCB::TrailingZeros(const uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index; //represents index of lowest set bit
+    _BitScanForward64(&index, value); //find lowest set bit
+    return index; //return index
+#else
+    return (size_t)__builtin_ctzll(value); //count trailing zeros
+#endif
+}
+
+
+/**
+ * @brief  Function that sets given offset to the offset after given number of blocks, the XOR of L_i for every bit i set in the Gray code of the count.
+ * @param  Context context
+ * @param  const unsigned char* initial
+ * @param  uint64_t blocks
+ * @param  unsigned char* offset
+ */
+void AESOCB::OffsetAt(const Context& context, const unsigned char* initial, const uint64_t blocks, unsigned char* offset) {
+    memcpy(offset, initial, BlockSize); //start at initial offset
+    uint64_t gray = blocks ^ (blocks >> 1); //represents Gray code of block count, bit i flips once for each block index with i trailing zeros
+    for (size_t i = 0; gray != 0; i++, gray >>= 1) //iterate over bits of Gray code
+        if (gray & 1) //if bit is set
+            XOR(offset, context.l[i]); //XOR L_i into offset
+}
+
+
+/**
+ * @brief  Function that derives the initial offset of given nonce.
+ * @param  Context context
+ * @param  const unsigned char* nonce
+ * @param  size_t nonceSize
+ * @param  unsigned char* offset
+ */
+void AESOCB::InitialOffset(const Context& context, const unsigned char* nonce, const size_t nonceSize, unsigned char* offset) {
+    unsigned char block[BlockSize] = {}; //represents formatted nonce
+    block[0] = (unsigned char)(((context.tagSize * 8) % 128) << 1); //first 7 bits hold tag length in bits modulo 128
+    block[BlockSize - 1 - nonceSize] |= 0x01; //single one bit before nonce
+    memcpy(block + BlockSize - nonceSize, nonce, nonceSize); //nonce fills the end of the block
+    size_t bottom = block[BlockSize - 1] & 0x3F; //last 6 bits select the shift of the stretch
+    block[BlockSize - 1] &= 0xC0; //clear last 6 bits
+    unsigned char stretch[BlockSize + 8]; //represents Ktop followed by Ktop[1..64] XOR Ktop[9..72]
+    memcpy(stretch, block, BlockSize); //set Ktop to formatted nonce
+    EncryptBlock(stretch, context.key.roundKeys, context.key.rounds); //encrypt the block into Ktop
+    for (size_t i = 0; i < 8; i++) //iterate over stretch extension
+        stretch[BlockSize + i] = stretch[i] ^ stretch[i + 1]; //XOR Ktop with itself shifted by 8 bits
+    size_t bytes = bottom / 8, bits = bottom % 8; //represents shift in bytes and bits
+    for (size_t i = 0; i < BlockSize; i++) //iterate over offset
+        offset[i] = (unsigned char)((stretch[i + bytes] << bits) | (bits ? stretch[i + bytes + 1] >> (8 - bits) : 0)); //take 128 bits of stretch starting at bit bottom
+    fill(block, block + BlockSize, 0x00); //clear formatted nonce
+    fill(stretch, stretch + sizeof(stretch), 0x00); //clear stretch
+}
+
+
+/**
+ * @brief  Function that computes the hash of given associated data.
+ * @param  Context context
+ * @param  const unsigned char* aad
+ * @param  size_t aadSize
+ * @param  unsigned char* sum
+ */
+void AESOCB::Hash(const Context& context, const unsigned char* aad, const size_t aadSize, unsigned char* sum) {
+    alignas(16) unsigned char blocks[Interleave * BlockSize]; //represents group of blocks handed to the block cipher in a row
+    unsigned char offset[BlockSize] = {}; //represents offset of current block, starts at zero
+    size_t full = aadSize / BlockSize; //represents number of full blocks
+    memset(sum, 0x00, BlockSize); //start sum at zero
+    for (size_t i = 0; i < full; i += Interleave) { //iterate over groups of blocks
+        size_t count = min(full - i, Interleave); //calculate group size, last group may be shorter
+        for (size_t k = 0; k < count; k++) { //iterate over group
+            XOR(offset, context.l[TrailingZeros(i + k + 1)]); //advance offset by L of block index
+            memcpy(blocks + k * BlockSize, aad + (i + k) * BlockSize, BlockSize); //copy block
+            XOR(blocks + k * BlockSize, offset); //XOR block with offset
+        }
+        for (size_t k = 0; k < count; k++) //iterate over group, blocks are independent
+            EncryptBlock(blocks + k * BlockSize, context.key.roundKeys, context.key.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+        for (size_t k = 0; k < count; k++) //iterate over group
+            XOR(sum, blocks + k * BlockSize); //add encrypted block to sum
+    }
+    if (aadSize % BlockSize != 0) { //if associated data ends with a partial block
+        XOR(offset, context.lStar); //advance offset by L_*
+        memset(blocks, 0x00, BlockSize); //clear block
+        memcpy(blocks, aad + full * BlockSize, aadSize % BlockSize); //copy partial block
+        blocks[aadSize % BlockSize] = 0x80; //pad with a single one bit
+        XOR(blocks, offset); //XOR block with offset
+        EncryptBlock(blocks, context.key.roundKeys, context.key.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+        XOR(sum, blocks); //add encrypted block to sum
+    }
+    fill(blocks, blocks + sizeof(blocks), 0x00); //clear blocks
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given number of full blocks in interleaved groups and XORs their plaintext into given checksum.
+ * @brief  Offset holds the offset of the block before the first one and is updated to the offset of the last one.
+ * @param  Context context
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t blocks
+ * @param  uint64_t firstIndex
+ * @param  unsigned char* offset
+ * @param  unsigned char* checksum
+ * @param  bool encrypt
+ */
+void AESOCB::ProcessBlocks(const Context& context, const unsigned char* input, unsigned char* output, const size_t blocks, const uint64_t firstIndex, unsigned char* offset, unsigned char* checksum, const bool encrypt) {
+    alignas(16) unsigned char group[Interleave * BlockSize]; //represents group of blocks handed to the block cipher in a row
+    alignas(16) unsigned char offsets[Interleave * BlockSize]; //represents offset of each block of group
+    for (size_t i = 0; i < blocks; i += Interleave) { //iterate over groups of blocks
+        size_t count = min(blocks - i, Interleave); //calculate group size, last group may be shorter
+        const unsigned char* in = input + i * BlockSize; //represents input of group
+        for (size_t k = 0; k < count; k++) { //iterate over group
+            XOR(offset, context.l[TrailingZeros(firstIndex + i + k)]); //advance offset by L of block index
+            memcpy(offsets + k * BlockSize, offset, BlockSize); //keep offset of block
+            memcpy(group + k * BlockSize, in + k * BlockSize, BlockSize); //copy block before output may overwrite it
+            if (encrypt) //if we encrypt the checksum covers the input
+                XOR(checksum, group + k * BlockSize); //add plaintext block to checksum
+            XOR(group + k * BlockSize, offset); //XOR block with offset
+        }
+        for (size_t k = 0; k < count; k++) //iterate over group, blocks are independent
+            encrypt ? EncryptBlock(group + k * BlockSize, context.key.roundKeys, context.key.rounds) : DecryptBlock(group + k * BlockSize, context.key.roundKeys, context.key.rounds); //encrypt or decrypt the block using our AES functions using flat round keys
+        for (size_t k = 0; k < count; k++) { //iterate over group
+            XOR(group + k * BlockSize, offsets + k * BlockSize); //XOR block with offset
+            if (!encrypt) //if we decrypt the checksum covers the output
+                XOR(checksum, group + k * BlockSize); //add plaintext block to checksum
+        }
+        memcpy(output + i * BlockSize, group, count * BlockSize); //write group
+    }
+    fill(group, group + sizeof(group), 0x00); //clear group
+    fill(offsets, offsets + sizeof(offsets), 0x00); //clear offsets
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given buffer and writes its full 16 byte tag, full blocks are processed in parallel if the buffer is large enough.
+ * @param  Context context
+ * @param  const unsigned char* nonce
+ * @param  size_t nonceSize
+ * @param  const unsigned char* aad
+ * @param  size_t aadSize
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  unsigned char* tag
+ * @param  bool encrypt
+ * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+ */
+void AESOCB::Process(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* tag, const bool encrypt) {
+    if (context.key.rounds == 0) //if context wasn't created
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if (nonce == NULL || nonceSize == 0 || nonceSize >= BlockSize) //if nonce isn't between 1 and 15 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid nonce that matches AES OCB requirements."); //throw invalid argument
+    if ((length > 0 && (input == NULL || output == NULL)) || (aadSize > 0 && aad == NULL)) //if buffer or associated data is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES OCB requirements."); //throw invalid argument
+    unsigned char initial[BlockSize], offset[BlockSize], checksum[BlockSize] = {}, sum[BlockSize]; //represents initial offset, current offset, checksum and hash of associated data
+    InitialOffset(context, nonce, nonceSize, initial); //derive initial offset from nonce
+    const size_t blocks = length / BlockSize, fullLength = blocks * BlockSize; //represents number and length of full blocks
+    const size_t chunk = max(BlockSize, GetChunkSize() / BlockSize * BlockSize); //represents chunk size rounded down to full blocks
+    mutex checksumMutex; //guards checksum when chunks are processed in parallel
+    ForEachChunk(fullLength, chunk, [&](size_t start, size_t size) { //process each chunk of full blocks
+        unsigned char chunkOffset[BlockSize], chunkChecksum[BlockSize] = {}; //represents offset and checksum of chunk
+        OffsetAt(context, initial, start / BlockSize, chunkOffset); //derive offset of block before chunk from its index
+        ProcessBlocks(context, input + start, output + start, size / BlockSize, start / BlockSize + 1, chunkOffset, chunkChecksum, encrypt); //process chunk
+        lock_guard<mutex> lock(checksumMutex); //lock checksum
+        XOR(checksum, chunkChecksum); //add checksum of chunk, XOR is order independent
+    });
+    OffsetAt(context, initial, blocks, offset); //derive offset of last full block
+    const size_t remainder = length % BlockSize; //represents length of partial block
+    if (remainder != 0) { //if buffer ends with a partial block
+        XOR(offset, context.lStar); //advance offset by L_*
+        unsigned char pad[BlockSize], last[BlockSize] = {}; //represents keystream pad and padded plaintext of partial block
+        memcpy(pad, offset, BlockSize); //set pad to offset
+        EncryptBlock(pad, context.key.roundKeys, context.key.rounds); //encrypt the offset into pad
+        for (size_t i = 0; i < remainder; i++) { //iterate over partial block
+            unsigned char byte = input[fullLength + i] ^ pad[i]; //perform byte XOR between input and pad
+            last[i] = encrypt ? input[fullLength + i] : byte; //keep plaintext byte for checksum
+            output[fullLength + i] = byte; //write output byte
+        }
+        last[remainder] = 0x80; //pad plaintext with a single one bit
+        XOR(checksum, last); //add padded plaintext to checksum
+        fill(pad, pad + BlockSize, 0x00); //clear pad
+        fill(last, last + BlockSize, 0x00); //clear padded plaintext
+    }
+    XOR(checksum, offset); //XOR checksum with final offset
+    XOR(checksum, context.lDollar); //XOR checksum with L_$
+    EncryptBlock(checksum, context.key.roundKeys, context.key.rounds); //encrypt checksum into tag
+    Hash(context, aad, aadSize, sum); //hash associated data
+    XOR(checksum, sum); //XOR tag with hash
+    memcpy(tag, checksum, BlockSize); //write full tag
+    fill(initial, initial + BlockSize, 0x00); //clear initial offset
+    fill(offset, offset + BlockSize, 0x00); //clear offset
+    fill(checksum, checksum + BlockSize, 0x00); //clear checksum
+    fill(sum, sum + BlockSize, 0x00); //clear sum
+}
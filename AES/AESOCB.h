@@ -0,0 +1,180 @@
+#ifndef _AESOCB_H
+#define _AESOCB_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+
+/**
+ * @file AESOCB.h
+ * @brief  AESOCB class for OCB3 authenticated encryption with associated data as specified in RFC 7253.
+ * @brief  OCB needs about one block cipher call per block and no field multiplication, so it authenticates at close to ECB speed on hosts without carry-less multiply.
+ * @brief  A Context holds the expanded round keys and the precomputed L table of offsets, so a key is prepared once and reused for every message.
+ * @brief  Blocks are processed in interleaved groups, the offset of any block is derived directly from its index, so large messages are split over the AESParallel worker pool.
+ */
+class AESOCB : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents the number of precomputed L values, enough for the index of any block.
+	 */
+	static const size_t LTableSize = 64;
+
+	/**
+	 * @brief  Represents an expanded OCB key with its precomputed offsets.
+	 */
+	struct Context {
+		KeyContext key; //expanded round keys
+		alignas(16) unsigned char lStar[16] = {}; //L_* = ENCIPHER(K, zeros(128))
+		alignas(16) unsigned char lDollar[16] = {}; //L_$ = double(L_*)
+		alignas(16) unsigned char l[LTableSize][16] = {}; //L_i = double(L_{i-1}) with L_0 = double(L_$)
+		size_t tagSize = 16; //tag size in bytes
+	};
+
+	using AESKeyBatch::Clear;
+
+	/**
+	 * @brief  Function that expands given key and precomputes its offsets into a new context.
+	 * @param  vector<unsigned char> key
+	 * @param  size_t tagSize
+	 * @return  Context context
+	 * @throws  invalid_argument thrown if given key or tag size is invalid.
+	 */
+	static Context CreateContext(const vector<unsigned char>& key, const size_t tagSize = 16);
+
+	/**
+	 * @brief  Function that clears the round keys and offsets of given context.
+	 * @param  Context context
+	 */
+	static void Clear(Context& context);
+
+	/**
+	 * @brief  Function that encrypts and authenticates given buffer with given context, nonce and associated data and writes the tag.
+	 * @brief  Input and output may be the same buffer, tag must have room for the tag size of the context.
+	 * @param  Context context
+	 * @param  const unsigned char* nonce
+	 * @param  size_t nonceSize
+	 * @param  const unsigned char* aad
+	 * @param  size_t aadSize
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  unsigned char* tag
+	 * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+	 */
+	static void Encrypt(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* tag);
+
+	/**
+	 * @brief  Function that decrypts given buffer with given context, nonce and associated data and returns if given tag is authentic.
+	 * @brief  Input and output may be the same buffer, output is cleared if the tag isn't authentic.
+	 * @param  Context context
+	 * @param  const unsigned char* nonce
+	 * @param  size_t nonceSize
+	 * @param  const unsigned char* aad
+	 * @param  size_t aadSize
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  const unsigned char* tag
+	 * @return  bool isAuthentic
+	 * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+	 */
+	static bool Decrypt(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, const unsigned char* tag);
+
+	/**
+	 * @brief  Function that encrypts and authenticates given plaintext with given key, nonce and associated data and returns the ciphertext followed by a 16 byte tag.
+	 * @param  vector<unsigned char> plainText
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> nonce
+	 * @param  vector<unsigned char> aad
+	 * @return  vector<unsigned char> cipherText
+	 * @throws  invalid_argument thrown if given key or nonce is invalid.
+	 */
+	static vector<unsigned char> Encrypt(const vector<unsigned char>& plainText, const vector<unsigned char>& key, const vector<unsigned char>& nonce, const vector<unsigned char>& aad = vector<unsigned char>());
+
+	/**
+	 * @brief  Function that checks the 16 byte tag at the end of given ciphertext and returns the plaintext.
+	 * @param  vector<unsigned char> cipherText
+	 * @param  vector<unsigned char> key
+	 * @param  vector<unsigned char> nonce
+	 * @param  vector<unsigned char> aad
+	 * @return  vector<unsigned char> plainText
+	 * @throws  invalid_argument thrown if given ciphertext, key or nonce is invalid or the tag isn't authentic.
+	 */
+	static vector<unsigned char> Decrypt(const vector<unsigned char>& cipherText, const vector<unsigned char>& key, const vector<unsigned char>& nonce, const vector<unsigned char>& aad = vector<unsigned char>());
+
+protected:
+	/**
+	 * @brief  Represents the number of independent blocks handed to the block cipher in a row.
+	 */
+	static const size_t Interleave = 8;
+
+	/**
+	 * @brief  Function that doubles given block in GF(2^128) as specified in RFC 7253.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 */
+	static void Double(const unsigned char* input, unsigned char* output);
+
+	/**
+	 * @brief  Function that returns the number of trailing zero bits of given nonzero value.
+	 * @param  uint64_t value
+	 * @return  size_t count
+	 */
+	static size_t TrailingZeros(const uint64_t value);
+
+	/**
+	 * @brief  Function that sets given offset to the offset after given number of blocks, the XOR of L_i for every bit i set in the Gray code of the count.
+	 * @param  Context context
+	 * @param  const unsigned char* initial
+	 * @param  uint64_t blocks
+	 * @param  unsigned char* offset
+	 */
+	static void OffsetAt(const Context& context, const unsigned char* initial, const uint64_t blocks, unsigned char* offset);
+
+	/**
+	 * @brief  Function that derives the initial offset of given nonce.
+	 * @param  Context context
+	 * @param  const unsigned char* nonce
+	 * @param  size_t nonceSize
+	 * @param  unsigned char* offset
+	 */
+	static void InitialOffset(const Context& context, const unsigned char* nonce, const size_t nonceSize, unsigned char* offset);
+
+	/**
+	 * @brief  Function that computes the hash of given associated data.
+	 * @param  Context context
+	 * @param  const unsigned char* aad
+	 * @param  size_t aadSize
+	 * @param  unsigned char* sum
+	 */
+	static void Hash(const Context& context, const unsigned char* aad, const size_t aadSize, unsigned char* sum);
+
+	/**
+	 * @brief  Function that encrypts or decrypts given number of full blocks in interleaved groups and XORs their plaintext into given checksum.
+	 * @brief  Offset holds the offset of the block before the first one and is updated to the offset of the last one.
+	 * @param  Context context
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t blocks
+	 * @param  uint64_t firstIndex
+	 * @param  unsigned char* offset
+	 * @param  unsigned char* checksum
+	 * @param  bool encrypt
+	 */
+	static void ProcessBlocks(const Context& context, const unsigned char* input, unsigned char* output, const size_t blocks, const uint64_t firstIndex, unsigned char* offset, unsigned char* checksum, const bool encrypt);
+
+	/**
+	 * @brief  Function that encrypts or decrypts given buffer and writes its full 16 byte tag, full blocks are processed in parallel if the buffer is large enough.
+	 * @param  Context context
+	 * @param  const unsigned char* nonce
+	 * @param  size_t nonceSize
+	 * @param  const unsigned char* aad
+	 * @param  size_t aadSize
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  unsigned char* tag
+	 * @param  bool encrypt
+	 * @throws  invalid_argument thrown if given context, nonce or buffer is invalid.
+	 */
+	static void Process(const Context& context, const unsigned char* nonce, const size_t nonceSize, const unsigned char* aad, const size_t aadSize, const unsigned char* input, unsigned char* output, const size_t length, unsigned char* tag, const bool encrypt);
+};
+#endif
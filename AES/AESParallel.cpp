@@ -0,0 +1,881 @@
+#include "AESParallel.h"
+#include "AESProfiler.h"
+#include <cstring>
+#include <cstdlib>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AES_PARALLEL_STREAMING //non-temporal stores and prefetch are available
+#endif
+
+
+//initialize worker pool and default parallel settings
+vector<thread> AESParallel::workers;
+deque<shared_ptr<AESParallel::Job>> AESParallel::jobs[PriorityCount];
+size_t AESParallel::workerLimits[PriorityCount] = {}; //no worker limits by default
+size_t AESParallel::runningWorkers[PriorityCount] = {};
+thread_local AESParallel::Priority AESParallel::priority = Normal; //threads start with normal priority
+mutex AESParallel::poolMutex;
+condition_variable AESParallel::poolCondition;
+condition_variable AESParallel::doneCondition;
+bool AESParallel::stopWorkers = false;
+atomic<size_t> AESParallel::threadCount{ thread::hardware_concurrency() ? thread::hardware_concurrency() : 1 }; //default to number of hardware threads
+atomic<size_t> AESParallel::parallelThreshold{ 256 * 1024 }; //default to 256 KB so small buffers don't pay for thread wake up
+atomic<size_t> AESParallel::chunkSize{ 64 * 1024 }; //default to 64 KB so chunk fits in L2 cache
+atomic<size_t> AESParallel::streamingThreshold{ 32 * 1024 * 1024 }; //default to 32 MB so only buffers larger than a typical last level cache bypass it
+
+
+/**
+ * @brief  Function that sets the number of threads used for parallel operations, including the calling thread.
+ * @brief  Zero sets the number of hardware threads.
+ * @param  size_t threadCount
+ */
+void AESParallel::SetThreadCount(const size_t threadCount) {
+    StopWorkers(); //stop current workers, new workers are started on next parallel operation
+    size_t count = threadCount ? threadCount : thread::hardware_concurrency(); //use number of hardware threads if zero given
+    AESParallel::threadCount = count ? count : 1; //set thread count, at least the calling thread
+    bool isPending = false; //represents if detached tasks are still queued
+    {
+        lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+        for (size_t i = 0; i < PriorityCount; i++) //iterate over priority classes
+            isPending = isPending || !jobs[i].empty(); //check queue of each class
+    }
+    if (isPending) //if tasks were queued while workers stopped we restart workers so they finish
+        StartWorkers(1);
+}
+
+
+/**
+ * @brief  Function that returns the number of threads used for parallel operations, including the calling thread.
+ * @return  size_t threadCount
+ */
+size_t AESParallel::GetThreadCount() {
+    return threadCount; //return thread count
+}
+
+
+/**
+ * @brief  Function that sets the buffer size in bytes from which operations are processed in parallel.
+ * @param  size_t threshold
+ */
+void AESParallel::SetParallelThreshold(const size_t threshold) {
+    parallelThreshold = threshold; //set parallel threshold
+}
+
+
+/**
+ * @brief  Function that returns the buffer size in bytes from which operations are processed in parallel.
+ * @return  size_t threshold
+ */
+size_t AESParallel::GetParallelThreshold() {
+    return parallelThreshold; //return parallel threshold
+}
+
+
+/**
+ * @brief  Function that sets the chunk size in bytes that each worker processes at a time, rounded down to a multiple of 16 bytes.
+ * @param  size_t chunkSize
+ * @throws  invalid_argument thrown if given chunkSize is smaller than 16 bytes.
+ */
+void AESParallel::SetChunkSize(const size_t chunkSize) {
+    if (chunkSize < BlockSize) //if chunk size is smaller than a single block
+        throw invalid_argument("Invalid chunk size, please provide chunk size of at least 16 bytes."); //throw invalid argument
+    AESParallel::chunkSize = chunkSize - (chunkSize % BlockSize); //set chunk size rounded down to a multiple of block size
+}
+
+
+/**
+ * @brief  Function that returns the chunk size in bytes that each worker processes at a time.
+ * @return  size_t chunkSize
+ */
+size_t AESParallel::GetChunkSize() {
+    return chunkSize; //return chunk size
+}
+
+
+/**
+ * @brief  Function that sets the buffer size in bytes from which out of place ECB, CTR and CBC decryption write output with non-temporal stores, zero disables them.
+ * @brief  Non-temporal stores bypass the cache, so huge buffers don't evict the working set of other threads and aren't read before they're written.
+ * @param  size_t threshold
+ */
+void AESParallel::SetStreamingThreshold(const size_t threshold) {
+    streamingThreshold = threshold; //set streaming threshold
+}
+
+
+/**
+ * @brief  Function that returns the buffer size in bytes from which out of place ECB, CTR and CBC decryption write output with non-temporal stores, zero if disabled.
+ * @return  size_t threshold
+ */
+size_t AESParallel::GetStreamingThreshold() {
+    return streamingThreshold; //return streaming threshold
+}
+
+
+/**
+ * @brief  Function that sets the priority of parallel operations started on the calling thread, Normal by default.
+ * @brief  Workers running a job take its priority, so operations they start inherit it.
+ * @param  Priority priority
+ * @throws  invalid_argument thrown if given priority is invalid.
+ */
+void AESParallel::SetPriority(const Priority priority) {
+    if ((size_t)priority >= PriorityCount) //if priority is out of range
+        throw invalid_argument("Invalid priority, please provide High, Normal or Low priority."); //throw invalid argument
+    AESParallel::priority = priority; //set priority of calling thread
+}
+
+
+/**
+ * @brief  Function that returns the priority of parallel operations started on the calling thread.
+ * @return  Priority priority
+ */
+AESParallel::Priority AESParallel::GetPriority() {
+    return priority; //return priority of calling thread
+}
+
+
+/**
+ * @brief  Function that sets the maximal number of workers that run jobs of given priority at the same time, zero for no limit.
+ * @brief  The calling thread of an operation always works on its own job, so operations progress even if their class is at its limit.
+ * @param  Priority priority
+ * @param  size_t workerLimit
+ * @throws  invalid_argument thrown if given priority is invalid.
+ */
+void AESParallel::SetWorkerLimit(const Priority priority, const size_t workerLimit) {
+    if ((size_t)priority >= PriorityCount) //if priority is out of range
+        throw invalid_argument("Invalid priority, please provide High, Normal or Low priority."); //throw invalid argument
+    {
+        lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+        workerLimits[priority] = workerLimit; //set worker limit of class
+    }
+    poolCondition.notify_all(); //wake up workers in case the limit was raised
+}
+
+
+/**
+ * @brief  Function that returns the maximal number of workers that run jobs of given priority at the same time, zero for no limit.
+ * @param  Priority priority
+ * @return  size_t workerLimit
+ * @throws  invalid_argument thrown if given priority is invalid.
+ */
+size_t AESParallel::GetWorkerLimit(const Priority priority) {
+    if ((size_t)priority >= PriorityCount) //if priority is out of range
+        throw invalid_argument("Invalid priority, please provide High, Normal or Low priority."); //throw invalid argument
+    lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+    return workerLimits[priority]; //return worker limit of class
+}
+
+
+/**
+ * @brief  Function that starts the worker threads if they aren't running.
+ * @brief  At least given number of workers is started even if the thread count is lower, detached tasks need a worker to run on.
+ * @param  size_t minimumWorkers
+ */
+void AESParallel::StartWorkers(const size_t minimumWorkers) {
+    static once_flag exitFlag; //flag for registering StopWorkers once
+    call_once(exitFlag, []() { atexit(StopWorkers); }); //join workers at exit so threads aren't destroyed while running
+    lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+    if (stopWorkers) //if workers are being stopped we don't start new ones, SetThreadCount restarts them
+        return;
+    while (workers.size() + 1 < threadCount || workers.size() < minimumWorkers) //start workers until we reach thread count, calling thread counts as one
+        workers.emplace_back(WorkerLoop); //start new worker
+}
+
+
+/**
+ * @brief  Function that adds given task to the end of the worker queue and returns without waiting for it.
+ * @brief  At least one worker is started, so the task never runs on the calling thread, exceptions thrown by the task are ignored.
+ * @param  function<void()> task
+ */
+void AESParallel::Submit(const function<void()>& task) {
+    StartWorkers(1); //start workers if they aren't running, at least one so the task can run
+    shared_ptr<Job> job = make_shared<Job>(); //create new detached job
+    job->ownedTask = [task](size_t) { task(); }; //job owns its task since nobody waits for it
+    job->task = &job->ownedTask; //set task of job
+    job->count = 1; //detached task runs once
+    job->priority = priority; //job has priority of calling thread
+    Enqueue(job); //add job to end of queue of its class
+}
+
+
+/**
+ * @brief  Function that stops and joins the worker threads.
+ */
+void AESParallel::StopWorkers() {
+    vector<thread> stoppedWorkers; //represents workers that we join
+    {
+        lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+        stopWorkers = true; //tell workers to exit
+        stoppedWorkers.swap(workers); //take workers from pool
+    }
+    poolCondition.notify_all(); //wake up all workers so they can exit
+    for (thread& worker : stoppedWorkers) //iterate over workers
+        worker.join(); //wait for each worker to exit
+    lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+    stopWorkers = false; //allow new workers to start
+}
+
+
+/**
+ * @brief  Function that runs on each worker thread and waits for jobs.
+ */
+void AESParallel::WorkerLoop() {
+    unique_lock<mutex> lock(poolMutex); //lock pool for worker
+    shared_ptr<Job> job; //represents job we work on
+    while (true) { //wait for jobs until told to exit
+        poolCondition.wait(lock, [&job]() { return stopWorkers || (job = NextJob()) != NULL; }); //wait for new job or exit
+        if (stopWorkers) //if told to exit
+            return; //exit worker
+        runningWorkers[job->priority]++; //count worker in class of job
+        lock.unlock(); //unlock pool while we run the job
+        priority = job->priority; //operations started by the job inherit its priority
+        RunJob(job, 1); //claim and run a single index, so a higher priority job can take over after each chunk
+        lock.lock(); //lock pool again
+        if (runningWorkers[job->priority]-- == workerLimits[job->priority]) //uncount worker even without a limit so a later limit sees the real count, if class was at its limit another worker may take its jobs now
+            poolCondition.notify_one(); //wake up a worker
+        job.reset(); //release job
+    }
+}
+
+
+/**
+ * @brief  Function that returns the first job with unclaimed indexes of the highest priority class that is below its worker limit, removes finished jobs on the way.
+ * @brief  Must be called with the pool mutex locked.
+ * @return  shared_ptr<Job> job
+ */
+shared_ptr<AESParallel::Job> AESParallel::NextJob() {
+    for (size_t i = 0; i < PriorityCount; i++) { //iterate over priority classes from highest to lowest
+        while (!jobs[i].empty() && jobs[i].front()->next >= jobs[i].front()->count) //while first job has all indexes claimed
+            jobs[i].pop_front(); //remove job from queue
+        if (!jobs[i].empty() && (workerLimits[i] == 0 || runningWorkers[i] < workerLimits[i])) //if class has a job and is below its limit
+            return jobs[i].front(); //return first job of class
+    }
+    return NULL; //no job available
+}
+
+
+/**
+ * @brief  Function that returns the first ParallelFor job with unclaimed indexes whose priority is given priority or higher, for callers that wait for their own job.
+ * @brief  Detached jobs are never stolen since they may resume coroutines. Must be called with the pool mutex locked.
+ * @param  Priority lowestPriority
+ * @return  shared_ptr<Job> job
+ */
+shared_ptr<AESParallel::Job> AESParallel::StealJob(const Priority lowestPriority) {
+    for (size_t i = 0; i <= (size_t)lowestPriority; i++) //iterate over priority classes from highest to given priority
+        for (const shared_ptr<Job>& job : jobs[i]) //iterate over queue of class
+            if (!job->ownedTask && job->next < job->count) //if job belongs to a waiting caller and has unclaimed indexes
+                return job; //return job
+    return NULL; //nothing to steal
+}
+
+
+/**
+ * @brief  Function that adds given job to the queue of its priority class.
+ * @param  shared_ptr<Job> job
+ */
+void AESParallel::Enqueue(const shared_ptr<Job>& job) {
+    {
+        lock_guard<mutex> lock(poolMutex); //lock pool for calling thread
+        jobs[job->priority].push_back(job); //add job to end of queue of its class
+    }
+    poolCondition.notify_all(); //wake up workers
+}
+
+
+/**
+ * @brief  Function that claims and runs indexes of given job until no index is left or given number of indexes is run.
+ * @param  shared_ptr<Job> job
+ * @param  size_t maxIndexes
+ */
+void AESParallel::RunJob(const shared_ptr<Job>& job, const size_t maxIndexes) {
+    size_t runIndexes = 0; //represents number of indexes we ran
+    for (size_t i = job->next++; i < job->count; i = job->next++) { //claim next index until no index is left
+        try {
+            AES_PROFILE_WORKER(job->profileScope); //add counters of index to scope of caller when AES_PROFILE is defined
+            (*job->task)(i); //run task on claimed index
+        }
+        catch (...) { //if task threw an exception we save it for the caller
+            lock_guard<mutex> lock(job->errorMutex); //lock error of job
+            if (!job->error) job->error = current_exception(); //save first exception
+        }
+        if (++job->done == job->count) { //if this was the last index of job we notify the caller
+            lock_guard<mutex> lock(poolMutex); //lock pool so caller can't miss the notification
+            doneCondition.notify_all(); //notify caller
+        }
+        if (++runIndexes == maxIndexes) //if we ran enough indexes we stop claiming
+            break;
+    }
+}
+
+
+/**
+ * @brief  Function that runs given task for each index in range [0, count) using the worker pool and the calling thread.
+ * @brief  Returns after all indexes are processed, rethrows the first exception thrown by the task.
+ * @param  size_t count
+ * @param  function<void(size_t)> task
+ */
+void AESParallel::ParallelFor(const size_t count, const function<void(size_t)>& task) {
+    if (count <= 1 || threadCount <= 1) { //if there's nothing to split we run the task on calling thread
+        for (size_t i = 0; i < count; i++) //iterate over indexes
+            task(i); //run task on each index
+        return;
+    }
+    StartWorkers(); //start workers if they aren't running
+    shared_ptr<Job> job = make_shared<Job>(); //create new job
+    job->task = &task; //set task of job
+    job->count = count; //set number of indexes of job
+    job->priority = priority; //job has priority of calling thread
+    job->profileScope = AES_PROFILE_CURRENT(); //workers measure indexes for profiled scope of calling thread
+    Enqueue(job); //add job to queue of its class
+    RunJob(job); //calling thread claims indexes too
+    {
+        unique_lock<mutex> lock(poolMutex); //lock pool for calling thread
+        while (job->done != job->count) { //while workers still run indexes of our job we steal work instead of idling
+            shared_ptr<Job> stolenJob = StealJob(job->priority); //represents queued job we help with
+            if (stolenJob == NULL) { //if there's nothing to steal we wait for our job
+                doneCondition.wait(lock); //wait until a job finishes
+                continue;
+            }
+            lock.unlock(); //unlock pool while we run the stolen index
+            Priority callerPriority = priority; //save priority of calling thread
+            priority = stolenJob->priority; //operations started by the stolen job inherit its priority
+            RunJob(stolenJob, 1); //run a single index so we return soon after our job finishes
+            priority = callerPriority; //restore priority of calling thread
+            lock.lock(); //lock pool again
+        }
+        deque<shared_ptr<Job>>& queue = jobs[job->priority]; //represents queue of job's class
+        for (deque<shared_ptr<Job>>::iterator it = queue.begin(); it != queue.end(); ++it) { //iterate over queue
+            if (*it == job) { //if job is still in queue
+                queue.erase(it); //remove job from queue
+                break;
+            }
+        }
+    }
+    if (job->error) //if task threw an exception
+        rethrow_exception(job->error); //rethrow exception on calling thread
+}
+
+
+/**
+ * @brief  Function that splits given length into chunks of given size and runs given task on each chunk with its offset and size.
+ * @brief  Chunks are processed in parallel if length reaches the threshold, otherwise the whole length is one chunk at offset zero.
+ * @param  size_t length
+ * @param  size_t chunk
+ * @param  function<void(size_t, size_t)> task
+ */
+void AESParallel::ForEachChunk(const size_t length, const size_t chunk, const function<void(size_t, size_t)>& task) {
+    if (length == 0) //if there's nothing to process
+        return;
+    if (length < parallelThreshold || threadCount <= 1) { //if length is below threshold we process it on calling thread
+        task(0, length); //process whole length as one chunk
+        return;
+    }
+    ParallelFor((length + chunk - 1) / chunk, [&](size_t index) { //process each chunk in parallel
+        size_t offset = index * chunk; //calculate chunk offset
+        task(offset, min(chunk, length - offset)); //process chunk
+    });
+}
+
+
+/**
+ * @brief  Function that validates key and iv and returns the round keys of given key.
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @param  string mode
+ * @return  vector<vector<unsigned char>> roundKeys
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+vector<vector<unsigned char>> AESParallel::Prepare(const vector<unsigned char>& key, const unsigned char* iv, const string& mode) {
+    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
+    if (mode != "ECB" && iv == NULL) //if IV is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + mode + " requirements."); //throw invalid argument
+    return KeySchedule(key); //call our KeySchedule function for generating round keys
+}
+
+
+/**
+ * @brief  Function that adds given number of blocks to the counter in the lower 64 bits of the iv.
+ * @param  unsigned char* counter
+ * @param  uint64_t blocks
+ */
+void AESParallel::AddCounter(unsigned char* counter, const uint64_t blocks) {
+    uint64_t value = 0; //represents lower 64 bits of counter
+    for (size_t i = BlockSize / 2; i < BlockSize; i++) //iterate over lower half of counter in big endian order
+        value = (value << 8) | counter[i]; //add each byte to value
+    value += blocks; //add blocks to counter, wraps around like AES Encrypt_CTR
+    for (size_t i = BlockSize; i-- > BlockSize / 2;) { //iterate over lower half of counter from end to start
+        counter[i] = (unsigned char)(value & 0xFF); //set each byte of counter
+        value >>= 8; //move to next byte
+    }
+}
+
+
+/**
+ * @brief  Function that returns if output of given buffer should be written with non-temporal stores.
+ * @brief  Requires an out of place buffer of at least the streaming threshold with output aligned to 16 bytes, and a processor with SSE2.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  bool isStreaming
+ */
+bool AESParallel::IsStreaming(const unsigned char* input, const unsigned char* output, const size_t length) {
+#ifdef AES_PARALLEL_STREAMING
+    size_t threshold = streamingThreshold; //read threshold once
+    return threshold > 0 && length >= threshold && input != output && (uintptr_t)output % BlockSize == 0; //stream only large, aligned, out of place buffers
+#else
+    (void)input; (void)output; (void)length; //unused without SSE2
+    return false; //non-temporal stores aren't available on this architecture
+#endif
+}
+
+
+/**
+ * @brief  Function that stores given block in given output, with a non-temporal store that bypasses the cache if streaming.
+ * @param  unsigned char* output
+ * @param  const unsigned char* block
+ * @param  bool streaming
+ */
+void AESParallel::StoreBlock(unsigned char* output, const unsigned char* block, const bool streaming) {
+#ifdef AES_PARALLEL_STREAMING
+    if (streaming) { //if streaming we store the block around the cache, output is aligned to 16 bytes
+        _mm_stream_si128((__m128i*)output, _mm_loadu_si128((const __m128i*)block)); //non-temporal store of block
+        return;
+    }
+#endif
+    (void)streaming; //unused without SSE2
+    memcpy(output, block, BlockSize); //regular store of block
+}
+
+
+/**
+ * @brief  Function that prefetches the input at prefetch distance ahead of given position and bypasses the cache if streaming.
+ * @param  const unsigned char* position
+ * @param  bool streaming
+ */
+void AESParallel::PrefetchAhead(const unsigned char* position, const bool streaming) {
+#ifdef AES_PARALLEL_STREAMING
+    if (streaming) //if streaming we load input ahead of time with minimal cache pollution, prefetching past the end never faults
+        _mm_prefetch((const char*)(position + PrefetchDistance), _MM_HINT_NTA); //prefetch input ahead
+#endif
+    (void)position; (void)streaming; //unused without SSE2
+}
+
+
+/**
+ * @brief  Function that makes non-temporal stores of the calling thread visible to other threads, must be called after streaming a chunk.
+ * @param  bool streaming
+ */
+void AESParallel::StreamFence(const bool streaming) {
+#ifdef AES_PARALLEL_STREAMING
+    if (streaming) //if we streamed the output
+        _mm_sfence(); //order non-temporal stores before the chunk is reported as done
+#endif
+    (void)streaming; //unused without SSE2
+}
+
+
+/**
+ * @brief  Function that performs CTR mode on given range of buffer starting with given counter block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  const unsigned char* counter
+ */
+void AESParallel::CTRRange(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, const unsigned char* counter, const bool streaming) {
+    unsigned char currentCounter[BlockSize]; //represents current counter block
+    unsigned char keystream[BlockSize]; //represents current keystream block
+    memcpy(currentCounter, counter, BlockSize); //initialize current counter with given counter
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over range
+        PrefetchAhead(input + i, streaming); //prefetch input ahead when streaming
+        memcpy(keystream, currentCounter, BlockSize); //set keystream to current counter for encryption
+        EncryptBlock(keystream, roundKeys); //encrypt the counter using our AES EncryptBlock function using round keys
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last block may be partial
+        if (size == BlockSize) { //if block is full we XOR it at once and store it
+            XOR(keystream, input + i); //perform XOR between keystream and input block
+            StoreBlock(output + i, keystream, streaming); //store output block, around the cache when streaming
+        }
+        else //else last block is partial
+            for (size_t j = 0; j < size; j++) //iterate over block
+                output[i + j] = input[i + j] ^ keystream[j]; //perform byte XOR between input and keystream block
+        AddCounter(currentCounter, 1); //increase counter for next block
+    }
+    StreamFence(streaming); //make streamed output visible before the range is reported as done
+    fill(keystream, keystream + BlockSize, 0x00); //clear keystream of last counter
+}
+
+
+/**
+ * @brief  Function that performs ECB mode on given buffer using given round keys, in parallel if length reaches the threshold.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  bool encrypt
+ */
+void AESParallel::ECBBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, const bool encrypt) {
+    const bool streaming = IsStreaming(input, output, length); //represents if output bypasses the cache
+    ForEachChunk(length, chunkSize, [&](size_t offset, size_t size) { //process each chunk
+        unsigned char block[BlockSize]; //represents current block
+        for (size_t i = offset; i < offset + size; i += BlockSize) { //iterate over chunk
+            PrefetchAhead(input + i, streaming); //prefetch input ahead when streaming
+            memcpy(block, input + i, BlockSize); //copy block, input and output may be the same buffer
+            if (encrypt) //if we encrypt
+                EncryptBlock(block, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
+            else //else we decrypt
+                DecryptBlock(block, roundKeys); //decrypt the block using our AES DecryptBlock function using round keys
+            StoreBlock(output + i, block, streaming); //store output block, around the cache when streaming
+        }
+        StreamFence(streaming); //make streamed output visible before the chunk is reported as done
+    });
+}
+
+
+/**
+ * @brief  Function that performs CBC encryption on given buffer using given round keys, updates iv with last cipher block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::CBCEncryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over buffer
+        for (size_t j = 0; j < BlockSize; j++) //iterate over block
+            output[i + j] = input[i + j] ^ iv[j]; //XOR with current cipher block
+        EncryptBlock(output + i, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
+        memcpy(iv, output + i, BlockSize); //update current cipher block with new cipher block
+    }
+}
+
+
+/**
+ * @brief  Function that performs CBC decryption on given buffer using given round keys, in parallel if length reaches the threshold.
+ * @brief  Updates iv with last cipher block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::CBCDecryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    if (length == 0) return; //nothing to decrypt, IV stays the same
+    const size_t chunk = chunkSize; //read chunk size once so chunk offsets match saved cipher blocks
+    vector<unsigned char> previousCiphers(((length + chunk - 1) / chunk) * BlockSize); //represents cipher block before each chunk, saved before chunks are decrypted in place
+    for (size_t offset = 0; offset < length; offset += chunk) //iterate over chunk offsets
+        memcpy(previousCiphers.data() + (offset / chunk) * BlockSize, offset == 0 ? iv : input + offset - BlockSize, BlockSize); //save cipher block before chunk
+    memcpy(iv, input + length - BlockSize, BlockSize); //update IV with last cipher block for next call
+    const bool streaming = IsStreaming(input, output, length); //represents if output bypasses the cache
+    ForEachChunk(length, chunk, [&](size_t offset, size_t size) { //process each chunk
+        unsigned char previousCipher[BlockSize]; //represents previous cipher block
+        unsigned char currentCipher[BlockSize]; //represents current cipher block
+        unsigned char block[BlockSize]; //represents current block
+        memcpy(previousCipher, previousCiphers.data() + (offset / chunk) * BlockSize, BlockSize); //initialize previous cipher block of chunk
+        for (size_t i = offset; i < offset + size; i += BlockSize) { //iterate over chunk
+            PrefetchAhead(input + i, streaming); //prefetch input ahead when streaming
+            memcpy(currentCipher, input + i, BlockSize); //save current cipher block before it's decrypted in place
+            memcpy(block, currentCipher, BlockSize); //copy block for decryption
+            DecryptBlock(block, roundKeys); //decrypt the block using our AES DecryptBlock function using round keys
+            XOR(block, previousCipher); //XOR with previous cipher block
+            StoreBlock(output + i, block, streaming); //store output block, around the cache when streaming
+            memcpy(previousCipher, currentCipher, BlockSize); //update previous cipher block with current cipher block
+        }
+        StreamFence(streaming); //make streamed output visible before the chunk is reported as done
+    });
+}
+
+
+/**
+ * @brief  Function that performs CFB encryption on given buffer using given round keys, updates iv with last full cipher block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::CFBEncryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    unsigned char keystream[BlockSize]; //represents current keystream block
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over buffer
+        memcpy(keystream, iv, BlockSize); //set keystream to previous cipher block for encryption
+        EncryptBlock(keystream, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last block may be partial
+        for (size_t j = 0; j < size; j++) //iterate over block
+            output[i + j] = input[i + j] ^ keystream[j]; //perform byte XOR between input and keystream block
+        if (size == BlockSize) //if block is full we use it as next previous cipher block
+            memcpy(iv, output + i, BlockSize); //update previous cipher block
+    }
+    fill(keystream, keystream + BlockSize, 0x00); //clear keystream of last block
+}
+
+
+/**
+ * @brief  Function that performs CFB decryption on given buffer using given round keys, in parallel if length reaches the threshold.
+ * @brief  Updates iv with last full cipher block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::CFBDecryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    if (length == 0) return; //nothing to decrypt, IV stays the same
+    const size_t chunk = chunkSize; //read chunk size once so chunk offsets match saved cipher blocks
+    vector<unsigned char> previousCiphers(((length + chunk - 1) / chunk) * BlockSize); //represents cipher block before each chunk, saved before chunks are decrypted in place
+    for (size_t offset = 0; offset < length; offset += chunk) //iterate over chunk offsets
+        memcpy(previousCiphers.data() + (offset / chunk) * BlockSize, offset == 0 ? iv : input + offset - BlockSize, BlockSize); //save cipher block before chunk
+    if (length >= BlockSize) //if buffer has a full block we update IV with last full cipher block for next call
+        memcpy(iv, input + (length - length % BlockSize) - BlockSize, BlockSize); //update IV
+    ForEachChunk(length, chunk, [&](size_t offset, size_t size) { //process each chunk
+        unsigned char keystream[BlockSize]; //represents current keystream block
+        memcpy(keystream, previousCiphers.data() + (offset / chunk) * BlockSize, BlockSize); //initialize keystream with previous cipher block of chunk
+        for (size_t i = offset; i < offset + size; i += BlockSize) { //iterate over chunk
+            EncryptBlock(keystream, roundKeys); //encrypt the previous cipher block using our AES EncryptBlock function using round keys
+            size_t blockSize = offset + size - i < BlockSize ? offset + size - i : BlockSize; //calculate block size, last block may be partial
+            for (size_t j = 0; j < blockSize; j++) { //iterate over block
+                unsigned char cipher = input[i + j]; //save cipher byte before it's decrypted in place
+                output[i + j] = cipher ^ keystream[j]; //perform byte XOR between input and keystream block
+                keystream[j] = cipher; //set keystream to cipher block for next block
+            }
+        }
+        fill(keystream, keystream + BlockSize, 0x00); //clear keystream of last block of chunk
+    });
+}
+
+
+/**
+ * @brief  Function that performs OFB mode on given buffer using given round keys, updates iv with last keystream block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::OFBBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over buffer
+        EncryptBlock(iv, roundKeys); //encrypt the previous keystream block using our AES EncryptBlock function using round keys
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last block may be partial
+        for (size_t j = 0; j < size; j++) //iterate over block
+            output[i + j] = input[i + j] ^ iv[j]; //perform byte XOR between input and keystream block
+    }
+}
+
+
+/**
+ * @brief  Function that performs CTR mode on given buffer using given round keys, in parallel if length reaches the threshold.
+ * @brief  Updates iv with counter of next block.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<vector<unsigned char>> roundKeys
+ * @param  unsigned char* iv
+ */
+void AESParallel::CTRBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv) {
+    const bool streaming = IsStreaming(input, output, length); //represents if output bypasses the cache
+    ForEachChunk(length, chunkSize, [&](size_t offset, size_t size) { //process each chunk
+        unsigned char counter[BlockSize]; //represents counter block of chunk
+        memcpy(counter, iv, BlockSize); //initialize counter with IV
+        AddCounter(counter, offset / BlockSize); //add number of blocks before chunk to counter
+        CTRRange(input + offset, output + offset, size, roundKeys, counter, streaming); //encrypt chunk
+    });
+    AddCounter(iv, (length + BlockSize - 1) / BlockSize); //update IV with counter of next block for next call
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in ECB mode on given buffer using specified key.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESParallel::Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("ECB-Encrypt-Par", length); //profile parallel ECB encryption
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES ECB requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, NULL, "ECB"); //validate key and generate round keys
+    ECBBlocks(input, output, length, roundKeys, true); //encrypt buffer
+    ClearVector(roundKeys); //clear round keys once every chunk is encrypted
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in ECB mode on given buffer using specified key.
+ * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESParallel::Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("ECB-Decrypt-Par", length); //profile parallel ECB decryption
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES ECB requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, NULL, "ECB"); //validate key and generate round keys
+    ECBBlocks(input, output, length, roundKeys, false); //decrypt buffer
+    ClearVector(roundKeys); //clear round keys once every chunk is decrypted
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CBC mode on given buffer using specified key and initialization vector.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length, encryption runs on the calling thread.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CBC-Encrypt-Par", length); //profile parallel CBC encryption
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CBC requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "CBC"); //validate key and IV and generate round keys
+    CBCEncryptBlocks(input, output, length, roundKeys, iv); //encrypt buffer
+    ClearVector(roundKeys); //clear round keys once the chain is encrypted
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CBC mode on given buffer using specified key and initialization vector.
+ * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CBC-Decrypt-Par", length); //profile parallel CBC decryption
+    if ((length > 0 && (input == NULL || output == NULL)) || length % BlockSize != 0) //if buffer is missing or length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES CBC requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "CBC"); //validate key and IV and generate round keys
+    CBCDecryptBlocks(input, output, length, roundKeys, iv); //decrypt buffer
+    ClearVector(roundKeys); //clear round keys once every chunk is decrypted
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CFB mode on given buffer using specified key and initialization vector.
+ * @brief  CFB mode supports buffer in any size, encryption runs on the calling thread.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Encrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CFB-Encrypt-Par", length); //profile parallel CFB encryption
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CFB requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "CFB"); //validate key and IV and generate round keys
+    CFBEncryptBlocks(input, output, length, roundKeys, iv); //encrypt buffer
+    ClearVector(roundKeys); //clear round keys once the chain is encrypted
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CFB mode on given buffer using specified key and initialization vector.
+ * @brief  CFB mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Decrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CFB-Decrypt-Par", length); //profile parallel CFB decryption
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES CFB requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "CFB"); //validate key and IV and generate round keys
+    CFBDecryptBlocks(input, output, length, roundKeys, iv); //decrypt buffer
+    ClearVector(roundKeys); //clear round keys once every chunk is decrypted
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in OFB mode on given buffer using specified key and initialization vector.
+ * @brief  OFB mode supports buffer in any size, runs on the calling thread.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Encrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("OFB-Encrypt-Par", length); //profile parallel OFB encryption
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES OFB requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "OFB"); //validate key and IV and generate round keys
+    OFBBlocks(input, output, length, roundKeys, iv); //encrypt buffer
+    ClearVector(roundKeys); //clear round keys once the keystream chain is applied
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in OFB mode on given buffer using specified key and initialization vector.
+ * @brief  OFB mode supports buffer in any size, runs on the calling thread.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Decrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    Encrypt_OFB(input, output, length, key, iv); //OFB decryption is the same operation as OFB encryption
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CTR mode on given buffer using specified key and initialization vector.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CTR-Encrypt-Par", length); //profile parallel CTR encryption
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES CTR requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, "CTR"); //validate key and IV and generate round keys
+    CTRBlocks(input, output, length, roundKeys, iv); //encrypt buffer
+    ClearVector(roundKeys); //clear round keys once every counter block is applied
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CTR mode on given buffer using specified key and initialization vector.
+ * @brief  CTR mode supports buffer in any size.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESParallel::Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv) {
+    Encrypt_CTR(input, output, length, key, iv); //CTR decryption is the same operation as CTR encryption
+}
\ No newline at end of file
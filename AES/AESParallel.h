@@ -0,0 +1,549 @@
+#ifndef _AESPARALLEL_H
+#define _AESPARALLEL_H
+#include "AES.h"
+#include "AESProfiler.h"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <exception>
+#include <cstdint>
+
+/**
+ * @file AESParallel.h
+ * @brief  AESParallel class for multi-threaded AES encryption and decryption on raw buffers.
+ * @brief  The class extends AES with pointer-based operation modes that work out of place (input and output may be the same buffer).
+ * @brief  ECB, CTR, CBC decryption and CFB decryption are split into chunks and processed by a shared worker pool.
+ * @brief  CBC encryption, CFB encryption and OFB are sequential by definition and run on the calling thread.
+ * @brief  Buffers no larger than the parallel threshold are processed on the calling thread.
+ * @brief  Huge out of place buffers are written with non-temporal stores so they don't evict the cache, see SetStreamingThreshold.
+ * @brief  Jobs have the priority of the thread that started them, workers always pick the next chunk from the highest priority job that is below its worker limit.
+ * @brief  Modes don't add or remove padding, the iv is updated with the chaining value so consecutive chunks can be processed.
+ */
+class AESParallel : public AES {
+public:
+	/**
+	 * @brief  Represents the priority classes of parallel operations.
+	 */
+	enum Priority { High = 0, Normal = 1, Low = 2 };
+
+	using AES::Encrypt_ECB;
+	using AES::Decrypt_ECB;
+	using AES::Encrypt_CBC;
+	using AES::Decrypt_CBC;
+	using AES::Encrypt_CFB;
+	using AES::Decrypt_CFB;
+	using AES::Encrypt_OFB;
+	using AES::Decrypt_OFB;
+	using AES::Encrypt_CTR;
+	using AES::Decrypt_CTR;
+
+	/**
+	 * @brief  Function that sets the number of threads used for parallel operations, including the calling thread.
+	 * @brief  Zero sets the number of hardware threads.
+	 * @param  size_t threadCount
+	 */
+	static void SetThreadCount(const size_t threadCount);
+
+	/**
+	 * @brief  Function that returns the number of threads used for parallel operations, including the calling thread.
+	 * @return  size_t threadCount
+	 */
+	static size_t GetThreadCount();
+
+	/**
+	 * @brief  Function that sets the buffer size in bytes from which operations are processed in parallel.
+	 * @param  size_t threshold
+	 */
+	static void SetParallelThreshold(const size_t threshold);
+
+	/**
+	 * @brief  Function that returns the buffer size in bytes from which operations are processed in parallel.
+	 * @return  size_t threshold
+	 */
+	static size_t GetParallelThreshold();
+
+	/**
+	 * @brief  Function that sets the chunk size in bytes that each worker processes at a time, rounded down to a multiple of 16 bytes.
+	 * @param  size_t chunkSize
+	 * @throws  invalid_argument thrown if given chunkSize is smaller than 16 bytes.
+	 */
+	static void SetChunkSize(const size_t chunkSize);
+
+	/**
+	 * @brief  Function that returns the chunk size in bytes that each worker processes at a time.
+	 * @return  size_t chunkSize
+	 */
+	static size_t GetChunkSize();
+
+	/**
+	 * @brief  Function that sets the buffer size in bytes from which out of place ECB, CTR and CBC decryption write output with non-temporal stores, zero disables them.
+	 * @brief  Non-temporal stores bypass the cache, so huge buffers don't evict the working set of other threads and aren't read before they're written.
+	 * @param  size_t threshold
+	 */
+	static void SetStreamingThreshold(const size_t threshold);
+
+	/**
+	 * @brief  Function that returns the buffer size in bytes from which out of place ECB, CTR and CBC decryption write output with non-temporal stores, zero if disabled.
+	 * @return  size_t threshold
+	 */
+	static size_t GetStreamingThreshold();
+
+	/**
+	 * @brief  Function that sets the priority of parallel operations started on the calling thread, Normal by default.
+	 * @brief  Workers running a job take its priority, so operations they start inherit it.
+	 * @param  Priority priority
+	 * @throws  invalid_argument thrown if given priority is invalid.
+	 */
+	static void SetPriority(const Priority priority);
+
+	/**
+	 * @brief  Function that returns the priority of parallel operations started on the calling thread.
+	 * @return  Priority priority
+	 */
+	static Priority GetPriority();
+
+	/**
+	 * @brief  Function that sets the maximal number of workers that run jobs of given priority at the same time, zero for no limit.
+	 * @brief  The calling thread of an operation always works on its own job, so operations progress even if their class is at its limit.
+	 * @param  Priority priority
+	 * @param  size_t workerLimit
+	 * @throws  invalid_argument thrown if given priority is invalid.
+	 */
+	static void SetWorkerLimit(const Priority priority, const size_t workerLimit);
+
+	/**
+	 * @brief  Function that returns the maximal number of workers that run jobs of given priority at the same time, zero for no limit.
+	 * @param  Priority priority
+	 * @return  size_t workerLimit
+	 * @throws  invalid_argument thrown if given priority is invalid.
+	 */
+	static size_t GetWorkerLimit(const Priority priority);
+
+	/**
+	 * @brief  Function that runs given task for each index in range [0, count) using the worker pool and the calling thread.
+	 * @brief  Returns after all indexes are processed, rethrows the first exception thrown by the task.
+	 * @param  size_t count
+	 * @param  function<void(size_t)> task
+	 */
+	static void ParallelFor(const size_t count, const function<void(size_t)>& task);
+
+	/**
+	 * @brief  Function that performs AES encryption in ECB mode on given buffer using specified key.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void Encrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES decryption in ECB mode on given buffer using specified key.
+	 * @brief  ECB mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void Decrypt_ECB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES encryption in CBC mode on given buffer using specified key and initialization vector.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length, encryption runs on the calling thread.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CBC mode on given buffer using specified key and initialization vector.
+	 * @brief  CBC mode requires length to be a multiple of 16 bytes in length.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CBC(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in CFB mode on given buffer using specified key and initialization vector.
+	 * @brief  CFB mode supports buffer in any size, encryption runs on the calling thread.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CFB mode on given buffer using specified key and initialization vector.
+	 * @brief  CFB mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in OFB mode on given buffer using specified key and initialization vector.
+	 * @brief  OFB mode supports buffer in any size, runs on the calling thread.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in OFB mode on given buffer using specified key and initialization vector.
+	 * @brief  OFB mode supports buffer in any size, runs on the calling thread.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_OFB(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in CTR mode on given buffer using specified key and initialization vector.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CTR mode on given buffer using specified key and initialization vector.
+	 * @brief  CTR mode supports buffer in any size.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CTR(const unsigned char* input, unsigned char* output, const size_t length, const vector<unsigned char>& key, unsigned char* iv);
+
+protected:
+	/**
+	 * @brief  Represents a ParallelFor call that is shared between the calling thread and the workers, or a detached task added with Submit.
+	 */
+	struct Job {
+		const function<void(size_t)>* task = NULL; //task to run for each index
+		function<void(size_t)> ownedTask; //task of detached jobs, owned by the job since nobody waits for it
+		Priority priority = Normal; //priority of the thread that started the job
+		size_t count = 0; //number of indexes
+		atomic<size_t> next{ 0 }; //next index to claim
+		atomic<size_t> done{ 0 }; //number of finished indexes
+		exception_ptr error; //first exception thrown by task
+		mutex errorMutex; //mutex that guards error
+		AESProfiler::Scope* profileScope = NULL; //profiled scope of the thread that started the job, workers add their counters to it
+	};
+
+	/**
+	 * @brief  Represents the number of priority classes.
+	 */
+	static const size_t PriorityCount = 3;
+
+	/**
+	 * @brief  Function that claims and runs indexes of given job until no index is left or given number of indexes is run.
+	 * @param  shared_ptr<Job> job
+	 * @param  size_t maxIndexes
+	 */
+	static void RunJob(const shared_ptr<Job>& job, const size_t maxIndexes = SIZE_MAX);
+
+	/**
+	 * @brief  Function that returns the first job with unclaimed indexes of the highest priority class that is below its worker limit, removes finished jobs on the way.
+	 * @brief  Must be called with the pool mutex locked.
+	 * @return  shared_ptr<Job> job
+	 */
+	static shared_ptr<Job> NextJob();
+
+	/**
+	 * @brief  Function that returns the first ParallelFor job with unclaimed indexes whose priority is given priority or higher, for callers that wait for their own job.
+	 * @brief  Detached jobs are never stolen since they may resume coroutines. Must be called with the pool mutex locked.
+	 * @param  Priority lowestPriority
+	 * @return  shared_ptr<Job> job
+	 */
+	static shared_ptr<Job> StealJob(const Priority lowestPriority);
+
+	/**
+	 * @brief  Function that adds given job to the queue of its priority class.
+	 * @param  shared_ptr<Job> job
+	 */
+	static void Enqueue(const shared_ptr<Job>& job);
+
+	/**
+	 * @brief  Function that runs on each worker thread and waits for jobs.
+	 */
+	static void WorkerLoop();
+
+	/**
+	 * @brief  Function that starts the worker threads if they aren't running.
+	 * @brief  At least given number of workers is started even if the thread count is lower, detached tasks need a worker to run on.
+	 * @param  size_t minimumWorkers
+	 */
+	static void StartWorkers(const size_t minimumWorkers = 0);
+
+	/**
+	 * @brief  Function that adds given task to the end of the worker queue and returns without waiting for it.
+	 * @brief  At least one worker is started, so the task never runs on the calling thread, exceptions thrown by the task are ignored.
+	 * @param  function<void()> task
+	 */
+	static void Submit(const function<void()>& task);
+
+	/**
+	 * @brief  Function that stops and joins the worker threads.
+	 */
+	static void StopWorkers();
+
+	/**
+	 * @brief  Function that validates key and iv and returns the round keys of given key.
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  string mode
+	 * @return  vector<vector<unsigned char>> roundKeys
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static vector<vector<unsigned char>> Prepare(const vector<unsigned char>& key, const unsigned char* iv, const string& mode);
+
+	/**
+	 * @brief  Function that splits given length into chunks of given size and runs given task on each chunk with its offset and size.
+	 * @brief  Chunks are processed in parallel if length reaches the threshold, otherwise the whole length is one chunk at offset zero.
+	 * @param  size_t length
+	 * @param  size_t chunk
+	 * @param  function<void(size_t, size_t)> task
+	 */
+	static void ForEachChunk(const size_t length, const size_t chunk, const function<void(size_t, size_t)>& task);
+
+	/**
+	 * @brief  Function that adds given number of blocks to the counter in the lower 64 bits of the iv.
+	 * @param  unsigned char* counter
+	 * @param  uint64_t blocks
+	 */
+	static void AddCounter(unsigned char* counter, const uint64_t blocks);
+
+	/**
+	 * @brief  Function that performs CTR mode on given range of buffer starting with given counter block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  const unsigned char* counter
+	 * @param  bool streaming
+	 */
+	static void CTRRange(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, const unsigned char* counter, const bool streaming = false);
+
+	/**
+	 * @brief  Function that returns if output of given buffer should be written with non-temporal stores.
+	 * @brief  Requires an out of place buffer of at least the streaming threshold with output aligned to 16 bytes, and a processor with SSE2.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  bool isStreaming
+	 */
+	static bool IsStreaming(const unsigned char* input, const unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that stores given block in given output, with a non-temporal store that bypasses the cache if streaming.
+	 * @param  unsigned char* output
+	 * @param  const unsigned char* block
+	 * @param  bool streaming
+	 */
+	static void StoreBlock(unsigned char* output, const unsigned char* block, const bool streaming);
+
+	/**
+	 * @brief  Function that prefetches the input at prefetch distance ahead of given position and bypasses the cache if streaming.
+	 * @param  const unsigned char* position
+	 * @param  bool streaming
+	 */
+	static void PrefetchAhead(const unsigned char* position, const bool streaming);
+
+	/**
+	 * @brief  Function that makes non-temporal stores of the calling thread visible to other threads, must be called after streaming a chunk.
+	 * @param  bool streaming
+	 */
+	static void StreamFence(const bool streaming);
+
+	/**
+	 * @brief  Function that performs ECB mode on given buffer using given round keys, in parallel if length reaches the threshold.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  bool encrypt
+	 */
+	static void ECBBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, const bool encrypt);
+
+	/**
+	 * @brief  Function that performs CBC encryption on given buffer using given round keys, updates iv with last cipher block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void CBCEncryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs CBC decryption on given buffer using given round keys, in parallel if length reaches the threshold.
+	 * @brief  Updates iv with last cipher block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void CBCDecryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs CFB encryption on given buffer using given round keys, updates iv with last full cipher block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void CFBEncryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs CFB decryption on given buffer using given round keys, in parallel if length reaches the threshold.
+	 * @brief  Updates iv with last full cipher block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void CFBDecryptBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs OFB mode on given buffer using given round keys, updates iv with last keystream block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void OFBBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs CTR mode on given buffer using given round keys, in parallel if length reaches the threshold.
+	 * @brief  Updates iv with counter of next block.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  vector<vector<unsigned char>> roundKeys
+	 * @param  unsigned char* iv
+	 */
+	static void CTRBlocks(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Represents the worker threads of the pool.
+	 */
+	static vector<thread> workers;
+
+	/**
+	 * @brief  Represents the jobs that workers can claim indexes from, one queue for each priority class.
+	 */
+	static deque<shared_ptr<Job>> jobs[PriorityCount];
+
+	/**
+	 * @brief  Represents the maximal number of workers for each priority class, zero for no limit, guarded by the pool mutex.
+	 */
+	static size_t workerLimits[PriorityCount];
+
+	/**
+	 * @brief  Represents the number of workers that run a job of each priority class, guarded by the pool mutex.
+	 */
+	static size_t runningWorkers[PriorityCount];
+
+	/**
+	 * @brief  Priority of operations started on the calling thread.
+	 */
+	static thread_local Priority priority;
+
+	/**
+	 * @brief  Mutex that guards the jobs and the worker threads.
+	 */
+	static mutex poolMutex;
+
+	/**
+	 * @brief  Condition variable for notifying workers about new jobs.
+	 */
+	static condition_variable poolCondition;
+
+	/**
+	 * @brief  Condition variable for notifying callers about finished jobs.
+	 */
+	static condition_variable doneCondition;
+
+	/**
+	 * @brief  Flag that tells workers to exit.
+	 */
+	static bool stopWorkers;
+
+	/**
+	 * @brief  Number of threads used for parallel operations, including the calling thread.
+	 */
+	static atomic<size_t> threadCount;
+
+	/**
+	 * @brief  Buffer size in bytes from which operations are processed in parallel.
+	 */
+	static atomic<size_t> parallelThreshold;
+
+	/**
+	 * @brief  Chunk size in bytes that each worker processes at a time.
+	 */
+	static atomic<size_t> chunkSize;
+
+	/**
+	 * @brief  Buffer size in bytes from which out of place output is written with non-temporal stores, zero if disabled.
+	 */
+	static atomic<size_t> streamingThreshold;
+
+	/**
+	 * @brief  Represents how many bytes ahead of the current block the input is prefetched when streaming.
+	 */
+	static const size_t PrefetchDistance = 512;
+};
+#endif
\ No newline at end of file
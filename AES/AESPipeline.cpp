@@ -0,0 +1,425 @@
+#include "AESPipeline.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define AES_IO_URING
+#endif
+#endif
+
+
+#ifdef AES_IO_URING
+/**
+ * @brief  Represents an io_uring instance with its submission and completion rings mapped into memory.
+ * @brief  Only the calling thread submits and reaps, so the rings need acquire and release ordering only against the kernel.
+ */
+struct Ring {
+    int fd = -1; //file descriptor of io_uring instance
+    void* sqMapping = MAP_FAILED; //mapping of submission ring
+    size_t sqMappingSize = 0; //size of submission ring mapping
+    void* cqMapping = MAP_FAILED; //mapping of completion ring, same as submission ring mapping with single mmap
+    size_t cqMappingSize = 0; //size of completion ring mapping
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED; //submission queue entries
+    size_t sqesSize = 0; //size of submission queue entries mapping
+    unsigned* sqHead = NULL; //head of submission ring, advanced by kernel
+    unsigned* sqTail = NULL; //tail of submission ring, advanced by us
+    unsigned* sqMask = NULL; //mask of submission ring index
+    unsigned* sqArray = NULL; //submission ring array of entry indices
+    unsigned sqEntries = 0; //number of submission entries
+    unsigned localTail = 0; //tail of submission ring including entries not yet published to kernel
+    unsigned* cqHead = NULL; //head of completion ring, advanced by us
+    unsigned* cqTail = NULL; //tail of completion ring, advanced by kernel
+    unsigned* cqMask = NULL; //mask of completion ring index
+    io_uring_cqe* cqes = NULL; //completion queue entries
+
+    /**
+     * @brief  Function that creates the io_uring instance and maps its rings.
+     * @param  unsigned entries
+     * @return  bool isOpened
+     */
+    bool Open(const unsigned entries) {
+        io_uring_params params; //represents io_uring parameters
+        memset(&params, 0, sizeof(params)); //clear parameters
+        fd = (int)syscall(__NR_io_uring_setup, entries, &params); //create io_uring instance
+        if (fd < 0) return false; //io_uring isn't available, for example old kernel or blocked by seccomp
+        sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned); //calculate submission ring size
+        cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe); //calculate completion ring size
+        if (params.features & IORING_FEAT_SINGLE_MMAP) //if kernel maps both rings together we map the larger size once
+            sqMappingSize = cqMappingSize = max(sqMappingSize, cqMappingSize);
+        sqMapping = mmap(NULL, sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING); //map submission ring
+        if (sqMapping == MAP_FAILED) return false; //return false if mapping failed
+        if (params.features & IORING_FEAT_SINGLE_MMAP) //if kernel maps both rings together
+            cqMapping = sqMapping; //completion ring shares submission ring mapping
+        else
+            cqMapping = mmap(NULL, cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING); //map completion ring
+        if (cqMapping == MAP_FAILED) return false; //return false if mapping failed
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe); //calculate submission entries size
+        sqes = (io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES); //map submission entries
+        if (sqes == (io_uring_sqe*)MAP_FAILED) return false; //return false if mapping failed
+        unsigned char* sq = (unsigned char*)sqMapping; //represents submission ring base
+        unsigned char* cq = (unsigned char*)cqMapping; //represents completion ring base
+        sqHead = (unsigned*)(sq + params.sq_off.head); //set submission ring pointers
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        sqEntries = params.sq_entries;
+        localTail = *sqTail;
+        cqHead = (unsigned*)(cq + params.cq_off.head); //set completion ring pointers
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        return true; //return true
+    }
+
+    /**
+     * @brief  Function that registers given buffers with the kernel so fixed reads and writes skip page pinning per request.
+     * @param  const iovec* buffers
+     * @param  unsigned count
+     * @return  bool isRegistered
+     */
+    bool Register(const iovec* buffers, const unsigned count) {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, count) == 0; //fails if buffers exceed the locked memory limit
+    }
+
+    /**
+     * @brief  Function that returns the next free submission entry cleared, or NULL if the submission ring is full.
+     * @return  io_uring_sqe* sqe
+     */
+    io_uring_sqe* Next() {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE); //read head published by kernel
+        if (localTail - head >= sqEntries) return NULL; //submission ring is full
+        unsigned index = localTail & *sqMask; //calculate entry index
+        sqArray[index] = index; //entries are used in ring order
+        localTail++; //move local tail to next entry
+        memset(&sqes[index], 0, sizeof(io_uring_sqe)); //clear entry
+        return &sqes[index]; //return entry
+    }
+
+    /**
+     * @brief  Function that submits all prepared entries and waits until given number of completions is available.
+     * @param  unsigned waitCount
+     * @return  int result, negative errno on failure
+     */
+    int Submit(const unsigned waitCount) {
+        unsigned toSubmit = localTail - *sqTail; //calculate number of prepared entries
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE); //publish prepared entries to kernel
+        while (true) { //submit until kernel accepted all entries
+            int result = (int)syscall(__NR_io_uring_enter, fd, toSubmit, waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0); //submit and wait
+            if (result < 0 && errno == EINTR) continue; //retry if interrupted
+            if (result < 0) return -errno; //return negative errno
+            if ((unsigned)result >= toSubmit) return 0; //return zero when all entries are submitted
+            toSubmit -= (unsigned)result; //submit the rest
+        }
+    }
+
+    /**
+     * @brief  Function that takes the next completion if one is available.
+     * @param  io_uring_cqe& cqe
+     * @return  bool isAvailable
+     */
+    bool Reap(io_uring_cqe& cqe) {
+        unsigned head = *cqHead; //read our head
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false; //no completion available
+        cqe = cqes[head & *cqMask]; //copy completion
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE); //release completion slot to kernel
+        return true; //return true
+    }
+
+    /**
+     * @brief  Destructor that unmaps the rings and closes the io_uring instance.
+     */
+    ~Ring() {
+        if (sqes != (io_uring_sqe*)MAP_FAILED) munmap(sqes, sqesSize); //unmap submission entries
+        if (cqMapping != MAP_FAILED && cqMapping != sqMapping) munmap(cqMapping, cqMappingSize); //unmap completion ring
+        if (sqMapping != MAP_FAILED) munmap(sqMapping, sqMappingSize); //unmap submission ring
+        if (fd >= 0) close(fd); //close io_uring instance
+    }
+};
+
+
+/**
+ * @brief  Represents one buffer slot of the pipeline, a chunk being read and the previous output of the slot being written.
+ */
+struct Slot {
+    unsigned char* readBuffer = NULL; //buffer of chunk being read
+    unsigned char* writeBuffer = NULL; //buffer of processed chunk being written
+    uint64_t sequence = 0; //chunk number of read buffer
+    size_t filled = 0; //bytes read into read buffer
+    size_t writeSize = 0; //bytes to write from write buffer
+    size_t written = 0; //bytes already written from write buffer
+    uint64_t writeOffset = 0; //output offset of write buffer
+    bool readDone = false; //true if read buffer is full or input ended
+    bool writing = false; //true if write buffer isn't written yet
+};
+#endif
+
+
+/**
+ * @brief  Function that checks if io_uring is available, otherwise Process uses the synchronous fallback.
+ * @return  bool isSupported
+ */
+bool AESPipeline::IsSupported() {
+#ifdef AES_IO_URING
+    Ring ring; //represents test ring
+    return ring.Open(1); //return true if io_uring instance can be created
+#else
+    return false; //io_uring is Linux only
+#endif
+}
+
+
+/**
+ * @brief  Function that reads all input from given file descriptor, processes it with given stream and writes it to given file descriptor.
+ * @brief  The stream is finished when input ends, so padding is added or removed according to its mode.
+ * @param  int inFd
+ * @param  int outFd
+ * @param  AESStream stream
+ * @param  size_t queueDepth
+ * @param  size_t chunkSize
+ * @return  uint64_t outputLength
+ * @throws  invalid_argument thrown if given queue depth or chunk size is invalid.
+ * @throws  invalid_argument thrown if input doesn't match stream mode requirements.
+ * @throws  runtime_error thrown if reading or writing failed.
+ */
+uint64_t AESPipeline::Process(const int inFd, const int outFd, AESStream& stream, const size_t queueDepth, const size_t chunkSize) {
+    if (queueDepth == 0 || queueDepth > 1024) //if queue depth is invalid
+        throw invalid_argument("Invalid queue depth, please provide queue depth between 1 and 1024."); //throw invalid argument
+    if (chunkSize == 0 || chunkSize > (1 << 30)) //if chunk size is invalid, registered buffers are limited to 1 GB
+        throw invalid_argument("Invalid chunk size, please provide chunk size between 1 byte and 1 GB."); //throw invalid argument
+#ifdef AES_IO_URING
+    Ring ring; //represents io_uring instance
+    if (!ring.Open((unsigned)(2 * queueDepth))) //each slot has at most one read and one write in flight
+        return ProcessSync(inFd, outFd, stream, chunkSize); //fall back to blocking loop if io_uring isn't available
+
+    const size_t writeSize = chunkSize + 2 * 16; //write buffer has room for carried block and padding block of AESStream
+    vector<unsigned char> buffers(queueDepth * (chunkSize + writeSize)); //represents all read and write buffers
+    vector<Slot> slots(queueDepth); //represents buffer slots
+    vector<iovec> iovecs(2 * queueDepth); //represents buffers to register, read buffer of slot i at 2i and write buffer at 2i+1
+    for (size_t i = 0; i < queueDepth; i++) { //iterate over slots and assign buffers
+        slots[i].readBuffer = buffers.data() + i * (chunkSize + writeSize); //set read buffer
+        slots[i].writeBuffer = slots[i].readBuffer + chunkSize; //set write buffer after read buffer
+        iovecs[2 * i] = { slots[i].readBuffer, chunkSize }; //set read buffer iovec
+        iovecs[2 * i + 1] = { slots[i].writeBuffer, writeSize }; //set write buffer iovec
+    }
+    bool registered = ring.Register(iovecs.data(), (unsigned)iovecs.size()); //register buffers, plain reads and writes are used if it fails
+
+    struct stat inStat{}, outStat{}; //represents input and output file status
+    fstat(inFd, &inStat); //get input status
+    fstat(outFd, &outStat); //get output status
+    off_t inStart = lseek(inFd, 0, SEEK_CUR); //represents input start offset, -1 if input isn't seekable
+    off_t outStart = lseek(outFd, 0, SEEK_CUR); //represents output start offset, -1 if output isn't seekable
+    bool inSeekable = (S_ISREG(inStat.st_mode) || S_ISBLK(inStat.st_mode)) && inStart >= 0; //seekable input is read at offsets with all slots in flight
+    bool outSeekable = (S_ISREG(outStat.st_mode) || S_ISBLK(outStat.st_mode)) && outStart >= 0 && !(fcntl(outFd, F_GETFL) & O_APPEND); //seekable output is written at offsets
+
+    uint64_t nextRead = 0; //represents next chunk to read
+    uint64_t nextProcess = 0; //represents next chunk to process
+    uint64_t inputLength = 0; //represents bytes of processed input
+    uint64_t outputLength = 0; //represents bytes of processed output
+    size_t readsInFlight = 0, writesInFlight = 0; //represents number of requests in flight
+    bool inputEnded = false; //true after a read returned end of file
+    bool finished = false; //true after the last chunk was processed
+    deque<size_t> writeQueue; //represents slots waiting to be written in order when output isn't seekable
+
+    function<void(size_t)> SubmitRead = [&](size_t index) { //submit read of remaining part of slot read buffer
+        Slot& slot = slots[index]; //get slot
+        io_uring_sqe* sqe = ring.Next(); //get submission entry, ring has room for every slot
+        sqe->opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ; //read into registered buffer if available
+        sqe->fd = inFd; //set input file descriptor
+        sqe->addr = (uint64_t)(uintptr_t)(slot.readBuffer + slot.filled); //set buffer position
+        sqe->len = (uint32_t)(chunkSize - slot.filled); //set remaining length
+        sqe->off = inSeekable ? (uint64_t)inStart + slot.sequence * chunkSize + slot.filled : (uint64_t)-1; //read at chunk offset or at current position
+        sqe->buf_index = (uint16_t)(2 * index); //set registered buffer index
+        sqe->user_data = 2 * index; //even user data marks a read of slot
+        readsInFlight++; //add read in flight
+    };
+    function<void(size_t)> SubmitWrite = [&](size_t index) { //submit write of remaining part of slot write buffer
+        Slot& slot = slots[index]; //get slot
+        io_uring_sqe* sqe = ring.Next(); //get submission entry, ring has room for every slot
+        sqe->opcode = registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE; //write from registered buffer if available
+        sqe->fd = outFd; //set output file descriptor
+        sqe->addr = (uint64_t)(uintptr_t)(slot.writeBuffer + slot.written); //set buffer position
+        sqe->len = (uint32_t)(slot.writeSize - slot.written); //set remaining length
+        sqe->off = outSeekable ? slot.writeOffset + slot.written : (uint64_t)-1; //write at chunk offset or at current position
+        sqe->buf_index = (uint16_t)(2 * index + 1); //set registered buffer index
+        sqe->user_data = 2 * index + 1; //odd user data marks a write of slot
+        writesInFlight++; //add write in flight
+    };
+
+    try {
+        while (true) {
+            while (!inputEnded && !finished && nextRead - nextProcess < queueDepth && (inSeekable || readsInFlight == 0)) { //read ahead while a slot is free
+                Slot& slot = slots[nextRead % queueDepth]; //get slot of chunk, its previous chunk was already processed
+                slot.sequence = nextRead++; //set chunk number
+                slot.filled = 0; //clear read buffer
+                slot.readDone = false; //mark read as pending
+                SubmitRead(slot.sequence % queueDepth); //submit read
+            }
+            while (!finished && nextProcess < nextRead) { //process chunks in order while their reads are complete
+                size_t index = nextProcess % queueDepth; //get slot index of chunk
+                Slot& slot = slots[index]; //get slot
+                if (!slot.readDone || slot.writing) break; //wait for read and for previous write of slot
+                bool last = slot.filled < chunkSize; //a chunk that isn't full is the last chunk
+                size_t size = stream.Update(slot.readBuffer, slot.writeBuffer, slot.filled); //process chunk into write buffer
+                if (last) //if this is the last chunk we finish the stream
+                    size += stream.Final(slot.writeBuffer + size);
+                inputLength += slot.filled; //add chunk to input length
+                slot.writeSize = size; //set write size
+                slot.written = 0; //clear written bytes
+                slot.writeOffset = (uint64_t)outStart + outputLength; //set output offset
+                outputLength += size; //add chunk to output length
+                if (size > 0) { //if chunk produced output we write it
+                    slot.writing = true; //mark write buffer as busy
+                    if (outSeekable) //if output is seekable we write immediately at chunk offset
+                        SubmitWrite(index);
+                    else //else we queue write to keep output order
+                        writeQueue.push_back(index);
+                }
+                nextProcess++; //move to next chunk
+                finished = last; //stop after last chunk
+            }
+            if (!outSeekable && writesInFlight == 0 && !writeQueue.empty()) //if output isn't seekable we write one chunk at a time
+                SubmitWrite(writeQueue.front());
+            if (finished && readsInFlight == 0 && writesInFlight == 0 && writeQueue.empty()) //if everything is processed and written
+                break; //stop pipeline
+            if (readsInFlight == 0 && writesInFlight == 0) //if chunks produced no output, as ECB and CBC hold back blocks of small chunks, there's nothing to wait for
+                continue; //read ahead again
+            int result = ring.Submit(1); //submit requests and wait for a completion
+            if (result < 0) //if submission failed
+                throw runtime_error(string("Failed submitting io_uring requests: ") + strerror(-result)); //throw runtime error
+            io_uring_cqe cqe; //represents completion
+            while (ring.Reap(cqe)) { //handle all available completions
+                size_t index = (size_t)(cqe.user_data / 2); //get slot index
+                Slot& slot = slots[index]; //get slot
+                if (cqe.user_data % 2 == 0) { //if completion is a read
+                    readsInFlight--; //remove read in flight
+                    if (cqe.res == -EINTR || cqe.res == -EAGAIN) //if read was interrupted we retry
+                        SubmitRead(index);
+                    else if (cqe.res < 0) //if read failed
+                        throw runtime_error(string("Failed reading input: ") + strerror(-cqe.res)); //throw runtime error
+                    else if (cqe.res == 0) { //if read reached end of file
+                        slot.readDone = true; //chunk is complete
+                        inputEnded = true; //stop reading ahead
+                    }
+                    else { //else we add read bytes
+                        slot.filled += (size_t)cqe.res; //add bytes read
+                        if (slot.filled == chunkSize) //if chunk is full
+                            slot.readDone = true; //chunk is complete
+                        else //else short read, we read the rest of chunk
+                            SubmitRead(index);
+                    }
+                }
+                else { //else completion is a write
+                    writesInFlight--; //remove write in flight
+                    if (cqe.res == -EINTR || cqe.res == -EAGAIN) //if write was interrupted we retry
+                        SubmitWrite(index);
+                    else if (cqe.res <= 0) //if write failed
+                        throw runtime_error(string("Failed writing output: ") + strerror(cqe.res < 0 ? -cqe.res : EIO)); //throw runtime error
+                    else { //else we add written bytes
+                        slot.written += (size_t)cqe.res; //add bytes written
+                        if (slot.written < slot.writeSize) //if short write we write the rest
+                            SubmitWrite(index);
+                        else { //else write buffer is free
+                            slot.writing = false; //mark write buffer as free
+                            if (!outSeekable) writeQueue.pop_front(); //remove slot from write queue
+                        }
+                    }
+                }
+            }
+        }
+    }
+    catch (...) { //if pipeline failed we wait for requests in flight before buffers are released
+        io_uring_cqe cqe; //represents completion
+        while (readsInFlight + writesInFlight > 0 && ring.Submit(1) == 0) //wait for completions
+            while (ring.Reap(cqe)) //reap completions without handling them
+                (cqe.user_data % 2 == 0 ? readsInFlight : writesInFlight)--;
+        AES::ClearVector(buffers); //clear buffers, the ring no longer writes into them
+        throw; //rethrow exception
+    }
+    if (inSeekable) lseek(inFd, inStart + (off_t)inputLength, SEEK_SET); //move input position past consumed input like blocking reads
+    if (outSeekable) lseek(outFd, outStart + (off_t)outputLength, SEEK_SET); //move output position past written output like blocking writes
+    AES::ClearVector(buffers); //clear buffers of plaintext and ciphertext chunks
+    return outputLength; //return output length
+#else
+    return ProcessSync(inFd, outFd, stream, chunkSize); //io_uring isn't available on this platform
+#endif
+}
+
+
+/**
+ * @brief  Function that processes input with blocking reads and writes, used when io_uring isn't available.
+ * @param  int inFd
+ * @param  int outFd
+ * @param  AESStream stream
+ * @param  size_t chunkSize
+ * @return  uint64_t outputLength
+ * @throws  runtime_error thrown if reading or writing failed.
+ */
+uint64_t AESPipeline::ProcessSync(const int inFd, const int outFd, AESStream& stream, const size_t chunkSize) {
+    vector<unsigned char> input(chunkSize), output(chunkSize + 2 * 16); //represents read buffer and write buffer with room for carried block and padding block
+    uint64_t outputLength = 0; //represents bytes of processed output
+    bool last = false; //represents if current chunk is the last chunk
+    while (!last) { //process chunks until end of input
+        size_t size = ReadFull(inFd, input.data(), chunkSize); //read next chunk
+        last = size < chunkSize; //chunk is last if it isn't full
+        size_t outputSize = stream.Update(input.data(), output.data(), size); //process chunk
+        if (last) //if this is the last chunk we finish the stream
+            outputSize += stream.Final(output.data() + outputSize);
+        WriteAll(outFd, output.data(), outputSize); //write processed chunk
+        outputLength += outputSize; //add chunk to output length
+    }
+    AES::ClearVector(input); //clear buffer of last chunk
+    AES::ClearVector(output);
+    return outputLength; //return output length
+}
+
+
+/**
+ * @brief  Function that reads from given file descriptor until buffer is full or end of file.
+ * @param  int fd
+ * @param  unsigned char* data
+ * @param  size_t length
+ * @return  size_t readLength
+ * @throws  runtime_error thrown if read failed.
+ */
+size_t AESPipeline::ReadFull(const int fd, unsigned char* data, const size_t length) {
+    size_t total = 0; //represents number of bytes read
+    while (total < length) { //read until buffer is full
+        long result = (long)read(fd, data + total, (unsigned int)min(length - total, (size_t)(1 << 30))); //read next part
+        if (result < 0 && errno == EINTR) continue; //retry if interrupted
+        if (result < 0) throw runtime_error(string("Failed reading input: ") + strerror(errno)); //throw runtime error
+        if (result == 0) break; //stop on end of file
+        total += (size_t)result; //add bytes read
+    }
+    return total; //return number of bytes read
+}
+
+
+/**
+ * @brief  Function that writes whole buffer to given file descriptor.
+ * @param  int fd
+ * @param  const unsigned char* data
+ * @param  size_t length
+ * @throws  runtime_error thrown if write failed.
+ */
+void AESPipeline::WriteAll(const int fd, const unsigned char* data, const size_t length) {
+    size_t total = 0; //represents number of bytes written
+    while (total < length) { //write until whole buffer is written
+        long result = (long)write(fd, data + total, (unsigned int)min(length - total, (size_t)(1 << 30))); //write next part
+        if (result < 0 && errno == EINTR) continue; //retry if interrupted
+        if (result < 0) throw runtime_error(string("Failed writing output: ") + strerror(errno)); //throw runtime error
+        total += (size_t)result; //add bytes written
+    }
+}
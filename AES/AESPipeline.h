@@ -0,0 +1,70 @@
+#ifndef _AESPIPELINE_H
+#define _AESPIPELINE_H
+#include "AESStream.h"
+#include <cstdint>
+
+/**
+ * @file AESPipeline.h
+ * @brief  AESPipeline class for overlapped read, encrypt and write of files and streams.
+ * @brief  Input is read in fixed-size chunks into a ring of buffers that is kept in flight through io_uring on Linux.
+ * @brief  While the current chunk is processed by AESStream, the next chunks are being read and the previous chunks are being written.
+ * @brief  Buffers are registered with the kernel so reads and writes don't need extra kernel copies.
+ * @brief  Regular files are read and written at explicit offsets with several requests in flight, pipes keep one request in flight per direction.
+ * @brief  Chunk size doesn't need to be a multiple of 16 bytes, AESStream carries partial blocks between chunks.
+ * @brief  When io_uring isn't available the pipeline falls back to a synchronous read, process and write loop.
+ */
+class AESPipeline {
+public:
+	/**
+	 * @brief  Function that reads all input from given file descriptor, processes it with given stream and writes it to given file descriptor.
+	 * @brief  The stream is finished when input ends, so padding is added or removed according to its mode.
+	 * @param  int inFd
+	 * @param  int outFd
+	 * @param  AESStream stream
+	 * @param  size_t queueDepth
+	 * @param  size_t chunkSize
+	 * @return  uint64_t outputLength
+	 * @throws  invalid_argument thrown if given queue depth or chunk size is invalid.
+	 * @throws  invalid_argument thrown if input doesn't match stream mode requirements.
+	 * @throws  runtime_error thrown if reading or writing failed.
+	 */
+	static uint64_t Process(const int inFd, const int outFd, AESStream& stream, const size_t queueDepth = 4, const size_t chunkSize = 1024 * 1024);
+
+	/**
+	 * @brief  Function that checks if io_uring is available, otherwise Process uses the synchronous fallback.
+	 * @return  bool isSupported
+	 */
+	static bool IsSupported();
+
+private:
+	/**
+	 * @brief  Function that processes input with blocking reads and writes, used when io_uring isn't available.
+	 * @param  int inFd
+	 * @param  int outFd
+	 * @param  AESStream stream
+	 * @param  size_t chunkSize
+	 * @return  uint64_t outputLength
+	 * @throws  runtime_error thrown if reading or writing failed.
+	 */
+	static uint64_t ProcessSync(const int inFd, const int outFd, AESStream& stream, const size_t chunkSize);
+
+	/**
+	 * @brief  Function that reads from given file descriptor until buffer is full or end of file.
+	 * @param  int fd
+	 * @param  unsigned char* data
+	 * @param  size_t length
+	 * @return  size_t readLength
+	 * @throws  runtime_error thrown if read failed.
+	 */
+	static size_t ReadFull(const int fd, unsigned char* data, const size_t length);
+
+	/**
+	 * @brief  Function that writes whole buffer to given file descriptor.
+	 * @param  int fd
+	 * @param  const unsigned char* data
+	 * @param  size_t length
+	 * @throws  runtime_error thrown if write failed.
+	 */
+	static void WriteAll(const int fd, const unsigned char* data, const size_t length);
+};
+#endif
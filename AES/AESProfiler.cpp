@@ -0,0 +1,277 @@
+#include "AESProfiler.h"
+#include <sstream>
+#include <iomanip>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+
+//initialize collected results and upper bounds of message-size buckets
+map<string, map<size_t, AESProfiler::Counters>> AESProfiler::results;
+mutex AESProfiler::resultsMutex;
+const size_t AESProfiler::SizeBuckets[10] = { 16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, SIZE_MAX };
+
+
+#if defined(__linux__)
+/**
+ * @brief  Represents the perf_event_open counter group of the calling thread.
+ * @brief  Counters that the kernel or the CPU doesn't support are skipped and reported as zero.
+ */
+struct ThreadCounters {
+	int leader = -1; //file descriptor of group leader, -1 if no counter could be opened
+	int fds[4] = { -1, -1, -1, -1 }; //file descriptors of cycles, instructions, L1D misses and branch misses
+	size_t order[4] = { 0, 0, 0, 0 }; //counter index of each value in group read
+	size_t count = 0; //number of counters in group
+	bool initialized = false; //true if we already tried to open counters for this thread
+
+	/**
+	 * @brief  Function that opens the counter group, called once per thread.
+	 */
+	void Open() {
+		initialized = true; //mark as initialized so we don't retry on every scope
+		const uint32_t types[4] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE }; //counter types
+		const uint64_t configs[4] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, //cycles and instructions
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), //L1D read misses
+			PERF_COUNT_HW_BRANCH_MISSES }; //branch misses
+		for (size_t i = 0; i < 4; i++) { //iterate over counters and add each supported counter to group
+			perf_event_attr attr; //represents counter attributes
+			memset(&attr, 0, sizeof(attr)); //clear attributes
+			attr.size = sizeof(attr); //set attributes size for kernel
+			attr.type = types[i]; //set counter type
+			attr.config = configs[i]; //set counter config
+			attr.disabled = leader == -1 ? 1 : 0; //group leader starts disabled, members follow leader
+			attr.exclude_kernel = 1; //count only user space so we don't need elevated permissions
+			attr.exclude_hv = 1; //exclude hypervisor
+			attr.read_format = PERF_FORMAT_GROUP; //read all counters of group in one call
+			int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0); //open counter for calling thread on any CPU
+			if (fd == -1) continue; //if counter isn't supported we skip it
+			if (leader == -1) leader = fd; //first opened counter becomes group leader
+			fds[i] = fd; //save file descriptor
+			order[count++] = i; //save counter index of value in group read
+		}
+		if (leader != -1) { //if we opened at least one counter we enable the group
+			ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP); //reset counters
+			ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP); //enable counters
+		}
+	}
+
+	/**
+	 * @brief  Destructor that closes the counter group when thread exits.
+	 */
+	~ThreadCounters() {
+		for (int fd : fds) //iterate over file descriptors
+			if (fd != -1) close(fd); //close each opened counter
+	}
+};
+
+static thread_local ThreadCounters threadCounters; //counter group of calling thread
+#endif
+static thread_local AESProfiler::Scope* currentScope = NULL; //innermost scope of calling thread, or scope a worker runs a chunk for
+
+
+/**
+ * @brief  Constructor that starts measuring the scope.
+ * @param  const char* name
+ * @param  size_t size
+ */
+AESProfiler::Scope::Scope(const char* name, const size_t size) : name(name), size(size), start{}, parent(currentScope), workerCounters{} {
+	currentScope = this; //scope becomes innermost scope of thread
+	ReadCounters(start); //read hardware counters at start of scope
+	startTime = chrono::steady_clock::now(); //read wall time last so counter read isn't included
+}
+
+
+/**
+ * @brief  Destructor that stops measuring the scope and records the result.
+ */
+AESProfiler::Scope::~Scope() {
+	chrono::steady_clock::time_point endTime = chrono::steady_clock::now(); //read wall time first so counter read isn't included
+	uint64_t end[4]{}; //represents hardware counter values at end of scope
+	Counters counters; //represents measurement of this scope
+	if (ReadCounters(end)) { //if hardware counters are available we calculate counter deltas
+		counters.cycles = end[0] - start[0]; //calculate cycles
+		counters.instructions = end[1] - start[1]; //calculate instructions
+		counters.l1dMisses = end[2] - start[2]; //calculate L1D misses
+		counters.branchMisses = end[3] - start[3]; //calculate branch misses
+	}
+	uint64_t workers[4]; //represents counters added by worker threads
+	for (size_t i = 0; i < 4; i++) //iterate over counters
+		workers[i] = workerCounters[i].load(); //read counter of workers
+	counters.cycles += workers[0]; //add cycles of workers
+	counters.instructions += workers[1]; //add instructions of workers
+	counters.l1dMisses += workers[2]; //add L1D misses of workers
+	counters.branchMisses += workers[3]; //add branch misses of workers
+	currentScope = parent; //enclosing scope becomes innermost scope again
+	if (parent != NULL) //if scope is nested the enclosing scope includes the work of our workers too
+		for (size_t i = 0; i < 4; i++) //iterate over counters
+			parent->workerCounters[i] += workers[i]; //add counter of workers
+	counters.calls = 1; //this scope is a single call
+	counters.bytes = size; //set bytes processed
+	counters.nanoseconds = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(endTime - startTime).count(); //calculate elapsed time
+	Record(name, size, counters); //record measurement
+}
+
+
+/**
+ * @brief  Function that returns the innermost scope of the calling thread, NULL if there's none.
+ * @return  Scope* scope
+ */
+AESProfiler::Scope* AESProfiler::Scope::Current() {
+	return currentScope; //return innermost scope
+}
+
+
+/**
+ * @brief  Constructor that starts measuring the chunk for given scope.
+ * @param  Scope* owner
+ */
+AESProfiler::WorkerScope::WorkerScope(Scope* owner) : owner(owner), previous(currentScope), start{}, isValid(false) {
+	if (owner == NULL || currentScope == owner) { //if there's no scope or the thread is already measured for it, like a caller running its own chunks
+		this->owner = NULL; //chunk isn't measured
+		return;
+	}
+	currentScope = owner; //nested work of the chunk belongs to the scope
+	isValid = ReadCounters(start); //read hardware counters at start of chunk
+}
+
+
+/**
+ * @brief  Destructor that stops measuring the chunk and adds its counters to the scope.
+ */
+AESProfiler::WorkerScope::~WorkerScope() {
+	if (owner == NULL) //if chunk isn't measured
+		return;
+	uint64_t end[4]{}; //represents hardware counter values at end of chunk
+	if (isValid && ReadCounters(end)) //if hardware counters are available we move counter deltas to the scope
+		for (size_t i = 0; i < 4; i++) { //iterate over counters
+			owner->workerCounters[i] += end[i] - start[i]; //add counter of chunk
+			if (previous != NULL) //if the thread measures another scope, like a caller stealing chunks while it waits, that scope mustn't count the chunk too
+				previous->workerCounters[i] -= end[i] - start[i]; //remove counter of chunk, wraps back when the scope adds its own counters
+		}
+	currentScope = previous; //restore innermost scope of thread
+}
+
+
+/**
+ * @brief  Function that reads the hardware counters of the calling thread, opens them on first use.
+ * @param  uint64_t* values
+ * @return  bool isValid
+ */
+bool AESProfiler::ReadCounters(uint64_t* values) {
+#if defined(__linux__)
+	if (!threadCounters.initialized) //if counters aren't opened yet for this thread
+		threadCounters.Open(); //open counter group
+	if (threadCounters.leader == -1) //if no counter is available
+		return false; //return false
+	uint64_t buffer[1 + 4]{}; //represents group read buffer, number of counters followed by counter values
+	if (read(threadCounters.leader, buffer, sizeof(uint64_t) * (1 + threadCounters.count)) <= 0) //read all counters in group
+		return false; //return false if read failed
+	for (size_t i = 0; i < threadCounters.count && i < buffer[0]; i++) //iterate over group values
+		values[threadCounters.order[i]] = buffer[1 + i]; //set each value to its counter index
+	return true; //return true
+#else
+	(void)values; //hardware counters aren't supported on this platform
+	return false; //return false
+#endif
+}
+
+
+/**
+ * @brief  Function that checks if hardware performance counters are available for the calling thread.
+ * @return  bool isSupported
+ */
+bool AESProfiler::IsSupported() {
+	uint64_t values[4]{}; //represents counter values
+	return ReadCounters(values); //return true if counters can be read
+}
+
+
+/**
+ * @brief  Function that returns the bucket upper bound for given message size.
+ * @param  size_t size
+ * @return  size_t bucket
+ */
+size_t AESProfiler::GetBucket(const size_t size) {
+	for (const size_t& bucket : SizeBuckets) //iterate over bucket upper bounds
+		if (size <= bucket) return bucket; //return first bucket that fits size
+	return SIZE_MAX; //return last bucket
+}
+
+
+/**
+ * @brief  Function that records a measurement for given operation name and message size.
+ * @param  const char* name
+ * @param  size_t size
+ * @param  Counters counters
+ */
+void AESProfiler::Record(const char* name, const size_t size, const Counters& counters) {
+	lock_guard<mutex> lock(resultsMutex); //lock results for calling thread
+	Counters& total = results[name][GetBucket(size)]; //get accumulated counters of operation and bucket
+	total.calls += counters.calls; //accumulate calls
+	total.bytes += counters.bytes; //accumulate bytes
+	total.nanoseconds += counters.nanoseconds; //accumulate elapsed time
+	total.cycles += counters.cycles; //accumulate cycles
+	total.instructions += counters.instructions; //accumulate instructions
+	total.l1dMisses += counters.l1dMisses; //accumulate L1D misses
+	total.branchMisses += counters.branchMisses; //accumulate branch misses
+}
+
+
+/**
+ * @brief  Function that returns the collected results grouped by operation name and bucket upper bound.
+ * @return  map<string, map<size_t, Counters>> results
+ */
+map<string, map<size_t, AESProfiler::Counters>> AESProfiler::GetResults() {
+	lock_guard<mutex> lock(resultsMutex); //lock results for calling thread
+	return results; //return copy of results
+}
+
+
+/**
+ * @brief  Function that returns the collected results formatted as a table.
+ * @return  string report
+ */
+string AESProfiler::Report() {
+	map<string, map<size_t, Counters>> snapshot = GetResults(); //take snapshot of results
+	ostringstream report; //represents formatted report
+	report << left << setw(16) << "Operation" << right << setw(10) << "Size<=" << setw(10) << "Calls" << setw(14) << "Bytes" //add header
+		<< setw(12) << "ns/call" << setw(12) << "cyc/byte" << setw(8) << "IPC" << setw(14) << "L1D miss/KB" << setw(14) << "br miss/call" << endl;
+	report << fixed << setprecision(2); //print ratios with two decimal places
+	for (const pair<const string, map<size_t, Counters>>& operation : snapshot) { //iterate over operations
+		for (const pair<const size_t, Counters>& bucket : operation.second) { //iterate over buckets of operation
+			const Counters& counters = bucket.second; //get counters of bucket
+			double bytes = counters.bytes ? (double)counters.bytes : 1.0; //avoid division by zero
+			report << left << setw(16) << operation.first << right << setw(10) << (bucket.first == SIZE_MAX ? string("inf") : to_string(bucket.first)) //add operation and bucket
+				<< setw(10) << counters.calls << setw(14) << counters.bytes //add calls and bytes
+				<< setw(12) << (double)counters.nanoseconds / counters.calls //add average time per call
+				<< setw(12) << (double)counters.cycles / bytes //add cycles per byte
+				<< setw(8) << (counters.cycles ? (double)counters.instructions / counters.cycles : 0.0) //add instructions per cycle
+				<< setw(14) << (double)counters.l1dMisses * 1024.0 / bytes //add L1D misses per kilobyte
+				<< setw(14) << (double)counters.branchMisses / counters.calls << endl; //add branch misses per call
+		}
+	}
+	if (!IsSupported()) //if hardware counters aren't available we notify in report
+		report << "Hardware counters unavailable, only calls, bytes and time were collected." << endl;
+	return report.str(); //return report
+}
+
+
+/**
+ * @brief  Function that prints the collected results formatted as a table.
+ */
+void AESProfiler::PrintReport() {
+	cout << Report(); //print report
+}
+
+
+/**
+ * @brief  Function that clears all collected results.
+ */
+void AESProfiler::Reset() {
+	lock_guard<mutex> lock(resultsMutex); //lock results for calling thread
+	results.clear(); //clear results
+}
\ No newline at end of file
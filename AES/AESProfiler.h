@@ -0,0 +1,185 @@
+#ifndef _AESPROFILER_H
+#define _AESPROFILER_H
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @file AESProfiler.h
+ * @brief  AESProfiler class for hardware performance-counter profiling of AES operations.
+ * @brief  Profiling is compiled in only when AES_PROFILE is defined, otherwise AES_PROFILE_SCOPE expands to nothing.
+ * @brief  On Linux each profiled scope is measured with perf_event_open counters (cycles, instructions, L1D misses, branch misses).
+ * @brief  On other platforms or when counters are unavailable only call count, bytes and elapsed time are collected.
+ * @brief  Results are grouped per operation name and per message-size bucket.
+ * @brief  Counters of worker threads that run chunks of a ParallelFor inside a scope are added to the scope, detached Submit tasks aren't included.
+ */
+class AESProfiler {
+public:
+	/**
+	 * @brief  Represents the accumulated measurements of one operation in one message-size bucket.
+	 */
+	struct Counters {
+		uint64_t calls = 0; //number of profiled calls
+		uint64_t bytes = 0; //total bytes processed by profiled calls
+		uint64_t nanoseconds = 0; //total elapsed wall time in nanoseconds
+		uint64_t cycles = 0; //total CPU cycles
+		uint64_t instructions = 0; //total retired instructions
+		uint64_t l1dMisses = 0; //total L1 data cache read misses
+		uint64_t branchMisses = 0; //total mispredicted branches
+	};
+
+	class WorkerScope;
+
+	/**
+	 * @brief  RAII scope that measures the enclosing block and records it under given operation name and size.
+	 * @brief  Nested scopes are measured inclusively, for example a mode function includes its KeySchedule call.
+	 * @brief  Hardware counters include the counters of worker threads that ran chunks for the scope, so cycles are the CPU work of all threads while time is wall time.
+	 */
+	class Scope {
+	public:
+		/**
+		 * @brief  Constructor that starts measuring the scope.
+		 * @param  const char* name
+		 * @param  size_t size
+		 */
+		Scope(const char* name, const size_t size);
+
+		/**
+		 * @brief  Destructor that stops measuring the scope and records the result.
+		 */
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		/**
+		 * @brief  Function that returns the innermost scope of the calling thread, NULL if there's none.
+		 * @return  Scope* scope
+		 */
+		static Scope* Current();
+
+	private:
+		friend class AESProfiler::WorkerScope;
+		const char* name; //operation name of scope
+		size_t size; //message size of scope in bytes
+		uint64_t start[4]; //hardware counter values at start of scope
+		chrono::steady_clock::time_point startTime; //wall time at start of scope
+		Scope* parent; //enclosing scope of the same thread, NULL if there's none
+		atomic<uint64_t> workerCounters[4]; //hardware counters added by worker threads that ran chunks for the scope
+	};
+
+	/**
+	 * @brief  RAII scope that measures a chunk a worker thread runs for given scope of another thread and adds its counters to that scope.
+	 * @brief  It does nothing if given scope is NULL or the calling thread is already measured for it.
+	 */
+	class WorkerScope {
+	public:
+		/**
+		 * @brief  Constructor that starts measuring the chunk for given scope.
+		 * @param  Scope* owner
+		 */
+		explicit WorkerScope(Scope* owner);
+
+		/**
+		 * @brief  Destructor that stops measuring the chunk and adds its counters to the scope.
+		 */
+		~WorkerScope();
+
+		WorkerScope(const WorkerScope&) = delete;
+		WorkerScope& operator=(const WorkerScope&) = delete;
+
+	private:
+		Scope* owner; //scope the chunk runs for, NULL if chunk isn't measured
+		Scope* previous; //innermost scope of the calling thread before the chunk
+		uint64_t start[4]; //hardware counter values at start of chunk
+		bool isValid; //true if counters were read at start of chunk
+	};
+
+	/**
+	 * @brief  Function that checks if hardware performance counters are available for the calling thread.
+	 * @return  bool isSupported
+	 */
+	static bool IsSupported();
+
+	/**
+	 * @brief  Function that returns the collected results grouped by operation name and bucket upper bound.
+	 * @return  map<string, map<size_t, Counters>> results
+	 */
+	static map<string, map<size_t, Counters>> GetResults();
+
+	/**
+	 * @brief  Function that returns the collected results formatted as a table.
+	 * @return  string report
+	 */
+	static string Report();
+
+	/**
+	 * @brief  Function that prints the collected results formatted as a table.
+	 */
+	static void PrintReport();
+
+	/**
+	 * @brief  Function that clears all collected results.
+	 */
+	static void Reset();
+
+private:
+	/**
+	 * @brief  Upper bounds of message-size buckets in bytes, last bucket holds every larger message.
+	 */
+	static const size_t SizeBuckets[10];
+
+	/**
+	 * @brief  Collected results grouped by operation name and bucket upper bound.
+	 */
+	static map<string, map<size_t, Counters>> results;
+
+	/**
+	 * @brief  Mutex that guards collected results.
+	 */
+	static mutex resultsMutex;
+
+	/**
+	 * @brief  Function that reads the hardware counters of the calling thread, opens them on first use.
+	 * @param  uint64_t* values
+	 * @return  bool isValid
+	 */
+	static bool ReadCounters(uint64_t* values);
+
+	/**
+	 * @brief  Function that returns the bucket upper bound for given message size.
+	 * @param  size_t size
+	 * @return  size_t bucket
+	 */
+	static size_t GetBucket(const size_t size);
+
+	/**
+	 * @brief  Function that records a measurement for given operation name and message size.
+	 * @param  const char* name
+	 * @param  size_t size
+	 * @param  Counters counters
+	 */
+	static void Record(const char* name, const size_t size, const Counters& counters);
+};
+
+
+/**
+ * @brief  Macros that profile the enclosing scope when AES_PROFILE is defined, and let worker threads add the counters of chunks to the scope that started them.
+ */
+#ifdef AES_PROFILE
+#define AES_PROFILE_SCOPE(name, size) AESProfiler::Scope profileScope(name, size)
+#define AES_PROFILE_CURRENT() AESProfiler::Scope::Current()
+#define AES_PROFILE_WORKER(scope) AESProfiler::WorkerScope profileWorker(scope)
+#else
+#define AES_PROFILE_SCOPE(name, size)
+#define AES_PROFILE_CURRENT() NULL
+#define AES_PROFILE_WORKER(scope)
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "AESRekey.h"
+#include "AESProfiler.h"
+#include <cstring>
+
+
+/**
+ * @brief  Function that returns the mode of given name.
+ * @param  string mode
+ * @return  Mode mode
+ * @throws  invalid_argument thrown if given mode is unknown.
+ */
+AESRekey::Mode AESRekey::ParseMode(const string& mode) {
+    if (mode == "ECB") return ECBMode;
+    if (mode == "CBC") return CBCMode;
+    if (mode == "CFB") return CFBMode;
+    if (mode == "OFB") return OFBMode;
+    if (mode == "CTR") return CTRMode;
+    throw invalid_argument("Invalid mode of operation, please provide valid mode that matches AES requirements."); //throw invalid argument
+}
+
+
+/**
+ * @brief  Function that decrypts given group of blocks into given plaintext group, the last block may be partial.
+ * @brief  Chain holds the previous cipher block, feedback or counter and is updated past the group.
+ * @param  Mode mode
+ * @param  KeyContext context
+ * @param  unsigned char* chain
+ * @param  const unsigned char* input
+ * @param  unsigned char* plain
+ * @param  size_t length
+ */
+void AESRekey::DecryptGroup(const Mode mode, const KeyContext& context, unsigned char* chain, const unsigned char* input, unsigned char* plain, const size_t length) {
+    unsigned char keystream[BlockSize]; //represents current keystream block
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over group
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last block may be partial
+        if (mode == ECBMode || mode == CBCMode) { //if mode decrypts the cipher block itself
+            memcpy(plain + i, input + i, BlockSize); //copy cipher block for decryption
+            DecryptBlock(plain + i, context.roundKeys, context.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+            if (mode == CBCMode) { //if mode is CBC
+                XOR(plain + i, chain); //XOR with previous cipher block
+                memcpy(chain, input + i, BlockSize); //update previous cipher block, input isn't overwritten before the group is encrypted
+            }
+            continue;
+        }
+        memcpy(keystream, chain, BlockSize); //set keystream to feedback or counter
+        EncryptBlock(keystream, context.roundKeys, context.rounds); //encrypt the block into keystream using our AES EncryptBlock function using flat round keys
+        if (mode == OFBMode) //if mode is OFB the keystream is the next feedback
+            memcpy(chain, keystream, BlockSize); //update feedback
+        else if (mode == CTRMode) //if mode is CTR
+            AddCounter(chain, 1); //increase counter for next block
+        for (size_t j = 0; j < size; j++) //iterate over block
+            plain[i + j] = input[i + j] ^ keystream[j]; //perform byte XOR between cipher block and keystream
+        if (mode == CFBMode && size == BlockSize) //if mode is CFB and block is full the cipher block is the next feedback
+            memcpy(chain, input + i, BlockSize); //update feedback
+    }
+    fill(keystream, keystream + BlockSize, 0x00); //clear keystream of last block
+}
+
+
+/**
+ * @brief  Function that encrypts given plaintext group into given output, the last block may be partial.
+ * @brief  Chain holds the previous cipher block, feedback or counter and is updated past the group.
+ * @param  Mode mode
+ * @param  KeyContext context
+ * @param  unsigned char* chain
+ * @param  const unsigned char* plain
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  bool streaming
+ */
+void AESRekey::EncryptGroup(const Mode mode, const KeyContext& context, unsigned char* chain, const unsigned char* plain, unsigned char* output, const size_t length, const bool streaming) {
+    unsigned char block[BlockSize]; //represents current output block
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over group
+        size_t size = length - i < BlockSize ? length - i : BlockSize; //calculate block size, last block may be partial
+        if (mode == ECBMode || mode == CBCMode) { //if mode encrypts the plaintext block itself
+            memcpy(block, plain + i, BlockSize); //copy plaintext block for encryption
+            if (mode == CBCMode) //if mode is CBC
+                XOR(block, chain); //XOR with previous cipher block
+            EncryptBlock(block, context.roundKeys, context.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+            if (mode == CBCMode) //if mode is CBC
+                memcpy(chain, block, BlockSize); //update previous cipher block with new cipher block
+        }
+        else { //else mode XORs the plaintext with a keystream block
+            memcpy(block, chain, BlockSize); //set block to feedback or counter
+            EncryptBlock(block, context.roundKeys, context.rounds); //encrypt the block into keystream using our AES EncryptBlock function using flat round keys
+            if (mode == OFBMode) //if mode is OFB the keystream is the next feedback
+                memcpy(chain, block, BlockSize); //update feedback
+            else if (mode == CTRMode) //if mode is CTR
+                AddCounter(chain, 1); //increase counter for next block
+            for (size_t j = 0; j < size; j++) //iterate over block
+                block[j] ^= plain[i + j]; //perform byte XOR between keystream and plaintext
+            if (mode == CFBMode && size == BlockSize) //if mode is CFB and block is full the cipher block is the next feedback
+                memcpy(chain, block, BlockSize); //update feedback
+        }
+        if (size == BlockSize) //if block is full
+            StoreBlock(output + i, block, streaming); //store output block, around the cache when streaming
+        else //else last block is partial
+            memcpy(output + i, block, size); //copy partial block to output
+    }
+    fill(block, block + BlockSize, 0x00); //clear last block of group
+}
+
+
+/**
+ * @brief  Function that re-encrypts given range group by group, both chains are updated past the range.
+ * @param  Mode oldMode
+ * @param  KeyContext oldContext
+ * @param  unsigned char* oldChain
+ * @param  Mode newMode
+ * @param  KeyContext newContext
+ * @param  unsigned char* newChain
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  bool streaming
+ */
+void AESRekey::ProcessRange(const Mode oldMode, const KeyContext& oldContext, unsigned char* oldChain, const Mode newMode, const KeyContext& newContext, unsigned char* newChain, const unsigned char* input, unsigned char* output, const size_t length, const bool streaming) {
+    alignas(16) unsigned char plain[GroupBlocks * BlockSize]; //represents plaintext of current group, it never leaves the stack
+    for (size_t i = 0; i < length; i += GroupBlocks * BlockSize) { //iterate over groups
+        size_t size = min(length - i, GroupBlocks * BlockSize); //calculate group size, last group may be shorter
+        PrefetchAhead(input + i, streaming); //prefetch input ahead when streaming
+        DecryptGroup(oldMode, oldContext, oldChain, input + i, plain, size); //decrypt group with old key
+        EncryptGroup(newMode, newContext, newChain, plain, output + i, size, streaming); //encrypt group with new key
+    }
+    StreamFence(streaming); //make streamed output visible before the range is reported as done
+    volatile unsigned char* clear = plain; //represents plaintext through volatile so clearing isn't optimized away
+    for (size_t i = 0; i < sizeof(plain); i++) //iterate over plaintext group
+        clear[i] = 0x00; //clear decrypted group, the plaintext never leaves this function
+}
+
+
+/**
+ * @brief  Function that decrypts given buffer with the old key, mode and iv and encrypts it with the new key, mode and iv in a single pass.
+ * @brief  Input and output may be the same buffer, ECB and CBC require length to be a multiple of 16 bytes, both ivs are updated for the next call.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @param  string oldMode
+ * @param  vector<unsigned char> oldKey
+ * @param  unsigned char* oldIV
+ * @param  string newMode
+ * @param  vector<unsigned char> newKey
+ * @param  unsigned char* newIV
+ * @throws  invalid_argument thrown if given mode or length is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESRekey::Reencrypt(const unsigned char* input, unsigned char* output, const size_t length, const string& oldMode, const vector<unsigned char>& oldKey, unsigned char* oldIV, const string& newMode, const vector<unsigned char>& newKey, unsigned char* newIV) {
+    AES_PROFILE_SCOPE("Reencrypt", length); //profile re-encryption
+    const Mode oldValue = ParseMode(oldMode), newValue = ParseMode(newMode); //represents modes on both sides, throws invalid argument if mode unknown
+    for (const string& mode : { oldMode, newMode }) //iterate over both modes
+        if ((length > 0 && (input == NULL || output == NULL)) || ((mode == "ECB" || mode == "CBC") && length % BlockSize != 0)) //if buffer is missing or length isn't multiply of 16 bytes
+            throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES " + mode + " requirements."); //throw invalid argument
+    if ((oldValue != ECBMode && oldIV == NULL) || (newValue != ECBMode && newIV == NULL)) //if IV is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + (oldValue != ECBMode && oldIV == NULL ? oldMode : newMode) + " requirements."); //throw invalid argument
+    KeyContext oldContext = Expand(oldKey), newContext; //validate old key and expand round keys
+    try {
+        newContext = Expand(newKey); //validate new key and expand round keys
+    }
+    catch (...) { //if new key is invalid
+        Clear(oldContext); //clear old round keys before we rethrow
+        throw;
+    }
+    unsigned char unused[BlockSize] = {}; //represents chain of ECB side, never read
+    unsigned char* oldChain = oldValue == ECBMode ? unused : oldIV; //represents chain of old side
+    unsigned char* newChain = newValue == ECBMode ? unused : newIV; //represents chain of new side
+    const bool streaming = IsStreaming(input, output, length); //represents if output bypasses the cache
+    const bool isParallel = oldValue != OFBMode && (newValue == ECBMode || newValue == CTRMode); //represents if chunks are independent, decryption only chains on ciphertext
+    if (!isParallel || length == 0) //if every block depends on the previous one on either side
+        ProcessRange(oldValue, oldContext, oldChain, newValue, newContext, newChain, input, output, length, streaming); //process whole buffer on calling thread, updates chains
+    else { //else chunks are independent
+        const size_t chunk = max(BlockSize, GetChunkSize() / BlockSize * BlockSize); //represents chunk size rounded down to full blocks
+        const size_t count = (length + chunk - 1) / chunk; //represents number of chunks
+        vector<unsigned char> chains(count * 2 * BlockSize); //represents old and new chain of each chunk, saved before chunks are processed in place
+        for (size_t offset = 0; offset < length; offset += chunk) { //iterate over chunk offsets
+            unsigned char* chain = chains.data() + (offset / chunk) * 2 * BlockSize; //represents old chain of chunk followed by new chain
+            if (oldValue == CBCMode || oldValue == CFBMode) //if old mode chains on the cipher block before chunk
+                memcpy(chain, offset == 0 ? oldIV : input + offset - BlockSize, BlockSize); //save cipher block before chunk
+            else if (oldValue == CTRMode) { //if old mode is CTR
+                memcpy(chain, oldIV, BlockSize); //initialize counter with old IV
+                AddCounter(chain, offset / BlockSize); //add number of blocks before chunk to counter
+            }
+            if (newValue == CTRMode) { //if new mode is CTR
+                memcpy(chain + BlockSize, newIV, BlockSize); //initialize counter with new IV
+                AddCounter(chain + BlockSize, offset / BlockSize); //add number of blocks before chunk to counter
+            }
+        }
+        size_t blocks = (length + BlockSize - 1) / BlockSize, fullLength = length / BlockSize * BlockSize; //represents number of blocks and length of full blocks
+        if ((oldValue == CBCMode || oldValue == CFBMode) && fullLength > 0) //if old mode chains on the last full cipher block
+            memcpy(oldIV, input + fullLength - BlockSize, BlockSize); //update old IV with last full cipher block for next call
+        else if (oldValue == CTRMode) //if old mode is CTR
+            AddCounter(oldIV, blocks); //update old IV with counter of next block for next call
+        if (newValue == CTRMode) //if new mode is CTR
+            AddCounter(newIV, blocks); //update new IV with counter of next block for next call
+        ForEachChunk(length, chunk, [&](size_t offset, size_t size) { //process each chunk
+            unsigned char* chain = chains.data() + (offset / chunk) * 2 * BlockSize; //represents old chain of chunk followed by new chain
+            ProcessRange(oldValue, oldContext, chain, newValue, newContext, chain + BlockSize, input + offset, output + offset, size, streaming); //process chunk
+        });
+        fill(chains.begin(), chains.end(), 0x00); //clear old and new chains of chunks
+    }
+    Clear(oldContext); //clear round keys of old key
+    Clear(newContext); //clear round keys of new key
+}
@@ -0,0 +1,91 @@
+#ifndef _AESREKEY_H
+#define _AESREKEY_H
+#include "AESKeyBatch.h"
+
+/**
+ * @file AESRekey.h
+ * @brief  AESRekey class for key rotation, it transforms ciphertext under an old key and mode into ciphertext under a new key and mode in a single pass.
+ * @brief  Blocks are decrypted into a small group on the stack and encrypted again right away, so plaintext is never written to the output or to the heap.
+ * @brief  Buffers are split over the AESParallel worker pool when both modes allow it, old ECB, CBC, CFB or CTR into new ECB or CTR.
+ * @brief  Padding of ECB and CBC ciphertext is carried over as data, so the new ciphertext has the same length as the old one.
+ */
+class AESRekey : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Function that decrypts given buffer with the old key, mode and iv and encrypts it with the new key, mode and iv in a single pass.
+	 * @brief  Input and output may be the same buffer, ECB and CBC require length to be a multiple of 16 bytes, both ivs are updated for the next call.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  string oldMode
+	 * @param  vector<unsigned char> oldKey
+	 * @param  unsigned char* oldIV
+	 * @param  string newMode
+	 * @param  vector<unsigned char> newKey
+	 * @param  unsigned char* newIV
+	 * @throws  invalid_argument thrown if given mode or length is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Reencrypt(const unsigned char* input, unsigned char* output, const size_t length, const string& oldMode, const vector<unsigned char>& oldKey, unsigned char* oldIV, const string& newMode, const vector<unsigned char>& newKey, unsigned char* newIV);
+
+protected:
+	/**
+	 * @brief  Represents the modes of operation on either side of the rotation.
+	 */
+	enum Mode { ECBMode, CBCMode, CFBMode, OFBMode, CTRMode };
+
+	/**
+	 * @brief  Represents the number of blocks decrypted on the stack before they're encrypted again.
+	 */
+	static const size_t GroupBlocks = 8;
+
+	/**
+	 * @brief  Function that returns the mode of given name.
+	 * @param  string mode
+	 * @return  Mode mode
+	 * @throws  invalid_argument thrown if given mode is unknown.
+	 */
+	static Mode ParseMode(const string& mode);
+
+	/**
+	 * @brief  Function that decrypts given group of blocks into given plaintext group, the last block may be partial.
+	 * @brief  Chain holds the previous cipher block, feedback or counter and is updated past the group.
+	 * @param  Mode mode
+	 * @param  KeyContext context
+	 * @param  unsigned char* chain
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* plain
+	 * @param  size_t length
+	 */
+	static void DecryptGroup(const Mode mode, const KeyContext& context, unsigned char* chain, const unsigned char* input, unsigned char* plain, const size_t length);
+
+	/**
+	 * @brief  Function that encrypts given plaintext group into given output, the last block may be partial.
+	 * @brief  Chain holds the previous cipher block, feedback or counter and is updated past the group.
+	 * @param  Mode mode
+	 * @param  KeyContext context
+	 * @param  unsigned char* chain
+	 * @param  const unsigned char* plain
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  bool streaming
+	 */
+	static void EncryptGroup(const Mode mode, const KeyContext& context, unsigned char* chain, const unsigned char* plain, unsigned char* output, const size_t length, const bool streaming);
+
+	/**
+	 * @brief  Function that re-encrypts given range group by group, both chains are updated past the range.
+	 * @param  Mode oldMode
+	 * @param  KeyContext oldContext
+	 * @param  unsigned char* oldChain
+	 * @param  Mode newMode
+	 * @param  KeyContext newContext
+	 * @param  unsigned char* newChain
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @param  bool streaming
+	 */
+	static void ProcessRange(const Mode oldMode, const KeyContext& oldContext, unsigned char* oldChain, const Mode newMode, const KeyContext& newContext, unsigned char* newChain, const unsigned char* input, unsigned char* output, const size_t length, const bool streaming);
+};
+#endif
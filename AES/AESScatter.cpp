@@ -0,0 +1,336 @@
+#include "AESScatter.h"
+#include "AESProfiler.h"
+#include <cstring>
+
+
+/**
+ * @brief  Function that skips empty buffers and buffers that were fully processed.
+ */
+void AESScatter::Cursor::Skip() {
+    while (index < count && offset >= buffers[index].iov_len) { //while current buffer has no bytes left
+        index++; //move to next buffer
+        offset = 0; //start at beginning of next buffer
+    }
+}
+
+
+/**
+ * @brief  Function that returns the number of bytes left in current buffer.
+ * @return  size_t available
+ */
+size_t AESScatter::Cursor::Available() const {
+    return index < count ? buffers[index].iov_len - offset : 0; //return bytes left in current buffer
+}
+
+
+/**
+ * @brief  Function that returns a pointer to the current position.
+ * @return  unsigned char* position
+ */
+unsigned char* AESScatter::Cursor::Position() const {
+    return (unsigned char*)buffers[index].iov_base + offset; //return pointer to current position
+}
+
+
+/**
+ * @brief  Function that moves the position forward by given number of bytes, which may span several buffers.
+ * @param  size_t length
+ */
+void AESScatter::Cursor::Advance(size_t length) {
+    while (length > 0) { //while we have bytes to skip
+        Skip(); //skip to a buffer with bytes left
+        size_t size = min(length, Available()); //calculate bytes we can skip in current buffer
+        offset += size; //move position in current buffer
+        length -= size; //subtract skipped bytes
+    }
+    Skip(); //skip to next buffer with bytes left
+}
+
+
+/**
+ * @brief  Function that copies given number of bytes from the current position to given buffer without moving the position.
+ * @param  unsigned char* destination
+ * @param  size_t length
+ */
+void AESScatter::Cursor::Gather(unsigned char* destination, const size_t length) const {
+    Cursor cursor = *this; //represents copy of cursor so our position stays the same
+    for (size_t done = 0; done < length;) { //iterate until all bytes are copied
+        cursor.Skip(); //skip to a buffer with bytes left
+        size_t size = min(length - done, cursor.Available()); //calculate bytes we can copy from current buffer
+        memcpy(destination + done, cursor.Position(), size); //copy bytes
+        cursor.offset += size; //move copy of cursor
+        done += size; //add copied bytes
+    }
+}
+
+
+/**
+ * @brief  Function that copies given number of bytes from given buffer to the current position without moving the position.
+ * @param  const unsigned char* source
+ * @param  size_t length
+ */
+void AESScatter::Cursor::Scatter(const unsigned char* source, const size_t length) const {
+    Cursor cursor = *this; //represents copy of cursor so our position stays the same
+    for (size_t done = 0; done < length;) { //iterate until all bytes are copied
+        cursor.Skip(); //skip to a buffer with bytes left
+        size_t size = min(length - done, cursor.Available()); //calculate bytes we can copy to current buffer
+        memcpy(cursor.Position(), source + done, size); //copy bytes
+        cursor.offset += size; //move copy of cursor
+        done += size; //add copied bytes
+    }
+}
+
+
+/**
+ * @brief  Function that returns the total length of given list of buffers.
+ * @param  const iovec* buffers
+ * @param  size_t count
+ * @return  size_t totalLength
+ */
+size_t AESScatter::TotalLength(const iovec* buffers, const size_t count) {
+    size_t length = 0; //represents total length
+    for (size_t i = 0; buffers != NULL && i < count; i++) //iterate over buffers
+        length += buffers[i].iov_len; //add length of each buffer
+    return length; //return total length
+}
+
+
+/**
+ * @brief  Function that validates given lists, key and iv, and processes the input list into the output list with given block function.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  BlockFunction function
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Process(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv, const string& mode, const bool encrypt, BlockFunction function) {
+    const string error = "Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + mode + " requirements."; //represents error message for invalid buffers
+    if ((inputCount > 0 && input == NULL) || (outputCount > 0 && output == NULL)) //if a list is missing
+        throw invalid_argument(error); //throw invalid argument
+    for (size_t i = 0; i < inputCount; i++) //iterate over input buffers
+        if (input[i].iov_base == NULL && input[i].iov_len > 0) //if buffer is missing
+            throw invalid_argument(error); //throw invalid argument
+    for (size_t i = 0; i < outputCount; i++) //iterate over output buffers
+        if (output[i].iov_base == NULL && output[i].iov_len > 0) //if buffer is missing
+            throw invalid_argument(error); //throw invalid argument
+    const size_t length = TotalLength(input, inputCount); //represents total length of data
+    if (length != TotalLength(output, outputCount) || ((mode == "ECB" || mode == "CBC") && length % BlockSize != 0)) //if output length doesn't match or block mode length isn't multiply of 16 bytes
+        throw invalid_argument(error); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = Prepare(key, iv, mode); //validate key and IV and generate round keys
+
+    Cursor source{ input, inputCount }; //represents position in input buffers
+    Cursor destination{ output, outputCount }; //represents position in output buffers
+    source.Skip(); //skip leading empty buffers
+    destination.Skip(); //skip leading empty buffers
+    unsigned char block[BlockSize]; //represents block that straddles buffer boundaries
+    for (size_t done = 0; done < length;) { //iterate until all data is processed
+        size_t run = min(source.Available(), destination.Available()); //represents contiguous bytes in both input and output buffers
+        size_t size = run - (run % BlockSize); //represents whole blocks in contiguous bytes
+        if (size > 0) //if whole blocks are contiguous we process them directly in their buffers
+            function(source.Position(), destination.Position(), size, roundKeys, iv); //process whole blocks
+        else { //else block straddles buffer boundaries or is the partial last block, we gather it into temporary block
+            size = min(BlockSize, length - done); //calculate block size, last block may be partial
+            source.Gather(block, size); //gather block from input buffers
+            function(block, block, size, roundKeys, iv); //process block
+            destination.Scatter(block, size); //scatter block to output buffers
+        }
+        source.Advance(size); //move input position past processed bytes
+        destination.Advance(size); //move output position past processed bytes
+        done += size; //add processed bytes
+    }
+    fill(block, block + BlockSize, 0x00); //clear gathered block of the last straddling block
+    ClearVector(roundKeys); //clear round keys of list
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in ECB mode on given list of buffers using specified key.
+ * @brief  ECB mode requires total length to be a multiple of 16 bytes, blocks that straddle buffer boundaries are handled internally.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESScatter::Encrypt_ECB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("ECB-Encrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather ECB encryption
+    Process(input, inputCount, output, outputCount, key, NULL, "ECB", true, [](const unsigned char* in, unsigned char* out, size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char*) { ECBBlocks(in, out, length, roundKeys, true); }); //encrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in ECB mode on given list of buffers using specified key.
+ * @brief  ECB mode requires total length to be a multiple of 16 bytes, blocks that straddle buffer boundaries are handled internally.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ */
+void AESScatter::Decrypt_ECB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key) {
+    AES_PROFILE_SCOPE("ECB-Decrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather ECB decryption
+    Process(input, inputCount, output, outputCount, key, NULL, "ECB", false, [](const unsigned char* in, unsigned char* out, size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char*) { ECBBlocks(in, out, length, roundKeys, false); }); //decrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CBC mode on given list of buffers using specified key and initialization vector.
+ * @brief  CBC mode requires total length to be a multiple of 16 bytes, updates iv with last cipher block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Encrypt_CBC(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CBC-Encrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CBC encryption
+    Process(input, inputCount, output, outputCount, key, iv, "CBC", true, CBCEncryptBlocks); //encrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CBC mode on given list of buffers using specified key and initialization vector.
+ * @brief  CBC mode requires total length to be a multiple of 16 bytes, updates iv with last cipher block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Decrypt_CBC(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CBC-Decrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CBC decryption
+    Process(input, inputCount, output, outputCount, key, iv, "CBC", false, CBCDecryptBlocks); //decrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CFB mode on given list of buffers using specified key and initialization vector.
+ * @brief  CFB mode supports any total length, updates iv with last full cipher block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Encrypt_CFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CFB-Encrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CFB encryption
+    Process(input, inputCount, output, outputCount, key, iv, "CFB", true, CFBEncryptBlocks); //encrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CFB mode on given list of buffers using specified key and initialization vector.
+ * @brief  CFB mode supports any total length, updates iv with last full cipher block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Decrypt_CFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CFB-Decrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CFB decryption
+    Process(input, inputCount, output, outputCount, key, iv, "CFB", false, CFBDecryptBlocks); //decrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in OFB mode on given list of buffers using specified key and initialization vector.
+ * @brief  OFB mode supports any total length, updates iv with last keystream block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Encrypt_OFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("OFB-Encrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather OFB encryption
+    Process(input, inputCount, output, outputCount, key, iv, "OFB", true, OFBBlocks); //encrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in OFB mode on given list of buffers using specified key and initialization vector.
+ * @brief  OFB mode supports any total length, updates iv with last keystream block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Decrypt_OFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("OFB-Decrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather OFB decryption
+    Process(input, inputCount, output, outputCount, key, iv, "OFB", false, OFBBlocks); //decrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES encryption in CTR mode on given list of buffers using specified key and initialization vector.
+ * @brief  CTR mode supports any total length, updates iv with counter of next block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Encrypt_CTR(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CTR-Encrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CTR encryption
+    Process(input, inputCount, output, outputCount, key, iv, "CTR", true, CTRBlocks); //encrypt buffers
+}
+
+
+/**
+ * @brief  Function that performs AES decryption in CTR mode on given list of buffers using specified key and initialization vector.
+ * @brief  CTR mode supports any total length, updates iv with counter of next block.
+ * @param  const iovec* input
+ * @param  size_t inputCount
+ * @param  const iovec* output
+ * @param  size_t outputCount
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @throws  invalid_argument thrown if given buffers are invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+void AESScatter::Decrypt_CTR(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv) {
+    AES_PROFILE_SCOPE("CTR-Decrypt-Iovec", TotalLength(input, inputCount)); //profile scatter-gather CTR decryption
+    Process(input, inputCount, output, outputCount, key, iv, "CTR", false, CTRBlocks); //decrypt buffers
+}
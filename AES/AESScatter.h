@@ -0,0 +1,250 @@
+#ifndef _AESSCATTER_H
+#define _AESSCATTER_H
+#include "AESParallel.h"
+#if defined(_WIN32)
+/**
+ * @brief  Represents a single buffer of a scatter-gather list, Windows has no iovec so we define it with the POSIX layout.
+ */
+struct iovec {
+	void* iov_base; //start of buffer
+	size_t iov_len; //length of buffer in bytes
+};
+#else
+#include <sys/uio.h>
+#endif
+
+/**
+ * @file AESScatter.h
+ * @brief  AESScatter class for encrypting and decrypting fragmented buffers described by iovec lists without coalescing them.
+ * @brief  The data is the concatenation of the input buffers, the result is written to the output buffers which may be split differently.
+ * @brief  Output may be the same list as input to encrypt in place, otherwise input and output buffers must not overlap.
+ * @brief  Whole blocks inside a buffer are processed directly (in parallel where AESParallel supports it), blocks that straddle buffers are gathered into a temporary block.
+ * @brief  Input and output lists must have the same total length, ECB and CBC modes require it to be a multiple of 16 bytes.
+ */
+class AESScatter : public AESParallel {
+public:
+	/**
+	 * @brief  Function that performs AES encryption in ECB mode on given list of buffers using specified key.
+	 * @brief  ECB mode requires total length to be a multiple of 16 bytes, blocks that straddle buffer boundaries are handled internally.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void Encrypt_ECB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES decryption in ECB mode on given list of buffers using specified key.
+	 * @brief  ECB mode requires total length to be a multiple of 16 bytes, blocks that straddle buffer boundaries are handled internally.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 */
+	static void Decrypt_ECB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key);
+
+	/**
+	 * @brief  Function that performs AES encryption in CBC mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CBC mode requires total length to be a multiple of 16 bytes, updates iv with last cipher block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CBC(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CBC mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CBC mode requires total length to be a multiple of 16 bytes, updates iv with last cipher block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CBC(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in CFB mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CFB mode supports any total length, updates iv with last full cipher block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CFB mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CFB mode supports any total length, updates iv with last full cipher block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in OFB mode on given list of buffers using specified key and initialization vector.
+	 * @brief  OFB mode supports any total length, updates iv with last keystream block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_OFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in OFB mode on given list of buffers using specified key and initialization vector.
+	 * @brief  OFB mode supports any total length, updates iv with last keystream block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_OFB(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES encryption in CTR mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CTR mode supports any total length, updates iv with counter of next block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Encrypt_CTR(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that performs AES decryption in CTR mode on given list of buffers using specified key and initialization vector.
+	 * @brief  CTR mode supports any total length, updates iv with counter of next block.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Decrypt_CTR(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv);
+
+	/**
+	 * @brief  Function that returns the total length of given list of buffers.
+	 * @param  const iovec* buffers
+	 * @param  size_t count
+	 * @return  size_t totalLength
+	 */
+	static size_t TotalLength(const iovec* buffers, const size_t count);
+
+protected:
+	/**
+	 * @brief  Represents a block function of AESParallel that processes a contiguous buffer and updates iv.
+	 */
+	typedef void (*BlockFunction)(const unsigned char* input, unsigned char* output, const size_t length, const vector<vector<unsigned char>>& roundKeys, unsigned char* iv);
+
+	/**
+	 * @brief  Represents a position in a list of buffers.
+	 */
+	struct Cursor {
+		const iovec* buffers = NULL; //list of buffers
+		size_t count = 0; //number of buffers
+		size_t index = 0; //index of current buffer
+		size_t offset = 0; //offset in current buffer
+
+		/**
+		 * @brief  Function that skips empty buffers and buffers that were fully processed.
+		 */
+		void Skip();
+
+		/**
+		 * @brief  Function that returns the number of bytes left in current buffer.
+		 * @return  size_t available
+		 */
+		size_t Available() const;
+
+		/**
+		 * @brief  Function that returns a pointer to the current position.
+		 * @return  unsigned char* position
+		 */
+		unsigned char* Position() const;
+
+		/**
+		 * @brief  Function that moves the position forward by given number of bytes, which may span several buffers.
+		 * @param  size_t length
+		 */
+		void Advance(size_t length);
+
+		/**
+		 * @brief  Function that copies given number of bytes from the current position to given buffer without moving the position.
+		 * @param  unsigned char* destination
+		 * @param  size_t length
+		 */
+		void Gather(unsigned char* destination, const size_t length) const;
+
+		/**
+		 * @brief  Function that copies given number of bytes from given buffer to the current position without moving the position.
+		 * @param  const unsigned char* source
+		 * @param  size_t length
+		 */
+		void Scatter(const unsigned char* source, const size_t length) const;
+	};
+
+	/**
+	 * @brief  Function that validates given lists, key and iv, and processes the input list into the output list with given block function.
+	 * @param  const iovec* input
+	 * @param  size_t inputCount
+	 * @param  const iovec* output
+	 * @param  size_t outputCount
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  BlockFunction function
+	 * @throws  invalid_argument thrown if given buffers are invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	static void Process(const iovec* input, const size_t inputCount, const iovec* output, const size_t outputCount, const vector<unsigned char>& key, unsigned char* iv, const string& mode, const bool encrypt, BlockFunction function);
+};
+#endif
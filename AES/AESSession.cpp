@@ -0,0 +1,183 @@
+#include "AESSession.h"
+#include "AESProfiler.h"
+#include <cstring>
+
+
+static_assert(sizeof(AESSession::State) <= 64, "AESSession::State must stay below 64 bytes");
+
+
+thread_local AESSession::CacheEntry AESSession::cache[CacheSize]; //per-thread cache of expanded keys
+
+
+/**
+ * @brief  Function that returns the round keys of given session from the per-thread cache, expanding them if they aren't cached.
+ * @brief  The returned context stays valid until the calling thread looks up another key.
+ * @param  State state
+ * @return  KeyContext context
+ */
+const AESKeyBatch::KeyContext& AESSession::Lookup(const State& state) {
+    size_t hash = state.keySize; //represents hash of key that selects the cache entry
+    for (size_t i = 0; i < state.keySize; i++) //iterate over key
+        hash = hash * 31 + state.key[i]; //mix each key byte into hash
+    CacheEntry& entry = cache[hash % CacheSize]; //represents cache entry of key
+    if (entry.keySize != state.keySize || memcmp(entry.key, state.key, state.keySize) != 0) { //if another key is cached in the entry we expand this key
+        Expand(state.key, state.keySize, entry.context); //expand key into entry
+        memcpy(entry.key, state.key, state.keySize); //remember key of entry
+        entry.keySize = state.keySize; //remember key size of entry
+    }
+    return entry.context; //return round keys
+}
+
+
+/**
+ * @brief  Function that validates given mode, key and iv and returns the initial state of a session.
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @return  State state
+ * @throws  invalid_argument thrown if given mode, key or iv is invalid.
+ */
+AESSession::State AESSession::Create(const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv) {
+    State state{}; //represents initial state
+    if (mode == "ECB") state.mode = ECB; //set mode
+    else if (mode == "CBC") state.mode = CBC;
+    else if (mode == "CFB") state.mode = CFB;
+    else if (mode == "OFB") state.mode = OFB;
+    else if (mode == "CTR") state.mode = CTR;
+    else //else mode is invalid
+        throw invalid_argument("Invalid mode of operation, please provide ECB, CBC, CFB, OFB or CTR mode for session."); //throw invalid argument
+    if (key.size() != 16 && key.size() != 24 && key.size() != 32) //if key size is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if (state.mode != ECB && iv == NULL) //if IV is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + mode + " requirements."); //throw invalid argument
+    memcpy(state.key, key.data(), key.size()); //copy key
+    if (iv != NULL && state.mode != ECB) //if mode uses an IV
+        memcpy(state.iv, iv, BlockSize); //copy IV
+    state.keySize = (uint8_t)key.size(); //set key size
+    state.encrypt = encrypt ? 1 : 0; //set direction
+    return state; //return initial state
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given buffer with given session and updates its state, input and output may be the same buffer.
+ * @brief  ECB and CBC sessions require length to be a multiple of 16 bytes.
+ * @param  State state
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @throws  invalid_argument thrown if given state or buffer is invalid.
+ */
+void AESSession::Process(State& state, const unsigned char* input, unsigned char* output, const size_t length) {
+    AES_PROFILE_SCOPE("Session-Process", length); //profile session processing
+    static const char* modes[] = { "ECB", "CBC", "CFB", "OFB", "CTR" }; //represents mode names for error messages
+    if (state.keySize == 0 || state.mode > CTR || state.offset >= BlockSize) //if state is empty or corrupted
+        throw invalid_argument("Invalid session, please create the session with AESSession::Create."); //throw invalid argument
+    if ((length > 0 && (input == NULL || output == NULL)) || ((state.mode == ECB || state.mode == CBC) && length % BlockSize != 0)) //if buffer is missing or block mode length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(state.encrypt ? "plaintext" : "ciphertext") + " that matches AES " + modes[state.mode] + " requirements."); //throw invalid argument
+    if (length == 0) //if there's nothing to process we don't expand the key
+        return;
+    const KeyContext& context = Lookup(state); //represents round keys of session
+    unsigned char block[BlockSize]; //represents current block or keystream block
+    size_t i = 0; //represents position in buffer
+
+    if (state.mode == ECB || state.mode == CBC) { //block modes process whole blocks
+        for (; i < length; i += BlockSize) { //iterate over blocks
+            memcpy(block, input + i, BlockSize); //copy block, input and output may be the same buffer
+            if (state.mode == ECB) //if mode is ECB each block is independent
+                state.encrypt ? EncryptBlock(block, context.roundKeys, context.rounds) : DecryptBlock(block, context.roundKeys, context.rounds); //encrypt or decrypt block
+            else if (state.encrypt) { //else if CBC encryption we chain the previous cipher block
+                XOR(block, state.iv); //XOR with previous cipher block
+                EncryptBlock(block, context.roundKeys, context.rounds); //encrypt the block using our AES EncryptBlock function using flat round keys
+                memcpy(state.iv, block, BlockSize); //update previous cipher block
+            }
+            else { //else CBC decryption
+                unsigned char cipher[BlockSize]; //represents current cipher block
+                memcpy(cipher, block, BlockSize); //save cipher block before it's decrypted
+                DecryptBlock(block, context.roundKeys, context.rounds); //decrypt the block using our AES DecryptBlock function using flat round keys
+                XOR(block, state.iv); //XOR with previous cipher block
+                memcpy(state.iv, cipher, BlockSize); //update previous cipher block
+            }
+            memcpy(output + i, block, BlockSize); //store block
+        }
+    }
+    else if (state.mode == CTR) { //CTR keeps the counter of the current block until the block is used up
+        if (state.offset > 0) { //if we continue mid-block we regenerate the keystream block of the counter
+            memcpy(block, state.iv, BlockSize); //copy counter block
+            EncryptBlock(block, context.roundKeys, context.rounds); //encrypt counter block
+        }
+        while (i < length) { //iterate over buffer
+            if (state.offset == 0) { //if a new block starts we generate its keystream
+                memcpy(block, state.iv, BlockSize); //copy counter block
+                EncryptBlock(block, context.roundKeys, context.rounds); //encrypt counter block
+            }
+            size_t size = min(length - i, BlockSize - state.offset); //calculate number of bytes we use from keystream block
+            for (size_t j = 0; j < size; j++) //iterate over bytes
+                output[i + j] = input[i + j] ^ block[state.offset + j]; //perform byte XOR between input and keystream block
+            i += size; //move past processed bytes
+            state.offset = (uint8_t)((state.offset + size) % BlockSize); //update offset in block
+            if (state.offset == 0) //if block is used up we move to next counter
+                AddCounter(state.iv, 1); //increment counter
+        }
+    }
+    else { //CFB and OFB keep the current block in the IV, like the classic byte-oriented implementations
+        while (i < length) { //iterate over buffer
+            if (state.offset == 0) //if a new block starts we encrypt the feedback block
+                EncryptBlock(state.iv, context.roundKeys, context.rounds); //encrypt feedback block in place, it becomes the keystream block
+            size_t size = min(length - i, BlockSize - state.offset); //calculate number of bytes we use from keystream block
+            unsigned char* keystream = state.iv + state.offset; //represents unused keystream bytes
+            if (state.mode == OFB) //if mode is OFB the keystream block is the next feedback block
+                for (size_t j = 0; j < size; j++) //iterate over bytes
+                    output[i + j] = input[i + j] ^ keystream[j]; //perform byte XOR between input and keystream
+            else if (state.encrypt) //else if CFB encryption the cipher bytes replace the keystream bytes
+                for (size_t j = 0; j < size; j++) //iterate over bytes
+                    output[i + j] = keystream[j] ^= input[i + j]; //perform byte XOR and keep cipher byte as feedback
+            else //else CFB decryption the cipher bytes replace the keystream bytes
+                for (size_t j = 0; j < size; j++) { //iterate over bytes
+                    unsigned char cipher = input[i + j]; //save cipher byte before it's decrypted in place
+                    output[i + j] = keystream[j] ^ cipher; //perform byte XOR between keystream and cipher byte
+                    keystream[j] = cipher; //keep cipher byte as feedback
+                }
+            i += size; //move past processed bytes
+            state.offset = (uint8_t)((state.offset + size) % BlockSize); //update offset in block
+        }
+    }
+    fill(block, block + BlockSize, 0x00); //clear last block or CTR keystream block, the state keeps only the IV and offset
+}
+
+
+/**
+ * @brief  Function that encrypts or decrypts given text in place with given session and updates its state.
+ * @param  State state
+ * @param  vector<unsigned char> text
+ * @return  vector<unsigned char> text
+ * @throws  invalid_argument thrown if given state or text is invalid.
+ */
+vector<unsigned char>& AESSession::Process(State& state, vector<unsigned char>& text) {
+    Process(state, text.data(), text.data(), text.size()); //process text in place
+    return text; //return processed text
+}
+
+
+/**
+ * @brief  Function that clears the key and state of given session.
+ * @param  State state
+ */
+void AESSession::Clear(State& state) {
+    volatile unsigned char* bytes = (volatile unsigned char*)&state; //write through volatile so session state is really wiped
+    for (size_t i = 0; i < sizeof(State); i++) //iterate over state
+        bytes[i] = 0x00; //clear each byte
+}
+
+
+/**
+ * @brief  Function that clears the expanded keys cached by the calling thread.
+ */
+void AESSession::ClearCache() {
+    for (size_t i = 0; i < CacheSize; i++) { //iterate over cache entries
+        fill(cache[i].key, cache[i].key + sizeof(cache[i].key), 0x00); //clear key
+        cache[i].keySize = 0; //mark entry as empty
+        AESKeyBatch::Clear(cache[i].context); //clear round keys
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef _AESSESSION_H
+#define _AESSESSION_H
+#include "AESKeyBatch.h"
+#include <cstdint>
+
+/**
+ * @file AESSession.h
+ * @brief  AESSession class for keeping many idle sessions in a compact fixed-size state.
+ * @brief  A session State stores only the raw key, the IV or counter, the mode, the direction and the partial-block offset in 52 bytes.
+ * @brief  Round keys aren't stored in the session, they are expanded when the session is processed, through a small per-thread cache of recently used keys.
+ * @brief  CFB, OFB and CTR sessions support messages of any length and continue mid-block, ECB and CBC sessions require multiples of 16 bytes.
+ * @brief  Processing consecutive messages gives the same output as processing their concatenation with the AESParallel pointer modes.
+ */
+class AESSession : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents the compact state of a session, a plain struct that can be stored in arrays or shared memory.
+	 */
+	struct State {
+		unsigned char key[32]; //raw key, only the first keySize bytes are used
+		unsigned char iv[BlockSize]; //IV in CBC, previous cipher block in CFB, keystream block in OFB and counter in CTR
+		uint8_t keySize; //key size in bytes, 0 if state is empty
+		uint8_t mode; //mode of operation, see Mode
+		uint8_t encrypt; //1 for encryption, 0 for decryption
+		uint8_t offset; //number of bytes used of the current block in CFB, OFB and CTR
+	};
+
+	/**
+	 * @brief  Represents the modes of operation of a session.
+	 */
+	enum Mode : uint8_t { ECB = 0, CBC = 1, CFB = 2, OFB = 3, CTR = 4 };
+
+	/**
+	 * @brief  Function that validates given mode, key and iv and returns the initial state of a session.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @return  State state
+	 * @throws  invalid_argument thrown if given mode, key or iv is invalid.
+	 */
+	static State Create(const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv = NULL);
+
+	/**
+	 * @brief  Function that encrypts or decrypts given buffer with given session and updates its state, input and output may be the same buffer.
+	 * @brief  ECB and CBC sessions require length to be a multiple of 16 bytes.
+	 * @param  State state
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @throws  invalid_argument thrown if given state or buffer is invalid.
+	 */
+	static void Process(State& state, const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that encrypts or decrypts given text in place with given session and updates its state.
+	 * @param  State state
+	 * @param  vector<unsigned char> text
+	 * @return  vector<unsigned char> text
+	 * @throws  invalid_argument thrown if given state or text is invalid.
+	 */
+	static vector<unsigned char>& Process(State& state, vector<unsigned char>& text);
+
+	/**
+	 * @brief  Function that clears the key and state of given session.
+	 * @param  State state
+	 */
+	static void Clear(State& state);
+
+	/**
+	 * @brief  Function that clears the expanded keys cached by the calling thread.
+	 */
+	static void ClearCache();
+
+protected:
+	/**
+	 * @brief  Represents the number of expanded keys each thread caches.
+	 */
+	static const size_t CacheSize = 16;
+
+	/**
+	 * @brief  Represents an expanded key in the per-thread cache.
+	 */
+	struct CacheEntry {
+		unsigned char key[32] = {}; //raw key of cached round keys
+		size_t keySize = 0; //key size in bytes, 0 if entry is empty
+		KeyContext context; //expanded round keys
+	};
+
+	/**
+	 * @brief  Represents the cache of recently used expanded keys of each thread.
+	 */
+	static thread_local CacheEntry cache[CacheSize];
+
+	/**
+	 * @brief  Function that returns the round keys of given session from the per-thread cache, expanding them if they aren't cached.
+	 * @brief  The returned context stays valid until the calling thread looks up another key.
+	 * @param  State state
+	 * @return  KeyContext context
+	 */
+	static const KeyContext& Lookup(const State& state);
+};
+#endif
@@ -0,0 +1,272 @@
+#include "AESStream.h"
+#include "AESProfiler.h"
+#include <cstring>
+
+
+/**
+ * @brief  Constructor that validates given key and iv and prepares the stream for given mode of operation and padding.
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @param  Padding padding
+ * @throws  invalid_argument thrown if given mode is invalid.
+ * @throws  invalid_argument thrown if given key is invalid.
+ * @throws  invalid_argument thrown if given iv is invalid.
+ */
+AESStream::AESStream(const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv, const Padding padding)
+    : mode(mode), modeType(ParseMode(mode)), padding(padding), encrypt(encrypt), finished(false), chain{}, keystream{}, keystreamOffset(0), carry{}, carrySize(0) {
+    roundKeys = Prepare(key, iv, mode); //validate key and IV and generate round keys
+    if (iv != NULL && modeType != ECBMode) //if mode uses an IV
+        memcpy(chain, iv, BlockSize); //initialize chaining value with IV
+}
+
+
+/**
+ * @brief  Destructor that clears the round keys and mode state.
+ */
+AESStream::~AESStream() {
+    Clear(); //clear round keys and mode state
+}
+
+
+/**
+ * @brief  Function that returns the mode of given name.
+ * @param  string mode
+ * @return  Mode mode
+ * @throws  invalid_argument thrown if given mode is invalid.
+ */
+AESStream::Mode AESStream::ParseMode(const string& mode) {
+    if (mode == "ECB") return ECBMode;
+    if (mode == "CBC") return CBCMode;
+    if (mode == "CFB") return CFBMode;
+    if (mode == "OFB") return OFBMode;
+    if (mode == "CTR") return CTRMode;
+    throw invalid_argument("Invalid mode of operation, please provide valid mode that matches AES requirements."); //throw invalid argument
+}
+
+
+/**
+ * @brief  Function that clears the round keys and mode state.
+ */
+void AESStream::Clear() {
+    ClearVector(roundKeys); //clear round keys of stream
+    fill(chain, chain + BlockSize, 0x00); //clear chaining value
+    fill(keystream, keystream + BlockSize, 0x00); //clear keystream
+    fill(carry, carry + BlockSize, 0x00); //clear carried bytes
+    keystreamOffset = 0; //reset keystream offset
+    carrySize = 0; //reset carry size
+}
+
+
+/**
+ * @brief  Function that processes whole blocks with the mode of the stream.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ */
+void AESStream::ProcessBlocks(const unsigned char* input, unsigned char* output, const size_t length) {
+    if (length == 0) return; //nothing to process
+    switch (modeType) { //process blocks with mode of stream
+    case ECBMode: ECBBlocks(input, output, length, roundKeys, encrypt); break;
+    case CBCMode: encrypt ? CBCEncryptBlocks(input, output, length, roundKeys, chain) : CBCDecryptBlocks(input, output, length, roundKeys, chain); break;
+    case CFBMode: encrypt ? CFBEncryptBlocks(input, output, length, roundKeys, chain) : CFBDecryptBlocks(input, output, length, roundKeys, chain); break;
+    case OFBMode: OFBBlocks(input, output, length, roundKeys, chain); break;
+    case CTRMode: CTRBlocks(input, output, length, roundKeys, chain); break;
+    }
+}
+
+
+/**
+ * @brief  Function that processes a piece of data in ECB or CBC, carries the incomplete block to the next call.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  size_t outputLength
+ */
+size_t AESStream::UpdateBlocks(const unsigned char* input, unsigned char* output, const size_t length) {
+    size_t total = carrySize + length; //represents number of bytes available including carried bytes
+    size_t produce = encrypt ? total - (total % BlockSize) : (total == 0 ? 0 : (total - 1) - ((total - 1) % BlockSize)); //decryption holds back the last block
+    if (produce == 0) { //if there is no complete block to process we only carry the input
+        memcpy(carry + carrySize, input, length); //append input to carried bytes
+        carrySize += length; //add input length to carry size
+        return 0; //return output length
+    }
+    vector<unsigned char> copy; //represents copy of input when output would overwrite unread input
+    if (carrySize > 0 && output < input + length && input < output + produce) { //output runs ahead of input by carried bytes, so overlapping buffers need a copy
+        copy.assign(input, input + length); //copy input
+        input = copy.data(); //read from copy
+    }
+    size_t consumed = 0, produced = 0; //represents input bytes consumed and output bytes produced
+    if (carrySize > 0) { //if we have carried bytes we complete the carried block first
+        consumed = BlockSize - carrySize; //calculate bytes needed to complete the block
+        memcpy(carry + carrySize, input, consumed); //complete carried block
+        ProcessBlocks(carry, output, BlockSize); //process carried block
+        produced = BlockSize; //add block to output
+    }
+    ProcessBlocks(input + consumed, output + produced, produce - produced); //process remaining whole blocks directly from input
+    consumed += produce - produced; //add processed bytes to consumed bytes
+    carrySize = length - consumed; //calculate number of bytes left for next call
+    memcpy(carry, input + consumed, carrySize); //carry bytes left
+    ClearVector(copy); //clear copy of input
+    return produce; //return output length
+}
+
+
+/**
+ * @brief  Function that processes a piece of data in CFB, OFB or CTR, keeps the unused keystream for the next call.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  size_t outputLength
+ */
+size_t AESStream::UpdateKeystream(const unsigned char* input, unsigned char* output, const size_t length) {
+    size_t i = 0; //represents position in input
+    const bool feedback = modeType == CFBMode; //if mode is CFB the cipher bytes become the next chaining value
+    auto XORKeystream = [&](size_t end) { //XOR bytes until end using saved keystream block
+        for (; i < end; i++) { //iterate over bytes
+            unsigned char byte = input[i]; //save input byte, input and output may be the same buffer
+            output[i] = byte ^ keystream[keystreamOffset]; //perform byte XOR between input and keystream block
+            if (feedback) //if mode is CFB the cipher byte becomes part of next chaining value
+                chain[keystreamOffset] = encrypt ? output[i] : byte; //set cipher byte in chaining value
+            keystreamOffset = (keystreamOffset + 1) % BlockSize; //move to next keystream byte, zero when block is used up
+        }
+    };
+    if (keystreamOffset > 0) //if a previous call left a partial block we use its keystream first
+        XORKeystream(min(length, i + BlockSize - keystreamOffset));
+    size_t whole = (length - i) - ((length - i) % BlockSize); //calculate length of whole blocks
+    ProcessBlocks(input + i, output + i, whole); //process whole blocks
+    i += whole; //move past whole blocks
+    if (i < length) { //if a partial block is left we generate its keystream and keep the rest for the next call
+        memcpy(keystream, chain, BlockSize); //set keystream to chaining value
+        EncryptBlock(keystream, roundKeys); //encrypt the block using our AES EncryptBlock function using round keys
+        if (modeType == OFBMode) //if mode is OFB the keystream block is the next chaining value
+            memcpy(chain, keystream, BlockSize);
+        else if (modeType == CTRMode) //if mode is CTR we move to the next counter
+            AddCounter(chain, 1);
+        XORKeystream(length); //XOR the partial block
+    }
+    return length; //return output length
+}
+
+
+/**
+ * @brief  Function that processes the next piece of data and returns the number of bytes written to output.
+ * @brief  Output must have room for length + 16 bytes, input and output may be the same buffer.
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  size_t outputLength
+ * @throws  invalid_argument thrown if given buffer is invalid or stream is already finished.
+ */
+size_t AESStream::Update(const unsigned char* input, unsigned char* output, const size_t length) {
+    AES_PROFILE_SCOPE("Stream-Update", length); //profile stream update
+    if (finished) //if stream is already finished
+        throw invalid_argument("Invalid mode of operation, stream is already finished."); //throw invalid argument
+    if (length > 0 && (input == NULL || output == NULL)) //if buffer is missing
+        throw invalid_argument("Invalid mode of operation, please provide valid " + string(encrypt ? "plaintext" : "ciphertext") + " that matches AES " + mode + " requirements."); //throw invalid argument
+    return IsPadded() ? UpdateBlocks(input, output, length) : UpdateKeystream(input, output, length); //process piece with mode of stream
+}
+
+
+/**
+ * @brief  Function that finishes the stream and returns the number of bytes written to output.
+ * @brief  Encryption adds padding in ECB and CBC, decryption removes it. Output must have room for 16 bytes.
+ * @param  unsigned char* output
+ * @return  size_t outputLength
+ * @throws  invalid_argument thrown if decrypted data isn't a multiple of 16 bytes in ECB or CBC or stream is already finished.
+ * @throws  invalid_argument thrown if decrypted data is empty or its padding is invalid with PKCS7Padding.
+ */
+size_t AESStream::Final(unsigned char* output) {
+    if (finished) //if stream is already finished
+        throw invalid_argument("Invalid mode of operation, stream is already finished."); //throw invalid argument
+    finished = true; //mark stream as finished
+    size_t outputLength = 0; //represents output length
+    if (IsPadded() && padding == PKCS7Padding) { //if mode is padded with PKCS7 we always add or remove padding
+        if (encrypt) { //if we encrypt we add 1 to 16 padding bytes, a full block if data is a multiple of 16 bytes
+            unsigned char value = (unsigned char)(BlockSize - carrySize); //calculate the number of padding bytes needed
+            memset(carry + carrySize, value, value); //append the padding bytes to the block
+            ProcessBlocks(carry, output, BlockSize); //encrypt last block
+            outputLength = BlockSize; //set output length
+        }
+        else { //else we decrypt the held back block and validate its padding
+            if (carrySize != BlockSize) { //if data is empty or isn't a multiple of 16 bytes
+                Clear(); //clear round keys and mode state
+                throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES " + mode + " requirements."); //throw invalid argument
+            }
+            ProcessBlocks(carry, carry, BlockSize); //decrypt last block
+            unsigned char value = carry[BlockSize - 1]; //get the value of the last byte, which indicates the padding size
+            unsigned char mismatch = (unsigned char)(value == 0 || value > BlockSize); //represents if padding is invalid, checked without early exit
+            for (size_t i = 0; i < BlockSize; i++) //iterate over bytes of block
+                mismatch |= (unsigned char)((i >= BlockSize - value) & (carry[i] != value)); //each padding byte must equal padding size
+            if (mismatch) { //if padding is invalid
+                Clear(); //clear round keys, mode state and decrypted block
+                throw invalid_argument("Invalid padding, please provide ciphertext with valid PKCS7 padding."); //throw invalid argument
+            }
+            outputLength = BlockSize - value; //represents length without padding
+            memcpy(output, carry, outputLength); //copy last block without padding
+        }
+    }
+    else if (IsPadded() && carrySize > 0) { //if mode is padded the legacy way and we have carried bytes
+        if (encrypt) { //if we encrypt we pad the carried block like AES Encrypt_ECB and Encrypt_CBC
+            unsigned char padding = (unsigned char)(BlockSize - carrySize); //calculate the number of padding bytes needed
+            memset(carry + carrySize, padding, padding); //append the padding bytes to the block
+            ProcessBlocks(carry, output, BlockSize); //encrypt last block
+            outputLength = BlockSize; //set output length
+        }
+        else { //else we decrypt the held back block and remove its padding like AES Decrypt_ECB and Decrypt_CBC
+            if (carrySize != BlockSize) { //if data isn't a multiple of 16 bytes
+                Clear(); //clear round keys and mode state
+                throw invalid_argument("Invalid mode of operation, please provide valid ciphertext that matches AES " + mode + " requirements."); //throw invalid argument
+            }
+            ProcessBlocks(carry, carry, BlockSize); //decrypt last block
+            outputLength = BlockSize; //represents length without padding
+            unsigned char padding = carry[BlockSize - 1]; //get the value of the last byte, which indicates the padding size
+            if (padding > 0 && padding <= BlockSize) { //if last byte may be valid padding
+                bool isPadding = true; //represents if last bytes match padding value
+                for (size_t i = BlockSize - padding; i < BlockSize; i++) //check if last bytes match padding value
+                    if (carry[i] != padding) isPadding = false;
+                if (isPadding) outputLength -= padding; //remove padding
+            }
+            memcpy(output, carry, outputLength); //copy last block without padding
+        }
+    }
+    Clear(); //clear round keys and mode state
+    return outputLength; //return output length
+}
+
+
+/**
+ * @brief  Function that returns the mode of operation of the stream.
+ * @return  string mode
+ */
+const string& AESStream::GetMode() const {
+    return mode; //return mode
+}
+
+
+/**
+ * @brief  Function that checks if the stream encrypts.
+ * @return  bool isEncrypt
+ */
+bool AESStream::IsEncrypt() const {
+    return encrypt; //return true if stream encrypts
+}
+
+
+/**
+ * @brief  Function that checks if the mode of the stream uses PKCS7 padding.
+ * @return  bool isPadded
+ */
+bool AESStream::IsPadded() const {
+    return modeType == ECBMode || modeType == CBCMode; //ECB and CBC use padding
+}
+
+
+/**
+ * @brief  Function that returns the padding of the stream, only used if the mode is ECB or CBC.
+ * @return  Padding padding
+ */
+AESStream::Padding AESStream::GetPadding() const {
+    return padding; //return padding
+}
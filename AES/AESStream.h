@@ -0,0 +1,145 @@
+#ifndef _AESSTREAM_H
+#define _AESSTREAM_H
+#include "AESParallel.h"
+
+/**
+ * @file AESStream.h
+ * @brief  AESStream class for incremental AES encryption and decryption of data that arrives in pieces of any size.
+ * @brief  The stream keeps the round keys and the mode state (chaining value, counter, partial keystream block and carried bytes) between calls.
+ * @brief  Piece boundaries don't need to align to 16 bytes, the output is identical to processing the whole data in one call.
+ * @brief  ECB and CBC pad with PKCS7Padding or LegacyPadding. PKCS7Padding always adds 1 to 16 bytes and rejects invalid padding when decrypting, so every input round-trips.
+ * @brief  LegacyPadding matches AES Encrypt_ECB and Encrypt_CBC, it pads only if data isn't a multiple of 16 bytes and strips anything that looks like padding, so it can lose data.
+ * @brief  When decrypting ECB and CBC the last block is held back until Final so its padding can be removed.
+ * @brief  Whole blocks are processed with AESParallel, so large pieces use the shared worker pool.
+ */
+class AESStream : public AESParallel {
+public:
+	/**
+	 * @brief  Represents the padding of ECB and CBC streams.
+	 */
+	enum Padding { LegacyPadding, PKCS7Padding };
+
+	/**
+	 * @brief  Constructor that validates given key and iv and prepares the stream for given mode of operation and padding.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  Padding padding
+	 * @throws  invalid_argument thrown if given mode is invalid.
+	 * @throws  invalid_argument thrown if given key is invalid.
+	 * @throws  invalid_argument thrown if given iv is invalid.
+	 */
+	AESStream(const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv = NULL, const Padding padding = LegacyPadding);
+
+	/**
+	 * @brief  Destructor that clears the round keys and mode state.
+	 */
+	~AESStream();
+
+	AESStream(const AESStream&) = delete;
+	AESStream& operator=(const AESStream&) = delete;
+
+	/**
+	 * @brief  Function that processes the next piece of data and returns the number of bytes written to output.
+	 * @brief  Output must have room for length + 16 bytes, input and output may be the same buffer.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  size_t outputLength
+	 * @throws  invalid_argument thrown if given buffer is invalid or stream is already finished.
+	 */
+	size_t Update(const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that finishes the stream and returns the number of bytes written to output.
+	 * @brief  Encryption adds padding in ECB and CBC, decryption removes it. Output must have room for 16 bytes.
+	 * @param  unsigned char* output
+	 * @return  size_t outputLength
+	 * @throws  invalid_argument thrown if decrypted data isn't a multiple of 16 bytes in ECB or CBC or stream is already finished.
+	 * @throws  invalid_argument thrown if decrypted data is empty or its padding is invalid with PKCS7Padding.
+	 */
+	size_t Final(unsigned char* output);
+
+	/**
+	 * @brief  Function that returns the mode of operation of the stream.
+	 * @return  string mode
+	 */
+	const string& GetMode() const;
+
+	/**
+	 * @brief  Function that checks if the stream encrypts.
+	 * @return  bool isEncrypt
+	 */
+	bool IsEncrypt() const;
+
+	/**
+	 * @brief  Function that checks if the mode of the stream uses PKCS7 padding.
+	 * @return  bool isPadded
+	 */
+	bool IsPadded() const;
+
+	/**
+	 * @brief  Function that returns the padding of the stream, only used if the mode is ECB or CBC.
+	 * @return  Padding padding
+	 */
+	Padding GetPadding() const;
+
+private:
+	/**
+	 * @brief  Represents the mode of operation, resolved once in the constructor so processing doesn't compare strings.
+	 */
+	enum Mode { ECBMode, CBCMode, CFBMode, OFBMode, CTRMode };
+
+	string mode; //mode of operation, one of ECB, CBC, CFB, OFB and CTR
+	Mode modeType; //mode of operation that processing switches on
+	Padding padding; //padding of ECB and CBC
+	bool encrypt; //true for encryption, false for decryption
+	bool finished; //true after Final was called
+	vector<vector<unsigned char>> roundKeys; //round keys of the key
+	unsigned char chain[BlockSize]; //chaining value, previous cipher block in CBC and CFB, previous keystream block in OFB, next counter in CTR
+	unsigned char keystream[BlockSize]; //keystream block of partial block in CFB, OFB and CTR
+	size_t keystreamOffset; //number of keystream bytes already used, zero if there is no partial block
+	unsigned char carry[BlockSize]; //bytes of incomplete block in ECB and CBC
+	size_t carrySize; //number of bytes in carry
+
+	/**
+	 * @brief  Function that returns the mode of given name.
+	 * @param  string mode
+	 * @return  Mode mode
+	 * @throws  invalid_argument thrown if given mode is invalid.
+	 */
+	static Mode ParseMode(const string& mode);
+
+	/**
+	 * @brief  Function that clears the round keys and mode state.
+	 */
+	void Clear();
+
+	/**
+	 * @brief  Function that processes whole blocks with the mode of the stream.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 */
+	void ProcessBlocks(const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that processes a piece of data in ECB or CBC, carries the incomplete block to the next call.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  size_t outputLength
+	 */
+	size_t UpdateBlocks(const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that processes a piece of data in CFB, OFB or CTR, keeps the unused keystream for the next call.
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  size_t outputLength
+	 */
+	size_t UpdateKeystream(const unsigned char* input, unsigned char* output, const size_t length);
+};
+#endif
@@ -0,0 +1,319 @@
+#include "AESTuner.h"
+#include "AESProfiler.h"
+#include "AESVectorPermute.h"
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#define AES_TUNER_CPUID
+#endif
+
+
+//header line of cache files, changed whenever the format changes
+const string AESTuner::CacheHeader = "#AESTuner 2";
+
+
+/**
+ * @brief  Function that runs given task given number of times and returns the fastest run in nanoseconds.
+ * @param  function<void()> task
+ * @param  size_t repeats
+ * @return  double nanoseconds
+ */
+double AESTuner::Time(const function<void()>& task, const size_t repeats) {
+    double best = 0; //represents fastest run
+    for (size_t i = 0; i < repeats; i++) { //iterate over runs
+        auto start = chrono::steady_clock::now(); //start time of run
+        task(); //run task
+        double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count(); //elapsed time of run
+        if (i == 0 || elapsed < best) //if run is the fastest so far
+            best = elapsed; //keep fastest run, slower runs were disturbed by other work
+    }
+    return best; //return fastest run
+}
+
+
+/**
+ * @brief  Function that measures the fastest configuration on the current machine, the current settings are restored afterwards.
+ * @return  Config config
+ */
+AESTuner::Config AESTuner::Measure() {
+    AES_PROFILE_SCOPE("Tuner-Measure", 0); //profile tuner measurement
+    const bool previousAESNI = aesniEnabled; //save current settings so we can restore them
+    const ModeBackend previousBackend = GetBackend();
+    const size_t previousThreads = GetThreadCount();
+    const size_t previousChunk = GetChunkSize();
+    const size_t previousThreshold = GetParallelThreshold();
+    Config config; //represents measured configuration
+    config.machine = GetMachineKey(); //set machine key
+    config.chunkSize = previousChunk; //chunk size and threshold stay the same unless we find better ones
+    config.parallelThreshold = previousThreshold;
+
+    //measure key expansion backends on a small batch of keys
+    if (HasAESNI()) { //if processor supports AES-NI we compare it with the software expansion, virtual machines may emulate it slowly
+        vector<unsigned char> keys(64 * 16, 0x2B); //represents batch of AES-128 keys
+        vector<KeyContext> contexts(64); //represents expanded keys
+        double software = Time([&]() { for (size_t i = 0; i < contexts.size(); i++) ExpandSoftware(keys.data() + i * 16, 16, contexts[i].roundKeys); }, 5); //time software expansion
+        double aesni = Time([&]() { for (size_t i = 0; i < contexts.size(); i++) ExpandAESNI(keys.data() + i * 16, 16, contexts[i].roundKeys); }, 5); //time AES-NI expansion
+        config.useAESNI = aesni < software; //use faster backend
+        Clear(contexts); //clear expanded keys
+    }
+
+    //measure block backends of the vector mode functions with CBC encryption, which is serial so the block function dominates
+    if (AESVectorPermute::UsesSSSE3()) { //if vector permutes are available we compare them with the tables, without SSSE3 the backend falls back to the tables
+        vector<unsigned char> text(4 * 1024, 0x2B), key(16, 0x2B), iv(BlockSize, 0x00); //represents sample text, key and IV
+        auto measureCBC = [&](ModeBackend backend) { SetBackend(backend); return Time([&]() { vector<unsigned char> sample(text); AES::Encrypt_CBC(sample, key, iv); }, 5); }; //times CBC encryption with given backend
+        double table = measureCBC(TableBackend); //time table-based backend
+        double permute = measureCBC(VectorPermuteBackend); //time vector permute backend
+        config.useVectorPermute = permute < table; //use faster backend
+    }
+
+    //measure thread count, chunk size and parallel threshold with CTR mode, which is the most parallel mode
+    const size_t hardware = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1; //number of hardware threads
+    config.threadCount = 1; //represents fastest thread count
+    if (hardware > 1) { //if there's more than one hardware thread
+        vector<unsigned char> buffer(max((size_t)64 * 1024, min((size_t)512 * 1024, hardware * 32 * 1024))); //represents sample buffer, larger on machines with more threads
+        vector<vector<unsigned char>> roundKeys = KeySchedule(vector<unsigned char>(16, 0x2B)); //represents round keys of sample key
+        unsigned char iv[BlockSize]{}; //represents sample counter
+        auto measureCTR = [&](size_t length) { return Time([&]() { CTRBlocks(buffer.data(), buffer.data(), length, roundKeys, iv); }, 2); }; //times CTR mode on given length of sample buffer
+
+        SetParallelThreshold(0); //process every measured buffer in parallel
+        SetChunkSize(16 * 1024); //use small chunks so every thread gets work
+        SetThreadCount(1); //start with calling thread only
+        double best = measureCTR(buffer.size()); //represents fastest time so far
+        for (size_t count = 2;; count = min(count * 2, hardware)) { //iterate over powers of two and the number of hardware threads
+            SetThreadCount(count); //set thread count
+            double elapsed = measureCTR(buffer.size()); //time thread count
+            if (elapsed < best * 0.95) { //if thread count is clearly faster, small differences are noise
+                best = elapsed; //keep fastest time
+                config.threadCount = count; //keep fastest thread count
+            }
+            if (count == hardware) break; //stop after number of hardware threads
+        }
+
+        if (config.threadCount > 1) { //if parallel processing pays off we tune chunk size and threshold
+            SetThreadCount(config.threadCount); //use fastest thread count
+            best = 0; //represents fastest chunk time
+            for (size_t chunk : { (size_t)8 * 1024, (size_t)16 * 1024, (size_t)32 * 1024, (size_t)64 * 1024 }) { //iterate over chunk sizes
+                SetChunkSize(chunk); //set chunk size
+                double elapsed = measureCTR(buffer.size()); //time chunk size
+                if (best == 0 || elapsed < best) { //if chunk size is the fastest so far
+                    best = elapsed; //keep fastest time
+                    config.chunkSize = chunk; //keep fastest chunk size
+                }
+            }
+            SetChunkSize(config.chunkSize); //use fastest chunk size
+            config.parallelThreshold = buffer.size() * 2; //if parallel never wins on the sample sizes we only go parallel above them
+            for (size_t length = 4 * 1024; length <= buffer.size(); length *= 4) { //iterate over buffer sizes
+                SetParallelThreshold(SIZE_MAX); //process on calling thread
+                double serial = measureCTR(length); //time serial processing
+                SetParallelThreshold(0); //process in parallel
+                double parallel = measureCTR(length); //time parallel processing
+                if (parallel < serial * 0.9) { //if parallel is clearly faster the thread wake up pays off from this size
+                    config.parallelThreshold = length; //set threshold
+                    break;
+                }
+            }
+        }
+        ClearVector(roundKeys); //clear round keys of sample key
+    }
+
+    SetAESNI(previousAESNI); //restore previous settings
+    SetBackend(previousBackend);
+    SetThreadCount(previousThreads);
+    SetChunkSize(previousChunk);
+    SetParallelThreshold(previousThreshold);
+    return config; //return measured configuration
+}
+
+
+/**
+ * @brief  Function that applies given configuration to AES, AESParallel and AESKeyBatch.
+ * @param  Config config
+ * @throws  invalid_argument thrown if given configuration is invalid.
+ */
+void AESTuner::Apply(const Config& config) {
+    if (config.threadCount == 0 || config.chunkSize < BlockSize) //if thread count or chunk size is invalid
+        throw invalid_argument("Invalid configuration, please provide at least one thread and chunk size of at least 16 bytes."); //throw invalid argument
+    SetAESNI(config.useAESNI); //set key expansion backend
+    SetBackend(config.useVectorPermute ? VectorPermuteBackend : TableBackend); //set block backend of vector mode functions
+    if (GetThreadCount() != config.threadCount) //if thread count changes we restart the workers
+        SetThreadCount(config.threadCount); //set thread count
+    SetChunkSize(config.chunkSize); //set chunk size
+    SetParallelThreshold(config.parallelThreshold); //set parallel threshold
+}
+
+
+/**
+ * @brief  Function that loads the configuration of the current machine from given cache file, or measures and stores it if it's missing.
+ * @brief  The configuration is applied in both cases, an empty path uses GetDefaultCachePath.
+ * @brief  A cache file that can't be written is ignored, the measured configuration is still applied.
+ * @param  string cachePath
+ * @return  Config config
+ */
+AESTuner::Config AESTuner::Autotune(const string& cachePath) {
+    const string path = cachePath.empty() ? GetDefaultCachePath() : cachePath; //represents cache file path
+    Config config; //represents configuration of current machine
+    if (!Load(path, GetMachineKey(), config)) { //if cache has no configuration for current machine we measure it
+        config = Measure(); //measure configuration
+        try {
+            Save(path, config); //store configuration for later process starts
+        }
+        catch (const runtime_error&) {} //cache is only an optimization, we still apply the measured configuration
+    }
+    Apply(config); //apply configuration
+    return config; //return configuration
+}
+
+
+/**
+ * @brief  Function that loads the configuration of given machine from given cache file.
+ * @param  string cachePath
+ * @param  string machine
+ * @param  Config config
+ * @return  bool isFound
+ */
+bool AESTuner::Load(const string& cachePath, const string& machine, Config& config) {
+    ifstream file(cachePath); //open cache file
+    string line; //represents current line
+    if (!file || !getline(file, line) || line != CacheHeader) //if cache is missing or has another format
+        return false; //configuration not found
+    while (getline(file, line)) { //iterate over configurations
+        vector<string> fields; //represents tab separated fields of line
+        stringstream stream(line); //represents line stream
+        for (string field; getline(stream, field, '\t');) //iterate over fields
+            fields.push_back(field); //add field
+        if (fields.size() != 6 || fields[0] != machine) //if line is invalid or belongs to another machine
+            continue; //skip line
+        try {
+            Config loaded; //represents loaded configuration
+            loaded.machine = fields[0]; //set machine
+            loaded.useAESNI = fields[1] == "1"; //set key expansion backend
+            loaded.useVectorPermute = fields[2] == "1"; //set block backend of vector mode functions
+            loaded.threadCount = (size_t)stoull(fields[3]); //set thread count
+            loaded.chunkSize = (size_t)stoull(fields[4]); //set chunk size
+            loaded.parallelThreshold = (size_t)stoull(fields[5]); //set parallel threshold
+            if (loaded.threadCount == 0 || loaded.chunkSize < BlockSize) //if values are invalid
+                continue; //skip line
+            config = loaded; //return loaded configuration
+            return true; //configuration found
+        }
+        catch (const exception&) {} //skip line with invalid numbers
+    }
+    return false; //configuration not found
+}
+
+
+/**
+ * @brief  Function that stores given configuration in given cache file, replacing an older configuration of the same machine.
+ * @param  string cachePath
+ * @param  Config config
+ * @throws  runtime_error thrown if the cache file can't be written.
+ */
+void AESTuner::Save(const string& cachePath, const Config& config) {
+    vector<string> lines; //represents configurations of other machines that share the cache file
+    {
+        ifstream file(cachePath); //open existing cache file
+        string line; //represents current line
+        if (file && getline(file, line) && line == CacheHeader) //if cache exists and has the same format we keep other machines
+            while (getline(file, line)) //iterate over configurations
+                if (!line.empty() && line.compare(0, config.machine.size() + 1, config.machine + "\t") != 0) //if line belongs to another machine
+                    lines.push_back(line); //keep line
+    }
+    const string temporaryPath = cachePath + ".tmp"; //represents temporary file, renamed over the cache so readers never see a partial file
+    {
+        ofstream file(temporaryPath, ios::trunc); //open temporary file
+        file << CacheHeader << "\n"; //write header
+        for (const string& line : lines) //iterate over other machines
+            file << line << "\n"; //write their configuration
+        file << config.machine << "\t" << (config.useAESNI ? 1 : 0) << "\t" << (config.useVectorPermute ? 1 : 0) << "\t" << config.threadCount << "\t" << config.chunkSize << "\t" << config.parallelThreshold << "\n"; //write configuration
+        if (!file.flush()) //if writing failed
+            throw runtime_error("Failed writing tuner cache " + temporaryPath + "."); //throw runtime error
+    }
+#if defined(_WIN32)
+    remove(cachePath.c_str()); //rename doesn't replace existing files on Windows
+#endif
+    if (rename(temporaryPath.c_str(), cachePath.c_str()) != 0) { //if replacing cache failed
+        remove(temporaryPath.c_str()); //remove temporary file
+        throw runtime_error("Failed writing tuner cache " + cachePath + "."); //throw runtime error
+    }
+}
+
+
+/**
+ * @brief  Function that returns the key of the current machine in the cache, made of CPU model, hardware thread count and AES-NI support.
+ * @brief  Virtual machines that mask AES-NI or have fewer threads get their own configuration.
+ * @return  string machine
+ */
+string AESTuner::GetMachineKey() {
+    const size_t hardware = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1; //number of hardware threads
+    return GetCPUModel() + " | " + to_string(hardware) + " threads | " + (HasAESNI() ? "AES-NI" : "no AES-NI"); //return machine key
+}
+
+
+/**
+ * @brief  Function that returns the CPU model name of the current machine.
+ * @return  string cpuModel
+ */
+string AESTuner::GetCPUModel() {
+    string model; //represents CPU model name
+#if defined(AES_TUNER_CPUID)
+    unsigned int brand[12]{}; //represents processor brand string of CPUID leaves 0x80000002 to 0x80000004
+#if defined(_MSC_VER)
+    int info[4]{}; //represents CPUID registers
+    __cpuid(info, 0x80000000); //get highest extended leaf
+    if ((unsigned int)info[0] >= 0x80000004) //if brand string is supported
+        for (int i = 0; i < 3; i++) //iterate over brand string leaves
+            __cpuid((int*)brand + i * 4, 0x80000002 + i); //get part of brand string
+#else
+    if (__get_cpuid_max(0x80000000, NULL) >= 0x80000004) //if brand string is supported
+        for (unsigned int i = 0; i < 3; i++) //iterate over brand string leaves
+            __get_cpuid(0x80000002 + i, &brand[i * 4], &brand[i * 4 + 1], &brand[i * 4 + 2], &brand[i * 4 + 3]); //get part of brand string
+#endif
+    model.assign((const char*)brand, strnlen((const char*)brand, sizeof(brand))); //convert brand string
+#endif
+    if (model.find_first_not_of(' ') == string::npos) { //if brand string isn't available we read the model from /proc/cpuinfo
+        ifstream cpuinfo("/proc/cpuinfo"); //open cpuinfo, missing on other systems
+        for (string line; getline(cpuinfo, line);) { //iterate over lines
+            if (line.compare(0, 10, "model name") == 0 || line.compare(0, 8, "Hardware") == 0 || line.compare(0, 8, "CPU part") == 0) { //if line holds the model
+                size_t colon = line.find(':'); //find separator
+                if (colon != string::npos) //if separator found
+                    model = line.substr(colon + 1); //set model
+                break;
+            }
+        }
+    }
+    for (char& c : model) //iterate over model
+        if (c == '\t' || c == '\n' || c == '\r') c = ' '; //replace characters that would break the cache format
+    size_t first = model.find_first_not_of(' '), last = model.find_last_not_of(' '); //find model without surrounding spaces
+    return first == string::npos ? "unknown" : model.substr(first, last - first + 1); //return trimmed model
+}
+
+
+/**
+ * @brief  Function that returns the default cache file path, AES_TUNE_CACHE environment variable if set, otherwise a file in the user cache directory.
+ * @return  string cachePath
+ */
+string AESTuner::GetDefaultCachePath() {
+    if (const char* path = getenv("AES_TUNE_CACHE")) //if cache path is set explicitly
+        return path; //return given path
+#if defined(_WIN32)
+    if (const char* directory = getenv("LOCALAPPDATA")) //if local application data directory is known
+        return string(directory) + "\\aes_tune.cache"; //return file in local application data
+#else
+    if (const char* directory = getenv("XDG_CACHE_HOME")) //if user cache directory is set
+        return string(directory) + "/aes_tune.cache"; //return file in user cache directory
+    if (const char* directory = getenv("HOME")) //if home directory is known
+        return string(directory) + "/.aes_tune.cache"; //return hidden file in home directory
+#endif
+    return "aes_tune.cache"; //return file in current directory
+}
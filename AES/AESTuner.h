@@ -0,0 +1,98 @@
+#ifndef _AESTUNER_H
+#define _AESTUNER_H
+#include "AESKeyBatch.h"
+
+/**
+ * @file AESTuner.h
+ * @brief  AESTuner class that picks the fastest configuration of the library on the current machine.
+ * @brief  The key expansion backend, block backend of the vector mode functions, thread count, chunk size and parallel threshold are measured with short microbenchmarks.
+ * @brief  The winning configuration is stored in a small cache file keyed by CPU model, thread count and AES-NI support.
+ * @brief  Later process starts on the same machine load the configuration from the cache instead of measuring again.
+ */
+class AESTuner : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents a tuned configuration of the library.
+	 */
+	struct Config {
+		string machine; //machine the configuration was measured on, see GetMachineKey
+		bool useAESNI = false; //true if key expansion uses AES-NI
+		bool useVectorPermute = false; //true if the vector mode functions use the vector permute backend
+		size_t threadCount = 1; //number of threads for parallel operations
+		size_t chunkSize = 64 * 1024; //chunk size in bytes that each worker processes at a time
+		size_t parallelThreshold = 256 * 1024; //buffer size in bytes from which operations are processed in parallel
+	};
+
+	/**
+	 * @brief  Function that loads the configuration of the current machine from given cache file, or measures and stores it if it's missing.
+	 * @brief  The configuration is applied in both cases, an empty path uses GetDefaultCachePath.
+	 * @brief  A cache file that can't be written is ignored, the measured configuration is still applied.
+	 * @param  string cachePath
+	 * @return  Config config
+	 */
+	static Config Autotune(const string& cachePath = "");
+
+	/**
+	 * @brief  Function that measures the fastest configuration on the current machine, the current settings are restored afterwards.
+	 * @return  Config config
+	 */
+	static Config Measure();
+
+	/**
+	 * @brief  Function that applies given configuration to AES, AESParallel and AESKeyBatch.
+	 * @param  Config config
+	 * @throws  invalid_argument thrown if given configuration is invalid.
+	 */
+	static void Apply(const Config& config);
+
+	/**
+	 * @brief  Function that loads the configuration of given machine from given cache file.
+	 * @param  string cachePath
+	 * @param  string machine
+	 * @param  Config config
+	 * @return  bool isFound
+	 */
+	static bool Load(const string& cachePath, const string& machine, Config& config);
+
+	/**
+	 * @brief  Function that stores given configuration in given cache file, replacing an older configuration of the same machine.
+	 * @param  string cachePath
+	 * @param  Config config
+	 * @throws  runtime_error thrown if the cache file can't be written.
+	 */
+	static void Save(const string& cachePath, const Config& config);
+
+	/**
+	 * @brief  Function that returns the key of the current machine in the cache, made of CPU model, hardware thread count and AES-NI support.
+	 * @brief  Virtual machines that mask AES-NI or have fewer threads get their own configuration.
+	 * @return  string machine
+	 */
+	static string GetMachineKey();
+
+	/**
+	 * @brief  Function that returns the CPU model name of the current machine.
+	 * @return  string cpuModel
+	 */
+	static string GetCPUModel();
+
+	/**
+	 * @brief  Function that returns the default cache file path, AES_TUNE_CACHE environment variable if set, otherwise a file in the user cache directory.
+	 * @return  string cachePath
+	 */
+	static string GetDefaultCachePath();
+
+protected:
+	/**
+	 * @brief  Represents the header line of cache files, changed whenever the format changes.
+	 */
+	static const string CacheHeader;
+
+	/**
+	 * @brief  Function that runs given task given number of times and returns the fastest run in nanoseconds.
+	 * @param  function<void()> task
+	 * @param  size_t repeats
+	 * @return  double nanoseconds
+	 */
+	static double Time(const function<void()>& task, const size_t repeats);
+};
+#endif
@@ -0,0 +1,454 @@
+#include "AESVectorPermute.h"
+#include <cstring>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES_VPERM_TARGET
+#else
+#define AES_VPERM_TARGET __attribute__((target("ssse3")))
+#endif
+#define AES_VECTOR_PERMUTE_SSSE3
+#endif
+
+
+//use the vector permute backend by default when the processor supports SSSE3
+atomic<bool> AESVectorPermute::ssse3Enabled{ true };
+
+
+#ifdef AES_VECTOR_PERMUTE_SSSE3
+//tables of the vector permute design, every pair of quad words is one 16 byte PSHUFB table, pairs of tables are indexed by the low and high nibble or by io and jo
+alignas(16) static const uint64_t Inverse[4] = { 0x0E05060F0D080180, 0x040703090A0B0C02, 0x01040A060F0B0780, 0x030D0E0C02050809 }; //inverse in GF(2^4) and a/k
+alignas(16) static const uint64_t InputTransform[4] = { 0xC2B2E8985A2A7000, 0xCABAE09052227808, 0x4C01307D317C4D00, 0xCD80B1FCB0FDCC81 }; //change of basis into the tower field
+alignas(16) static const uint64_t OutputTransform[4] = { 0xFF9F4929D6B66000, 0xF7974121DEBE6808, 0x01EDBD5150BCEC00, 0xE10D5DB1B05C0CE0 }; //change of basis of last encryption round key
+alignas(16) static const uint64_t Deskew[4] = { 0x07E4A34047A4E300, 0x1DFEB95A5DBEF91A, 0x5F36B5DC83EA6900, 0x2841C2ABF49D1E77 }; //change of basis of last decryption round key
+alignas(16) static const uint64_t SBox1[4] = { 0xB19BE18FCB503E00, 0xA5DF7A6E142AF544, 0x3618D415FAE22300, 0x3BF7CCC10D2ED9EF }; //SubBytes output
+alignas(16) static const uint64_t SBox2[4] = { 0xE27A93C60B712400, 0x5EB7E955BC982FCD, 0x69EB88400AE12900, 0xC2A163C8AB82234A }; //SubBytes output multiplied by 2
+alignas(16) static const uint64_t SBoxOutput[4] = { 0xD0D26D176FBDC700, 0x15AABF7AC502A878, 0xCFE474A55FBB6A00, 0x8E1E90D1412B35FA }; //SubBytes output of last round
+alignas(16) static const uint64_t MixForward[8] = { 0x0407060500030201, 0x0C0F0E0D080B0A09, 0x080B0A0904070605, 0x000302010C0F0E0D, 0x0C0F0E0D080B0A09, 0x0407060500030201, 0x000302010C0F0E0D, 0x080B0A0904070605 }; //rotations of columns for each round modulo 4
+alignas(16) static const uint64_t MixBackward[8] = { 0x0605040702010003, 0x0E0D0C0F0A09080B, 0x020100030E0D0C0F, 0x0A09080B06050407, 0x0E0D0C0F0A09080B, 0x0605040702010003, 0x0A09080B06050407, 0x020100030E0D0C0F }; //inverse rotations of columns for each round modulo 4
+alignas(16) static const uint64_t RowShifts[8] = { 0x0706050403020100, 0x0F0E0D0C0B0A0908, 0x030E09040F0A0500, 0x0B06010C07020D08, 0x0F060D040B020900, 0x070E050C030A0108, 0x0B0E0104070A0D00, 0x0306090C0F020508 }; //ShiftRows applied 0 to 3 times
+alignas(16) static const uint64_t RoundConstant[2] = { 0x1F8391B9AF9DEEB6, 0x702A98084D7C7D81 }; //round constants of key schedule in the basis of the design
+alignas(16) static const uint64_t DecryptKeyD[4] = { 0xFEB91A5DA3E44700, 0x0740E3A45A1DBEF9, 0x41C277F4B5368300, 0x5FDC69EAAB289D1E }; //decryption key schedule, inverse skew times 0x0D
+alignas(16) static const uint64_t DecryptKeyB[4] = { 0x9A4FCA1F8550D500, 0x03D653861CC94C99, 0x115BEDA7B6FC4A00, 0xD993256F7E3482C8 }; //decryption key schedule, inverse skew times 0x0B
+alignas(16) static const uint64_t DecryptKeyE[4] = { 0xD5031CCA1FC9D600, 0x53859A4C994F5086, 0xA23196054FDC7BE8, 0xCD5EF96A20B31487 }; //decryption key schedule, inverse skew times 0x0E plus 0x63
+alignas(16) static const uint64_t DecryptKey9[4] = { 0xB6116FC87ED9A700, 0x4AED933482255BFC, 0x4576516227143300, 0x8BB89FACE9DAFDCE }; //decryption key schedule, inverse skew times 0x09
+alignas(16) static const uint64_t DecryptInputTransform[4] = { 0x0F505B040B545F00, 0x154A411E114E451A, 0x86E383E660056500, 0x12771772F491F194 }; //change of basis of decryption input
+alignas(16) static const uint64_t DecryptSBox9[4] = { 0x851C03539A86D600, 0xCAD51F504F994CC9, 0xC03B1789ECD74900, 0x725E2C9EB2FBA565 }; //InvSubBytes output multiplied by 0x09
+alignas(16) static const uint64_t DecryptSBoxD[4] = { 0x7D57CCDFE6B1A200, 0xF56E9B13882A4439, 0x3CE2FAF724C6CB00, 0x2931180D15DEEFD3 }; //InvSubBytes output multiplied by 0x0D
+alignas(16) static const uint64_t DecryptSBoxB[4] = { 0xD022649296B44200, 0x602646F6B0F2D404, 0xC19498A6CD596700, 0xF3FF0C3E3255AA6B }; //InvSubBytes output multiplied by 0x0B
+alignas(16) static const uint64_t DecryptSBoxE[4] = { 0x46F2929626D4D000, 0x2242600464B4F6B0, 0x0C55A6CDFFAAC100, 0x9467F36B98593E32 }; //InvSubBytes output multiplied by 0x0E
+alignas(16) static const uint64_t DecryptSBoxOutput[4] = { 0x1387EA537EF94000, 0xC7AA6DB9D4943E2D, 0x12D7560F93441D00, 0xCA4B8159D8C58E9C }; //InvSubBytes output of last round
+
+
+/**
+ * @brief  Function that loads the 16 byte table at given position.
+ * @param  const uint64_t* table
+ * @return  __m128i table
+ */
+AES_VPERM_TARGET static inline __m128i Table(const uint64_t* table) {
+    return _mm_load_si128((const __m128i*)table); //load aligned table
+}
+
+
+/**
+ * @brief  Function that looks up the low nibbles of given bytes in the first table and the high nibbles in the second table and XORs the results.
+ * @param  __m128i bytes
+ * @param  const uint64_t* tables
+ * @return  __m128i transformed
+ */
+AES_VPERM_TARGET static inline __m128i Transform(const __m128i bytes, const uint64_t* tables) {
+    const __m128i mask = _mm_set1_epi8(0x0F); //represents mask of low nibbles
+    __m128i high = _mm_srli_epi32(_mm_andnot_si128(mask, bytes), 4); //high nibbles
+    __m128i low = _mm_and_si128(bytes, mask); //low nibbles
+    return _mm_xor_si128(_mm_shuffle_epi8(Table(tables), low), _mm_shuffle_epi8(Table(tables + 2), high)); //look up both nibbles and combine them
+}
+
+
+/**
+ * @brief  Function that inverts given bytes in the tower field and returns the two halves of the inverse as indices into the output tables.
+ * @param  __m128i bytes
+ * @param  __m128i io
+ * @param  __m128i jo
+ */
+AES_VPERM_TARGET static inline void Invert(const __m128i bytes, __m128i& io, __m128i& jo) {
+    const __m128i mask = _mm_set1_epi8(0x0F), inverse = Table(Inverse), inverseA = Table(Inverse + 2); //represents mask of low nibbles and inverse tables
+    __m128i i = _mm_srli_epi32(_mm_andnot_si128(mask, bytes), 4); //high nibbles
+    __m128i k = _mm_and_si128(bytes, mask); //low nibbles
+    __m128i ak = _mm_shuffle_epi8(inverseA, k); //a/k
+    __m128i j = _mm_xor_si128(k, i); //j = i + k
+    __m128i iak = _mm_xor_si128(_mm_shuffle_epi8(inverse, i), ak); //1/i + a/k
+    __m128i jak = _mm_xor_si128(_mm_shuffle_epi8(inverse, j), ak); //1/j + a/k
+    io = _mm_xor_si128(_mm_shuffle_epi8(inverse, iak), j); //1/iak + j
+    jo = _mm_xor_si128(_mm_shuffle_epi8(inverse, jak), i); //1/jak + i
+}
+
+
+/**
+ * @brief  Function that looks up given halves of the inverse in given pair of output tables and XORs the results.
+ * @param  const uint64_t* tables
+ * @param  __m128i io
+ * @param  __m128i jo
+ * @return  __m128i output
+ */
+AES_VPERM_TARGET static inline __m128i Output(const uint64_t* tables, const __m128i io, const __m128i jo) {
+    return _mm_xor_si128(_mm_shuffle_epi8(Table(tables), io), _mm_shuffle_epi8(Table(tables + 2), jo)); //look up both halves and combine them
+}
+
+
+/**
+ * @brief  Function that performs the SubBytes part of a key schedule round on given word and XORs it into given previous round key, which becomes the result.
+ * @param  __m128i word
+ * @param  __m128i previous
+ * @return  __m128i roundKey
+ */
+AES_VPERM_TARGET static inline __m128i LowRound(const __m128i word, __m128i& previous) {
+    __m128i io, jo; //represents halves of inverse
+    previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4)); //XOR with words shifted by one position
+    previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 8)); //XOR with words shifted by two positions
+    previous = _mm_xor_si128(previous, _mm_set1_epi8(0x5B)); //add 0x63 in the basis of the design
+    Invert(word, io, jo); //invert bytes of word
+    previous = _mm_xor_si128(Output(SBox1, io, jo), previous); //substitute word and add it to previous round key
+    return previous; //return round key
+}
+
+
+/**
+ * @brief  Function that performs a full key schedule round, rotates the last word of given key, adds the round constant and XORs it into given previous round key.
+ * @param  __m128i key
+ * @param  __m128i previous
+ * @param  __m128i rcon
+ * @return  __m128i roundKey
+ */
+AES_VPERM_TARGET static inline __m128i ScheduleRound(const __m128i key, __m128i& previous, __m128i& rcon) {
+    previous = _mm_xor_si128(previous, _mm_alignr_epi8(_mm_setzero_si128(), rcon, 15)); //add round constant, its last byte
+    rcon = _mm_alignr_epi8(rcon, rcon, 15); //rotate round constants for next round
+    __m128i word = _mm_shuffle_epi32(key, 0xFF); //broadcast last word
+    word = _mm_alignr_epi8(word, word, 1); //rotate word by one byte
+    return LowRound(word, previous); //substitute word and add it to previous round key
+}
+
+
+/**
+ * @brief  Function that smears the short half of an AES-192 key schedule into its next words.
+ * @param  __m128i shortHalf
+ * @param  __m128i previous
+ * @return  __m128i key
+ */
+AES_VPERM_TARGET static inline __m128i Smear192(__m128i& shortHalf, const __m128i previous) {
+    shortHalf = _mm_xor_si128(shortHalf, _mm_shuffle_epi32(shortHalf, 0x80)); //XOR with its words shifted up
+    shortHalf = _mm_xor_si128(shortHalf, _mm_shuffle_epi32(previous, 0xFE)); //XOR with last words of previous round key
+    __m128i key = shortHalf; //represents smeared key
+    shortHalf = _mm_unpackhi_epi64(_mm_setzero_si128(), shortHalf); //clear low half of short half
+    return key; //return smeared key
+}
+
+
+/**
+ * @brief  Function that stores given round key into the schedule, mixing it for encryption or transforming it for decryption, and moves given position.
+ * @param  __m128i key
+ * @param  unsigned char* position
+ * @param  size_t shift
+ * @param  bool decrypt
+ */
+AES_VPERM_TARGET static inline void Mangle(const __m128i key, unsigned char*& position, size_t& shift, const bool decrypt) {
+    const __m128i forward = Table(MixForward); //represents rotation of columns
+    __m128i mixed; //represents stored round key
+    if (!decrypt) { //if we store an encryption round key
+        __m128i rotated = _mm_shuffle_epi8(_mm_xor_si128(key, _mm_set1_epi8(0x5B)), forward); //remove 0x63 and rotate columns
+        mixed = rotated; //first rotation
+        rotated = _mm_shuffle_epi8(rotated, forward); //rotate again
+        mixed = _mm_xor_si128(mixed, rotated); //add second rotation
+        rotated = _mm_shuffle_epi8(rotated, forward); //rotate again
+        mixed = _mm_xor_si128(mixed, rotated); //add third rotation
+        position += 16; //encryption round keys are stored forwards
+    }
+    else { //else we store a decryption round key
+        mixed = _mm_shuffle_epi8(Transform(key, DecryptKeyD), forward); //multiply by 0x0D and rotate
+        mixed = _mm_shuffle_epi8(_mm_xor_si128(mixed, Transform(key, DecryptKeyB)), forward); //add key times 0x0B and rotate
+        mixed = _mm_shuffle_epi8(_mm_xor_si128(mixed, Transform(key, DecryptKeyE)), forward); //add key times 0x0E and rotate
+        mixed = _mm_xor_si128(mixed, Transform(key, DecryptKey9)); //add key times 0x09
+        position -= 16; //decryption round keys are stored backwards
+    }
+    mixed = _mm_shuffle_epi8(mixed, Table(RowShifts + 2 * shift)); //apply ShiftRows of round
+    shift = (shift - 1) & 3; //previous ShiftRows for next round key
+    _mm_storeu_si128((__m128i*)position, mixed); //store round key
+}
+
+
+/**
+ * @brief  Function that expands given key into round keys of given direction in the basis of the design.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* roundKeys
+ * @param  bool decrypt
+ */
+AES_VPERM_TARGET static void Schedule(const unsigned char* key, const size_t keySize, unsigned char* roundKeys, const bool decrypt) {
+    const size_t rounds = keySize / 4 + 6; //number of rounds (10, 12 or 14)
+    __m128i rcon = Table(RoundConstant); //represents round constants
+    __m128i raw = _mm_loadu_si128((const __m128i*)key); //first 16 bytes of key
+    __m128i current = Transform(raw, InputTransform); //represents current round key in the basis of the design
+    __m128i previous = current; //represents previous round key
+    size_t shift = decrypt ? (keySize == 24 ? 0 : 2) : 3; //represents ShiftRows of next stored round key
+    unsigned char* position = roundKeys; //represents position of last stored round key
+    if (!decrypt) //if we expand encryption round keys
+        _mm_storeu_si128((__m128i*)position, current); //first round key is the transformed key
+    else { //else decryption round keys are stored backwards
+        position = roundKeys + rounds * 16; //first round key is the last one of decryption
+        _mm_storeu_si128((__m128i*)position, _mm_shuffle_epi8(raw, Table(RowShifts + 2 * shift))); //store key with ShiftRows applied
+        shift ^= 3; //next ShiftRows
+    }
+    if (keySize == 16) { //if key is AES-128
+        for (size_t i = 10;;) { //iterate over round keys
+            current = ScheduleRound(current, previous, rcon); //generate next round key
+            if (--i == 0) break; //last round key is stored below
+            Mangle(current, position, shift, decrypt); //store round key
+        }
+    }
+    else if (keySize == 24) { //if key is AES-192, each round produces one and a half round keys
+        current = Transform(_mm_loadu_si128((const __m128i*)(key + 8)), InputTransform); //last 16 bytes of key, the first round rotates its last word
+        __m128i shortHalf = _mm_unpackhi_epi64(_mm_setzero_si128(), current); //last 8 bytes of key in high half
+        for (size_t i = 4;;) { //iterate over pairs of rounds
+            current = ScheduleRound(current, previous, rcon); //generate next words
+            current = _mm_alignr_epi8(current, shortHalf, 8); //combine with short half into round key
+            Mangle(current, position, shift, decrypt); //store round key
+            current = Smear192(shortHalf, previous); //smear short half
+            Mangle(current, position, shift, decrypt); //store round key
+            current = ScheduleRound(current, previous, rcon); //generate next round key
+            if (--i == 0) break; //last round key is stored below
+            Mangle(current, position, shift, decrypt); //store round key
+            current = Smear192(shortHalf, previous); //smear short half
+        }
+    }
+    else { //else key is AES-256, rounds alternate between both halves
+        current = Transform(_mm_loadu_si128((const __m128i*)(key + 16)), InputTransform); //last 16 bytes of key
+        for (size_t i = 7;;) { //iterate over pairs of rounds
+            Mangle(current, position, shift, decrypt); //store high half
+            __m128i low = current; //represents high half, which is the previous key of the low round
+            current = ScheduleRound(current, previous, rcon); //generate next round key
+            if (--i == 0) break; //last round key is stored below
+            Mangle(current, position, shift, decrypt); //store round key
+            current = LowRound(_mm_shuffle_epi32(current, 0xFF), low); //generate next high half without rotation and round constant
+        }
+    }
+    const uint64_t* output = Deskew; //represents change of basis of last round key
+    if (!decrypt) { //if we expand encryption round keys
+        current = _mm_shuffle_epi8(current, Table(RowShifts + 2 * shift)); //apply ShiftRows of last round
+        output = OutputTransform; //last encryption round key leaves the basis of the design
+        position += 2 * 16; //last round key follows previous one
+    }
+    position -= 16; //last round key precedes previous one when decrypting
+    _mm_storeu_si128((__m128i*)position, Transform(_mm_xor_si128(current, _mm_set1_epi8(0x5B)), output)); //store last round key
+}
+
+
+/**
+ * @brief  Function that expands given key into round keys of encryption and decryption in the basis of the design.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* encryptKeys
+ * @param  unsigned char* decryptKeys
+ */
+void AESVectorPermute::ExpandSSSE3(const unsigned char* key, const size_t keySize, unsigned char* encryptKeys, unsigned char* decryptKeys) {
+    Schedule(key, keySize, encryptKeys, false); //expand encryption round keys
+    Schedule(key, keySize, decryptKeys, true); //expand decryption round keys
+}
+
+
+/**
+ * @brief  Function that encrypts given number of consecutive blocks in place with vector permutes.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ */
+AES_VPERM_TARGET void AESVectorPermute::EncryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds) {
+    for (size_t b = 0; b < count; b++) { //iterate over blocks
+        __m128i* block = (__m128i*)(blocks + b * BlockSize); //represents current block
+        __m128i state = _mm_xor_si128(Transform(_mm_loadu_si128(block), InputTransform), _mm_loadu_si128((const __m128i*)roundKeys)); //change basis and add first round key
+        __m128i io, jo; //represents halves of inverse
+        size_t shift = 1; //represents rotation of columns of current round
+        Invert(state, io, jo); //SubBytes of first round
+        for (size_t round = 1; round < rounds; round++) { //iterate over middle rounds
+            __m128i forward = Table(MixForward + 2 * shift), backward = Table(MixBackward + 2 * shift); //rotations of columns of round
+            __m128i a = _mm_xor_si128(Output(SBox1, io, jo), _mm_loadu_si128((const __m128i*)(roundKeys + round * BlockSize))); //A = S(x) + k
+            __m128i a2 = Output(SBox2, io, jo); //2A = 2 * S(x)
+            __m128i b2 = _mm_xor_si128(_mm_shuffle_epi8(a, forward), a2); //B = 2A + rotated A
+            __m128i d = _mm_shuffle_epi8(a, backward); //D = A rotated backwards
+            state = _mm_xor_si128(_mm_xor_si128(_mm_shuffle_epi8(b2, forward), d), b2); //MixColumns = rotated B + D + B
+            shift = (shift + 1) & 3; //rotation of next round
+            Invert(state, io, jo); //SubBytes of next round
+        }
+        state = _mm_xor_si128(Output(SBoxOutput, io, jo), _mm_loadu_si128((const __m128i*)(roundKeys + rounds * BlockSize))); //last SubBytes and last round key
+        _mm_storeu_si128(block, _mm_shuffle_epi8(state, Table(RowShifts + 2 * shift))); //apply remaining ShiftRows and store block
+    }
+}
+
+
+/**
+ * @brief  Function that decrypts given number of consecutive blocks in place with vector permutes.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ */
+AES_VPERM_TARGET void AESVectorPermute::DecryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds) {
+    for (size_t b = 0; b < count; b++) { //iterate over blocks
+        __m128i* block = (__m128i*)(blocks + b * BlockSize); //represents current block
+        __m128i state = _mm_xor_si128(Transform(_mm_loadu_si128(block), DecryptInputTransform), _mm_loadu_si128((const __m128i*)roundKeys)); //change basis and add first round key
+        __m128i mix = Table(MixForward + 6), io, jo; //represents rotation of columns and halves of inverse
+        Invert(state, io, jo); //InvSubBytes of first round
+        for (size_t round = 1; round < rounds; round++) { //iterate over middle rounds
+            state = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(roundKeys + round * BlockSize)), Output(DecryptSBox9, io, jo)); //round key + 9 * S(x)
+            state = _mm_xor_si128(_mm_shuffle_epi8(state, mix), Output(DecryptSBoxD, io, jo)); //rotate and add 0x0D * S(x)
+            state = _mm_xor_si128(_mm_shuffle_epi8(state, mix), Output(DecryptSBoxB, io, jo)); //rotate and add 0x0B * S(x)
+            state = _mm_xor_si128(_mm_shuffle_epi8(state, mix), Output(DecryptSBoxE, io, jo)); //rotate and add 0x0E * S(x)
+            mix = _mm_alignr_epi8(mix, mix, 12); //rotation of next round
+            Invert(state, io, jo); //InvSubBytes of next round
+        }
+        state = _mm_xor_si128(Output(DecryptSBoxOutput, io, jo), _mm_loadu_si128((const __m128i*)(roundKeys + rounds * BlockSize))); //last InvSubBytes and last round key
+        _mm_storeu_si128(block, _mm_shuffle_epi8(state, Table(RowShifts + 2 * (((rounds - 1) ^ 3) & 3)))); //apply remaining ShiftRows and store block
+    }
+}
+#else
+/**
+ * @brief  Function that expands given key into round keys of encryption and decryption in the basis of the design.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  unsigned char* encryptKeys
+ * @param  unsigned char* decryptKeys
+ */
+void AESVectorPermute::ExpandSSSE3(const unsigned char* key, const size_t keySize, unsigned char* encryptKeys, unsigned char* decryptKeys) {
+    (void)decryptKeys; //SSSE3 isn't available on this architecture so decryption uses the encryption round keys
+    KeySchedule(key, keySize, encryptKeys); //generate flat round keys
+}
+
+
+/**
+ * @brief  Function that encrypts given number of consecutive blocks in place with vector permutes.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ */
+void AESVectorPermute::EncryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds) {
+    for (size_t i = 0; i < count; i++) //SSSE3 isn't available on this architecture so we use the table-based encryption
+        EncryptBlock(blocks + i * BlockSize, roundKeys, rounds); //encrypt the block using flat round keys
+}
+
+
+/**
+ * @brief  Function that decrypts given number of consecutive blocks in place with vector permutes.
+ * @brief  Must only be called if HasSSSE3 returns true.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  const unsigned char* roundKeys
+ * @param  size_t rounds
+ */
+void AESVectorPermute::DecryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds) {
+    for (size_t i = 0; i < count; i++) //SSSE3 isn't available on this architecture so we use the table-based decryption
+        DecryptBlock(blocks + i * BlockSize, roundKeys, rounds); //decrypt the block using flat round keys
+}
+#endif
+
+
+/**
+ * @brief  Function that expands given key into given schedule, key size must be valid.
+ * @param  const unsigned char* key
+ * @param  size_t keySize
+ * @param  Schedule schedule
+ */
+void AESVectorPermute::Backend::Expand(const unsigned char* key, const size_t keySize, Schedule& schedule) {
+    schedule.rounds = keySize / Nb + 6; //number of rounds derived from key
+    schedule.isPermuted = UsesSSSE3(); //save implementation so later calls match the round keys
+    if (schedule.isPermuted) //if we use vector permutes
+        ExpandSSSE3(key, keySize, schedule.encryptKeys, schedule.decryptKeys); //expand round keys of both directions
+    else //else we fall back to the table-based backend
+        KeySchedule(key, keySize, schedule.encryptKeys); //generate flat round keys
+}
+
+
+/**
+ * @brief  Function that clears given schedule.
+ * @param  Schedule schedule
+ */
+void AESVectorPermute::Backend::Clear(Schedule& schedule) {
+    volatile unsigned char* bytes = schedule.encryptKeys; //write through volatile so permuted round keys are really wiped
+    for (size_t i = 0; i < sizeof(schedule.encryptKeys); i++) //iterate over round keys of encryption
+        bytes[i] = 0x00; //clear each byte
+    bytes = schedule.decryptKeys; //round keys of decryption
+    for (size_t i = 0; i < sizeof(schedule.decryptKeys); i++) //iterate over round keys of decryption
+        bytes[i] = 0x00; //clear each byte
+}
+
+
+/**
+ * @brief  Function that encrypts given number of consecutive blocks in place.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  Schedule schedule
+ */
+void AESVectorPermute::Backend::EncryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule) {
+    if (schedule.isPermuted) //if schedule is in the basis of the design
+        EncryptSSSE3(blocks, count, schedule.encryptKeys, schedule.rounds); //encrypt blocks with vector permutes
+    else //else we use the table-based fallback
+        for (size_t i = 0; i < count; i++) //iterate over blocks
+            EncryptBlock(blocks + i * BlockSize, schedule.encryptKeys, schedule.rounds); //encrypt the block using flat round keys
+}
+
+
+/**
+ * @brief  Function that decrypts given number of consecutive blocks in place.
+ * @param  unsigned char* blocks
+ * @param  size_t count
+ * @param  Schedule schedule
+ */
+void AESVectorPermute::Backend::DecryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule) {
+    if (schedule.isPermuted) //if schedule is in the basis of the design
+        DecryptSSSE3(blocks, count, schedule.decryptKeys, schedule.rounds); //decrypt blocks with vector permutes
+    else //else we use the table-based fallback
+        for (size_t i = 0; i < count; i++) //iterate over blocks
+            DecryptBlock(blocks + i * BlockSize, schedule.encryptKeys, schedule.rounds); //decrypt the block using flat round keys
+}
+
+
+/**
+ * @brief  Function that returns if the processor supports SSSE3, in which case the backend uses vector permutes unless disabled.
+ * @return  bool hasSSSE3
+ */
+bool AESVectorPermute::HasSSSE3() {
+#if defined(AES_VECTOR_PERMUTE_SSSE3) && defined(_MSC_VER)
+    static const bool hasSSSE3 = []() { int info[4]{}; __cpuid(info, 1); return ((info[2] >> 9) & 1) != 0; }(); //check SSSE3 bit of CPUID leaf 1 once
+    return hasSSSE3; //return cached result
+#elif defined(AES_VECTOR_PERMUTE_SSSE3)
+    static const bool hasSSSE3 = __builtin_cpu_supports("ssse3"); //check processor features once
+    return hasSSSE3; //return cached result
+#else
+    return false; //SSSE3 isn't available on this architecture
+#endif
+}
+
+
+/**
+ * @brief  Function that enables or disables the vector permute backend, it's only used if the processor supports SSSE3.
+ * @brief  Schedules expanded before the change keep the implementation they were expanded for.
+ * @param  bool enabled
+ */
+void AESVectorPermute::SetSSSE3(const bool enabled) {
+    ssse3Enabled = enabled; //set if SSSE3 is enabled
+}
+
+
+/**
+ * @brief  Function that returns if the backend uses vector permutes, which requires them to be enabled and SSSE3 to be supported by the processor.
+ * @return  bool usesSSSE3
+ */
+bool AESVectorPermute::UsesSSSE3() {
+    return ssse3Enabled && HasSSSE3(); //return if SSSE3 is enabled and supported
+}
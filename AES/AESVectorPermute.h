@@ -0,0 +1,116 @@
+#ifndef _AESVECTORPERMUTE_H
+#define _AESVECTORPERMUTE_H
+#include "AES.h"
+#include <atomic>
+
+/**
+ * @file AESVectorPermute.h
+ * @brief  AESVectorPermute class, a constant-time block backend for AESModeEngine in the style of the vector permute design by Mike Hamburg (vpaes).
+ * @brief  SubBytes inverts each byte in GF(2^8) as a tower of GF(2^4) with 16 entry PSHUFB nibble tables, so there are no secret-indexed SBOX or GaloisMult lookups.
+ * @brief  MixColumns and ShiftRows are byte permutations, the key schedule uses the same SubBytes and stores round keys in the basis of the design.
+ * @brief  It targets serial modes such as CBC encryption, CFB and OFB on processors without AES-NI, one block takes a few dozen vector instructions per round.
+ * @brief  Requires SSSE3, on other processors or architectures the backend falls back to the table-based EncryptBlock and DecryptBlock, which aren't constant-time.
+ */
+class AESVectorPermute : public AES {
+public:
+	/**
+	 * @brief  Represents the vector permute backend of the mode engine, selected with AESModeEngine::Encrypt<AESVectorPermute::Backend, Policy> or for the vector mode functions with AES::SetBackend.
+	 */
+	struct Backend {
+		/**
+		 * @brief  Represents the expanded round keys of a key for both directions.
+		 */
+		struct Schedule {
+			alignas(16) unsigned char encryptKeys[15 * BlockSize]; //round keys of encryption, 11, 13 or 15 keys of 16 bytes
+			alignas(16) unsigned char decryptKeys[15 * BlockSize]; //round keys of decryption in the basis of the design, unused by the fallback
+			size_t rounds; //number of rounds (10, 12 or 14)
+			bool isPermuted; //true if round keys are in the basis of the design, false if they're plain round keys of the fallback
+		};
+
+		/**
+		 * @brief  Function that expands given key into given schedule, key size must be valid.
+		 * @param  const unsigned char* key
+		 * @param  size_t keySize
+		 * @param  Schedule schedule
+		 */
+		static void Expand(const unsigned char* key, const size_t keySize, Schedule& schedule);
+
+		/**
+		 * @brief  Function that clears given schedule.
+		 * @param  Schedule schedule
+		 */
+		static void Clear(Schedule& schedule);
+
+		/**
+		 * @brief  Function that encrypts given number of consecutive blocks in place.
+		 * @param  unsigned char* blocks
+		 * @param  size_t count
+		 * @param  Schedule schedule
+		 */
+		static void EncryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule);
+
+		/**
+		 * @brief  Function that decrypts given number of consecutive blocks in place.
+		 * @param  unsigned char* blocks
+		 * @param  size_t count
+		 * @param  Schedule schedule
+		 */
+		static void DecryptBlocks(unsigned char* blocks, const size_t count, const Schedule& schedule);
+	};
+
+	/**
+	 * @brief  Function that returns if the processor supports SSSE3, in which case the backend uses vector permutes unless disabled.
+	 * @return  bool hasSSSE3
+	 */
+	static bool HasSSSE3();
+
+	/**
+	 * @brief  Function that enables or disables the vector permute backend, it's only used if the processor supports SSSE3.
+	 * @brief  Schedules expanded before the change keep the implementation they were expanded for.
+	 * @param  bool enabled
+	 */
+	static void SetSSSE3(const bool enabled);
+
+	/**
+	 * @brief  Function that returns if the backend uses vector permutes, which requires them to be enabled and SSSE3 to be supported by the processor.
+	 * @return  bool usesSSSE3
+	 */
+	static bool UsesSSSE3();
+
+protected:
+	/**
+	 * @brief  Represents if the vector permute backend is enabled, true by default.
+	 */
+	static atomic<bool> ssse3Enabled;
+
+	/**
+	 * @brief  Function that expands given key into round keys of encryption and decryption in the basis of the design.
+	 * @brief  Must only be called if HasSSSE3 returns true.
+	 * @param  const unsigned char* key
+	 * @param  size_t keySize
+	 * @param  unsigned char* encryptKeys
+	 * @param  unsigned char* decryptKeys
+	 */
+	static void ExpandSSSE3(const unsigned char* key, const size_t keySize, unsigned char* encryptKeys, unsigned char* decryptKeys);
+
+	/**
+	 * @brief  Function that encrypts given number of consecutive blocks in place with vector permutes.
+	 * @brief  Must only be called if HasSSSE3 returns true.
+	 * @param  unsigned char* blocks
+	 * @param  size_t count
+	 * @param  const unsigned char* roundKeys
+	 * @param  size_t rounds
+	 */
+	static void EncryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds);
+
+	/**
+	 * @brief  Function that decrypts given number of consecutive blocks in place with vector permutes.
+	 * @brief  Must only be called if HasSSSE3 returns true.
+	 * @param  unsigned char* blocks
+	 * @param  size_t count
+	 * @param  const unsigned char* roundKeys
+	 * @param  size_t rounds
+	 */
+	static void DecryptSSSE3(unsigned char* blocks, const size_t count, const unsigned char* roundKeys, const size_t rounds);
+};
+#endif
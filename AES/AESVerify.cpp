@@ -0,0 +1,1434 @@
+#include "AESVerify.h"
+#include "AESStream.h"
+#include "AESPipeline.h"
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#ifdef AES_KEYSTORE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+const char* const AESVerify::Modes[5] = { "ECB", "CBC", "CFB", "OFB", "CTR" };
+const size_t AESVerify::ChunkWidths[4] = { 16, 48, 4096, 65536 };
+
+
+/**
+ * @brief  Represents the FIPS-197 examples and the NIST AESAVS known answer samples, each with name, key, plaintext and ciphertext.
+ */
+static const char* const BlockVectors[][4] = {
+    { "FIPS-197 C.1", "000102030405060708090a0b0c0d0e0f", "00112233445566778899aabbccddeeff", "69c4e0d86a7b0430d8cdb78070b4c55a" },
+    { "FIPS-197 C.2", "000102030405060708090a0b0c0d0e0f1011121314151617", "00112233445566778899aabbccddeeff", "dda97ca4864cdfe06eaf70a0ec0d7191" },
+    { "FIPS-197 C.3", "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "00112233445566778899aabbccddeeff", "8ea2b7ca516745bfeafc49904b496089" },
+    { "AESAVS GFSbox-128", "00000000000000000000000000000000", "f34481ec3cc627bacd5dc3fb08f273e6", "0336763e966d92595a567cc9ce537f5e" },
+    { "AESAVS GFSbox-192", "000000000000000000000000000000000000000000000000", "1b077a6af4b7f98229de786d7516b639", "275cfc0413d8ccb70513c3859b1d0f72" },
+    { "AESAVS GFSbox-256", "0000000000000000000000000000000000000000000000000000000000000000", "014730f80ac625fe84f026c60bfd547d", "5c9d844ed46f9885085e5d6a4f94c7d7" },
+    { "AESAVS KeySbox-128", "10a58869d74be5a374cf867cfb473859", "00000000000000000000000000000000", "6d251e6944b051e04eaa6fb4dbf78465" },
+    { "AESAVS VarTxt-128", "00000000000000000000000000000000", "80000000000000000000000000000000", "3ad78e726c1ec02b7ebfe92b23d9ec34" },
+    { "AESAVS VarKey-128", "80000000000000000000000000000000", "00000000000000000000000000000000", "0edd33d3c621e546455bd8ba1418bec8" }
+};
+
+
+/**
+ * @brief  Represents the NIST SP 800-38A vectors, each with mode, key and ciphertext of the common four block plaintext.
+ */
+static const char* const ModeVectors[][3] = {
+    { "ECB", "2b7e151628aed2a6abf7158809cf4f3c", "3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4" },
+    { "CBC", "2b7e151628aed2a6abf7158809cf4f3c", "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b273bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7" },
+    { "CFB", "2b7e151628aed2a6abf7158809cf4f3c", "3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b26751f67a3cbb140b1808cf187a4f4dfc04b05357c5d1c0eeac4c66f9ff7f2e6" },
+    { "OFB", "2b7e151628aed2a6abf7158809cf4f3c", "3b3fd92eb72dad20333449f8e83cfb4a7789508d16918f03f53c52dac54ed8259740051e9c5fecf64344f7a82260edcc304c6528f659c77866a510d9c1d6ae5e" },
+    { "CTR", "2b7e151628aed2a6abf7158809cf4f3c", "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee" },
+    { "ECB", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "bd334f1d6e45f25ff712a214571fa5cc974104846d0ad3ad7734ecb3ecee4eefef7afd2270e2e60adce0ba2face6444e9a4b41ba738d6c72fb16691603c18e0e" },
+    { "CBC", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "4f021db243bc633d7178183a9fa071e8b4d9ada9ad7dedf4e5e738763f69145a571b242012fb7ae07fa9baac3df102e008b0e27988598881d920a9e64f5615cd" },
+    { "CFB", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "cdc80d6fddf18cab34c25909c99a417467ce7f7f81173621961a2b70171d3d7a2e1e8a1dd59b88b1c8e60fed1efac4c9c05f9f9ca9834fa042ae8fba584b09ff" },
+    { "OFB", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "cdc80d6fddf18cab34c25909c99a4174fcc28b8d4c63837c09e81700c11004018d9a9aeac0f6596f559c6d4daf59a5f26d9f200857ca6c3e9cac524bd9acc92a" },
+    { "CTR", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "1abc932417521ca24f2b0459fe7e6e0b090339ec0aa6faefd5ccc2c6f4ce8e941e36b26bd1ebc670d1bd1d665620abf74f78a7f6d29809585a97daec58c6b050" },
+    { "ECB", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "f3eed1bdb5d2a03c064b5a7e3db181f8591ccb10d410ed26dc5ba74a31362870b6ed21b99ca6f4f9f153e7b1beafed1d23304b7a39f9f3ff067d8d8f9e24ecc7" },
+    { "CBC", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b" },
+    { "CFB", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "dc7e84bfda79164b7ecd8486985d386039ffed143b28b1c832113c6331e5407bdf10132415e54b92a13ed0a8267ae2f975a385741ab9cef82031623d55b1e471" },
+    { "OFB", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "dc7e84bfda79164b7ecd8486985d38604febdc6740d20b3ac88f6ad82a4fb08d71ab47a086e86eedf39d1c5bba97c4080126141d67f37be8538f5a8be740e484" },
+    { "CTR", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c52b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6" }
+};
+
+
+/**
+ * @brief  Represents the NIST SP 800-38G FF1 samples, each with key, radix, tweak, plaintext and ciphertext.
+ */
+static const char* const FF1Vectors[][5] = {
+    { "2b7e151628aed2a6abf7158809cf4f3c", "10", "", "0123456789", "2433477484" },
+    { "2b7e151628aed2a6abf7158809cf4f3c", "10", "39383736353433323130", "0123456789", "6124200773" },
+    { "2b7e151628aed2a6abf7158809cf4f3c", "36", "3737373770717273373737", "0123456789abcdefghi", "a9tv40mll9kdu509eum" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f", "10", "", "0123456789", "2830668132" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f", "10", "39383736353433323130", "0123456789", "2496655549" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f", "36", "3737373770717273373737", "0123456789abcdefghi", "xbj3kv35jrawxv32ysr" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f7f036d6f04fc6a94", "10", "", "0123456789", "6657667009" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f7f036d6f04fc6a94", "10", "39383736353433323130", "0123456789", "1001623463" },
+    { "2b7e151628aed2a6abf7158809cf4f3cef4359d8d580aa4f7f036d6f04fc6a94", "36", "3737373770717273373737", "0123456789abcdefghi", "xs8a0azh2avyalyzuwd" }
+};
+
+
+/**
+ * @brief  Represents the RFC 3394 and RFC 5649 key wrap examples, each with name, key encryption key, key data and wrapped key.
+ */
+static const char* const KeyWrapVectors[][4] = {
+    { "RFC 3394 4.1", "000102030405060708090a0b0c0d0e0f", "00112233445566778899aabbccddeeff", "1fa68b0a8112b447aef34bd8fb5a7b829d3e862371d2cfe5" },
+    { "RFC 3394 4.6", "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "00112233445566778899aabbccddeeff000102030405060708090a0b0c0d0e0f", "28c9f404c4b810f4cbccb35cfb87f8263f5786e2d80ed326cbc7f0e71a99f43bfb988b9b7a02dd21" },
+    { "RFC 5649 20 byte", "5840df6e29b02af1ab493b705bf16ea1ae8338f4dcc176a8", "c37b7e6492584340bed12207808941155068f738", "138bdeaa9b8fa7fc61f97742e72248ee5ae6ae5360d1ae6a5f54f373fa543b6a" },
+    { "RFC 5649 7 byte", "5840df6e29b02af1ab493b705bf16ea1ae8338f4dcc176a8", "466f7250617369", "afbeb0f07dfbf5419200f2ccb50bb24f" }
+};
+
+/**
+ * @brief  Function that runs the known answers, the Monte Carlo procedure and given number of random differential cases and returns the report.
+ * @brief  Parallel settings are changed while verifying and restored afterwards, so it shouldn't run alongside other parallel operations.
+ * @param  size_t iterations
+ * @param  size_t rounds
+ * @param  uint64_t seed
+ * @return  Report report
+ */
+AESVerify::Report AESVerify::Run(const size_t iterations, const size_t rounds, const uint64_t seed) {
+    Report report; //represents report of all checks
+    KnownAnswer(report); //check known answers
+    CheckWorkerLimits(report); //check scheduling of worker limits
+    CheckKeyStore(report); //check shared key store
+    CheckDaemon(report); //check daemon and client
+    MonteCarlo(report, rounds); //run Monte Carlo procedure
+    Differential(report, iterations, seed); //run random cases
+    return report; //return report
+}
+
+
+/**
+ * @brief  Function that checks the FIPS-197, AESAVS, SP 800-38A, RFC 7253, RFC 3720, RFC 3394 and RFC 5649 known answers on every path, round-trips the containers, sessions, scatter-gather lists and buffer pool, and adds the results to given report.
+ * @param  Report report
+ */
+void AESVerify::KnownAnswer(Report& report) {
+    for (const auto& answer : BlockVectors) { //iterate over block vectors
+        CheckKnown(report, answer[0], "ECB", answer[1], "", answer[2], answer[3]); //check vector as a single ECB block
+        vector<unsigned char> key = HexToVector(answer[1]); //represents key of vector
+        vector<vector<unsigned char>> roundKeys = KeySchedule(key); //represents reference round keys
+        vector<unsigned char> expected; //represents reference round keys stored back to back
+        for (const vector<unsigned char>& roundKey : roundKeys) //iterate over round keys
+            expected.insert(expected.end(), roundKey.begin(), roundKey.end()); //append round key
+        unsigned char flat[15 * BlockSize] = {}; //represents flat round keys
+        KeySchedule(key.data(), key.size(), flat); //expand with flat key schedule
+        Compare(report, string(answer[0]) + " KeySchedule", expected.data(), flat, expected.size()); //compare flat key schedule
+        ExpandSoftware(key.data(), key.size(), flat); //expand with AESKeyBatch software expansion
+        Compare(report, string(answer[0]) + " AESKeyBatch software expansion", expected.data(), flat, expected.size()); //compare software expansion
+        if (HasAESNI()) { //if processor supports AES-NI we check its expansion too
+            ExpandAESNI(key.data(), key.size(), flat); //expand with AESKEYGENASSIST
+            Compare(report, string(answer[0]) + " AESKeyBatch AES-NI expansion", expected.data(), flat, expected.size()); //compare AES-NI expansion
+        }
+        fill(flat, flat + sizeof(flat), 0x00); //clear flat round keys
+        ClearVector(roundKeys); //clear round keys
+    }
+    const string plainText = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710"; //represents SP 800-38A plaintext
+    for (const auto& answer : ModeVectors) { //iterate over mode vectors
+        string mode = answer[0]; //represents mode of vector
+        string name = "SP 800-38A " + mode + "-" + to_string(strlen(answer[1]) * 4); //represents name of vector
+        string iv = mode == "CTR" ? "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff" : "000102030405060708090a0b0c0d0e0f"; //represents IV or initial counter of vector
+        CheckKnown(report, name, mode, answer[1], mode == "ECB" ? "" : iv, plainText, answer[2]); //check vector
+    }
+    CheckOCB(report); //check OCB vectors
+    CheckCRC32C(report); //check CRC32C vectors
+    CheckFF1(report); //check FF1 samples
+    CheckKeyWrap(report); //check key wrap examples
+    CheckPadding(report); //check PKCS7 padding of streams
+    CheckPipeline(report); //check padded modes through the pipeline
+    CheckMappedView(report); //check lazily decrypted views
+    CheckContainer(report); //check containers
+    CheckSession(report); //check compact sessions
+    CheckScatter(report); //check scatter-gather lists
+    CheckBufferPool(report); //check padding of pooled buffers
+}
+
+
+/**
+ * @brief  Function that runs given number of outer rounds of the AESAVS Monte Carlo procedure for every mode, key size and direction and adds the results to given report.
+ * @brief  Each round chains 1000 calls on a single block, AESAVS uses 100 rounds.
+ * @param  Report report
+ * @param  size_t rounds
+ */
+void AESVerify::MonteCarlo(Report& report, const size_t rounds) {
+    if (rounds == 0) //if there's nothing to run
+        return;
+    const vector<unsigned char> ecbKey = HexToVector("8d2e60365f17c7df1040d7501b4a7b5a59b5088e6dadc3ad5f27a460872d5929"); //represents AESAVS ECB seed key followed by seed plaintext
+    const vector<unsigned char> chainKey = HexToVector("9dc2c84a37850c11699818605f47958c2e586692e647f5028ec6fa47a55a2aab"); //represents AESAVS CBC seed key followed by seed plaintext
+    const vector<unsigned char> iv = HexToVector("256953b2feab2a04ae0180d8335bbed6"); //represents AESAVS CBC seed IV
+    for (const char* mode : Modes) { //iterate over modes
+        const vector<unsigned char>& seed = string(mode) == "ECB" ? ecbKey : chainKey; //ECB and chained modes have their own AESAVS seed
+        for (size_t keySize = 16; keySize <= 32; keySize += 8) { //iterate over key sizes
+            vector<unsigned char> key(seed.begin(), seed.begin() + keySize); //longer keys continue into the seed plaintext
+            for (bool encrypt : { true, false }) { //iterate over directions
+                string name = string(mode) + "-" + to_string(keySize * 8) + (encrypt ? " encrypt" : " decrypt") + " Monte Carlo"; //represents name of procedure
+                vector<unsigned char> expected, results; //represents last output of each round of reference and of path
+                MonteCarloPath(ReferencePath, mode, encrypt, key, iv.data(), seed.data() + 16, rounds, expected); //run procedure with reference
+                if (encrypt && keySize == 16 && string(mode) != "CFB" && string(mode) != "OFB" && string(mode) != "CTR") { //if AESAVS lists the answer of the first round we check it
+                    vector<unsigned char> answer = HexToVector(string(mode) == "ECB" ? "a02600ecb8ea77625bba6641ed5f5920" : "1b1ebd1fc45ec43037fd4844241a437f"); //represents AESAVS answer of first round
+                    Compare(report, name + " reference AESAVS answer", answer.data(), expected.data(), BlockSize); //compare reference with AESAVS
+                }
+                for (int path = VectorPath; path < PathCount; path++) { //iterate over paths
+                    try {
+                        if (MonteCarloPath((Path)path, mode, encrypt, key, iv.data(), seed.data() + 16, rounds, results)) //if path supports mode
+                            Compare(report, name + " " + PathName((Path)path), expected.data(), results.data(), expected.size()); //compare path with reference
+                    }
+                    catch (const exception& e) { //if path threw
+                        report.checks++; //count check
+                        report.failures.push_back(name + " " + PathName((Path)path) + ": threw " + e.what()); //add failure
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that runs given number of random cases through every path and adds the results to given report.
+ * @param  Report report
+ * @param  size_t iterations
+ * @param  uint64_t seed
+ */
+void AESVerify::Differential(Report& report, const size_t iterations, const uint64_t seed) {
+    mt19937_64 random(seed); //represents reproducible random generator
+    size_t threads = GetThreadCount(); //represents thread count to restore
+    if (threads < 2) //if operations run on calling thread only
+        SetThreadCount(2); //use two threads so parallel paths split buffers into chunks
+    for (size_t i = 0; i < iterations; i++) { //iterate over cases
+        Case testCase; //represents random case
+        testCase.mode = Modes[random() % 5]; //pick mode
+        testCase.encrypt = random() % 2 == 0; //pick direction
+        testCase.key.resize(16 + 8 * (random() % 3)); //pick key size
+        for (unsigned char& byte : testCase.key) //iterate over key
+            byte = (unsigned char)random(); //set random byte
+        for (unsigned char& byte : testCase.iv) //iterate over IV
+            byte = (unsigned char)random(); //set random byte
+        size_t counterCase = random() % 4; //represents if counter is about to wrap
+        if (counterCase == 0) //if lower 64 bits of counter wrap within the first blocks
+            fill(testCase.iv + 8, testCase.iv + BlockSize - 1, 0xFF), testCase.iv[BlockSize - 1] = (unsigned char)(0xFF - random() % 8); //set lower half close to its maximum
+        else if (counterCase == 1) //if lower 32 bits of counter carry within the first blocks
+            fill(testCase.iv + 12, testCase.iv + BlockSize - 1, 0xFF), testCase.iv[BlockSize - 1] = (unsigned char)(0xFF - random() % 8); //set lower quarter close to its maximum
+        size_t sizeCase = random() % 100; //represents size class of case
+        size_t length = sizeCase < 70 ? random() % 1025 : sizeCase < 95 ? random() % 65537 : random() % (256 * 1024 + 1); //pick small, medium or large length
+        if (testCase.mode == "ECB" || testCase.mode == "CBC") //if mode requires full blocks
+            length -= length % BlockSize; //round length down to full blocks
+        testCase.input.resize(length); //allocate input
+        for (unsigned char& byte : testCase.input) //iterate over input
+            byte = (unsigned char)random(); //set random byte
+        testCase.inputOffset = random() % BlockSize; //pick unaligned input offset
+        testCase.outputOffset = random() % BlockSize; //pick unaligned output offset
+        testCase.inPlace = random() % 4 == 0; //pick in-place processing
+        testCase.chunkWidth = ChunkWidths[random() % 4]; //pick chunk width of parallel path
+        testCase.streaming = random() % 2 == 0; //pick non-temporal stores
+        testCase.newMode = Modes[length % BlockSize == 0 ? random() % 5 : 2 + random() % 3]; //pick mode to re-encrypt into, ECB and CBC need full blocks
+        testCase.newKey.resize(16 + 8 * (random() % 3)); //pick key size to re-encrypt into
+        for (unsigned char& byte : testCase.newKey) //iterate over new key
+            byte = (unsigned char)random(); //set random byte
+        for (unsigned char& byte : testCase.newIV) //iterate over new IV
+            byte = (unsigned char)random(); //set random byte
+        CheckCase(report, testCase); //run case through every path
+    }
+    if (threads < 2) //if thread count was changed
+        SetThreadCount(threads); //restore thread count
+}
+
+
+/**
+ * @brief  Function that decodes a case from given fuzzer input, runs it through every path and returns the report.
+ * @brief  The first byte selects mode, direction and key size, the second the input and output offsets, the third in-place, streaming and chunk width, then follow key, IV and input.
+ * @brief  Inputs too short to hold a key and IV return an empty report.
+ * @param  const unsigned char* data
+ * @param  size_t size
+ * @return  Report report
+ */
+AESVerify::Report AESVerify::Fuzz(const unsigned char* data, const size_t size) {
+    Report report; //represents report of case
+    if (size < 3) //if input can't select a case
+        return report;
+    Case testCase; //represents case of input
+    testCase.mode = Modes[data[0] % 5]; //select mode
+    testCase.encrypt = (data[0] / 5) % 2 == 0; //select direction
+    size_t keySize = 16 + 8 * ((data[0] / 10) % 3); //select key size
+    testCase.inputOffset = data[1] & 0x0F; //select input offset
+    testCase.outputOffset = data[1] >> 4; //select output offset
+    testCase.inPlace = (data[2] & 0x01) != 0; //select in-place processing
+    testCase.streaming = (data[2] & 0x02) != 0; //select non-temporal stores
+    testCase.chunkWidth = ChunkWidths[(data[2] >> 2) % 4]; //select chunk width
+    if (size < 3 + keySize + BlockSize) //if input can't hold key and IV
+        return report;
+    testCase.key.assign(data + 3, data + 3 + keySize); //set key
+    memcpy(testCase.iv, data + 3 + keySize, BlockSize); //set IV
+    testCase.input.assign(data + 3 + keySize + BlockSize, data + size); //set input
+    if (testCase.mode == "ECB" || testCase.mode == "CBC") //if mode requires full blocks
+        testCase.input.resize(testCase.input.size() - testCase.input.size() % BlockSize); //drop partial block
+    CheckCase(report, testCase); //run case through every path
+    ClearVector(testCase.key); //clear key
+    return report; //return report
+}
+
+
+/**
+ * @brief  Function that performs given mode on given buffer block by block with the reference EncryptBlock and DecryptBlock, iv is updated for the next call.
+ * @brief  ECB and CBC require length to be a multiple of 16 bytes, CTR increments the lower 8 bytes of the counter like the rest of the library.
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @throws  invalid_argument thrown if given mode, key or length is invalid.
+ */
+void AESVerify::Reference(const string& mode, const bool encrypt, const vector<unsigned char>& key, unsigned char* iv, const unsigned char* input, unsigned char* output, const size_t length) {
+    if (mode != "ECB" && mode != "CBC" && mode != "CFB" && mode != "OFB" && mode != "CTR") //if mode is unknown
+        throw invalid_argument("Invalid mode of operation, please provide valid mode that matches AES requirements."); //throw invalid argument
+    SetOperationMode(key.size()); //call our SetOperationMode function to check the key and set correct AES mode, throws invalid argument if key invalid
+    if ((mode == "ECB" || mode == "CBC") && length % BlockSize != 0) //if mode requires full blocks and length isn't multiply of 16 bytes
+        throw invalid_argument("Invalid mode of operation, please provide valid plaintext that matches AES " + mode + " requirements."); //throw invalid argument
+    vector<vector<unsigned char>> roundKeys = KeySchedule(key); //generate round keys with reference key schedule
+    unsigned char block[BlockSize], saved[BlockSize]; //represents current block and current input block saved for in-place buffers
+    for (size_t i = 0; i < length; i += BlockSize) { //iterate over blocks
+        size_t size = min(length - i, BlockSize); //calculate block size, last block may be partial
+        memcpy(saved, input + i, size); //save input block before output may overwrite it
+        if (mode == "ECB") { //if mode is ECB
+            memcpy(block, saved, BlockSize); //set block to input block
+            encrypt ? EncryptBlock(block, roundKeys) : DecryptBlock(block, roundKeys); //encrypt or decrypt the block using our AES reference functions
+        }
+        else if (mode == "CBC" && encrypt) { //if mode is CBC encryption
+            memcpy(block, saved, BlockSize); //set block to input block
+            XOR(block, iv); //XOR with previous cipher block
+            EncryptBlock(block, roundKeys); //encrypt the block using our AES EncryptBlock function
+            memcpy(iv, block, BlockSize); //update previous cipher block
+        }
+        else if (mode == "CBC") { //if mode is CBC decryption
+            memcpy(block, saved, BlockSize); //set block to cipher block
+            DecryptBlock(block, roundKeys); //decrypt the block using our AES DecryptBlock function
+            XOR(block, iv); //XOR with previous cipher block
+            memcpy(iv, saved, BlockSize); //update previous cipher block
+        }
+        else { //else mode is CFB, OFB or CTR and XORs input with a keystream block
+            memcpy(block, iv, BlockSize); //set block to feedback or counter
+            EncryptBlock(block, roundKeys); //encrypt the block into keystream using our AES EncryptBlock function
+            if (mode == "OFB") //if mode is OFB the keystream is the next feedback
+                memcpy(iv, block, BlockSize); //update feedback
+            else if (mode == "CTR") //if mode is CTR
+                AddCounter(iv, 1); //increment lower 8 bytes of counter
+            for (size_t j = 0; j < size; j++) //iterate over block
+                block[j] ^= saved[j]; //perform byte XOR between input and keystream
+            if (mode == "CFB" && size == BlockSize) //if mode is CFB and block is full the cipher block is the next feedback
+                memcpy(iv, encrypt ? block : saved, BlockSize); //update feedback
+        }
+        memcpy(output + i, block, size); //write output block
+    }
+    fill(block, block + BlockSize, 0x00); //clear block
+    fill(saved, saved + BlockSize, 0x00); //clear saved block
+    ClearVector(roundKeys); //clear reference round keys
+}
+
+
+/**
+ * @brief  Function that runs given case through every path that supports it, compares each with the reference and adds the results to given report.
+ * @param  Report report
+ * @param  Case testCase
+ */
+void AESVerify::CheckCase(Report& report, const Case& testCase) {
+    size_t length = testCase.input.size(); //represents length of case
+    vector<unsigned char> expected(length); //represents reference output
+    unsigned char expectedIV[BlockSize]; //represents reference IV for the next call
+    memcpy(expectedIV, testCase.iv, BlockSize); //initialize reference IV
+    Reference(testCase.mode, testCase.encrypt, testCase.key, expectedIV, testCase.input.data(), expected.data(), length); //run case with reference
+    size_t chunkSize = GetChunkSize(), parallelThreshold = GetParallelThreshold(), streamingThreshold = GetStreamingThreshold(); //represents parallel settings to restore
+    if (testCase.chunkWidth != 0) { //if case sets a chunk width every length is split into chunks of it
+        SetChunkSize(testCase.chunkWidth); //set chunk width
+        SetParallelThreshold(0); //process all lengths in parallel
+    }
+    SetStreamingThreshold(testCase.streaming ? BlockSize : 0); //enable or disable non-temporal stores
+    string name = testCase.mode + "-" + to_string(testCase.key.size() * 8) + (testCase.encrypt ? " encrypt " : " decrypt ") + to_string(length) + " bytes, offsets " + to_string(testCase.inputOffset) + "/" + (testCase.inPlace ? "in place" : to_string(testCase.outputOffset)) + ", chunk " + to_string(testCase.chunkWidth) + (testCase.streaming ? " streaming" : ""); //represents name of case
+    vector<unsigned char> inputBuffer(length + 2 * BlockSize), outputBuffer(length + 2 * BlockSize); //represents buffers with room for offsets and padding
+    for (int path = VectorPath; path < PathCount; path++) { //iterate over paths
+        unsigned char* input = inputBuffer.data() + testCase.inputOffset; //represents unaligned input
+        unsigned char* output = testCase.inPlace ? input : outputBuffer.data() + testCase.outputOffset; //represents unaligned output
+        if (length > 0) //if case has input
+            memcpy(input, testCase.input.data(), length); //copy input
+        unsigned char iv[BlockSize]; //represents IV of path
+        memcpy(iv, testCase.iv, BlockSize); //initialize IV
+        try {
+            if (!RunPath((Path)path, testCase.mode, testCase.encrypt, testCase.key, iv, input, output, length)) //if path doesn't support case
+                continue;
+        }
+        catch (const exception& e) { //if path threw
+            report.checks++; //count check
+            report.failures.push_back(name + " " + PathName((Path)path) + ": threw " + e.what()); //add failure
+            continue;
+        }
+        Compare(report, name + " " + PathName((Path)path), expected.data(), output, length); //compare output with reference
+        if ((path == ParallelPath || path == ChecksumPath) && testCase.mode != "ECB" && length % BlockSize == 0) //if path keeps chaining state we compare IV for the next call
+            Compare(report, name + " " + PathName((Path)path) + " next IV", expectedIV, iv, BlockSize); //compare IV with reference
+    }
+    if (!testCase.newMode.empty()) //if case is re-encrypted too
+        CheckReencrypt(report, testCase, name); //re-encrypt with parallel settings of case
+    SetChunkSize(chunkSize); //restore chunk size
+    SetParallelThreshold(parallelThreshold); //restore parallel threshold
+    SetStreamingThreshold(streamingThreshold); //restore streaming threshold
+    fill(inputBuffer.begin(), inputBuffer.end(), 0x00); //clear input buffer
+    fill(outputBuffer.begin(), outputBuffer.end(), 0x00); //clear output buffer
+}
+
+
+/**
+ * @brief  Function that re-encrypts the input of given case as ciphertext of its mode into its new mode, compares the output and both IVs with the reference and adds the results to given report.
+ * @param  Report report
+ * @param  Case testCase
+ * @param  string name
+ */
+void AESVerify::CheckReencrypt(Report& report, const Case& testCase, const string& name) {
+    size_t length = testCase.input.size(); //represents length of case
+    vector<unsigned char> plain(length), expected(length); //represents reference plaintext and reference new ciphertext
+    unsigned char expectedOldIV[BlockSize], expectedNewIV[BlockSize], oldIV[BlockSize], newIV[BlockSize]; //represents IVs for the next call of reference and of AESRekey
+    memcpy(expectedOldIV, testCase.iv, BlockSize); //initialize reference old IV
+    memcpy(expectedNewIV, testCase.newIV, BlockSize); //initialize reference new IV
+    Reference(testCase.mode, false, testCase.key, expectedOldIV, testCase.input.data(), plain.data(), length); //decrypt input with old key
+    Reference(testCase.newMode, true, testCase.newKey, expectedNewIV, plain.data(), expected.data(), length); //encrypt plaintext with new key
+    string rekeyName = name + " AESRekey into " + testCase.newMode + "-" + to_string(testCase.newKey.size() * 8); //represents name of check
+    vector<unsigned char> inputBuffer(length + 2 * BlockSize), outputBuffer(length + 2 * BlockSize); //represents buffers with room for offsets
+    unsigned char* input = inputBuffer.data() + testCase.inputOffset; //represents unaligned input
+    unsigned char* output = testCase.inPlace ? input : outputBuffer.data() + testCase.outputOffset; //represents unaligned output
+    if (length > 0) //if case has input
+        memcpy(input, testCase.input.data(), length); //copy input
+    memcpy(oldIV, testCase.iv, BlockSize); //initialize old IV
+    memcpy(newIV, testCase.newIV, BlockSize); //initialize new IV
+    try {
+        AESRekey::Reencrypt(input, output, length, testCase.mode, testCase.key, oldIV, testCase.newMode, testCase.newKey, newIV); //re-encrypt in a single pass
+        Compare(report, rekeyName, expected.data(), output, length); //compare output with reference
+        if (testCase.mode != "ECB") //if old mode keeps chaining state
+            Compare(report, rekeyName + " next old IV", expectedOldIV, oldIV, BlockSize); //compare old IV with reference
+        if (testCase.newMode != "ECB") //if new mode keeps chaining state
+            Compare(report, rekeyName + " next new IV", expectedNewIV, newIV, BlockSize); //compare new IV with reference
+    }
+    catch (const exception& e) { //if re-encryption threw
+        report.checks++; //count check
+        report.failures.push_back(rekeyName + ": threw " + e.what()); //add failure
+    }
+    fill(plain.begin(), plain.end(), 0x00); //clear reference plaintext
+    fill(inputBuffer.begin(), inputBuffer.end(), 0x00); //clear input buffer
+    fill(outputBuffer.begin(), outputBuffer.end(), 0x00); //clear output buffer
+}
+
+
+/**
+ * @brief  Function that checks given known answer in both directions on every path that supports it and adds the results to given report.
+ * @param  Report report
+ * @param  string name
+ * @param  string mode
+ * @param  string key
+ * @param  string iv
+ * @param  string plainText
+ * @param  string cipherText
+ */
+void AESVerify::CheckKnown(Report& report, const string& name, const string& mode, const string& key, const string& iv, const string& plainText, const string& cipherText) {
+    vector<unsigned char> keyBytes = HexToVector(key), plain = HexToVector(plainText), cipher = HexToVector(cipherText); //represents key, plaintext and ciphertext of answer
+    vector<unsigned char> ivBytes = iv.empty() ? vector<unsigned char>(BlockSize) : HexToVector(iv); //represents IV of answer, zeros in ECB mode
+    vector<unsigned char> output(plain.size() + BlockSize); //represents output with room for padding
+    for (int path = ReferencePath; path < PathCount; path++) { //iterate over reference and paths
+        for (bool encrypt : { true, false }) { //iterate over directions
+            unsigned char state[BlockSize]; //represents IV of path
+            memcpy(state, ivBytes.data(), BlockSize); //initialize IV
+            const vector<unsigned char>& input = encrypt ? plain : cipher; //represents input of direction
+            try {
+                if (!RunPath((Path)path, mode, encrypt, keyBytes, state, input.data(), output.data(), input.size())) //if path doesn't support answer
+                    continue;
+            }
+            catch (const exception& e) { //if path threw
+                report.checks++; //count check
+                report.failures.push_back(name + (encrypt ? " encrypt " : " decrypt ") + PathName((Path)path) + ": threw " + e.what()); //add failure
+                continue;
+            }
+            Compare(report, name + (encrypt ? " encrypt " : " decrypt ") + PathName((Path)path), (encrypt ? cipher : plain).data(), output.data(), input.size()); //compare output with answer
+        }
+    }
+    ClearVector(keyBytes); //clear key
+}
+
+
+/**
+ * @brief  Function that checks the RFC 7253 sample vectors and the iterative OCB test of every key size and adds the results to given report.
+ * @param  Report report
+ */
+void AESVerify::CheckOCB(Report& report) {
+    const vector<unsigned char> key = HexToVector("000102030405060708090a0b0c0d0e0f"), text = HexToVector("0001020304050607"); //represents key and text of sample vectors
+    vector<unsigned char> expected = HexToVector("785407bfffc8ad9edcc5520ac9111ee6"); //represents tag of empty sample
+    vector<unsigned char> result = AESOCB::Encrypt(vector<unsigned char>(), key, HexToVector("bbaa99887766554433221100")); //encrypt empty sample
+    Compare(report, "RFC 7253 sample 1", expected.data(), result.data(), expected.size()); //compare with answer
+    expected = HexToVector("6820b3657b6f615a5725bda0d3b4eb3a257c9af1f8f03009"); //represents ciphertext and tag of second sample
+    result = AESOCB::Encrypt(text, key, HexToVector("bbaa99887766554433221101"), text); //encrypt second sample
+    Compare(report, "RFC 7253 sample 2", expected.data(), result.data(), expected.size()); //compare with answer
+    const char* const answers[] = { "67e944d23256c5e0b6c61fa22fdf1ea2", "f673f2c3e7174aae7bae986ca9f29e17", "d90eb8e9c977c88b79dd793d7ffa161c" }; //represents answers of iterative test for each key size
+    for (size_t k = 0; k < 3; k++) { //iterate over key sizes
+        vector<unsigned char> iterativeKey(16 + 8 * k), nonce(12), output; //represents key of zeros ending with tag length, nonce and concatenated outputs
+        iterativeKey.back() = 128; //last key byte holds tag length in bits
+        for (size_t i = 0; i <= 128; i++) { //iterate over rounds of test, the last one authenticates all outputs
+            for (size_t j = 1; j <= 3; j++) { //iterate over the three messages of round
+                uint64_t number = 3 * i + j; //represents nonce number
+                for (size_t n = 0; n < 8; n++) //iterate over lower nonce bytes
+                    nonce[11 - n] = (unsigned char)(number >> (8 * n)); //set nonce to number in big endian
+                vector<unsigned char> data(i); //represents text of zeros of round length
+                if (i == 128) //if round is the last one
+                    result = AESOCB::Encrypt(vector<unsigned char>(), iterativeKey, nonce, output); //authenticate all outputs
+                else //else we encrypt text with associated data, text only and associated data only
+                    result = AESOCB::Encrypt(j == 3 ? vector<unsigned char>() : data, iterativeKey, nonce, j == 2 ? vector<unsigned char>() : data); //encrypt message
+                if (i == 128) //if round is the last one we're done
+                    break;
+                output.insert(output.end(), result.begin(), result.end()); //append output
+            }
+        }
+        expected = HexToVector(answers[k]); //represents answer of key size
+        Compare(report, "RFC 7253 iterative OCB-" + to_string(iterativeKey.size() * 8), expected.data(), result.data(), expected.size()); //compare with answer
+    }
+}
+
+
+/**
+ * @brief  Function that checks the RFC 3720 CRC32C vectors with the lookup tables and the CRC32 instruction and the combination of checksums and adds the results to given report.
+ * @param  Report report
+ */
+void AESVerify::CheckCRC32C(Report& report) {
+    vector<vector<unsigned char>> texts(5, vector<unsigned char>(32)); //represents zeros, ones, ascending and descending bytes and the common check string
+    fill(texts[1].begin(), texts[1].end(), 0xFF); //set all ones
+    for (size_t i = 0; i < 32; i++) //iterate over bytes
+        texts[2][i] = (unsigned char)i, texts[3][i] = (unsigned char)(31 - i); //set ascending and descending bytes
+    texts[4].assign({ '1', '2', '3', '4', '5', '6', '7', '8', '9' }); //set check string
+    const uint32_t answers[] = { 0x8A9136AA, 0x62A8AB43, 0x46DD794E, 0x113FDB5C, 0xE3069283 }; //represents CRC32C of each text
+    const char* const names[] = { "zeros", "ones", "ascending", "descending", "check string" }; //represents name of each text
+    const bool usesSSE42 = AESChecksum::UsesSSE42(); //represents setting to restore
+    for (bool sse42 : { false, true }) { //iterate over lookup tables and CRC32 instruction
+        if (sse42 && !AESChecksum::HasSSE42()) //if processor doesn't support CRC32 instruction
+            break;
+        AESChecksum::SetSSE42(sse42); //select implementation
+        for (size_t i = 0; i < 5; i++) { //iterate over texts
+            const vector<unsigned char>& text = texts[i]; //represents current text
+            const size_t half = text.size() / 2; //represents split point of combination
+            const uint32_t results[] = { AESChecksum::CRC32C(text.data(), text.size()), AESChecksum::CRC32C(text.data() + half, text.size() - half, AESChecksum::CRC32C(text.data(), half)),
+                AESChecksum::Combine(AESChecksum::CRC32C(text.data(), half), AESChecksum::CRC32C(text.data() + half, text.size() - half), text.size() - half) }; //represents whole, continued and combined checksums
+            const char* const kinds[] = { "", " continued", " combined" }; //represents name of each result
+            for (size_t j = 0; j < 3; j++) //iterate over results
+                Compare(report, string("RFC 3720 CRC32C ") + names[i] + kinds[j] + (sse42 ? " SSE4.2" : " table"), (const unsigned char*)&answers[i], (const unsigned char*)&results[j], sizeof(uint32_t)); //compare with answer
+        }
+    }
+    if (AESChecksum::HasSSE42()) //if setting may have changed
+        AESChecksum::SetSSE42(usesSSE42); //restore setting
+}
+
+
+/**
+ * @brief  Function that checks the NIST SP 800-38G FF1 samples with single calls and a batch that interleaves the rounds of both texts and adds the results to given report.
+ * @param  Report report
+ */
+void AESVerify::CheckFF1(Report& report) {
+    for (size_t i = 0; i < sizeof(FF1Vectors) / sizeof(FF1Vectors[0]); i++) { //iterate over samples
+        const auto& answer = FF1Vectors[i]; //represents current sample
+        const string name = "SP 800-38G FF1 sample " + to_string(i + 1); //represents name of sample
+        const AESFF1 ff1(HexToVector(answer[0]), (unsigned)stoul(answer[1])); //represents FF1 with key and radix of sample
+        const vector<unsigned char> tweak = HexToVector(answer[2]); //represents tweak of sample
+        const string plainText = answer[3], cipherText = answer[4]; //represents texts of sample
+        vector<string> batch = { plainText, cipherText }; //represents batch of plaintext and ciphertext
+        ff1.EncryptBatch(batch, tweak); //encrypt both texts
+        const string results[] = { ff1.Encrypt(plainText, tweak), ff1.Decrypt(cipherText, tweak), batch[0], ff1.Decrypt(batch[1], tweak) }; //represents encryption, decryption, batch encryption and batch round trip
+        const string* const expected[] = { &cipherText, &plainText, &cipherText, &cipherText }; //represents answer of each result
+        const char* const kinds[] = { " encrypt", " decrypt", " batch encrypt", " batch round trip" }; //represents name of each result
+        for (size_t j = 0; j < 4; j++) //iterate over results
+            Compare(report, name + kinds[j], (const unsigned char*)expected[j]->data(), (const unsigned char*)results[j].data(), expected[j]->size()); //compare with answer
+    }
+}
+
+/**
+ * @brief  Function that checks the RFC 3394 and RFC 5649 key wrap examples with single calls and a batch and that unwrapping rejects a tampered wrapped key, and adds the results to given report.
+ * @param  Report report
+ */
+void AESVerify::CheckKeyWrap(Report& report) {
+    for (const auto& answer : KeyWrapVectors) { //iterate over examples
+        const string name = answer[0]; //represents name of example
+        const bool padded = name.find("5649") != string::npos; //RFC 5649 examples wrap with padding
+        KeyContext kek = Expand(HexToVector(answer[1])); //represents expanded key encryption key of example
+        const vector<unsigned char> keyData = HexToVector(answer[2]), wrappedKey = HexToVector(answer[3]); //represents key data and wrapped key of example
+        try {
+            const vector<unsigned char> wrapped = padded ? AESKeyWrap::WrapPad(keyData, kek) : AESKeyWrap::Wrap(keyData, kek); //wrap key data
+            const vector<unsigned char> unwrapped = padded ? AESKeyWrap::UnwrapPad(wrappedKey, kek) : AESKeyWrap::Unwrap(wrappedKey, kek); //unwrap wrapped key
+            const vector<vector<unsigned char>> batch = AESKeyWrap::UnwrapBatch({ wrappedKey, wrappedKey }, kek, padded); //unwrap two copies in lockstep
+            const vector<unsigned char>* const results[] = { &wrapped, &unwrapped, &batch[0], &batch[1] }; //represents wrap, unwrap and both batch results
+            const vector<unsigned char>* const expected[] = { &wrappedKey, &keyData, &keyData, &keyData }; //represents answer of each result
+            const char* const kinds[] = { " wrap", " unwrap", " batch unwrap", " batch unwrap" }; //represents name of each result
+            for (size_t i = 0; i < 4; i++) { //iterate over results
+                report.checks++; //count length check
+                if (results[i]->size() != expected[i]->size()) //if result has the wrong length
+                    report.failures.push_back(name + kinds[i] + ": returned " + to_string(results[i]->size()) + " bytes"); //add failure
+                else
+                    Compare(report, name + kinds[i], expected[i]->data(), results[i]->data(), expected[i]->size()); //compare with answer
+            }
+            vector<unsigned char> tampered = wrappedKey; //represents wrapped key with a flipped bit
+            tampered.back() ^= 0x01; //flip last bit, which breaks the integrity check
+            report.checks++; //count rejection check
+            try {
+                padded ? AESKeyWrap::UnwrapPad(tampered, kek) : AESKeyWrap::Unwrap(tampered, kek); //must reject tampered key
+                report.failures.push_back(name + ": accepted a tampered wrapped key"); //add failure
+            }
+            catch (const invalid_argument&) { //tampered key is rejected
+            }
+            report.checks++; //count batch rejection check
+            if (!AESKeyWrap::UnwrapBatch({ tampered, wrappedKey }, kek, padded)[0].empty()) //if batch returned a key for tampered input
+                report.failures.push_back(name + ": batch returned a tampered wrapped key"); //add failure
+        }
+        catch (const exception& error) { //if a valid example was rejected
+            report.checks++; //count example check
+            report.failures.push_back(name + ": " + error.what()); //add failure
+        }
+        Clear(kek); //clear round keys of key encryption key
+    }
+}
+
+
+
+/**
+ * @brief  Function that checks that AESStream with PKCS7Padding round-trips texts of every length up to three blocks in ECB and CBC, including texts that end like padding, and rejects invalid padding.
+ * @param  Report report
+ */
+void AESVerify::CheckPadding(Report& report) {
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), iv = HexToVector("000102030405060708090a0b0c0d0e0f"); //represents key and iv of checks
+    for (const char* mode : { "ECB", "CBC" }) { //iterate over padded modes
+        for (size_t length = 0; length <= 48; length++) { //iterate over text lengths
+            const string name = string("PKCS7 ") + mode + " stream of " + to_string(length) + " bytes"; //represents name of check
+            vector<unsigned char> text(length, 0x01), expected(text); //represents text ending in a byte that looks like padding and its padded encryption
+            for (size_t i = 0; i + 1 < length; i++) //iterate over bytes but the last
+                text[i] = expected[i] = (unsigned char)(i * 7); //set varied bytes
+            expected.insert(expected.end(), BlockSize - length % BlockSize, (unsigned char)(BlockSize - length % BlockSize)); //append PKCS7 padding, a full block if length is a multiple of 16
+            mode == string("ECB") ? AES::Encrypt_ECB(expected, key) : AES::Encrypt_CBC(expected, key, iv); //encrypt padded text, a multiple of 16 bytes isn't padded again
+            vector<unsigned char> cipher(length + BlockSize), plain(cipher.size()); //represents stream ciphertext and decrypted text
+            AESStream encryptor(mode, true, key, iv.data(), AESStream::PKCS7Padding); //represents encrypting stream
+            size_t written = encryptor.Update(text.data(), cipher.data(), length); //encrypt text
+            written += encryptor.Final(cipher.data() + written); //add padding
+            report.checks++; //count length check
+            if (written != expected.size()) //if stream didn't add 1 to 16 bytes of padding
+                report.failures.push_back(name + ": encrypted to " + to_string(written) + " bytes"); //add failure
+            else if (Compare(report, name + " encrypt", expected.data(), cipher.data(), written)) { //if ciphertext matches we decrypt it
+                AESStream decryptor(mode, false, key, iv.data(), AESStream::PKCS7Padding); //represents decrypting stream
+                size_t read = decryptor.Update(cipher.data(), plain.data(), written); //decrypt ciphertext, last block is held back
+                read += decryptor.Final(plain.data() + read); //remove padding
+                report.checks++; //count length check
+                if (read != length) //if decrypted text lost or kept bytes
+                    report.failures.push_back(name + ": decrypted to " + to_string(read) + " bytes"); //add failure
+                else
+                    Compare(report, name + " decrypt", text.data(), plain.data(), length); //compare with text
+            }
+        }
+        vector<unsigned char> block(BlockSize, 0x00); //represents block that ends in zero, which is never valid padding
+        mode == string("ECB") ? AES::Encrypt_ECB(block, key) : AES::Encrypt_CBC(block, key, iv); //encrypt block without padding
+        unsigned char plain[BlockSize]; //represents decrypted text
+        AESStream decryptor(mode, false, key, iv.data(), AESStream::PKCS7Padding); //represents decrypting stream
+        report.checks++; //count rejection check
+        try {
+            size_t read = decryptor.Update(block.data(), plain, BlockSize); //decrypt block, it's held back
+            decryptor.Final(plain + read); //must reject padding
+            report.failures.push_back(string("PKCS7 ") + mode + " stream accepted invalid padding"); //add failure
+        }
+        catch (const invalid_argument&) { //invalid padding is rejected
+        }
+    }
+}
+
+/**
+ * @brief  Function that checks that AESPipeline round-trips ECB and CBC with PKCS7 padding through pipes with chunks of 1, 7 and 16 bytes, where chunks produce no output, does nothing on Windows.
+ * @param  Report report
+ */
+void AESVerify::CheckPipeline(Report& report) {
+#if !defined(_WIN32)
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), iv = HexToVector("000102030405060708090a0b0c0d0e0f"); //represents key and iv of checks
+    auto run = [](AESStream& stream, const vector<unsigned char>& input, const size_t queueDepth, const size_t chunkSize) { //runs given input through pipeline between two pipes, input and output fit in pipe buffers
+        int in[2], out[2]; //represents input and output pipes
+        if (pipe(in) != 0) //if input pipe can't be created
+            throw runtime_error("Failed to create input pipe."); //throw runtime error
+        if (pipe(out) != 0) { //if output pipe can't be created
+            close(in[0]); //close input pipe
+            close(in[1]);
+            throw runtime_error("Failed to create output pipe."); //throw runtime error
+        }
+        bool isWritten = write(in[1], input.data(), input.size()) == (ssize_t)input.size(); //write whole input, pipeline reads it until end of file
+        close(in[1]); //end input
+        vector<unsigned char> output; //represents output of pipeline
+        try {
+            if (!isWritten) //if input didn't fit in pipe
+                throw runtime_error("Failed to write input pipe."); //throw runtime error
+            AESPipeline::Process(in[0], out[1], stream, queueDepth, chunkSize); //process input
+        }
+        catch (...) { //if pipeline failed we close pipes before we rethrow
+            close(in[0]);
+            close(out[0]);
+            close(out[1]);
+            throw;
+        }
+        close(in[0]); //close input pipe
+        close(out[1]); //end output
+        unsigned char buffer[256]; //represents part of output
+        for (ssize_t read; (read = ::read(out[0], buffer, sizeof(buffer))) > 0;) //read output until end of file
+            output.insert(output.end(), buffer, buffer + read); //add part
+        close(out[0]); //close output pipe
+        return output;
+    };
+    for (const char* mode : { "ECB", "CBC" }) { //iterate over padded modes
+        for (size_t length : { (size_t)0, (size_t)15, (size_t)16, (size_t)100 }) { //iterate over lengths below, at and above a block
+            vector<unsigned char> text(length), expected(length + BlockSize); //represents text and its encryption in a single call
+            for (size_t i = 0; i < length; i++) //iterate over bytes
+                text[i] = (unsigned char)(i * 13 + 1); //set varied bytes
+            AESStream reference(mode, true, key, iv.data(), AESStream::PKCS7Padding); //represents stream of single call
+            size_t size = reference.Update(text.data(), expected.data(), length); //encrypt text
+            expected.resize(size + reference.Final(expected.data() + size)); //add padding
+            for (size_t chunkSize : { (size_t)1, (size_t)7, (size_t)16 }) { //iterate over chunks smaller than, not aligned to and equal to a block
+                for (size_t queueDepth : { (size_t)1, (size_t)4 }) { //iterate over queue depths
+                    const string name = string("AESPipeline ") + mode + " of " + to_string(length) + " bytes with " + to_string(chunkSize) + " byte chunks and queue depth " + to_string(queueDepth); //represents name of check
+                    try {
+                        AESStream encryptor(mode, true, key, iv.data(), AESStream::PKCS7Padding); //represents encrypting stream
+                        vector<unsigned char> cipher = run(encryptor, text, queueDepth, chunkSize); //encrypt through pipeline
+                        report.checks++; //count length check
+                        if (cipher.size() != expected.size()) { //if pipeline lost or added bytes
+                            report.failures.push_back(name + ": encrypted to " + to_string(cipher.size()) + " bytes"); //add failure
+                            continue;
+                        }
+                        if (!Compare(report, name + " encrypt", expected.data(), cipher.data(), cipher.size())) //if ciphertext differs we don't decrypt it
+                            continue;
+                        AESStream decryptor(mode, false, key, iv.data(), AESStream::PKCS7Padding); //represents decrypting stream
+                        vector<unsigned char> plain = run(decryptor, cipher, queueDepth, chunkSize); //decrypt through pipeline
+                        report.checks++; //count length check
+                        if (plain.size() != length) //if padding wasn't removed exactly
+                            report.failures.push_back(name + ": decrypted to " + to_string(plain.size()) + " bytes"); //add failure
+                        else
+                            Compare(report, name + " decrypt", text.data(), plain.data(), length); //compare with text
+                    }
+                    catch (const exception& error) { //if pipeline failed
+                        report.checks++; //count pipeline check
+                        report.failures.push_back(name + ": " + error.what()); //add failure
+                    }
+                }
+            }
+        }
+    }
+#else
+    (void)report; //pipes of the check are POSIX only
+#endif
+}
+
+/**
+ * @brief  Function that checks that AESMappedView reads the same plaintext as Decrypt_CTR of the whole file with a cache smaller than the file, counters that wrap inside the file, prefetching and concurrent readers.
+ * @param  Report report
+ */
+void AESVerify::CheckMappedView(Report& report) {
+    const size_t pageSize = 256, cacheSize = 3 * pageSize, dataOffset = 48, length = 40 * pageSize + 37; //represents view of three cached pages over a file of 41 pages behind a header
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"); //represents key of checks
+    const string path = (filesystem::temp_directory_path() / ("aes-verify-" + to_string(random_device()()) + ".bin")).string(); //represents temporary file
+    const size_t threads = GetThreadCount(), threshold = GetParallelThreshold(); //represents settings to restore
+    SetThreadCount(4); //use workers for prefetching and concurrent reads
+    SetParallelThreshold(0); //prefetch in parallel regardless of size
+    mt19937_64 random(7); //represents reproducible random generator
+    for (const char* counter : { "ffffffffffffffffffffffffffffff00", "f0f1f2f3f4f5f6f7fffffffffffffff0" }) { //iterate over counters that wrap the whole counter and its low half inside the file
+        const string name = string("AESMappedView with counter ") + counter; //represents name of checks
+        const vector<unsigned char> iv = HexToVector(counter); //represents initial counter
+        vector<unsigned char> file(dataOffset + length), expected(length); //represents file and plaintext of view
+        for (unsigned char& byte : file) //iterate over bytes of file
+            byte = (unsigned char)random(); //set random header and ciphertext
+        memcpy(expected.data(), file.data() + dataOffset, length); //copy ciphertext
+        AES::Decrypt_CTR(expected, key, iv); //decrypt whole ciphertext in a single call
+        FILE* output = fopen(path.c_str(), "wb"); //create temporary file
+        bool isWritten = output != NULL && fwrite(file.data(), 1, file.size(), output) == file.size(); //write file
+        if (output != NULL && fclose(output) != 0) //if file couldn't be flushed
+            isWritten = false;
+        report.checks++; //count file check
+        if (!isWritten) { //if temporary file couldn't be written we can't check the view
+            report.failures.push_back(name + ": failed to write " + path); //add failure
+            remove(path.c_str()); //remove partial file
+            continue;
+        }
+        try {
+            AESMappedView view(path, key, iv.data(), cacheSize, pageSize, dataOffset); //represents view with a cache smaller than the file
+            vector<unsigned char> actual(length + pageSize); //represents plaintext read through view, with room for reads past the end
+            report.checks++; //count size check
+            if (view.Read(0, actual.data(), actual.size()) != length) //if whole read didn't stop at the end of view
+                report.failures.push_back(name + ": whole read returned wrong length"); //add failure
+            Compare(report, name + " whole read", expected.data(), actual.data(), length); //compare sequential read, every page is evicted again
+            for (size_t i = 0; i < 200; i++) { //read random ranges, many cross pages
+                size_t offset = (size_t)(random() % length), size = (size_t)(random() % (3 * pageSize)) + 1; //represents random range
+                size_t read = view.Read(offset, actual.data(), size); //read range
+                report.checks++; //count length check
+                if (read != min(size, length - offset)) //if read didn't stop at the end of view
+                    report.failures.push_back(name + ": read of " + to_string(size) + " bytes at " + to_string(offset) + " returned " + to_string(read)); //add failure
+                else if (!Compare(report, name + " read at " + to_string(offset), expected.data() + offset, actual.data(), read)) //if range differs we stop
+                    break;
+            }
+            for (size_t first = 0; first < length; first += cacheSize) { //iterate over ranges of a cache size
+                view.Prefetch(first, cacheSize); //decrypt range in parallel
+                size_t size = min(cacheSize, length - first); //represents size of range
+                view.Read(first, actual.data(), size); //read prefetched range
+                if (!Compare(report, name + " prefetched read at " + to_string(first), expected.data() + first, actual.data(), size)) //if range differs we stop
+                    break;
+            }
+            atomic<size_t> mismatches{ 0 }; //represents number of concurrent reads that differ
+            ParallelFor(64, [&](size_t i) { //read ranges from several threads, pages are evicted while others are pinned
+                unsigned char buffer[2 * pageSize]; //represents plaintext of a range
+                size_t offset = (i * 977) % length, size = min(sizeof(buffer), length - offset); //represents range of index
+                if (view.Read(offset, buffer, size) != size || memcmp(buffer, expected.data() + offset, size) != 0) //if range differs
+                    mismatches++; //count mismatch
+            });
+            report.checks++; //count concurrency check
+            if (mismatches > 0) //if a concurrent read differs
+                report.failures.push_back(name + ": " + to_string(mismatches.load()) + " concurrent reads differ"); //add failure
+            report.checks++; //count eviction check
+            if (view.GetEvictions() == 0 || view.GetCached() > view.GetCapacity()) //if cache didn't evict pages or holds more than its capacity
+                report.failures.push_back(name + ": cache didn't stay within " + to_string(view.GetCapacity()) + " pages"); //add failure
+        }
+        catch (const exception& error) { //if view failed
+            report.checks++; //count view check
+            report.failures.push_back(name + ": " + error.what()); //add failure
+        }
+        remove(path.c_str()); //remove temporary file
+    }
+    SetParallelThreshold(threshold); //restore parallel threshold
+    SetThreadCount(threads); //restore thread count
+}
+
+/**
+ * @brief  Function that checks that AESContainer round-trips data of several chunks in CBC and CTR, reads single chunks and ranges that cross chunks, and rejects a tampered chunk and a wrong key.
+ * @param  Report report
+ */
+void AESVerify::CheckContainer(Report& report) {
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), iv = HexToVector("000102030405060708090a0b0c0d0e0f"), keyId(16, 0x5A); //represents key, base iv and key ID of containers
+    const size_t chunkSize = 64; //represents chunk size, small so the data spans several chunks
+    vector<unsigned char> text(3 * chunkSize + 21); //represents data of three full chunks and a partial one
+    for (size_t i = 0; i < text.size(); i++) //iterate over bytes
+        text[i] = (unsigned char)(i * 29 + 3); //set varied bytes
+    for (const char* mode : { "CBC", "CTR" }) { //iterate over modes of containers
+        const string name = string("AESContainer ") + mode; //represents name of checks
+        try {
+            stringstream stream; //represents container in memory
+            {
+                AESContainer::Writer writer(stream, key, mode, keyId, iv, chunkSize); //represents writer of container
+                writer.Write(text.data(), 50); //write data in pieces that don't align to chunks
+                writer.Write(text.data() + 50, text.size() - 50);
+                writer.Close(); //write index footer
+            }
+            const string container = stream.str(); //represents bytes of container
+            {
+                AESContainer::Reader reader(stream, key); //represents reader of container
+                report.checks++; //count size check
+                if (reader.GetSize() != text.size() || reader.GetChunkCount() != 4 || !reader.Verify()) //if footer or tags don't describe the data
+                    report.failures.push_back(name + ": footer doesn't describe " + to_string(text.size()) + " bytes in 4 chunks"); //add failure
+                vector<unsigned char> data = reader.Read(0, text.size()); //read whole data
+                if (data.size() == text.size()) //if whole data was read we compare it
+                    Compare(report, name + " read", text.data(), data.data(), text.size()); //compare with data
+                data = reader.Read(chunkSize - 5, chunkSize + 10); //read range across chunk boundaries
+                if (data.size() == chunkSize + 10) //if range was read we compare it
+                    Compare(report, name + " range read", text.data() + chunkSize - 5, data.data(), data.size()); //compare with data
+                data = reader.ReadChunk(3); //read partial last chunk
+                if (data.size() == 21) //if last chunk was read we compare it
+                    Compare(report, name + " last chunk", text.data() + 3 * chunkSize, data.data(), data.size()); //compare with data
+            }
+            string tampered = container; //represents container with a flipped bit in its second chunk
+            tampered[AESContainer::HeaderSize + chunkSize + 1] ^= 0x01; //flip bit of ciphertext
+            stringstream tamperedStream(tampered); //represents tampered container
+            AESContainer::Reader reader(tamperedStream, key); //footer is still authentic
+            report.checks++; //count tamper check
+            if (reader.Verify()) //if tampered chunk passed verification
+                report.failures.push_back(name + ": accepted a tampered chunk"); //add failure
+            stringstream wrongKeyStream(container); //represents container read with a different key
+            report.checks++; //count key check
+            try {
+                AESContainer::Reader wrongKey(wrongKeyStream, vector<unsigned char>(16, 0x00)); //must reject key
+                report.failures.push_back(name + ": accepted a wrong key"); //add failure
+            }
+            catch (const invalid_argument&) { //wrong key is rejected
+            }
+        }
+        catch (const exception& error) { //if container failed
+            report.checks++; //count container check
+            report.failures.push_back(name + ": " + error.what()); //add failure
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that checks that AESSession gives the same output as the reference when a message is processed in pieces, in every mode and both directions.
+ * @param  Report report
+ */
+void AESVerify::CheckSession(Report& report) {
+    const vector<unsigned char> key = HexToVector("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b"), iv = HexToVector("f0f1f2f3f4f5f6f7fffffffffffffffe"); //represents key and an iv whose low counter half wraps inside the message
+    vector<unsigned char> text(96); //represents message of six blocks
+    for (size_t i = 0; i < text.size(); i++) //iterate over bytes
+        text[i] = (unsigned char)(i * 11 + 7); //set varied bytes
+    for (const char* mode : Modes) { //iterate over modes
+        const bool isBlockMode = mode == string("ECB") || mode == string("CBC"); //ECB and CBC sessions take whole blocks
+        const size_t pieces[] = { isBlockMode ? (size_t)16 : (size_t)1, isBlockMode ? (size_t)48 : (size_t)20 }; //represents sizes of first pieces, the rest is the last piece
+        vector<unsigned char> expected(text.size()), cipher(text.size()), plain(text.size()); //represents reference ciphertext, session ciphertext and decrypted text
+        unsigned char state[BlockSize]; //represents iv of reference
+        memcpy(state, iv.data(), BlockSize); //set iv of reference
+        Reference(mode, true, key, state, text.data(), expected.data(), text.size()); //encrypt message with reference
+        const string name = string("AESSession ") + mode; //represents name of checks
+        try {
+            for (bool encrypt : { true, false }) { //iterate over directions
+                AESSession::State session = AESSession::Create(mode, encrypt, key, iv.data()); //represents session of direction
+                const unsigned char* input = encrypt ? text.data() : cipher.data(); //represents input of direction
+                unsigned char* output = encrypt ? cipher.data() : plain.data(); //represents output of direction
+                AESSession::Process(session, input, output, pieces[0]); //process pieces, CFB, OFB and CTR continue mid-block
+                AESSession::Process(session, input + pieces[0], output + pieces[0], pieces[1]);
+                AESSession::Process(session, input + pieces[0] + pieces[1], output + pieces[0] + pieces[1], text.size() - pieces[0] - pieces[1]);
+                AESSession::Clear(session); //clear key of session
+            }
+            if (Compare(report, name + " encrypt", expected.data(), cipher.data(), text.size())) //if ciphertext matches we compare the decrypted text
+                Compare(report, name + " decrypt", text.data(), plain.data(), text.size()); //compare with message
+        }
+        catch (const exception& error) { //if session failed
+            report.checks++; //count session check
+            report.failures.push_back(name + ": " + error.what()); //add failure
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that checks that AESScatter matches the reference in CBC and CTR when input and output lists are split differently and blocks straddle buffers, and decrypts in place.
+ * @param  Report report
+ */
+void AESVerify::CheckScatter(Report& report) {
+    typedef void (*ScatterFunction)(const iovec*, const size_t, const iovec*, const size_t, const vector<unsigned char>&, unsigned char*); //represents scatter function of a mode with iv
+    const struct { const char* mode; ScatterFunction encrypt; ScatterFunction decrypt; } functions[] = { { "CBC", AESScatter::Encrypt_CBC, AESScatter::Decrypt_CBC }, { "CTR", AESScatter::Encrypt_CTR, AESScatter::Decrypt_CTR } }; //represents modes and their functions
+    const vector<unsigned char> key = HexToVector("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"), iv = HexToVector("000102030405060708090a0b0c0d0e0f"); //represents key and iv of checks
+    vector<unsigned char> text(96), expected(96), buffer(96); //represents data, reference ciphertext and fragmented output
+    for (size_t i = 0; i < text.size(); i++) //iterate over bytes
+        text[i] = (unsigned char)(i * 5 + 9); //set varied bytes
+    const iovec input[] = { { text.data(), 5 }, { text.data() + 5, 27 }, { text.data() + 32, 16 }, { text.data() + 48, 48 } }; //represents input split inside and between blocks
+    const iovec output[] = { { buffer.data(), 50 }, { buffer.data() + 50, 46 } }; //represents output split differently
+    for (const auto& function : functions) { //iterate over modes
+        const string name = string("AESScatter ") + function.mode; //represents name of checks
+        unsigned char state[BlockSize]; //represents iv of each call
+        memcpy(state, iv.data(), BlockSize); //set iv of reference
+        Reference(function.mode, true, key, state, text.data(), expected.data(), text.size()); //encrypt data with reference
+        try {
+            memcpy(state, iv.data(), BlockSize); //set iv of encryption
+            function.encrypt(input, 4, output, 2, key, state); //encrypt fragmented input into fragmented output
+            if (!Compare(report, name + " encrypt", expected.data(), buffer.data(), buffer.size())) //if ciphertext differs we don't decrypt it
+                continue;
+            memcpy(state, iv.data(), BlockSize); //set iv of decryption
+            function.decrypt(output, 2, output, 2, key, state); //decrypt in place
+            Compare(report, name + " decrypt", text.data(), buffer.data(), buffer.size()); //compare with data
+        }
+        catch (const exception& error) { //if scatter function failed
+            report.checks++; //count scatter check
+            report.failures.push_back(name + ": " + error.what()); //add failure
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that checks that AESBufferPool always pads ECB and CBC with PKCS7, matches the reference on the padded data, round-trips data that ends like padding and rejects invalid padding.
+ * @param  Report report
+ */
+void AESVerify::CheckBufferPool(Report& report) {
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), iv = HexToVector("000102030405060708090a0b0c0d0e0f"); //represents key and iv of checks
+    try {
+        AESBufferPool pool(64, 2); //represents pool of two small buffers
+        for (const char* mode : { "ECB", "CBC" }) { //iterate over padded modes
+            const bool isCBC = mode == string("CBC"); //represents if mode uses an iv
+            for (size_t length : { (size_t)0, (size_t)1, (size_t)15, (size_t)16, (size_t)17, (size_t)48 }) { //iterate over lengths around block boundaries
+                const string name = string("AESBufferPool ") + mode + " of " + to_string(length) + " bytes"; //represents name of checks
+                vector<unsigned char> text(length, 0x01), expected(text); //represents data ending in a byte that looks like padding and its padded encryption
+                for (size_t i = 0; i + 1 < length; i++) //iterate over bytes but the last
+                    text[i] = expected[i] = (unsigned char)(i * 3); //set varied bytes
+                expected.insert(expected.end(), BlockSize - length % BlockSize, (unsigned char)(BlockSize - length % BlockSize)); //append PKCS7 padding, a full block if length is a multiple of 16
+                unsigned char state[BlockSize]; //represents iv of each call
+                memcpy(state, iv.data(), BlockSize); //set iv of reference
+                Reference(mode, true, key, state, expected.data(), expected.data(), expected.size()); //encrypt padded data with reference
+                AESBufferPool::Buffer buffer = pool.Acquire(length); //represents buffer of data
+                memcpy(buffer.Data(), text.data(), length); //copy data into buffer
+                memcpy(state, iv.data(), BlockSize); //set iv of encryption
+                isCBC ? AESBufferPool::Encrypt_CBC(buffer, key, state) : AESBufferPool::Encrypt_ECB(buffer, key); //encrypt and pad in place
+                report.checks++; //count length check
+                if (buffer.Size() != expected.size()) { //if pool didn't add 1 to 16 bytes of padding
+                    report.failures.push_back(name + ": encrypted to " + to_string(buffer.Size()) + " bytes"); //add failure
+                    continue;
+                }
+                if (!Compare(report, name + " encrypt", expected.data(), buffer.Data(), expected.size())) //if ciphertext differs we don't decrypt it
+                    continue;
+                memcpy(state, iv.data(), BlockSize); //set iv of decryption
+                isCBC ? AESBufferPool::Decrypt_CBC(buffer, key, state) : AESBufferPool::Decrypt_ECB(buffer, key); //decrypt and remove padding
+                report.checks++; //count length check
+                if (buffer.Size() != length) //if decryption lost or kept bytes
+                    report.failures.push_back(name + ": decrypted to " + to_string(buffer.Size()) + " bytes"); //add failure
+                else
+                    Compare(report, name + " decrypt", text.data(), buffer.Data(), length); //compare with data
+            }
+            AESBufferPool::Buffer buffer = pool.Acquire(BlockSize); //represents block that ends in zero, which is never valid padding
+            fill(buffer.Data(), buffer.Data() + BlockSize, 0x00); //set block of zeros
+            unsigned char state[BlockSize]; //represents iv of reference and decryption
+            memcpy(state, iv.data(), BlockSize); //set iv of reference
+            Reference(mode, true, key, state, buffer.Data(), buffer.Data(), BlockSize); //encrypt block without padding
+            memcpy(state, iv.data(), BlockSize); //set iv of decryption
+            report.checks++; //count rejection check
+            try {
+                isCBC ? AESBufferPool::Decrypt_CBC(buffer, key, state) : AESBufferPool::Decrypt_ECB(buffer, key); //must reject padding
+                report.failures.push_back(string("AESBufferPool ") + mode + " accepted invalid padding"); //add failure
+            }
+            catch (const invalid_argument&) { //invalid padding is rejected, decrypted block must be cleared
+                report.checks++; //count clearing check
+                if (any_of(buffer.Data(), buffer.Data() + BlockSize, [](unsigned char byte) { return byte != 0; })) //if decrypted block was handed out
+                    report.failures.push_back(string("AESBufferPool ") + mode + " kept the decrypted block of invalid padding"); //add failure
+            }
+        }
+    }
+    catch (const exception& error) { //if pool failed
+        report.checks++; //count pool check
+        report.failures.push_back(string("AESBufferPool: ") + error.what()); //add failure
+    }
+}
+
+
+
+/**
+ * @brief  Function that checks that a worker limit set after a priority class ran without a limit is honored, so limited jobs still run on several workers and detached tasks still run.
+ * @param  Report report
+ */
+void AESVerify::CheckWorkerLimits(Report& report) {
+    const size_t threads = GetThreadCount(), limit = GetWorkerLimit(Low); //represents settings to restore
+    const Priority previous = GetPriority(); //represents priority of calling thread to restore
+    SetThreadCount(4); //use three workers besides the calling thread
+    SetPriority(Low); //start low priority jobs
+    SetWorkerLimit(Low, 0); //run low priority jobs without a limit first
+    atomic<size_t> running{ 0 }, peak{ 0 }; //represents number of indexes running at once and its maximum
+    auto task = [&](size_t) { //runs an index long enough for workers to overlap
+        size_t now = ++running, seen = peak.load(); //represents indexes running now and maximum seen so far
+        while (now > seen && !peak.compare_exchange_weak(seen, now)); //raise maximum
+        this_thread::sleep_for(chrono::milliseconds(2)); //keep index running
+        running--; //index finished
+    };
+    ParallelFor(64, task); //run low priority job without a limit
+    SetWorkerLimit(Low, 2); //limit low priority jobs to two workers
+    peak = 0; //measure limited job only
+    ParallelFor(64, task); //run low priority job with a limit
+    report.checks++; //count concurrency check
+    if (peak < 2 || peak > 3) //two workers and the calling thread may run indexes at once
+        report.failures.push_back("AESParallel low priority job ran " + to_string(peak.load()) + " indexes at once with a worker limit of 2"); //add failure
+    struct Signal { mutex lock; condition_variable condition; bool done = false; }; //represents completion of detached task
+    shared_ptr<Signal> signal = make_shared<Signal>(); //shared with task, which may outlive this function if it hangs
+    Submit([signal]() { //submit detached low priority task, which nobody steals
+        lock_guard<mutex> lock(signal->lock); //lock signal for worker
+        signal->done = true; //mark task as run
+        signal->condition.notify_all(); //wake up waiting thread
+    });
+    {
+        unique_lock<mutex> lock(signal->lock); //lock signal for calling thread
+        report.checks++; //count detached task check
+        if (!signal->condition.wait_for(lock, chrono::seconds(5), [&signal]() { return signal->done; })) //if task didn't run in time
+            report.failures.push_back("AESParallel detached low priority task didn't run with a worker limit of 2"); //add failure
+    }
+    SetWorkerLimit(Low, limit); //restore worker limit
+    SetPriority(previous); //restore priority
+    SetThreadCount(threads); //restore thread count
+}
+
+/**
+ * @brief  Function that checks that AESKeyStore stores, replaces, finds, rotates and zeroizes entries, that a read-only store sees them and that lookups fail instead of hanging on an entry whose writer died, does nothing without AES_KEYSTORE.
+ * @param  Report report
+ */
+void AESVerify::CheckKeyStore(Report& report) {
+#ifdef AES_KEYSTORE
+    struct Layout : AESKeyStore { using AESKeyStore::Header; using AESKeyStore::Entry; using AESKeyStore::ReadTimeout; }; //exposes layout of store to simulate a writer that died while writing
+    const string name = "/aes-verify-" + to_string(random_device()()); //represents name of temporary store
+    const vector<unsigned char> keys[] = { HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), HexToVector("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b"),
+        HexToVector("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"), HexToVector("000102030405060708090a0b0c0d0e0f") }; //represents keys of every size and a replacement key
+    auto check = [&](const string& title, const bool isFound, const KeyContext& context, const vector<unsigned char>& key) { //compares found round keys with the key schedule of given key
+        report.checks++; //count lookup check
+        if (!isFound || context.rounds != key.size() / 4 + 6) { //if entry is missing or has the wrong number of rounds
+            report.failures.push_back("AESKeyStore " + title + ": " + (isFound ? "wrong number of rounds" : "entry not found")); //add failure
+            return;
+        }
+        unsigned char expected[15 * BlockSize] = {}; //represents round keys of key
+        KeySchedule(key.data(), key.size(), expected); //expand key with flat key schedule
+        Compare(report, "AESKeyStore " + title, expected, context.roundKeys, (context.rounds + 1) * BlockSize); //compare round keys
+    };
+    auto expect = [&](const string& title, const bool isTrue) { //adds a failure if given condition doesn't hold
+        report.checks++; //count check
+        if (!isTrue) //if condition doesn't hold
+            report.failures.push_back("AESKeyStore " + title); //add failure
+    };
+    KeyContext context; //represents round keys of lookups
+    uint64_t version = 0; //represents version found by FindLatest
+    try {
+        AESKeyStore store(name, 5); //represents store, capacity is rounded up to 8 entries
+        expect("capacity rounds up to a power of two", store.GetCapacity() == 8 && store.IsWritable() && store.GetCount() == 0); //check new store
+        store.Put(1, 1, keys[0]); //add first version of key 1
+        store.Put(1, 2, keys[1]); //rotate key 1 to a second version
+        store.Put(2, 7, keys[2]); //add key 2
+        expect("counts three entries", store.GetCount() == 3); //check count
+        check("find key 1 version 1", store.Find(1, 1, context), context, keys[0]); //find first version
+        check("find key 1 version 2", store.Find(1, 2, context), context, keys[1]); //find second version
+        check("find key 2 version 7", store.Find(2, 7, context), context, keys[2]); //find key 2
+        expect("doesn't find missing version", !store.Find(2, 1, context) && !store.Find(3, 1, context)); //check missing entries
+        check("find latest version of key 1", store.FindLatest(1, context, version) && version == 2, context, keys[1]); //find latest version while both are stored
+        store.Put(1, 2, keys[3]); //replace second version of key 1
+        expect("replacing doesn't count again", store.GetCount() == 3); //check count after replacement
+        check("find replaced key 1 version 2", store.Find(1, 2, context), context, keys[3]); //find replaced entry
+        unsigned char lastRoundKey[BlockSize]; //represents last round key of removed entry, which isn't part of the key
+        memcpy(lastRoundKey, context.roundKeys + context.rounds * BlockSize, BlockSize); //copy last round key
+        expect("removes key 1 version 2", store.Remove(1, 2) && !store.Remove(1, 2) && store.GetCount() == 2); //remove second version once
+        expect("doesn't find removed version", !store.Find(1, 2, context)); //check removed entry
+        check("find latest version after removal", store.FindLatest(1, context, version) && version == 1, context, keys[0]); //first version is the latest again
+
+        AESKeyStore reader(name); //represents store opened read-only like a worker process
+        expect("reopened store is read-only", !reader.IsWritable() && reader.GetCapacity() == 8 && reader.GetCount() == 2); //check reopened store
+        check("reader finds key 2 version 7", reader.Find(2, 7, context), context, keys[2]); //find entry through read-only mapping
+        check("reader finds latest version of key 1", reader.FindLatest(1, context, version) && version == 1, context, keys[0]); //find latest through read-only mapping
+        bool isRejected = false; //represents if read-only store rejected a write
+        try {
+            reader.Put(3, 1, keys[0]); //must reject write
+        }
+        catch (const runtime_error&) { //read-only store rejects writes
+            isRejected = true;
+        }
+        expect("read-only store rejects writes", isRejected); //check rejection
+
+        int fd = shm_open(name.c_str(), O_RDWR, 0); //open store again to inspect and disturb its entries
+        struct stat info{}; //represents file information
+        void* mapping = fd != -1 && fstat(fd, &info) == 0 ? mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED; //map whole store
+        if (fd != -1) //if store was opened
+            close(fd); //mapping keeps shared memory alive
+        expect("store can be mapped for inspection", mapping != MAP_FAILED); //check mapping
+        if (mapping != MAP_FAILED) { //if store is mapped we check zeroization and dead writers
+            unsigned char* bytes = (unsigned char*)mapping; //represents bytes of store
+            expect("removed round keys are zeroized", search(bytes, bytes + info.st_size, lastRoundKey, lastRoundKey + BlockSize) == bytes + info.st_size); //last round key of removed entry must be gone
+            Layout::Entry* entries = (Layout::Entry*)(bytes + sizeof(Layout::Header)); //represents entries of store
+            const size_t count = (size_t)((Layout::Header*)mapping)->capacity; //represents number of entries
+            for (size_t i = 0; i < count; i++) //iterate over entries
+                entries[i].sequence.fetch_add(1); //mark entry as being written, as if the writer died halfway
+            auto start = chrono::steady_clock::now(); //represents start of lookups
+            bool isFound = reader.Find(2, 7, context) || reader.FindLatest(1, context, version); //lookups must give up on entries that stay mid-write
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); //represents time of both lookups
+            expect("lookups fail on entries of a dead writer", !isFound && context.rounds == 0); //check failed lookups left no round keys
+            expect("lookups give up within their timeout", elapsed < 10.0 * Layout::ReadTimeout); //two lookups wait one timeout each
+            for (size_t i = 0; i < count; i++) //iterate over entries
+                entries[i].sequence.fetch_add(1); //finish write, entries are unchanged
+            check("reader finds key 2 after writer finished", reader.Find(2, 7, context), context, keys[2]); //lookups work again
+            munmap(mapping, (size_t)info.st_size); //unmap store
+        }
+    }
+    catch (const exception& error) { //if store failed
+        report.checks++; //count store check
+        report.failures.push_back(string("AESKeyStore: ") + error.what()); //add failure
+    }
+    Clear(context); //clear round keys of lookups
+    AESKeyStore::Unlink(name); //remove temporary store
+#else
+    (void)report; //key store isn't available on this platform
+#endif
+}
+
+/**
+ * @brief  Function that checks that AESDaemon and AESClient round-trip every mode through shared memory, match the reference and that the daemon rejects modes outside Mode, does nothing without AES_DAEMON.
+ * @param  Report report
+ */
+void AESVerify::CheckDaemon(Report& report) {
+#ifdef AES_DAEMON
+    struct Daemon : AESDaemon { using AESDaemon::AESDaemon; using AESDaemon::Client; using AESDaemon::Validate; }; //exposes validation of requests that AESClient never sends
+    const string path = (filesystem::temp_directory_path() / ("aes-verify-" + to_string(random_device()()) + ".sock")).string(); //represents temporary socket
+    const vector<unsigned char> key = HexToVector("2b7e151628aed2a6abf7158809cf4f3c"), iv = HexToVector("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"); //represents key and iv of checks
+    vector<unsigned char> text(100), expected(text.size()); //represents message, not a multiple of 16 bytes, and reference output
+    for (size_t i = 0; i < text.size(); i++) //iterate over bytes
+        text[i] = (unsigned char)(i * 17 + 5); //set varied bytes
+    try {
+        Daemon daemon(path); //represents daemon on temporary socket
+        thread server([&daemon]() { //serve clients until stopped
+            try {
+                daemon.Run(); //serve clients
+            }
+            catch (const exception&) { //failures surface as failed client calls
+            }
+        });
+        try {
+            AESClient client(path, 4096); //represents client with a small shared buffer
+            const uint32_t keyId = client.RegisterKey(key); //register key once
+            for (const char* mode : Modes) { //iterate over modes
+                const string name = string("AESDaemon ") + mode; //represents name of checks
+                const size_t length = mode == string("ECB") || mode == string("CBC") ? 96 : text.size(); //ECB and CBC take whole blocks
+                const size_t offset = 32; //represents offset of payload in shared buffer
+                unsigned char state[BlockSize]; //represents iv of each call
+                memcpy(state, iv.data(), BlockSize); //set iv of reference
+                Reference(mode, true, key, state, text.data(), expected.data(), length); //encrypt message with reference
+                memcpy(client.GetBuffer() + offset, text.data(), length); //write message to shared buffer
+                memcpy(state, iv.data(), BlockSize); //set iv of encryption
+                client.Encrypt(mode, keyId, offset, length, state); //encrypt in place
+                if (!Compare(report, name + " encrypt", expected.data(), client.GetBuffer() + offset, length)) //if ciphertext differs we don't decrypt it
+                    continue;
+                memcpy(state, iv.data(), BlockSize); //set iv of decryption
+                client.Decrypt(mode, keyId, offset, length, state); //decrypt in place
+                Compare(report, name + " decrypt", text.data(), client.GetBuffer() + offset, length); //compare with message
+            }
+            Daemon::Client peer; //represents client without keys or shared memory
+            AESDaemon::Request request{}; //represents Process request with a mode outside Mode
+            request.type = AESDaemon::Process; //set type
+            request.mode = AESDaemon::ModeCount; //set first invalid mode
+            report.checks++; //count rejection check
+            if (daemon.Validate(peer, request) != AESDaemon::InvalidRequest) //if mode wasn't rejected before anything else
+                report.failures.push_back("AESDaemon accepted mode " + to_string(request.mode)); //add failure
+        }
+        catch (const exception& error) { //if client failed
+            report.checks++; //count client check
+            report.failures.push_back(string("AESDaemon: ") + error.what()); //add failure
+        }
+        daemon.Stop(); //make server return
+        server.join(); //wait for server
+    }
+    catch (const exception& error) { //if daemon couldn't start
+        report.checks++; //count daemon check
+        report.failures.push_back(string("AESDaemon: ") + error.what()); //add failure
+    }
+#else
+    (void)report; //daemon isn't available on this platform
+#endif
+}
+
+
+
+/**
+ * @brief  Function that runs given number of rounds of the AESAVS Monte Carlo procedure with given path and stores the last output of each round in given results.
+ * @brief  Returns false if the path doesn't support given mode.
+ * @param  Path path
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  vector<unsigned char> key
+ * @param  const unsigned char* iv
+ * @param  const unsigned char* text
+ * @param  size_t rounds
+ * @param  vector<unsigned char> results
+ * @return  bool isSupported
+ */
+bool AESVerify::MonteCarloPath(const Path path, const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv, const unsigned char* text, const size_t rounds, vector<unsigned char>& results) {
+    vector<unsigned char> roundKey = key; //represents key of current round
+    unsigned char roundIV[BlockSize], input[BlockSize], output[BlockSize] = {}, previous[BlockSize] = {}, chain[BlockSize], state[BlockSize]; //represents IV of round, current input and output, previous output, chaining value and IV handed to path
+    memcpy(roundIV, iv, BlockSize); //set IV of first round
+    memcpy(input, text, BlockSize); //set input of first round
+    results.clear(); //clear results of previous run
+    for (size_t i = 0; i < rounds; i++) { //iterate over rounds
+        memcpy(chain, roundIV, BlockSize); //chain starts with IV of round
+        for (size_t j = 0; j < MonteCarloCalls; j++) { //iterate over chained calls
+            memcpy(previous, output, BlockSize); //keep output of previous call
+            memcpy(state, chain, BlockSize); //hand chaining value to path
+            if (!RunPath(path, mode, encrypt, roundKey, state, input, output, BlockSize)) //if path doesn't support mode
+                return false;
+            NextChain(mode, encrypt, chain, input, output); //advance chaining value past block
+            if (mode == "ECB") //if mode is ECB the output is the next input
+                memcpy(input, output, BlockSize); //set next input
+            else //else the next input is the IV after the first call and the previous output after that
+                memcpy(input, j == 0 ? roundIV : previous, BlockSize); //set next input
+        }
+        results.insert(results.end(), output, output + BlockSize); //keep last output of round
+        size_t keySize = roundKey.size(); //represents key size in bytes
+        for (size_t k = 0; k < keySize; k++) //iterate over key, the last outputs fill it from the end
+            roundKey[keySize - 1 - k] ^= k < BlockSize ? output[BlockSize - 1 - k] : previous[2 * BlockSize - 1 - k]; //XOR key with tail of previous and last output
+        if (mode != "ECB") { //if mode chains the next round starts from the last outputs
+            memcpy(roundIV, output, BlockSize); //set IV of next round
+            memcpy(input, previous, BlockSize); //set input of next round
+        }
+    }
+    ClearVector(roundKey); //clear key
+    return true;
+}
+
+
+/**
+ * @brief  Function that advances given chaining value of given mode past one full block with given input and output.
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  unsigned char* chain
+ * @param  const unsigned char* input
+ * @param  const unsigned char* output
+ */
+void AESVerify::NextChain(const string& mode, const bool encrypt, unsigned char* chain, const unsigned char* input, const unsigned char* output) {
+    if (mode == "CBC" || mode == "CFB") //if mode chains the cipher block
+        memcpy(chain, encrypt ? output : input, BlockSize); //set chain to cipher block
+    else if (mode == "OFB") //if mode chains the keystream block
+        for (size_t i = 0; i < BlockSize; i++) //iterate over block
+            chain[i] = input[i] ^ output[i]; //recover keystream from input and output
+    else if (mode == "CTR") //if mode is CTR
+        AddCounter(chain, 1); //increment counter
+}
+
+
+/**
+ * @brief  Function that performs given mode on given buffer with given path, iv is updated for the next call if the path keeps chaining state.
+ * @brief  Returns false without processing if the path doesn't support given mode and length, the vector API removes padding so padded decryption is verified through the engine it wraps.
+ * @brief  The checksum path compares its fused checksums with the CRC32C of the input and output and throws if they differ.
+ * @param  Path path
+ * @param  string mode
+ * @param  bool encrypt
+ * @param  vector<unsigned char> key
+ * @param  unsigned char* iv
+ * @param  const unsigned char* input
+ * @param  unsigned char* output
+ * @param  size_t length
+ * @return  bool isSupported
+ * @throws  runtime_error thrown if the fused checksums don't match.
+ */
+bool AESVerify::RunPath(const Path path, const string& mode, const bool encrypt, const vector<unsigned char>& key, unsigned char* iv, const unsigned char* input, unsigned char* output, const size_t length) {
+    bool isPadded = mode == "ECB" || mode == "CBC"; //represents if mode requires full blocks
+    if (path == ReferencePath) //if path is the reference
+        Reference(mode, encrypt, key, iv, input, output, length); //run reference
+    else if (path == VectorPath) { //if path is the vector API of AES
+        if (length == 0 || (isPadded && !encrypt)) //if vector API rejects empty text or would remove padding
+            return false;
+        vector<unsigned char> text(input, input + length), ivVector(iv, iv + BlockSize); //represents text and IV vectors
+        if (mode == "ECB") //if mode is ECB
+            AES::Encrypt_ECB(text, key); //encrypt text
+        else if (mode == "CBC") //if mode is CBC
+            AES::Encrypt_CBC(text, key, ivVector); //encrypt text
+        else if (mode == "CFB") //if mode is CFB
+            encrypt ? AES::Encrypt_CFB(text, key, ivVector) : AES::Decrypt_CFB(text, key, ivVector); //encrypt or decrypt text
+        else if (mode == "OFB") //if mode is OFB
+            encrypt ? AES::Encrypt_OFB(text, key, ivVector) : AES::Decrypt_OFB(text, key, ivVector); //encrypt or decrypt text
+        else //else mode is CTR
+            encrypt ? AES::Encrypt_CTR(text, key, ivVector) : AES::Decrypt_CTR(text, key, ivVector); //encrypt or decrypt text
+        memcpy(output, text.data(), length); //copy text to output
+        ClearVector(text); //clear text
+    }
+    else if (path == VectorBackendPath) { //if path is the vector API of AES with the vector permute backend selected
+        const ModeBackend previous = GetBackend(); //represents backend to restore
+        SetBackend(VectorPermuteBackend); //select vector permute backend
+        try {
+            bool isSupported = RunPath(VectorPath, mode, encrypt, key, iv, input, output, length); //run vector API on selected backend
+            SetBackend(previous); //restore backend
+            return isSupported;
+        }
+        catch (...) { //if path threw we restore backend before we rethrow
+            SetBackend(previous);
+            throw;
+        }
+    }
+    else if (path == EnginePath) { //if path is the mode engine
+        if (length > 0) //if there's input
+            memmove(output, input, length); //copy input to output, buffers may be the same
+        RunEngine<AESModeEngine::SoftwareBackend>(mode, encrypt, key, iv, output, length); //process output in place with software backend
+    }
+    else if (path == ParallelPath) { //if path is the pointer API of AESParallel
+        if (mode == "ECB") //if mode is ECB
+            encrypt ? AESParallel::Encrypt_ECB(input, output, length, key) : AESParallel::Decrypt_ECB(input, output, length, key); //encrypt or decrypt buffer
+        else if (mode == "CBC") //if mode is CBC
+            encrypt ? AESParallel::Encrypt_CBC(input, output, length, key, iv) : AESParallel::Decrypt_CBC(input, output, length, key, iv); //encrypt or decrypt buffer
+        else if (mode == "CFB") //if mode is CFB
+            encrypt ? AESParallel::Encrypt_CFB(input, output, length, key, iv) : AESParallel::Decrypt_CFB(input, output, length, key, iv); //encrypt or decrypt buffer
+        else if (mode == "OFB") //if mode is OFB
+            encrypt ? AESParallel::Encrypt_OFB(input, output, length, key, iv) : AESParallel::Decrypt_OFB(input, output, length, key, iv); //encrypt or decrypt buffer
+        else //else mode is CTR
+            encrypt ? AESParallel::Encrypt_CTR(input, output, length, key, iv) : AESParallel::Decrypt_CTR(input, output, length, key, iv); //encrypt or decrypt buffer
+    }
+    else if (path == StreamPath) { //if path is AESStream
+        if (isPadded) //if stream would add or remove padding
+            return false;
+        AESStream stream(mode, encrypt, key, iv); //represents stream of mode
+        size_t first = length / 3, second = min(length - first, (size_t)1 + length / 3); //split input into three pieces so pieces end inside blocks
+        size_t written = stream.Update(input, output, first); //process first piece
+        written += stream.Update(input + first, output + written, second); //process second piece
+        written += stream.Update(input + first + second, output + written, length - first - second); //process last piece
+        stream.Final(output + written); //finish stream
+    }
+    else if (path == KeyBatchPath) { //if path is AESKeyBatch
+        if (mode != "ECB" || length == 0) //if key batch doesn't support mode
+            return false;
+        KeyContext context = Expand(key); //expand key into flat context
+        encrypt ? EncryptBlocks(context, input, output, length) : DecryptBlocks(context, input, output, length); //encrypt or decrypt blocks
+        Clear(context); //clear context
+    }
+    else if (path == VectorPermutePath) { //if path is the mode engine with the vector permute backend
+        if (length > 0) //if there's input
+            memmove(output, input, length); //copy input to output, buffers may be the same
+        RunEngine<AESVectorPermute::Backend>(mode, encrypt, key, iv, output, length); //process output in place with vector permute backend
+    }
+    else { //else path is AESChecksum
+        if (mode == "CFB" || mode == "OFB") //if checksums aren't fused into mode
+            return false;
+        uint32_t inputChecksum = AESChecksum::CRC32C(input, length); //represents checksum of input, taken before it may be overwritten in place
+        AESChecksum::Checksums checksums; //represents fused checksums
+        if (mode == "ECB") //if mode is ECB
+            checksums = encrypt ? AESChecksum::Encrypt_ECB(input, output, length, key) : AESChecksum::Decrypt_ECB(input, output, length, key); //encrypt or decrypt buffer
+        else if (mode == "CBC") //if mode is CBC
+            checksums = encrypt ? AESChecksum::Encrypt_CBC(input, output, length, key, iv) : AESChecksum::Decrypt_CBC(input, output, length, key, iv); //encrypt or decrypt buffer
+        else //else mode is CTR
+            checksums = encrypt ? AESChecksum::Encrypt_CTR(input, output, length, key, iv) : AESChecksum::Decrypt_CTR(input, output, length, key, iv); //encrypt or decrypt buffer
+        if (checksums.input != inputChecksum || checksums.output != AESChecksum::CRC32C(output, length)) //if fused checksums differ from separate ones
+            throw runtime_error("Fused CRC32C checksums don't match the input and output."); //throw runtime error
+    }
+    return true;
+}
+
+
+/**
+ * @brief  Function that returns the name of given path for reports.
+ * @param  Path path
+ * @return  string name
+ */
+string AESVerify::PathName(const Path path) {
+    switch (path) {
+    case ReferencePath: return "reference";
+    case VectorPath: return "AES";
+    case EnginePath: return "AESModeEngine";
+    case ParallelPath: return "AESParallel";
+    case StreamPath: return "AESStream";
+    case KeyBatchPath: return "AESKeyBatch";
+    case ChecksumPath: return "AESChecksum";
+    case VectorPermutePath: return "AESVectorPermute";
+    case VectorBackendPath: return "AES with vector permute backend";
+    default: return "unknown";
+    }
+}
+
+
+/**
+ * @brief  Function that compares given buffers, counts the check and adds a failure with given name to given report if they differ.
+ * @param  Report report
+ * @param  string name
+ * @param  const unsigned char* expected
+ * @param  const unsigned char* actual
+ * @param  size_t length
+ * @return  bool matches
+ */
+bool AESVerify::Compare(Report& report, const string& name, const unsigned char* expected, const unsigned char* actual, const size_t length) {
+    report.checks++; //count check
+    for (size_t i = 0; i < length; i++) { //iterate over buffers
+        if (expected[i] != actual[i]) { //if bytes differ
+            report.failures.push_back(name + ": mismatch at byte " + to_string(i)); //add failure with first differing byte
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#ifdef AES_FUZZ
+/**
+ * @brief  libFuzzer entry point that runs each input through every path and aborts on the first mismatch with the reference.
+ * @brief  Build the library sources without main.cpp with -fsanitize=fuzzer -DAES_FUZZ.
+ * @param  const uint8_t* data
+ * @param  size_t size
+ * @return  int result
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool isConfigured = (AESParallel::SetThreadCount(2), true); //use two threads once so parallel paths split buffers
+    (void)isConfigured;
+    AESVerify::Report report = AESVerify::Fuzz(data, size); //run input through every path
+    for (const string& failure : report.failures) //iterate over failures
+        cerr << failure << endl; //print failure
+    if (!report.failures.empty()) //if any path differs from the reference
+        abort(); //report crash to fuzzer
+    return 0;
+}
+#endif
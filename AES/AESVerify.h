@@ -0,0 +1,329 @@
+#ifndef _AESVERIFY_H
+#define _AESVERIFY_H
+#include "AESKeyBatch.h"
+#include "AESModeEngine.h"
+#include "AESVectorPermute.h"
+#include "AESOCB.h"
+#include "AESChecksum.h"
+#include "AESRekey.h"
+#include "AESFF1.h"
+#include "AESMappedView.h"
+#include "AESKeyStore.h"
+#include "AESKeyWrap.h"
+#include "AESContainer.h"
+#include "AESSession.h"
+#include "AESScatter.h"
+#include "AESBufferPool.h"
+#include "AESClient.h"
+#include <cstdint>
+
+/**
+ * @file AESVerify.h
+ * @brief  AESVerify class, a differential verification harness that proves the optimized paths of the library match the reference byte for byte.
+ * @brief  The reference is a plain block by block implementation of every mode on top of EncryptBlock and DecryptBlock with the KeySchedule round keys.
+ * @brief  Known answers are the FIPS-197 examples, the NIST AESAVS GFSbox, KeySbox, VarTxt and VarKey samples, the NIST SP 800-38A vectors of all modes and key sizes, the RFC 7253 OCB vectors, the RFC 3720 CRC32C vectors, the NIST SP 800-38G FF1 samples and the RFC 3394 and RFC 5649 key wrap examples.
+ * @brief  Monte Carlo runs the AESAVS Monte Carlo procedure on every mode, key size and direction, checks the NIST answers of ECB and CBC and compares every path with the reference.
+ * @brief  Differential runs random cases of random lengths, unaligned offsets, in-place buffers and counters about to wrap through every path and chunk width, and re-encrypts each case under a random new key and mode.
+ * @brief  Compiled with AES_FUZZ, the harness provides a libFuzzer entry point that runs the differential check on each input.
+ */
+class AESVerify : public AESKeyBatch {
+public:
+	/**
+	 * @brief  Represents the result of a verification run.
+	 */
+	struct Report {
+		size_t checks = 0; //number of comparisons performed
+		vector<string> failures; //description of each mismatch, empty if all checks passed
+	};
+
+	/**
+	 * @brief  Function that runs the known answers, the Monte Carlo procedure and given number of random differential cases and returns the report.
+	 * @brief  Parallel settings are changed while verifying and restored afterwards, so it shouldn't run alongside other parallel operations.
+	 * @param  size_t iterations
+	 * @param  size_t rounds
+	 * @param  uint64_t seed
+	 * @return  Report report
+	 */
+	static Report Run(const size_t iterations = 1000, const size_t rounds = 100, const uint64_t seed = 1);
+
+	/**
+	 * @brief  Function that checks the FIPS-197, AESAVS, SP 800-38A, RFC 7253, RFC 3720, RFC 3394 and RFC 5649 known answers on every path, round-trips the containers, sessions, scatter-gather lists and buffer pool, and adds the results to given report.
+	 * @param  Report report
+	 */
+	static void KnownAnswer(Report& report);
+
+	/**
+	 * @brief  Function that runs given number of outer rounds of the AESAVS Monte Carlo procedure for every mode, key size and direction and adds the results to given report.
+	 * @brief  Each round chains 1000 calls on a single block, AESAVS uses 100 rounds.
+	 * @param  Report report
+	 * @param  size_t rounds
+	 */
+	static void MonteCarlo(Report& report, const size_t rounds = 100);
+
+	/**
+	 * @brief  Function that runs given number of random cases through every path and adds the results to given report.
+	 * @param  Report report
+	 * @param  size_t iterations
+	 * @param  uint64_t seed
+	 */
+	static void Differential(Report& report, const size_t iterations, const uint64_t seed);
+
+	/**
+	 * @brief  Function that decodes a case from given fuzzer input, runs it through every path and returns the report.
+	 * @brief  The first byte selects mode, direction and key size, the second the input and output offsets, the third in-place, streaming and chunk width, then follow key, IV and input.
+	 * @brief  Inputs too short to hold a key and IV return an empty report.
+	 * @param  const unsigned char* data
+	 * @param  size_t size
+	 * @return  Report report
+	 */
+	static Report Fuzz(const unsigned char* data, const size_t size);
+
+	/**
+	 * @brief  Function that performs given mode on given buffer block by block with the reference EncryptBlock and DecryptBlock, iv is updated for the next call.
+	 * @brief  ECB and CBC require length to be a multiple of 16 bytes, CTR increments the lower 8 bytes of the counter like the rest of the library.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @throws  invalid_argument thrown if given mode, key or length is invalid.
+	 */
+	static void Reference(const string& mode, const bool encrypt, const vector<unsigned char>& key, unsigned char* iv, const unsigned char* input, unsigned char* output, const size_t length);
+
+protected:
+	/**
+	 * @brief  Represents the reference and the paths of the library that are compared with it.
+	 */
+	enum Path { ReferencePath, VectorPath, EnginePath, ParallelPath, StreamPath, KeyBatchPath, ChecksumPath, VectorPermutePath, VectorBackendPath, PathCount };
+
+	/**
+	 * @brief  Represents the modes of operation that are verified.
+	 */
+	static const char* const Modes[5];
+
+	/**
+	 * @brief  Represents the number of chained calls in each round of the AESAVS Monte Carlo procedure.
+	 */
+	static const size_t MonteCarloCalls = 1000;
+
+	/**
+	 * @brief  Represents the chunk sizes in bytes the parallel path is verified with, so chunk boundaries fall inside and between blocks of every batch width.
+	 */
+	static const size_t ChunkWidths[4];
+
+	/**
+	 * @brief  Represents a single differential case.
+	 */
+	struct Case {
+		string mode; //mode of operation
+		bool encrypt = true; //true for encryption, false for decryption
+		vector<unsigned char> key; //AES key
+		unsigned char iv[16] = {}; //IV or counter, unused in ECB mode
+		vector<unsigned char> input; //input of case
+		size_t inputOffset = 0; //offset of input from the start of its buffer
+		size_t outputOffset = 0; //offset of output from the start of its buffer
+		bool inPlace = false; //true if output overwrites input
+		size_t chunkWidth = 0; //chunk size of the parallel path
+		bool streaming = false; //true if the parallel path may use non-temporal stores
+		string newMode; //mode the input is re-encrypted into as ciphertext of mode, empty to skip re-encryption
+		vector<unsigned char> newKey; //key the input is re-encrypted into
+		unsigned char newIV[16] = {}; //IV or counter the input is re-encrypted into
+	};
+
+	/**
+	 * @brief  Function that runs given case through every path that supports it, compares each with the reference and adds the results to given report.
+	 * @param  Report report
+	 * @param  Case testCase
+	 */
+	static void CheckCase(Report& report, const Case& testCase);
+
+	/**
+	 * @brief  Function that re-encrypts the input of given case as ciphertext of its mode into its new mode, compares the output and both IVs with the reference and adds the results to given report.
+	 * @param  Report report
+	 * @param  Case testCase
+	 * @param  string name
+	 */
+	static void CheckReencrypt(Report& report, const Case& testCase, const string& name);
+
+	/**
+	 * @brief  Function that checks given known answer in both directions on every path that supports it and adds the results to given report.
+	 * @param  Report report
+	 * @param  string name
+	 * @param  string mode
+	 * @param  string key
+	 * @param  string iv
+	 * @param  string plainText
+	 * @param  string cipherText
+	 */
+	static void CheckKnown(Report& report, const string& name, const string& mode, const string& key, const string& iv, const string& plainText, const string& cipherText);
+
+	/**
+	 * @brief  Function that checks the RFC 7253 sample vectors and the iterative OCB test of every key size and adds the results to given report.
+	 * @param  Report report
+	 */
+	static void CheckOCB(Report& report);
+
+	/**
+	 * @brief  Function that checks the RFC 3720 CRC32C vectors with the lookup tables and the CRC32 instruction and the combination of checksums and adds the results to given report.
+	 * @param  Report report
+	 */
+	static void CheckCRC32C(Report& report);
+
+	/**
+	 * @brief  Function that checks the NIST SP 800-38G FF1 samples with single calls and a batch that interleaves the rounds of both texts and adds the results to given report.
+	 * @param  Report report
+	 */
+	static void CheckFF1(Report& report);
+
+	/**
+	 * @brief  Function that checks the RFC 3394 and RFC 5649 key wrap examples with single calls and a batch and that unwrapping rejects a tampered wrapped key, and adds the results to given report.
+	 * @param  Report report
+	 */
+	static void CheckKeyWrap(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESStream with PKCS7Padding round-trips texts of every length up to three blocks in ECB and CBC, including texts that end like padding, and rejects invalid padding.
+	 * @param  Report report
+	 */
+	static void CheckPadding(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESPipeline round-trips ECB and CBC with PKCS7 padding through pipes with chunks of 1, 7 and 16 bytes, where chunks produce no output, does nothing on Windows.
+	 * @param  Report report
+	 */
+	static void CheckPipeline(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESMappedView reads the same plaintext as Decrypt_CTR of the whole file with a cache smaller than the file, counters that wrap inside the file, prefetching and concurrent readers.
+	 * @param  Report report
+	 */
+	static void CheckMappedView(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESContainer round-trips data of several chunks in CBC and CTR, reads single chunks and ranges that cross chunks, and rejects a tampered chunk and a wrong key.
+	 * @param  Report report
+	 */
+	static void CheckContainer(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESSession gives the same output as the reference when a message is processed in pieces, in every mode and both directions.
+	 * @param  Report report
+	 */
+	static void CheckSession(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESScatter matches the reference in CBC and CTR when input and output lists are split differently and blocks straddle buffers, and decrypts in place.
+	 * @param  Report report
+	 */
+	static void CheckScatter(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESBufferPool always pads ECB and CBC with PKCS7, matches the reference on the padded data, round-trips data that ends like padding and rejects invalid padding.
+	 * @param  Report report
+	 */
+	static void CheckBufferPool(Report& report);
+
+	/**
+	 * @brief  Function that checks that a worker limit set after a priority class ran without a limit is honored, so limited jobs still run on several workers and detached tasks still run.
+	 * @param  Report report
+	 */
+	static void CheckWorkerLimits(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESKeyStore stores, replaces, finds, rotates and zeroizes entries, that a read-only store sees them and that lookups fail instead of hanging on an entry whose writer died, does nothing without AES_KEYSTORE.
+	 * @param  Report report
+	 */
+	static void CheckKeyStore(Report& report);
+
+	/**
+	 * @brief  Function that checks that AESDaemon and AESClient round-trip every mode through shared memory, match the reference and that the daemon rejects modes outside Mode, does nothing without AES_DAEMON.
+	 * @param  Report report
+	 */
+	static void CheckDaemon(Report& report);
+
+	/**
+	 * @brief  Function that runs given number of rounds of the AESAVS Monte Carlo procedure with given path and stores the last output of each round in given results.
+	 * @brief  Returns false if the path doesn't support given mode.
+	 * @param  Path path
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  const unsigned char* iv
+	 * @param  const unsigned char* text
+	 * @param  size_t rounds
+	 * @param  vector<unsigned char> results
+	 * @return  bool isSupported
+	 */
+	static bool MonteCarloPath(const Path path, const string& mode, const bool encrypt, const vector<unsigned char>& key, const unsigned char* iv, const unsigned char* text, const size_t rounds, vector<unsigned char>& results);
+
+	/**
+	 * @brief  Function that advances given chaining value of given mode past one full block with given input and output.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  unsigned char* chain
+	 * @param  const unsigned char* input
+	 * @param  const unsigned char* output
+	 */
+	static void NextChain(const string& mode, const bool encrypt, unsigned char* chain, const unsigned char* input, const unsigned char* output);
+
+	/**
+	 * @brief  Function that performs given mode on given buffer with given path, iv is updated for the next call if the path keeps chaining state.
+	 * @brief  Returns false without processing if the path doesn't support given mode and length, the vector API removes padding so padded decryption is verified through the engine it wraps.
+	 * @brief  The checksum path compares its fused checksums with the CRC32C of the input and output and throws if they differ.
+	 * @param  Path path
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  const unsigned char* input
+	 * @param  unsigned char* output
+	 * @param  size_t length
+	 * @return  bool isSupported
+	 * @throws  runtime_error thrown if the fused checksums don't match.
+	 */
+	static bool RunPath(const Path path, const string& mode, const bool encrypt, const vector<unsigned char>& key, unsigned char* iv, const unsigned char* input, unsigned char* output, const size_t length);
+
+	/**
+	 * @brief  Function that performs given mode in place with the mode engine instantiated for given backend, iv is updated for the next call.
+	 * @param  string mode
+	 * @param  bool encrypt
+	 * @param  vector<unsigned char> key
+	 * @param  unsigned char* iv
+	 * @param  unsigned char* text
+	 * @param  size_t length
+	 */
+	template <class Backend>
+	static void RunEngine(const string& mode, const bool encrypt, const vector<unsigned char>& key, unsigned char* iv, unsigned char* text, const size_t length) {
+		if (mode == "ECB") //if mode is ECB
+			AESModeEngine::Process<Backend, AESModeEngine::ECBPolicy>(text, length, key, iv, encrypt); //process with ECB policy
+		else if (mode == "CBC") //if mode is CBC
+			AESModeEngine::Process<Backend, AESModeEngine::CBCPolicy>(text, length, key, iv, encrypt); //process with CBC policy
+		else if (mode == "CFB") //if mode is CFB
+			AESModeEngine::Process<Backend, AESModeEngine::CFBPolicy>(text, length, key, iv, encrypt); //process with CFB policy
+		else if (mode == "OFB") //if mode is OFB
+			AESModeEngine::Process<Backend, AESModeEngine::OFBPolicy>(text, length, key, iv, encrypt); //process with OFB policy
+		else //else mode is CTR
+			AESModeEngine::Process<Backend, AESModeEngine::CTRPolicy>(text, length, key, iv, encrypt); //process with CTR policy
+	}
+
+	/**
+	 * @brief  Function that returns the name of given path for reports.
+	 * @param  Path path
+	 * @return  string name
+	 */
+	static string PathName(const Path path);
+
+	/**
+	 * @brief  Function that compares given buffers, counts the check and adds a failure with given name to given report if they differ.
+	 * @param  Report report
+	 * @param  string name
+	 * @param  const unsigned char* expected
+	 * @param  const unsigned char* actual
+	 * @param  size_t length
+	 * @return  bool matches
+	 */
+	static bool Compare(Report& report, const string& name, const unsigned char* expected, const unsigned char* actual, const size_t length);
+};
+#endif
@@ -1,41 +1,415 @@
-#include "AES.h"
+#include "AESPipeline.h"
+#include "AESTuner.h"
+#include "AESClient.h"
+#include "AESVerify.h"
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <csignal>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define AES_CLI_MMAP
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 
-int main() {
+/**
+ * @brief  Represents the command line options of the AES tool.
+ */
+struct Options {
+    bool encrypt = true; //true for encryption, false for decryption
+    string mode; //operation mode, one of ECB, CBC, CFB, OFB and CTR
+    vector<unsigned char> key; //AES key
+    vector<unsigned char> iv; //initialization vector, unused in ECB mode
+    string input = "-"; //input file path, "-" for standard input
+    string output = "-"; //output file path, "-" for standard output
+    size_t threads = 0; //number of threads, zero for number of hardware threads
+    size_t queueDepth = 4; //number of chunks in flight in the pipeline
+    size_t chunkSize = 1024 * 1024; //size of pipeline chunks in bytes
+    string tuneCache; //tuner cache file path, "-" for default path, empty if autotuning is disabled
+};
+
+
+/**
+ * @brief  Function that prints the usage of the AES tool.
+ */
+void PrintUsage() {
+    cerr << "Usage: AES <encrypt|decrypt> -m <ecb|cbc|cfb|ofb|ctr> -k <hex key> [-v <hex iv>] [-i <input>] [-o <output>] [-t <threads>] [-q <queue depth>] [-c <chunk size>] [-a <tuner cache>]" << endl;
+    cerr << "  -m  operation mode, ECB and CBC use PKCS7 padding" << endl;
+    cerr << "  -k  AES-128, AES-192 or AES-256 key in hex" << endl;
+    cerr << "  -v  16 byte initialization vector in hex, required for all modes except ECB" << endl;
+    cerr << "  -i  input file, standard input if omitted or \"-\"" << endl;
+    cerr << "  -o  output file, standard output if omitted or \"-\"" << endl;
+    cerr << "  -t  number of threads, number of hardware threads if omitted" << endl;
+    cerr << "  -q  number of chunks in flight when input or output isn't a regular file, 4 if omitted" << endl;
+    cerr << "  -c  chunk size in bytes when input or output isn't a regular file, 1048576 if omitted" << endl;
+    cerr << "  -a  autotune parallel settings, cached in given file or in the default cache file if \"-\", -t overrides the tuned thread count" << endl;
+    cerr << "Usage: AES benchmark" << endl;
+    cerr << "  prints p50 and p99 latency in nanoseconds per call of CTR and CBC encryption for small messages" << endl;
+    cerr << "Usage: AES verify [-n <cases>] [-r <rounds>] [-s <seed>]" << endl;
+    cerr << "  checks every path of the library against the reference with known answers, Monte Carlo rounds and random cases" << endl;
+    cerr << "  -n  number of random differential cases, 1000 if omitted" << endl;
+    cerr << "  -r  number of AESAVS Monte Carlo rounds, 100 if omitted" << endl;
+    cerr << "  -s  seed of random cases, 1 if omitted" << endl;
+#ifdef AES_DAEMON
+    cerr << "Usage: AES daemon <socket> [-w <batch window>] [-t <threads>]" << endl;
+    cerr << "  serves encryption requests of local processes on given Unix domain socket until interrupted" << endl;
+    cerr << "  -w  microseconds to wait for more requests before processing a batch, 0 if omitted" << endl;
+    cerr << "Usage: AES loadgen <socket> [-m <ecb|cbc|cfb|ofb|ctr>] [-c <clients>] [-n <requests>] [-s <size>]" << endl;
+    cerr << "  measures throughput and latency of a running daemon, clients share one AES-128 key" << endl;
+    cerr << "  -m  operation mode, CTR if omitted" << endl;
+    cerr << "  -c  number of concurrent clients, 4 if omitted" << endl;
+    cerr << "  -n  number of requests per client, 10000 if omitted" << endl;
+    cerr << "  -s  payload size in bytes, 256 if omitted" << endl;
+#endif
+}
+
+
+/**
+ * @brief  Function that parses the command line arguments of the AES tool.
+ * @param  int argc
+ * @param  char* argv[]
+ * @return  Options options
+ * @throws  invalid_argument thrown if given arguments are invalid.
+ */
+Options ParseArguments(int argc, char* argv[]) {
+    Options options; //represents parsed options
+    if (argc < 2) //if operation is missing
+        throw invalid_argument("Missing operation, please provide encrypt or decrypt."); //throw invalid argument
+    string operation = argv[1]; //get operation
+    if (operation != "encrypt" && operation != "decrypt") //if operation is invalid
+        throw invalid_argument("Invalid operation, please provide encrypt or decrypt."); //throw invalid argument
+    options.encrypt = operation == "encrypt"; //set operation
+    for (int i = 2; i < argc; i += 2) { //iterate over option pairs
+        string option = argv[i]; //get option name
+        if (i + 1 >= argc) //if option value is missing
+            throw invalid_argument("Missing value for option " + option + "."); //throw invalid argument
+        string value = argv[i + 1]; //get option value
+        if (option == "-m") { //if option is mode
+            for (char& c : value) c = (char)toupper((unsigned char)c); //convert mode to upper case
+            if (value != "ECB" && value != "CBC" && value != "CFB" && value != "OFB" && value != "CTR") //if mode is invalid
+                throw invalid_argument("Invalid mode, please provide ecb, cbc, cfb, ofb or ctr."); //throw invalid argument
+            options.mode = value; //set mode
+        }
+        else if (option == "-k") //if option is key
+            options.key = AES::HexToVector(value); //convert key from hex
+        else if (option == "-v") //if option is IV
+            options.iv = AES::HexToVector(value); //convert IV from hex
+        else if (option == "-i") //if option is input
+            options.input = value; //set input path
+        else if (option == "-o") //if option is output
+            options.output = value; //set output path
+        else if (option == "-t") //if option is threads
+            options.threads = (size_t)stoul(value); //set number of threads
+        else if (option == "-q") //if option is queue depth
+            options.queueDepth = (size_t)stoul(value); //set queue depth
+        else if (option == "-c") //if option is chunk size
+            options.chunkSize = (size_t)stoul(value); //set chunk size
+        else if (option == "-a") //if option is autotune
+            options.tuneCache = value; //set tuner cache path
+        else //else option is unknown
+            throw invalid_argument("Unknown option " + option + "."); //throw invalid argument
+    }
+    if (options.mode.empty()) //if mode is missing
+        throw invalid_argument("Missing mode, please provide -m option."); //throw invalid argument
+    if (options.key.size() != 16 && options.key.size() != 24 && options.key.size() != 32) //if key size is invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid key that matches AES requirements."); //throw invalid argument
+    if (options.mode != "ECB" && options.iv.size() != 16) //if IV is missing or invalid
+        throw invalid_argument("Invalid mode of operation, please provide valid initialization vector that matches AES " + options.mode + " requirements."); //throw invalid argument
+    return options; //return parsed options
+}
+
+
+/**
+ * @brief  Function that measures the latency of CTR and CBC encryption calls for small messages and prints p50 and p99 in nanoseconds.
+ * @brief  All sizes run on the mode engine with the key expanded on the stack, 1024 byte messages are included for comparison.
+ */
+void RunBenchmark() {
+    const size_t iterations = 20000; //number of measured calls for each mode and size
+    const size_t sizes[] = { 16, 64, 256, 1024 }; //message sizes in bytes
+    vector<unsigned char> key = AES::Create_Vector(16), iv = AES::Create_Vector(16); //AES-128 key and IV
+    vector<double> samples(iterations); //represents latency of each call in nanoseconds
+    printf("mode  bytes  p50 ns  p99 ns\n"); //print header
+    for (const string mode : { "CTR", "CBC" }) { //iterate over modes
+        for (size_t size : sizes) { //iterate over message sizes
+            vector<unsigned char> message = AES::Create_Vector(size), text; //represents message and text we encrypt
+            for (size_t i = 0; i < iterations + iterations / 10; i++) { //iterate over calls, first tenth warms up caches
+                text = message; //copy message outside the measurement, CBC adds padding to text
+                text.reserve(size + 16); //reserve padding so measurement doesn't include reallocation
+                chrono::steady_clock::time_point start = chrono::steady_clock::now(); //start measurement
+                mode == "CTR" ? AES::Encrypt_CTR(text, key, iv) : AES::Encrypt_CBC(text, key, iv); //encrypt message
+                chrono::steady_clock::time_point end = chrono::steady_clock::now(); //end measurement
+                if (i >= iterations / 10) //if warm up is over we keep the sample
+                    samples[i - iterations / 10] = chrono::duration<double, nano>(end - start).count(); //save latency
+            }
+            sort(samples.begin(), samples.end()); //sort samples for percentiles
+            printf("%-4s  %5zu  %6.0f  %6.0f\n", mode.c_str(), size, samples[iterations / 2], samples[iterations * 99 / 100]); //print percentiles
+        }
+    }
+}
+
+
+/**
+ * @brief  Function that verifies every path of the library against the reference and prints the failures, returns if all checks passed.
+ * @param  int argc
+ * @param  char* argv[]
+ * @return  bool isPassed
+ * @throws  invalid_argument thrown if given arguments are invalid.
+ */
+bool RunVerify(int argc, char* argv[]) {
+    size_t cases = 1000, rounds = 100; //represents number of random cases and Monte Carlo rounds
+    uint64_t seed = 1; //represents seed of random cases
+    for (int i = 2; i < argc; i += 2) { //iterate over option pairs
+        string option = argv[i]; //get option name
+        if (option != "-n" && option != "-r" && option != "-s") //if option is unknown
+            throw invalid_argument("Unknown option " + option + "."); //throw invalid argument
+        if (i + 1 >= argc) //if option value is missing
+            throw invalid_argument("Missing value for option " + option + "."); //throw invalid argument
+        if (option == "-n") cases = stoul(argv[i + 1]); //set number of random cases
+        else if (option == "-r") rounds = stoul(argv[i + 1]); //set number of Monte Carlo rounds
+        else seed = stoull(argv[i + 1]); //set seed
+    }
+    auto start = chrono::steady_clock::now(); //represents start of verification
+    AESVerify::Report report = AESVerify::Run(cases, rounds, seed); //verify every path
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count(); //represents duration of verification
+    for (const string& failure : report.failures) //iterate over failures
+        cerr << failure << endl; //print failure
+    printf("%zu checks, %zu failures in %.1f s\n", report.checks, report.failures.size(), seconds); //print summary
+    return report.failures.empty(); //return if all checks passed
+}
+
+
+#ifdef AES_DAEMON
+static AESDaemon* runningDaemon = NULL; //daemon stopped by signal handler
+
+
+/**
+ * @brief  Function that stops the running daemon when the process is interrupted.
+ * @param  int signal
+ */
+void StopDaemon(int signal) {
+    (void)signal; //both signals stop the daemon
+    if (runningDaemon != NULL) runningDaemon->Stop(); //stop daemon, Stop is async-signal-safe
+}
+
+
+/**
+ * @brief  Function that parses option pairs of the daemon and load generator commands into given map.
+ * @param  int argc
+ * @param  char* argv[]
+ * @param  map<string, string> options
+ * @throws  invalid_argument thrown if given arguments are invalid.
+ */
+void ParsePairs(int argc, char* argv[], map<string, string>& options) {
+    if (argc < 3) //if socket path is missing
+        throw invalid_argument("Missing socket path, please provide path of daemon socket."); //throw invalid argument
+    for (int i = 3; i < argc; i += 2) { //iterate over option pairs
+        string option = argv[i]; //get option name
+        if (options.find(option) == options.end()) //if option is unknown
+            throw invalid_argument("Unknown option " + option + "."); //throw invalid argument
+        if (i + 1 >= argc) //if option value is missing
+            throw invalid_argument("Missing value for option " + option + "."); //throw invalid argument
+        options[option] = argv[i + 1]; //set option value
+    }
+}
+
+
+/**
+ * @brief  Function that runs the encryption daemon on given socket until the process is interrupted.
+ * @param  int argc
+ * @param  char* argv[]
+ * @throws  invalid_argument thrown if given arguments are invalid.
+ * @throws  runtime_error thrown if the daemon fails.
+ */
+void RunDaemon(int argc, char* argv[]) {
+    map<string, string> options = { { "-w", "0" }, { "-t", "0" } }; //represents options with defaults
+    ParsePairs(argc, argv, options); //parse options
+    AESParallel::SetThreadCount(stoul(options["-t"])); //set number of threads for large batches
+    AESDaemon daemon(argv[2]); //create daemon
+    daemon.SetBatchWindow(stoul(options["-w"])); //set batch window
+    runningDaemon = &daemon; //let signal handler stop daemon
+    signal(SIGINT, StopDaemon); //stop on interrupt
+    signal(SIGTERM, StopDaemon); //stop on termination
+    signal(SIGPIPE, SIG_IGN); //disconnected clients shouldn't kill the daemon
+    cerr << "Serving on " << argv[2] << endl; //report socket
+    daemon.Run(); //serve clients until stopped
+    runningDaemon = NULL; //daemon is about to be destroyed
+    size_t requests = daemon.GetRequestCount(), batches = daemon.GetBatchCount(); //represents statistics
+    cerr << "Served " << requests << " requests in " << batches << " batches" << endl; //report statistics
+}
+
+
+/**
+ * @brief  Function that measures throughput and latency of a running daemon with concurrent clients.
+ * @param  int argc
+ * @param  char* argv[]
+ * @throws  invalid_argument thrown if given arguments are invalid.
+ * @throws  runtime_error thrown if the daemon can't be reached.
+ */
+void RunLoadGenerator(int argc, char* argv[]) {
+    map<string, string> options = { { "-m", "ctr" }, { "-c", "4" }, { "-n", "10000" }, { "-s", "256" } }; //represents options with defaults
+    ParsePairs(argc, argv, options); //parse options
+    string mode = options["-m"]; //get mode
+    transform(mode.begin(), mode.end(), mode.begin(), ::toupper); //convert mode to uppercase
+    size_t clients = stoul(options["-c"]), requests = stoul(options["-n"]), size = stoul(options["-s"]); //get clients, requests and payload size
+    if (clients == 0 || requests == 0 || size == 0) //if load is empty
+        throw invalid_argument("Invalid load, please provide clients, requests and size larger than zero."); //throw invalid argument
+    string path = argv[2]; //represents socket path
+    vector<unsigned char> key = AES::Create_Vector(16); //AES-128 key shared by all clients so their requests are coalesced
+    vector<vector<double>> samples(clients, vector<double>(requests)); //represents latency of each request in microseconds
+    vector<size_t> batched(clients, 0); //represents sum of batch sizes of each client
+    vector<string> errors(clients); //represents error of each client
+    vector<thread> threads; //represents client threads
+    chrono::steady_clock::time_point start = chrono::steady_clock::now(); //start measurement
+    for (size_t c = 0; c < clients; c++) //iterate over clients
+        threads.emplace_back([&, c] { //run each client on its own thread, like separate processes
+            try {
+                AESClient client(path, size); //connect to daemon
+                uint32_t keyId = client.RegisterKey(key); //register shared key
+                unsigned char iv[16] = {}; //represents IV or counter of client
+                for (size_t i = 0; i < requests; i++) { //iterate over requests
+                    chrono::steady_clock::time_point begin = chrono::steady_clock::now(); //start request measurement
+                    client.Encrypt(mode, keyId, 0, size, iv); //encrypt payload in shared buffer
+                    samples[c][i] = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count(); //save latency
+                    batched[c] += client.GetLastBatchSize(); //add batch size
+                }
+            }
+            catch (const exception& e) { //if client failed we report it after joining
+                errors[c] = e.what(); //save error
+            }
+        });
+    for (thread& clientThread : threads) //iterate over client threads
+        clientThread.join(); //wait for client
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count(); //represents elapsed time
+    for (const string& error : errors) //iterate over client errors
+        if (!error.empty()) throw runtime_error(error); //report first error
+    vector<double> all; //represents latency of all requests
+    size_t batchTotal = 0; //represents sum of batch sizes
+    for (size_t c = 0; c < clients; c++) { //iterate over clients
+        all.insert(all.end(), samples[c].begin(), samples[c].end()); //add latencies of client
+        batchTotal += batched[c]; //add batch sizes of client
+    }
+    sort(all.begin(), all.end()); //sort samples for percentiles
+    double total = (double)(clients * requests); //represents number of requests
+    printf("mode %s  clients %zu  size %zu  requests %.0f\n", mode.c_str(), clients, size, total); //print load
+    printf("throughput %.0f requests/s  %.1f MB/s\n", total / seconds, total * size / seconds / 1e6); //print throughput
+    printf("latency p50 %.1f us  p99 %.1f us\n", all[all.size() / 2], all[all.size() * 99 / 100]); //print latency percentiles
+    printf("average batch %.2f requests\n", batchTotal / total); //print average batch size seen by requests
+}
+#endif
+
+
+#ifdef AES_CLI_MMAP
+/**
+ * @brief  Function that processes a memory-mapped input file directly into a memory-mapped output file without staging copies.
+ * @param  AESStream stream
+ * @param  const unsigned char* input
+ * @param  size_t inputSize
+ * @param  int outFd
+ * @throws  runtime_error thrown if output can't be mapped.
+ */
+void RunMapped(AESStream& stream, const unsigned char* input, const size_t inputSize, const int outFd) {
+    size_t outputSize = stream.IsEncrypt() && stream.IsPadded() ? inputSize + 16 - (inputSize % 16) : inputSize; //calculate output size with PKCS7 padding, a full block if input is a multiple of 16 bytes
+    if (ftruncate(outFd, (off_t)outputSize) != 0) //resize output file
+        throw runtime_error(string("Failed resizing output: ") + strerror(errno)); //throw runtime error
+    void* mapping = mmap(NULL, outputSize, PROT_READ | PROT_WRITE, MAP_SHARED, outFd, 0); //map output file
+    if (mapping == MAP_FAILED) //if mapping failed
+        throw runtime_error(string("Failed mapping output: ") + strerror(errno)); //throw runtime error
+    unsigned char* output = (unsigned char*)mapping; //represents output mapping
+    madvise(mapping, outputSize, MADV_SEQUENTIAL); //tell the kernel we write output sequentially
+    size_t finalSize = 0; //represents output size after adding or removing padding
     try {
-        ///test key schedule///
-        //vector<unsigned char> key1(16, 0x00);
-        //AES::SetOperationMode(key1.size());
-        //vector<vector<unsigned char>> keys = AES::KeySchedule(key1);
-        //cout << "Round Keys:" << endl;
-        //for (const vector<unsigned char>& key : keys)
-        //    cout << AES::VectorToHex(key) << endl;
-        //cout << endl;
-
-        ///test AES encryption and decryption///
-        string plaintext = "TheKingOfNewYork";
-        vector<unsigned char> plaintextVec(plaintext.begin(), plaintext.end());
-        vector<unsigned char> keyVec = AES::Create_Key(128);
-        vector<unsigned char> ivVec = AES::Create_IV(8);
-        cout << "Plain Text:" << endl;
-        cout << AES::VectorToHex(plaintextVec) << endl;
-        cout << "Cipher Text:" << endl;
-        //plaintextVec = AES::Encrypt_ECB(plaintextVec, keyVec);
-        //plaintextVec = AES::Encrypt_CBC(plaintextVec, keyVec, ivVec);
-        //plaintextVec = AES::Encrypt_CFB(plaintextVec, keyVec, ivVec);
-        //plaintextVec = AES::Encrypt_OFB(plaintextVec, keyVec, ivVec);
-        plaintextVec = AES::Encrypt_CTR(plaintextVec, keyVec, ivVec);
-        cout << AES::VectorToHex(plaintextVec) << endl;
-        cout << "Original Text:" << endl;
-        //plaintextVec = AES::Decrypt_ECB(plaintextVec, keyVec);
-        //plaintextVec = AES::Decrypt_CBC(plaintextVec, keyVec, ivVec);
-        //plaintextVec = AES::Decrypt_CFB(plaintextVec, keyVec, ivVec);
-        //plaintextVec = AES::Decrypt_OFB(plaintextVec, keyVec, ivVec);
-        plaintextVec = AES::Decrypt_CTR(plaintextVec, keyVec, ivVec);
-        cout << AES::VectorToHex(plaintextVec) << endl;
-        AES::PrintVector(plaintextVec);
+        finalSize = stream.Update(input, output, inputSize); //process input, decryption holds back the last block
+        finalSize += stream.Final(output + finalSize); //process last block with padding
+    }
+    catch (...) { //if processing failed we unmap output before rethrowing
+        munmap(mapping, outputSize); //unmap output
+        int truncated = ftruncate(outFd, 0); //don't leave a partially processed output, such as plaintext of a ciphertext with invalid padding
+        (void)truncated; //original exception matters more than a failed truncation
+        throw; //rethrow exception
+    }
+    munmap(mapping, outputSize); //unmap output, kernel writes it back to the file
+    if (finalSize != outputSize && ftruncate(outFd, (off_t)finalSize) != 0) //remove padding from output file
+        throw runtime_error(string("Failed resizing output: ") + strerror(errno)); //throw runtime error
+}
+#endif
+
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc == 2 && string(argv[1]) == "benchmark") { //if latency benchmark is requested we run it instead of encryption
+            RunBenchmark(); //measure and print latency
+            return 0;
+        }
+        if (argc >= 2 && string(argv[1]) == "verify") //if verification is requested we check every path against the reference
+            return RunVerify(argc, argv) ? 0 : 1; //verify and fail if any path differs
+#ifdef AES_DAEMON
+        if (argc >= 2 && string(argv[1]) == "daemon") { //if daemon is requested we serve local processes instead of encryption
+            RunDaemon(argc, argv); //serve until interrupted
+            return 0;
+        }
+        if (argc >= 2 && string(argv[1]) == "loadgen") { //if load generator is requested we measure a running daemon
+            RunLoadGenerator(argc, argv); //measure and print throughput and latency
+            return 0;
+        }
+#endif
+        Options options = ParseArguments(argc, argv); //parse command line arguments
+        if (!options.tuneCache.empty()) //if autotuning is requested we load or measure the settings of this machine
+            AESTuner::Autotune(options.tuneCache == "-" ? "" : options.tuneCache); //apply tuned settings
+        if (options.tuneCache.empty() || options.threads != 0) //if not tuned or thread count is given explicitly
+            AESParallel::SetThreadCount(options.threads); //set number of threads for parallel modes
+#if defined(_WIN32)
+        _setmode(0, O_BINARY); //set standard input to binary mode
+        _setmode(1, O_BINARY); //set standard output to binary mode
+#endif
+        int inFd = options.input == "-" ? 0 : open(options.input.c_str(), O_RDONLY | O_BINARY); //open input file
+        if (inFd < 0) //if input can't be opened
+            throw runtime_error("Failed opening input " + options.input + ": " + strerror(errno)); //throw runtime error
+        int outFd = options.output == "-" ? 1 : open(options.output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0644); //open output file
+        if (outFd < 0) //if output can't be opened
+            throw runtime_error("Failed opening output " + options.output + ": " + strerror(errno)); //throw runtime error
+        AESStream stream(options.mode, options.encrypt, options.key, options.iv.empty() ? NULL : options.iv.data(), AESStream::PKCS7Padding); //represents streaming mode state, files always round-trip with PKCS7 padding
+        bool isMapped = false; //represents if input was processed mapping to mapping
+#ifdef AES_CLI_MMAP
+        struct stat inStat{}, outStat{}; //represents input and output file status
+        fstat(inFd, &inStat); //get input status
+        fstat(outFd, &outStat); //get output status
+        bool mappable = S_ISREG(outStat.st_mode) && (fcntl(outFd, F_GETFL) & O_ACCMODE) == O_RDWR; //output can be mapped if it's a regular file opened for reading and writing
+        if (S_ISREG(inStat.st_mode) && inStat.st_size > 0 && mappable) { //if both input and output are regular files we process mapping to mapping
+            size_t mappedSize = (size_t)inStat.st_size; //set mapping size to file size
+            void* mapping = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, inFd, 0); //map input file
+            if (mapping == MAP_FAILED) //if mapping failed
+                throw runtime_error(string("Failed mapping input: ") + strerror(errno)); //throw runtime error
+            madvise(mapping, mappedSize, MADV_SEQUENTIAL); //tell the kernel we read input sequentially
+            RunMapped(stream, (const unsigned char*)mapping, mappedSize, outFd); //process input mapping into output mapping
+            munmap(mapping, mappedSize); //unmap input
+            isMapped = true; //mark input as processed
+        }
+#endif
+        if (!isMapped) //if input or output is a pipe or terminal we overlap reading, processing and writing
+            AESPipeline::Process(inFd, outFd, stream, options.queueDepth, options.chunkSize); //process input in chunks
+        if (inFd != 0) close(inFd); //close input file
+        if (outFd != 1) close(outFd); //close output file
     }
     catch (const invalid_argument& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+    catch (const exception& e) {
         cerr << e.what() << endl;
         return 1;
     }